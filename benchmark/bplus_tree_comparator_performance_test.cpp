@@ -0,0 +1,132 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <benchmark/benchmark.h>
+
+#include "common/lang/lower_bound.h"
+#include "common/lang/random.h"
+#include "storage/index/bplus_tree.h"
+
+using namespace std;
+using namespace common;
+using namespace benchmark;
+
+/**
+ * @brief B+树节点内二分查找的耗时
+ * @details 模拟一个叶子节点，键值按照 B+树的格式(属性 + RID)有序存放，随机查找节点中的键值。
+ * 第一个参数是属性类型，第二个参数是比较方式：
+ * - 0: 构造 Value 比较，即原来 AttrComparator 的实现；
+ * - 1: 每次比较都按照类型分派(KeyComparator::operator())；
+ * - 2: 使用 KeyComparator::visit 拿到特化的比较器，只分派一次。
+ */
+class BplusTreeComparatorBenchmark : public Fixture
+{
+public:
+  static constexpr int KEY_NUM     = 256;
+  static constexpr int CHAR_LENGTH = 16;
+
+  void SetUp(const State &state) override
+  {
+    attr_type_   = static_cast<AttrType>(state.range(0));
+    attr_length_ = attr_type_ == AttrType::CHARS ? CHAR_LENGTH : 4;
+    key_length_  = attr_length_ + static_cast<int>(sizeof(RID));
+    comparator_.init(attr_type_, attr_length_);
+
+    // 键值 i 的属性值随 i 递增，RID 都相同
+    keys_.assign(static_cast<size_t>(KEY_NUM) * key_length_, 0);
+    for (int i = 0; i < KEY_NUM; i++) {
+      char *key = keys_.data() + static_cast<size_t>(i) * key_length_;
+      switch (attr_type_) {
+        case AttrType::INTS: {
+          int32_t value = i * 2;
+          memcpy(key, &value, sizeof(value));
+        } break;
+        case AttrType::FLOATS: {
+          float value = i * 2.0f;
+          memcpy(key, &value, sizeof(value));
+        } break;
+        default: {
+          snprintf(key, attr_length_, "key_%08d", i * 2);
+        } break;
+      }
+      RID rid(1, 1);
+      memcpy(key + attr_length_, &rid, sizeof(rid));
+    }
+
+    random_device rd;
+    mt19937       gen(rd());
+    uniform_int_distribution<int> dist(0, KEY_NUM - 1);
+    probes_.resize(1024);
+    for (int &probe : probes_) {
+      probe = dist(gen);
+    }
+  }
+
+  const char *key_at(int index) const { return keys_.data() + static_cast<size_t>(index) * key_length_; }
+
+  template <typename Comparator>
+  int lookup(const char *key, const Comparator &comparator) const
+  {
+    BinaryIterator<char> iter_begin(key_length_, const_cast<char *>(key_at(0)));
+    BinaryIterator<char> iter_end(key_length_, const_cast<char *>(key_at(KEY_NUM)));
+    bool                 found = false;
+    BinaryIterator<char> iter  = common::lower_bound(iter_begin, iter_end, key, comparator, &found);
+    return found ? static_cast<int>(iter - iter_begin) : -1;
+  }
+
+  int lookup(const char *key, int mode) const
+  {
+    switch (mode) {
+      case 0: {
+        KeyComparatorT<GenericAttrComparator> comparator(GenericAttrComparator(attr_type_, attr_length_));
+        return lookup(key, comparator);
+      }
+      case 1: {
+        return lookup(key, comparator_);
+      }
+      default: {
+        return comparator_.visit([this, key](const auto &comparator) { return lookup(key, comparator); });
+      }
+    }
+  }
+
+protected:
+  AttrType      attr_type_   = AttrType::UNDEFINED;
+  int           attr_length_ = 0;
+  int           key_length_  = 0;
+  KeyComparator comparator_;
+  vector<char>  keys_;
+  vector<int>   probes_;
+};
+
+BENCHMARK_DEFINE_F(BplusTreeComparatorBenchmark, Lookup)(State &state)
+{
+  const int mode  = static_cast<int>(state.range(1));
+  size_t    probe = 0;
+  for (auto _ : state) {
+    const int index = probes_[probe++ % probes_.size()];
+    int       pos   = lookup(key_at(index), mode);
+    if (pos != index) {
+      state.SkipWithError("lookup result mismatch");
+      return;
+    }
+    DoNotOptimize(pos);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_REGISTER_F(BplusTreeComparatorBenchmark, Lookup)
+    ->ArgNames({"type", "mode"})
+    ->ArgsProduct({{static_cast<int64_t>(AttrType::INTS),
+                       static_cast<int64_t>(AttrType::FLOATS),
+                       static_cast<int64_t>(AttrType::CHARS)},
+        {0, 1, 2}});
+
+BENCHMARK_MAIN();
@@ -40,6 +40,9 @@ struct Stat
   int64_t scan_open_failed_count = 0;
   int64_t mismatch_count         = 0;
   int64_t scan_other_count       = 0;
+
+  int64_t get_success_count   = 0;
+  int64_t get_not_exist_count = 0;
 };
 
 class BenchmarkBase : public Fixture
@@ -180,6 +183,19 @@ public:
     }
   }
 
+  void Get(uint32_t value, Stat &stat)
+  {
+    const char *key = reinterpret_cast<const char *>(&value);
+    list<RID>   rids;
+
+    RC rc = handler_.get_entry(key, sizeof(value), rids);
+    if (rc == RC::SUCCESS && !rids.empty()) {
+      stat.get_success_count++;
+    } else {
+      stat.get_not_exist_count++;
+    }
+  }
+
 protected:
   BufferPoolManager bpm_{512};
   BplusTreeHandler  handler_;
@@ -294,6 +310,48 @@ BENCHMARK_REGISTER_F(ScanBenchmark, Scan)->Threads(10)->Arg(4 * 10000);
 
 ////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * @brief 所有页面都在内存中时的点查询
+ * @details 每次查询都会从根节点到叶子节点访问若干个页面，而且都会命中buffer pool，
+ * 用来观察页帧管理器随着线程数增加的扩展性
+ */
+class PageHitBenchmark : public BenchmarkBase
+{
+public:
+  string Name() const override { return "page_hit"; }
+
+  void SetUp(const State &state) override
+  {
+    if (0 != state.thread_index()) {
+      return;
+    }
+
+    BenchmarkBase::SetUp(state);
+
+    uint32_t max = GetRangeMax(state);
+    ASSERT(max > 0, "invalid argument count. %ld", state.range(0));
+    FillUp(0, max);
+  }
+};
+
+BENCHMARK_DEFINE_F(PageHitBenchmark, PageHit)(State &state)
+{
+  IntegerGenerator generator(0, GetRangeMax(state) - 1);
+  Stat             stat;
+
+  for (auto _ : state) {
+    uint32_t value = static_cast<uint32_t>(generator.next());
+    Get(value, stat);
+  }
+
+  state.counters["success"]   = Counter(stat.get_success_count, Counter::kIsRate);
+  state.counters["not_exist"] = Counter(stat.get_not_exist_count, Counter::kIsRate);
+}
+
+BENCHMARK_REGISTER_F(PageHitBenchmark, PageHit)->ThreadRange(1, 32)->Arg(2000)->UseRealTime();
+
+////////////////////////////////////////////////////////////////////////////////
+
 struct MixtureBenchmark : public BenchmarkBase
 {
   string Name() const override { return "mixture"; }
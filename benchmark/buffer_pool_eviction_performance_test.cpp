@@ -0,0 +1,129 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <benchmark/benchmark.h>
+
+#include "common/lang/stdexcept.h"
+#include "common/log/log.h"
+#include "common/math/integer_generator.h"
+#include "storage/buffer/disk_buffer_pool.h"
+#include "storage/buffer/double_write_buffer.h"
+#include "storage/clog/vacuous_log_handler.h"
+
+using namespace std;
+using namespace common;
+using namespace benchmark;
+
+/**
+ * @brief 点查询与全表扫描混合时不同淘汰策略的命中率
+ * @details 一个全表扫描不停地顺序访问整个文件，同时在一小部分热点页面上做随机的点查询，
+ * 每次点查询之后，扫描前进 SCAN_PAGES_PER_LOOKUP 个页面。
+ * 热点页面的个数小于页帧个数，但是文件的页面个数远大于页帧个数。
+ * 这里使用一个线程交替执行扫描和点查询，这样可以精确地统计点查询的命中率。
+ * 参数是淘汰策略的下标，参考 POLICIES。
+ */
+class EvictionBenchmark : public Fixture
+{
+public:
+  static constexpr const char *POLICIES[] = {"lru", "2q"};
+
+  static constexpr int MEMORY_PAGE_NUM       = 256;
+  static constexpr int FILE_PAGE_NUM         = 4096;
+  static constexpr int HOT_PAGE_NUM          = 160;
+  static constexpr int SCAN_PAGES_PER_LOOKUP = 1;
+
+  void SetUp(const State &state) override
+  {
+    LoggerFactory::init_default("eviction.log", LOG_LEVEL_WARN);
+
+    const char *policy = POLICIES[state.range(0)];
+    bpm_ = make_unique<BufferPoolManager>(MEMORY_PAGE_NUM * BP_PAGE_SIZE, 0 /*partition_num*/, policy);
+    bpm_->init(make_unique<VacuousDoubleWriteBuffer>());
+
+    ::remove(filename_);
+    RC rc = bpm_->create_file(filename_);
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to create buffer pool file");
+    }
+
+    rc = bpm_->open_file(log_handler_, filename_, buffer_pool_);
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to open buffer pool file");
+    }
+
+    for (int i = 1; i < FILE_PAGE_NUM; i++) {
+      Frame *frame = nullptr;
+      rc           = buffer_pool_->allocate_page(&frame);
+      if (OB_FAIL(rc)) {
+        throw runtime_error("failed to allocate page");
+      }
+      frame->mark_dirty();
+      buffer_pool_->unpin_page(frame);
+    }
+  }
+
+  void TearDown(const State &state) override
+  {
+    buffer_pool_->close_file();
+    buffer_pool_ = nullptr;
+    bpm_.reset();
+    ::remove(filename_);
+  }
+
+  /// @return 页面是否已经在内存中
+  bool Access(PageNum page_num)
+  {
+    BPFrameManager &frame_manager = bpm_->get_frame_manager();
+    int64_t         hit_count     = frame_manager.hit_count();
+
+    Frame *frame = nullptr;
+    RC     rc    = buffer_pool_->get_this_page(page_num, &frame);
+    if (OB_SUCC(rc)) {
+      buffer_pool_->unpin_page(frame);
+    }
+    return frame_manager.hit_count() > hit_count;
+  }
+
+protected:
+  const char                   *filename_ = "eviction.bp";
+  unique_ptr<BufferPoolManager> bpm_;
+  DiskBufferPool               *buffer_pool_ = nullptr;
+  VacuousLogHandler             log_handler_;
+};
+
+BENCHMARK_DEFINE_F(EvictionBenchmark, PointLookupWithScan)(State &state)
+{
+  IntegerGenerator generator(1, HOT_PAGE_NUM);
+  PageNum          scan_page_num = 1;
+
+  int64_t lookup_count = 0;
+  int64_t lookup_hit   = 0;
+  int64_t scan_count   = 0;
+  int64_t scan_hit     = 0;
+
+  for (auto _ : state) {
+    lookup_count++;
+    lookup_hit += Access(static_cast<PageNum>(generator.next())) ? 1 : 0;
+
+    for (int i = 0; i < SCAN_PAGES_PER_LOOKUP; i++) {
+      scan_count++;
+      scan_hit += Access(scan_page_num) ? 1 : 0;
+      scan_page_num = scan_page_num + 1 >= FILE_PAGE_NUM ? 1 : scan_page_num + 1;
+    }
+  }
+
+  state.SetLabel(POLICIES[state.range(0)]);
+  state.counters["lookup_hit_ratio"] = static_cast<double>(lookup_hit) / max(lookup_count, int64_t(1));
+  state.counters["hit_ratio"] = static_cast<double>(lookup_hit + scan_hit) / max(lookup_count + scan_count, int64_t(1));
+}
+
+BENCHMARK_REGISTER_F(EvictionBenchmark, PointLookupWithScan)->DenseRange(0, 1);
+
+BENCHMARK_MAIN();
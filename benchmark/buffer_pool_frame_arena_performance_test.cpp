@@ -0,0 +1,110 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <benchmark/benchmark.h>
+
+#include "common/lang/stdexcept.h"
+#include "common/log/log.h"
+#include "common/math/integer_generator.h"
+#include "storage/buffer/disk_buffer_pool.h"
+#include "storage/buffer/double_write_buffer.h"
+#include "storage/clog/vacuous_log_handler.h"
+
+using namespace std;
+using namespace common;
+using namespace benchmark;
+
+/**
+ * @brief 页面都在内存中时随机访问页面的开销
+ * @details 所有的页面都已经加载到内存中，每次随机访问一个页面，并读取页面中随机位置的数据。
+ * 页帧占用的内存远大于TLB能够覆盖的范围，使用大页时TLB缺失和页表遍历(page walk)会明显减少。
+ * 可以使用 perf 观察，比如：
+ * perf stat -e dTLB-loads,dTLB-load-misses,dtlb_load_misses.walk_active ./buffer_pool_frame_arena_performance_test
+ * 参数表示是否使用大页。
+ */
+class FrameArenaBenchmark : public Fixture
+{
+public:
+  static constexpr int MEMORY_PAGE_NUM = 32 * 1024;
+  static constexpr int FILE_PAGE_NUM   = MEMORY_PAGE_NUM - 1024;
+
+  void SetUp(const State &state) override
+  {
+    LoggerFactory::init_default("frame_arena.log", LOG_LEVEL_WARN);
+
+    const bool huge_page = state.range(0) != 0;
+    bpm_ = make_unique<BufferPoolManager>(MEMORY_PAGE_NUM * BP_PAGE_SIZE, 0 /*partition_num*/, "lru", huge_page);
+    bpm_->init(make_unique<VacuousDoubleWriteBuffer>());
+
+    ::remove(filename_);
+    RC rc = bpm_->create_file(filename_);
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to create buffer pool file");
+    }
+
+    rc = bpm_->open_file(log_handler_, filename_, buffer_pool_);
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to open buffer pool file");
+    }
+
+    for (int i = 1; i < FILE_PAGE_NUM; i++) {
+      Frame *frame = nullptr;
+      rc           = buffer_pool_->allocate_page(&frame);
+      if (OB_FAIL(rc)) {
+        throw runtime_error("failed to allocate page");
+      }
+      memset(frame->data(), i & 0xFF, BP_PAGE_DATA_SIZE);
+      frame->mark_dirty();
+      buffer_pool_->unpin_page(frame);
+    }
+  }
+
+  void TearDown(const State &state) override
+  {
+    buffer_pool_->close_file();
+    buffer_pool_ = nullptr;
+    bpm_.reset();
+    ::remove(filename_);
+  }
+
+protected:
+  const char                   *filename_ = "frame_arena.bp";
+  unique_ptr<BufferPoolManager> bpm_;
+  DiskBufferPool               *buffer_pool_ = nullptr;
+  VacuousLogHandler             log_handler_;
+};
+
+BENCHMARK_DEFINE_F(FrameArenaBenchmark, RandomAccess)(State &state)
+{
+  IntegerGenerator page_generator(1, FILE_PAGE_NUM - 1);
+  IntegerGenerator offset_generator(0, BP_PAGE_DATA_SIZE - 1);
+
+  int64_t sum = 0;
+  for (auto _ : state) {
+    Frame *frame = nullptr;
+    RC     rc    = buffer_pool_->get_this_page(static_cast<PageNum>(page_generator.next()), &frame);
+    if (OB_FAIL(rc)) {
+      state.SkipWithError("failed to get page");
+      return;
+    }
+
+    sum += frame->data()[offset_generator.next()];
+    buffer_pool_->unpin_page(frame);
+  }
+  DoNotOptimize(sum);
+
+  const FrameArena &arena = bpm_->get_frame_manager().arena();
+  state.SetLabel(arena.use_hugetlb() ? "hugetlb" : (state.range(0) != 0 ? "thp" : "normal"));
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_REGISTER_F(FrameArenaBenchmark, RandomAccess)->DenseRange(0, 1);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,131 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "common/lang/stdexcept.h"
+#include "common/log/log.h"
+#include "storage/buffer/disk_buffer_pool.h"
+#include "storage/buffer/double_write_buffer.h"
+#include "storage/clog/vacuous_log_handler.h"
+
+using namespace std;
+using namespace common;
+using namespace benchmark;
+
+/**
+ * @brief 冷数据的全表扫描
+ * @details 每次扫描之前，把页面从buffer pool中淘汰掉，并且让操作系统丢弃文件的page cache，
+ * 这样每个页面都需要从磁盘读取。
+ * 第一个参数是预读的页面个数，0表示不预读，每个页面单独读取一次。
+ * 第二个参数是IO引擎的下标，参考 IO_ENGINES。
+ */
+class ColdScanBenchmark : public Fixture
+{
+public:
+  static constexpr const char *IO_ENGINES[] = {"sync", "thread_pool", "io_uring"};
+
+  static constexpr int MEMORY_PAGE_NUM = 1024;
+  static constexpr int FILE_PAGE_NUM   = 8192;
+
+  void SetUp(const State &state) override
+  {
+    LoggerFactory::init_default("cold_scan.log", LOG_LEVEL_WARN);
+
+    bpm_ = make_unique<BufferPoolManager>(MEMORY_PAGE_NUM * BP_PAGE_SIZE);
+    bpm_->set_io_engine(AsyncIoEngine::create(IO_ENGINES[state.range(1)]));
+    bpm_->init(make_unique<VacuousDoubleWriteBuffer>());
+
+    ::remove(filename_);
+    RC rc = bpm_->create_file(filename_);
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to create buffer pool file");
+    }
+
+    rc = bpm_->open_file(log_handler_, filename_, buffer_pool_);
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to open buffer pool file");
+    }
+
+    for (int i = 1; i < FILE_PAGE_NUM; i++) {
+      Frame *frame = nullptr;
+      rc           = buffer_pool_->allocate_page(&frame);
+      if (OB_FAIL(rc)) {
+        throw runtime_error("failed to allocate page");
+      }
+      frame->mark_dirty();
+      buffer_pool_->unpin_page(frame);
+    }
+  }
+
+  void TearDown(const State &state) override
+  {
+    buffer_pool_->close_file();
+    buffer_pool_ = nullptr;
+    bpm_.reset();
+    ::remove(filename_);
+  }
+
+  /// @brief 把所有数据页从内存中淘汰掉，包括操作系统的page cache
+  void DropCache()
+  {
+    for (PageNum page_num = 1; page_num < FILE_PAGE_NUM; page_num++) {
+      buffer_pool_->purge_page(page_num);
+    }
+
+    fsync(buffer_pool_->file_desc());
+    posix_fadvise(buffer_pool_->file_desc(), 0, 0, POSIX_FADV_DONTNEED);
+  }
+
+protected:
+  const char                   *filename_ = "cold_scan.bp";
+  unique_ptr<BufferPoolManager> bpm_;
+  DiskBufferPool               *buffer_pool_ = nullptr;
+  VacuousLogHandler             log_handler_;
+};
+
+BENCHMARK_DEFINE_F(ColdScanBenchmark, Scan)(State &state)
+{
+  const int read_ahead_pages = static_cast<int>(state.range(0));
+
+  int64_t page_count = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    DropCache();
+    state.ResumeTiming();
+
+    BufferPoolIterator iterator;
+    iterator.init(*buffer_pool_, 1);
+    iterator.set_read_ahead(read_ahead_pages);
+    while (iterator.has_next()) {
+      Frame *frame = nullptr;
+      RC     rc    = buffer_pool_->get_this_page(iterator.next(), &frame);
+      if (OB_FAIL(rc)) {
+        state.SkipWithError("failed to get page");
+        return;
+      }
+      buffer_pool_->unpin_page(frame);
+      page_count++;
+    }
+  }
+
+  state.SetLabel(bpm_->io_engine().name());
+  state.SetItemsProcessed(page_count);
+  state.SetBytesProcessed(page_count * BP_PAGE_SIZE);
+}
+
+BENCHMARK_REGISTER_F(ColdScanBenchmark, Scan)
+    ->ArgsProduct({{0, BufferPoolIterator::DEFAULT_READ_AHEAD_PAGES}, {0, 1, 2}})
+    ->Unit(kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
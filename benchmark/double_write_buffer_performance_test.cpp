@@ -0,0 +1,129 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+
+#include "common/lang/algorithm.h"
+#include "common/lang/chrono.h"
+#include "common/lang/stdexcept.h"
+#include "common/log/log.h"
+#include "common/math/integer_generator.h"
+#include "storage/buffer/disk_buffer_pool.h"
+#include "storage/buffer/double_write_buffer.h"
+#include "storage/clog/vacuous_log_handler.h"
+
+using namespace std;
+using namespace common;
+using namespace benchmark;
+
+/**
+ * @brief 持续淘汰脏页时的页面写入吞吐和延迟
+ * @details 内存中的页帧远少于文件中的页面，每次随机修改一个页面，
+ * 加载页面时需要淘汰一个脏页，脏页通过 double write buffer 写入磁盘。
+ * 统计每次访问的耗时，输出 p50/p99/p999 延迟。参数是 double write buffer 每个批次的页面数。
+ */
+class DoubleWriteBufferBenchmark : public Fixture
+{
+public:
+  static constexpr int MEMORY_PAGE_NUM = 256;
+  static constexpr int FILE_PAGE_NUM   = 4096;
+
+  void SetUp(const State &state) override
+  {
+    LoggerFactory::init_default("double_write_buffer.log", LOG_LEVEL_WARN);
+
+    filesystem::remove_all(directory_);
+    filesystem::create_directories(directory_);
+
+    bpm_ = make_unique<BufferPoolManager>(MEMORY_PAGE_NUM * BP_PAGE_SIZE);
+
+    const int max_pages    = static_cast<int>(state.range(0));
+    auto      dblwr_buffer = make_unique<DiskDoubleWriteBuffer>(*bpm_, max_pages);
+    RC        rc           = dblwr_buffer->open_file((directory_ / "dblwr.db").c_str());
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to open double write buffer");
+    }
+    dblwr_buffer_ = dblwr_buffer.get();
+    bpm_->init(std::move(dblwr_buffer));
+
+    const string filename = (directory_ / "dblwr.bp").string();
+    rc                    = bpm_->create_file(filename.c_str());
+    if (OB_SUCC(rc)) {
+      rc = bpm_->open_file(log_handler_, filename.c_str(), buffer_pool_);
+    }
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to open buffer pool file");
+    }
+
+    for (int i = 1; i < FILE_PAGE_NUM; i++) {
+      Frame *frame = nullptr;
+      rc           = buffer_pool_->allocate_page(&frame);
+      if (OB_FAIL(rc)) {
+        throw runtime_error("failed to allocate page");
+      }
+      frame->mark_dirty();
+      buffer_pool_->unpin_page(frame);
+    }
+    dblwr_buffer_->flush_page();
+  }
+
+  void TearDown(const State &state) override
+  {
+    buffer_pool_  = nullptr;
+    dblwr_buffer_ = nullptr;
+    bpm_.reset();
+    filesystem::remove_all(directory_);
+  }
+
+protected:
+  filesystem::path              directory_{"double_write_buffer_benchmark"};
+  unique_ptr<BufferPoolManager> bpm_;
+  DiskBufferPool               *buffer_pool_  = nullptr;
+  DiskDoubleWriteBuffer        *dblwr_buffer_ = nullptr;
+  VacuousLogHandler             log_handler_;
+};
+
+BENCHMARK_DEFINE_F(DoubleWriteBufferBenchmark, DirtyEviction)(State &state)
+{
+  IntegerGenerator page_generator(1, FILE_PAGE_NUM - 1);
+  vector<int64_t>  latencies;
+  latencies.reserve(1024 * 1024);
+
+  for (auto _ : state) {
+    auto begin = chrono::steady_clock::now();
+
+    Frame *frame = nullptr;
+    RC     rc    = buffer_pool_->get_this_page(static_cast<PageNum>(page_generator.next()), &frame);
+    if (OB_FAIL(rc)) {
+      state.SkipWithError("failed to get page");
+      return;
+    }
+    frame->data()[0]++;
+    frame->mark_dirty();
+    buffer_pool_->unpin_page(frame);
+
+    latencies.push_back(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - begin).count());
+  }
+
+  sort(latencies.begin(), latencies.end());
+  auto percentile = [&latencies](double p) {
+    return latencies.empty() ? 0.0 : static_cast<double>(latencies[static_cast<size_t>(p * (latencies.size() - 1))]);
+  };
+  state.counters["p50_us"]  = percentile(0.5) / 1000;
+  state.counters["p99_us"]  = percentile(0.99) / 1000;
+  state.counters["p999_us"] = percentile(0.999) / 1000;
+  state.counters["max_us"]  = latencies.empty() ? 0.0 : static_cast<double>(latencies.back()) / 1000;
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_REGISTER_F(DoubleWriteBufferBenchmark, DirtyEviction)->Arg(16)->Arg(64)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,120 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+
+#include "common/lang/atomic.h"
+#include "common/lang/stdexcept.h"
+#include "common/lang/thread.h"
+#include "common/log/log.h"
+#include "storage/clog/log_buffer.h"
+#include "storage/clog/log_file.h"
+
+using namespace std;
+using namespace common;
+using namespace benchmark;
+
+/**
+ * @brief 多个线程同时向日志缓冲区追加日志的吞吐
+ * @details 一个后台线程不停地把缓冲区中的日志刷到文件中，每个文件存放 ENTRIES_PER_FILE 条日志。
+ * 参数是每条日志的数据大小，线程数从1到16。
+ */
+class LogBufferBenchmark : public Fixture
+{
+public:
+  static constexpr LSN ENTRIES_PER_FILE = 100000;
+
+  void SetUp(const State &state) override
+  {
+    if (0 != state.thread_index()) {
+      return;
+    }
+
+    LoggerFactory::init_default("log_buffer.log", LOG_LEVEL_WARN);
+
+    filesystem::remove_all(directory_);
+    filesystem::create_directories(directory_);
+
+    buffer_ = make_unique<LogEntryBuffer>();
+    if (OB_FAIL(buffer_->init(0))) {
+      throw runtime_error("failed to init log buffer");
+    }
+
+    running_.store(true);
+    flusher_ = thread(&LogBufferBenchmark::flush_thread_func, this);
+  }
+
+  void TearDown(const State &state) override
+  {
+    if (0 != state.thread_index()) {
+      return;
+    }
+
+    running_.store(false);
+    flusher_.join();
+    buffer_.reset();
+    filesystem::remove_all(directory_);
+  }
+
+  void flush_thread_func()
+  {
+    LogFileWriter writer;
+    while (running_.load() || buffer_->flushed_lsn() < buffer_->current_lsn()) {
+      if (!writer.valid() || writer.full()) {
+        writer.close();
+        // 文件只是为了让刷盘有真实的IO，写完的文件马上删除，避免占用太多磁盘空间
+        filesystem::remove_all(directory_);
+        filesystem::create_directories(directory_);
+
+        const LSN    first_lsn = buffer_->flushed_lsn() + 1;
+        const string filename  = (directory_ / to_string(first_lsn)).string();
+        if (OB_FAIL(writer.open(filename.c_str(), first_lsn + ENTRIES_PER_FILE - 1))) {
+          throw runtime_error("failed to open log file");
+        }
+      }
+
+      int count = 0;
+      RC  rc    = buffer_->flush(writer, count);
+      if (OB_FAIL(rc) && rc != RC::LOG_FILE_FULL) {
+        throw runtime_error("failed to flush log buffer");
+      }
+      if (count == 0) {
+        this_thread::yield();
+      }
+    }
+    writer.close();
+  }
+
+protected:
+  filesystem::path           directory_{"log_buffer_benchmark"};
+  unique_ptr<LogEntryBuffer> buffer_;
+  thread                     flusher_;
+  atomic_bool                running_{false};
+};
+
+BENCHMARK_DEFINE_F(LogBufferBenchmark, Append)(State &state)
+{
+  const size_t data_size = static_cast<size_t>(state.range(0));
+  for (auto _ : state) {
+    LSN lsn = 0;
+    RC  rc  = buffer_->append(lsn, LogModule::Id::BUFFER_POOL, vector<char>(data_size));
+    if (OB_FAIL(rc)) {
+      state.SkipWithError("failed to append log");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * (data_size + LogHeader::SIZE));
+}
+
+BENCHMARK_REGISTER_F(LogBufferBenchmark, Append)->Arg(64)->Arg(512)->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,123 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+
+#include "common/lang/algorithm.h"
+#include "common/lang/chrono.h"
+#include "common/lang/stdexcept.h"
+#include "common/log/log.h"
+#include "storage/clog/disk_log_handler.h"
+#include "storage/clog/log_replayer.h"
+
+using namespace std;
+using namespace common;
+using namespace benchmark;
+
+class NoopLogReplayer : public LogReplayer
+{
+public:
+  RC replay(const LogEntry &) override { return RC::SUCCESS; }
+};
+
+/**
+ * @brief 多个线程同时提交时的提交延迟和吞吐
+ * @details 模拟事务提交：每次追加一条提交日志，然后按照持久化级别等待这条日志。
+ * 参数是持久化级别(LogDurability)，线程数从1到64，统计每次提交的耗时，输出各个线程 p50/p99 延迟的平均值。
+ */
+class LogCommitBenchmark : public Fixture
+{
+public:
+  static constexpr int COMMIT_LOG_SIZE = 64;
+
+  void SetUp(const State &state) override
+  {
+    if (0 != state.thread_index()) {
+      return;
+    }
+
+    LoggerFactory::init_default("log_commit.log", LOG_LEVEL_WARN);
+
+    filesystem::remove_all(directory_);
+    handler_ = make_unique<DiskLogHandler>();
+    handler_->set_durability(static_cast<LogDurability>(state.range(0)));
+
+    NoopLogReplayer replayer;
+
+    RC rc = handler_->init(directory_.c_str());
+    if (OB_SUCC(rc)) {
+      rc = handler_->replay(replayer, 0);
+    }
+    if (OB_SUCC(rc)) {
+      rc = handler_->start();
+    }
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to start log handler");
+    }
+  }
+
+  void TearDown(const State &state) override
+  {
+    if (0 != state.thread_index()) {
+      return;
+    }
+
+    handler_->stop();
+    handler_->await_termination();
+    handler_.reset();
+    filesystem::remove_all(directory_);
+  }
+
+protected:
+  filesystem::path           directory_{"log_commit_benchmark"};
+  unique_ptr<DiskLogHandler> handler_;
+};
+
+BENCHMARK_DEFINE_F(LogCommitBenchmark, Commit)(State &state)
+{
+  state.SetLabel(log_durability_name(static_cast<LogDurability>(state.range(0))));
+
+  vector<int64_t> latencies;
+  latencies.reserve(64 * 1024);
+
+  for (auto _ : state) {
+    auto begin = chrono::steady_clock::now();
+
+    LSN lsn = 0;
+    RC  rc  = handler_->append(lsn, LogModule::Id::TRANSACTION, vector<char>(COMMIT_LOG_SIZE));
+    if (OB_SUCC(rc)) {
+      rc = handler_->wait_commit_lsn(lsn);
+    }
+    if (OB_FAIL(rc)) {
+      state.SkipWithError("failed to commit");
+      break;
+    }
+
+    latencies.push_back(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - begin).count());
+  }
+
+  sort(latencies.begin(), latencies.end());
+  auto percentile = [&latencies](double p) {
+    return latencies.empty() ? 0.0 : static_cast<double>(latencies[static_cast<size_t>(p * (latencies.size() - 1))]);
+  };
+  // 每个线程统计自己的延迟，输出所有线程的平均值
+  state.counters["p50_us"] = Counter(percentile(0.5) / 1000, Counter::kAvgThreads);
+  state.counters["p99_us"] = Counter(percentile(0.99) / 1000, Counter::kAvgThreads);
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_REGISTER_F(LogCommitBenchmark, Commit)
+    ->DenseRange(static_cast<int>(LogDurability::NONE), static_cast<int>(LogDurability::DSYNC))
+    ->ThreadRange(1, 64)
+    ->MinTime(2.0)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,130 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+
+#include "common/lang/stdexcept.h"
+#include "common/log/log.h"
+#include "storage/clog/disk_log_handler.h"
+#include "storage/clog/log_entry.h"
+#include "storage/clog/log_replayer.h"
+
+using namespace std;
+using namespace common;
+using namespace benchmark;
+
+/**
+ * @brief 读取日志文件的速度
+ * @details 先写入 ENTRY_NUM 条日志，每次迭代使用 DiskLogHandler::iterate 读出所有的日志，
+ * 回调中访问每条日志的数据，模拟重启时读取日志的开销，但是不包括重做日志本身的开销。
+ * 第一个参数是每条日志数据的大小，第二个参数是开始读取的LSN，0表示从头读取，
+ * 其它值通常落在某个日志文件的中间，需要先跳过文件中前面的日志。
+ */
+class LogReaderBenchmark : public Fixture
+{
+public:
+  static constexpr int ENTRY_NUM = 200000;
+
+  class NoopLogReplayer : public LogReplayer
+  {
+  public:
+    RC replay(const LogEntry &) override { return RC::SUCCESS; }
+  };
+
+  void SetUp(const State &state) override
+  {
+    LoggerFactory::init_default("log_reader.log", LOG_LEVEL_WARN);
+
+    filesystem::remove_all(directory_);
+
+    DiskLogHandler  handler;
+    NoopLogReplayer replayer;
+    handler.set_durability(LogDurability::NONE);
+
+    RC rc = handler.init(directory_.c_str());
+    if (OB_SUCC(rc)) {
+      rc = handler.replay(replayer, 0);
+    }
+    if (OB_SUCC(rc)) {
+      rc = handler.start();
+    }
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to start log handler");
+    }
+
+    const int entry_size = static_cast<int>(state.range(0));
+    LSN       lsn        = 0;
+    for (int i = 0; OB_SUCC(rc) && i < ENTRY_NUM; i++) {
+      vector<char> data(entry_size, static_cast<char>(i));
+      rc = handler.append(lsn, LogModule::Id::RECORD_MANAGER, std::move(data));
+    }
+    if (OB_SUCC(rc)) {
+      rc = handler.wait_lsn(lsn);
+    }
+    handler.stop();
+    handler.await_termination();
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to write log entries");
+    }
+  }
+
+  void TearDown(const State &state) override { filesystem::remove_all(directory_); }
+
+protected:
+  filesystem::path directory_{"log_reader_benchmark"};
+};
+
+BENCHMARK_DEFINE_F(LogReaderBenchmark, Iterate)(State &state)
+{
+  const LSN start_lsn = state.range(1);
+
+  int64_t entries = 0;
+  int64_t bytes   = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    DiskLogHandler handler;
+    RC             rc = handler.init(directory_.c_str());
+    if (OB_FAIL(rc)) {
+      state.SkipWithError("failed to init log handler");
+      return;
+    }
+    state.ResumeTiming();
+
+    int64_t checksum = 0;
+    rc               = handler.iterate(
+        [&](LogEntry &entry) {
+          const char *data = entry.data();
+          for (int i = 0; i < entry.payload_size(); i += 64) {
+            checksum += data[i];
+          }
+          entries++;
+          bytes += entry.total_size();
+          return RC::SUCCESS;
+        },
+        start_lsn);
+    if (OB_FAIL(rc)) {
+      state.SkipWithError("failed to iterate log entries");
+      return;
+    }
+    DoNotOptimize(checksum);
+  }
+
+  state.SetItemsProcessed(entries);
+  state.SetBytesProcessed(bytes);
+}
+
+BENCHMARK_REGISTER_F(LogReaderBenchmark, Iterate)
+    ->ArgsProduct({{64, 512}, {0, LogReaderBenchmark::ENTRY_NUM - 500}})
+    ->ArgNames({"entry_size", "start_lsn"})
+    ->Unit(kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,169 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+
+#include "common/conf/ini.h"
+#include "common/ini_setting.h"
+#include "common/lang/deque.h"
+#include "common/lang/stdexcept.h"
+#include "common/log/log.h"
+#include "storage/clog/disk_log_handler.h"
+#include "storage/db/db.h"
+#include "storage/table/table.h"
+#include "storage/trx/trx.h"
+
+using namespace std;
+using namespace common;
+using namespace benchmark;
+
+/**
+ * @brief 每个事务产生的日志量
+ * @details 使用 mvcc 事务，每个事务插入 ROWS_PER_TRX 条记录后提交。提交时会修改每条记录的事务ID字段，
+ * 这些修改使用只记录修改部分的日志(UPDATE_DELTA)。
+ * 第一个参数是日志压缩算法(LogCompression)，第二个参数是负载：
+ * - 0: 只插入；
+ * - 1: 同时删除 ROWS_PER_TRX 条之前插入的记录，相当于 mvcc 的更新。
+ * 输出每个事务压缩前(raw_bytes_per_trx)和实际写入文件(written_bytes_per_trx)的日志字节数。
+ */
+class LogVolumeBenchmark : public Fixture
+{
+public:
+  static constexpr int FIELD_NUM    = 10;
+  static constexpr int ROWS_PER_TRX = 10;
+
+  void SetUp(const State &state) override
+  {
+    LoggerFactory::init_default("log_volume.log", LOG_LEVEL_WARN);
+
+    filesystem::remove_all(directory_);
+    filesystem::create_directories(directory_);
+
+    const auto compression = static_cast<LogCompression>(state.range(0));
+    get_properties()->put(LOG_COMPRESSION, log_compression_name(compression), STORAGE);
+
+    db_ = make_unique<Db>();
+    RC rc = db_->init("log_volume", directory_.c_str(), "mvcc", "disk");
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to init db");
+    }
+
+    vector<AttrInfoSqlNode> attr_infos(FIELD_NUM);
+    for (int i = 0; i < FIELD_NUM; i++) {
+      attr_infos[i].name   = "field_" + to_string(i);
+      attr_infos[i].type   = AttrType::INTS;
+      attr_infos[i].length = 4;
+    }
+    rc = db_->create_table("t", attr_infos);
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to create table");
+    }
+    table_ = db_->find_table("t");
+
+    log_handler_ = dynamic_cast<DiskLogHandler *>(&db_->log_handler());
+    if (log_handler_ == nullptr) {
+      throw runtime_error("log handler is not a disk log handler");
+    }
+  }
+
+  void TearDown(const State &state) override
+  {
+    db_.reset();
+    rids_.clear();
+    get_properties()->put(LOG_COMPRESSION, LOG_COMPRESSION_DEFAULT, STORAGE);
+    filesystem::remove_all(directory_);
+  }
+
+  /// @brief 等待已经产生的日志写入文件，返回写入前后的字节数
+  void flushed_bytes(int64_t &raw_bytes, int64_t &written_bytes)
+  {
+    RC rc = log_handler_->wait_lsn(log_handler_->current_lsn());
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to wait lsn");
+    }
+    raw_bytes     = log_handler_->raw_bytes();
+    written_bytes = log_handler_->written_bytes();
+  }
+
+protected:
+  filesystem::path    directory_{"log_volume_benchmark"};
+  unique_ptr<Db>      db_;
+  Table              *table_       = nullptr;
+  DiskLogHandler     *log_handler_ = nullptr;
+  deque<RID>          rids_;
+};
+
+BENCHMARK_DEFINE_F(LogVolumeBenchmark, Commit)(State &state)
+{
+  const bool delete_rows = state.range(1) != 0;
+
+  TrxKit &trx_kit = db_->trx_kit();
+  int     value   = 0;
+
+  int64_t begin_raw_bytes     = 0;
+  int64_t begin_written_bytes = 0;
+  flushed_bytes(begin_raw_bytes, begin_written_bytes);
+
+  for (auto _ : state) {
+    Trx *trx = trx_kit.create_trx(db_->log_handler());
+    trx->start_if_need();
+
+    RC rc = RC::SUCCESS;
+    for (int i = 0; OB_SUCC(rc) && i < ROWS_PER_TRX; i++) {
+      if (delete_rows && !rids_.empty()) {
+        Record record;
+        record.set_rid(rids_.front());
+        rids_.pop_front();
+        rc = trx->delete_record(table_, record);
+        if (OB_FAIL(rc)) {
+          break;
+        }
+      }
+
+      vector<Value> values(FIELD_NUM, Value(value++));
+      Record        record;
+      rc = table_->make_record(values.size(), values.data(), record);
+      if (OB_SUCC(rc)) {
+        rc = trx->insert_record(table_, record);
+      }
+      if (OB_SUCC(rc)) {
+        rids_.push_back(record.rid());
+      }
+    }
+
+    if (OB_SUCC(rc)) {
+      rc = trx->commit();
+    }
+    trx_kit.destroy_trx(trx);
+    if (OB_FAIL(rc)) {
+      state.SkipWithError("failed to execute transaction");
+      return;
+    }
+  }
+
+  int64_t end_raw_bytes     = 0;
+  int64_t end_written_bytes = 0;
+  flushed_bytes(end_raw_bytes, end_written_bytes);
+
+  const double trx_num                    = static_cast<double>(state.iterations());
+  state.counters["raw_bytes_per_trx"]     = (end_raw_bytes - begin_raw_bytes) / trx_num;
+  state.counters["written_bytes_per_trx"] = (end_written_bytes - begin_written_bytes) / trx_num;
+  state.SetLabel(string(log_compression_name(static_cast<LogCompression>(state.range(0)))) +
+                 (delete_rows ? "/update" : "/insert"));
+}
+
+BENCHMARK_REGISTER_F(LogVolumeBenchmark, Commit)
+    ->ArgsProduct({{static_cast<int>(LogCompression::NONE), static_cast<int>(LogCompression::BUILTIN)}, {0, 1}})
+    ->Iterations(5000)
+    ->Unit(kMicrosecond)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
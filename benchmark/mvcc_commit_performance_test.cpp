@@ -0,0 +1,124 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+
+#include "common/conf/ini.h"
+#include "common/ini_setting.h"
+#include "common/lang/chrono.h"
+#include "common/lang/stdexcept.h"
+#include "common/log/log.h"
+#include "storage/db/db.h"
+#include "storage/table/table.h"
+#include "storage/trx/trx.h"
+
+using namespace std;
+using namespace common;
+using namespace benchmark;
+
+/**
+ * @brief 事务提交的耗时
+ * @details 使用 mvcc 事务，每个事务插入若干条记录，只统计 commit 的耗时。
+ * 参数是每个事务插入的记录数。日志不等待落盘，不启动后台清理线程。
+ */
+class MvccCommitBenchmark : public Fixture
+{
+public:
+  static constexpr int FIELD_NUM = 4;
+
+  void SetUp(const State &state) override
+  {
+    LoggerFactory::init_default("mvcc_commit.log", LOG_LEVEL_WARN);
+
+    filesystem::remove_all(directory_);
+    filesystem::create_directories(directory_);
+
+    get_properties()->put(PURGE_INTERVAL_MS, "0", STORAGE);
+    get_properties()->put(LOG_DURABILITY, "none", STORAGE);
+
+    db_   = make_unique<Db>();
+    RC rc = db_->init("mvcc_commit", directory_.c_str(), "mvcc", "disk");
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to init db");
+    }
+
+    vector<AttrInfoSqlNode> attr_infos(FIELD_NUM);
+    for (int i = 0; i < FIELD_NUM; i++) {
+      attr_infos[i].name   = "field_" + to_string(i);
+      attr_infos[i].type   = AttrType::INTS;
+      attr_infos[i].length = 4;
+    }
+    rc = db_->create_table("t", attr_infos);
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to create table");
+    }
+    table_ = db_->find_table("t");
+  }
+
+  void TearDown(const State &state) override
+  {
+    db_.reset();
+    get_properties()->put(PURGE_INTERVAL_MS, PURGE_INTERVAL_MS_DEFAULT, STORAGE);
+    get_properties()->put(LOG_DURABILITY, LOG_DURABILITY_DEFAULT, STORAGE);
+    filesystem::remove_all(directory_);
+  }
+
+protected:
+  filesystem::path directory_{"mvcc_commit_benchmark"};
+  unique_ptr<Db>   db_;
+  Table           *table_ = nullptr;
+};
+
+BENCHMARK_DEFINE_F(MvccCommitBenchmark, Commit)(State &state)
+{
+  const int rows_per_trx = static_cast<int>(state.range(0));
+  TrxKit   &trx_kit      = db_->trx_kit();
+
+  for (auto _ : state) {
+    Trx *trx = trx_kit.create_trx(db_->log_handler());
+    trx->start_if_need();
+
+    RC rc = RC::SUCCESS;
+    for (int i = 0; OB_SUCC(rc) && i < rows_per_trx; i++) {
+      vector<Value> values(FIELD_NUM, Value(i));
+      Record        record;
+      rc = table_->make_record(values.size(), values.data(), record);
+      if (OB_SUCC(rc)) {
+        rc = trx->insert_record(table_, record);
+      }
+    }
+
+    auto begin = chrono::steady_clock::now();
+    if (OB_SUCC(rc)) {
+      rc = trx->commit();
+    }
+    auto end = chrono::steady_clock::now();
+    trx_kit.destroy_trx(trx);
+
+    if (OB_FAIL(rc)) {
+      state.SkipWithError("failed to execute transaction");
+      return;
+    }
+    state.SetIterationTime(chrono::duration<double>(end - begin).count());
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_REGISTER_F(MvccCommitBenchmark, Commit)
+    ->Arg(1)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Iterations(200)
+    ->UseManualTime()
+    ->Unit(kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,195 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+
+#include "common/conf/ini.h"
+#include "common/ini_setting.h"
+#include "common/lang/stdexcept.h"
+#include "common/log/log.h"
+#include "storage/db/db.h"
+#include "storage/field/field.h"
+#include "storage/record/record_manager.h"
+#include "storage/table/table.h"
+#include "storage/trx/trx.h"
+
+using namespace std;
+using namespace common;
+using namespace benchmark;
+
+/**
+ * @brief 热点行的并发更新
+ * @details 表中只有 HOT_ROWS 行计数器，多个线程并发地给随机的一行加一。
+ * 每次迭代是一次成功提交的更新：扫描找到这一行，删除后插入新值。与其它事务冲突时回滚并重试。
+ * 参数表示遇到其它事务锁住的行时是否等待：
+ * - 0: 等锁超时时间为0，马上返回冲突，相当于客户端忙等重试；
+ * - 1: 等待持有锁的事务结束。
+ * 输出每次成功提交平均回滚的次数(aborts)。需要编译时打开 CONCURRENCY。
+ */
+class MvccHotRowBenchmark : public Fixture
+{
+public:
+  static constexpr int HOT_ROWS = 4;
+
+  void SetUp(const State &state) override
+  {
+    if (0 != state.thread_index()) {
+      return;
+    }
+
+    LoggerFactory::init_default("mvcc_hot_row.log", LOG_LEVEL_WARN);
+
+    filesystem::remove_all(directory_);
+    filesystem::create_directories(directory_);
+
+    // 清理线程及时清理旧版本，否则扫描会越来越慢
+    get_properties()->put(PURGE_INTERVAL_MS, "10", STORAGE);
+    get_properties()->put(LOG_DURABILITY, "none", STORAGE);
+    get_properties()->put(LOCK_WAIT_TIMEOUT_MS, state.range(0) != 0 ? "10000" : "0", STORAGE);
+
+    db_   = make_unique<Db>();
+    RC rc = db_->init("mvcc_hot_row", directory_.c_str(), "mvcc", "disk");
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to init db");
+    }
+
+    vector<AttrInfoSqlNode> attr_infos(2);
+    attr_infos[0].name = "id";
+    attr_infos[1].name = "counter";
+    for (AttrInfoSqlNode &attr_info : attr_infos) {
+      attr_info.type   = AttrType::INTS;
+      attr_info.length = 4;
+    }
+    rc = db_->create_table("t", attr_infos);
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to create table");
+    }
+    table_         = db_->find_table("t");
+    id_field_      = Field(table_, table_->table_meta().field("id"));
+    counter_field_ = Field(table_, table_->table_meta().field("counter"));
+
+    TrxKit &trx_kit = db_->trx_kit();
+    Trx    *trx     = trx_kit.create_trx(db_->log_handler());
+    trx->start_if_need();
+    for (int i = 0; OB_SUCC(rc) && i < HOT_ROWS; i++) {
+      rc = insert(trx, i, 0);
+    }
+    if (OB_SUCC(rc)) {
+      rc = trx->commit();
+    }
+    trx_kit.destroy_trx(trx);
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to insert hot rows");
+    }
+  }
+
+  void TearDown(const State &state) override
+  {
+    if (0 != state.thread_index()) {
+      return;
+    }
+
+    db_.reset();
+    get_properties()->put(PURGE_INTERVAL_MS, PURGE_INTERVAL_MS_DEFAULT, STORAGE);
+    get_properties()->put(LOG_DURABILITY, LOG_DURABILITY_DEFAULT, STORAGE);
+    get_properties()->put(LOCK_WAIT_TIMEOUT_MS, LOCK_WAIT_TIMEOUT_MS_DEFAULT, STORAGE);
+    filesystem::remove_all(directory_);
+  }
+
+  RC insert(Trx *trx, int id, int counter)
+  {
+    Value  values[] = {Value(id), Value(counter)};
+    Record record;
+    RC     rc = table_->make_record(2, values, record);
+    if (OB_SUCC(rc)) {
+      rc = trx->insert_record(table_, record);
+    }
+    return rc;
+  }
+
+  /// @brief 在一个事务中给一行计数器加一
+  RC increment(int id)
+  {
+    TrxKit &trx_kit = db_->trx_kit();
+    Trx    *trx     = trx_kit.create_trx(db_->log_handler());
+    trx->start_if_need();
+
+    RecordFileScanner scanner;
+    Record            row;
+    bool              found = false;
+    Record            record;
+    RC                rc = table_->get_record_scanner(scanner, trx, ReadWriteMode::READ_ONLY);
+    while (OB_SUCC(rc) && OB_SUCC(rc = scanner.next(record))) {
+      if (id_field_.get_int(record) == id) {
+        row.copy_data(record.data(), record.len());
+        row.set_rid(record.rid());
+        found = true;
+        break;
+      }
+    }
+    scanner.close_scan();
+
+    rc = found ? RC::SUCCESS : RC::RECORD_NOT_EXIST;
+    if (OB_SUCC(rc)) {
+      rc = trx->delete_record(table_, row);
+    }
+    if (OB_SUCC(rc)) {
+      rc = insert(trx, id, counter_field_.get_int(row) + 1);
+    }
+
+    if (OB_SUCC(rc)) {
+      rc = trx->commit();
+    } else {
+      trx->rollback();
+    }
+    trx_kit.destroy_trx(trx);
+    return rc;
+  }
+
+protected:
+  filesystem::path directory_{"mvcc_hot_row_benchmark"};
+  unique_ptr<Db>   db_;
+  Table           *table_ = nullptr;
+  Field            id_field_;
+  Field            counter_field_;
+};
+
+BENCHMARK_DEFINE_F(MvccHotRowBenchmark, Increment)(State &state)
+{
+  int64_t aborts = 0;
+  int     id     = state.thread_index() % HOT_ROWS;
+  for (auto _ : state) {
+    RC rc = RC::SUCCESS;
+    while (OB_FAIL(rc = increment(id))) {
+      if (rc != RC::LOCKED_CONCURRENCY_CONFLICT && rc != RC::LOCKED_DEADLOCK) {
+        state.SkipWithError("failed to increment counter");
+        return;
+      }
+      aborts++;
+    }
+    id = (id + 1) % HOT_ROWS;
+  }
+
+  state.counters["aborts"] = Counter(static_cast<double>(aborts), Counter::kAvgIterations);
+  state.SetLabel(state.range(0) != 0 ? "wait" : "no_wait");
+}
+
+BENCHMARK_REGISTER_F(MvccHotRowBenchmark, Increment)
+    ->Arg(0)
+    ->Arg(1)
+    ->Threads(1)
+    ->Threads(4)
+    ->Threads(8)
+    ->Iterations(2000)
+    ->UseRealTime()
+    ->Unit(kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,170 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+
+#include "common/conf/ini.h"
+#include "common/ini_setting.h"
+#include "common/lang/stdexcept.h"
+#include "common/log/log.h"
+#include "storage/db/db.h"
+#include "storage/record/record_manager.h"
+#include "storage/table/table.h"
+#include "storage/trx/trx.h"
+
+using namespace std;
+using namespace common;
+using namespace benchmark;
+
+/**
+ * @brief 清理旧版本记录对扫描的影响
+ * @details 使用 mvcc 事务，插入 ROW_NUM 条记录，然后把每条记录都更新 UPDATE_ROUNDS 次。
+ * mvcc 的更新是删除旧记录再插入新记录，旧记录会一直留在表中。每次迭代用一个新的事务扫描整张表。
+ * 第一个参数表示是否清理旧版本记录：
+ * - 0: 不清理，表中有 ROW_NUM * UPDATE_ROUNDS 条已经删除的记录；
+ * - 1: 每轮更新后执行 Db::purge，相当于后台清理线程跟上了更新的速度，删除的记录占用的空间会被之后的插入复用。
+ * 输出表文件的页面数(pages)和清理掉的记录数(purged_records)。
+ */
+class MvccPurgeBenchmark : public Fixture
+{
+public:
+  static constexpr int FIELD_NUM     = 10;
+  static constexpr int ROW_NUM       = 20000;
+  static constexpr int UPDATE_ROUNDS = 4;
+  static constexpr int ROWS_PER_TRX  = 100;
+
+  void SetUp(const State &state) override
+  {
+    LoggerFactory::init_default("mvcc_purge.log", LOG_LEVEL_WARN);
+
+    filesystem::remove_all(directory_);
+    filesystem::create_directories(directory_);
+
+    // 只在需要的时候手动清理，不启动后台线程
+    get_properties()->put(PURGE_INTERVAL_MS, "0", STORAGE);
+    get_properties()->put(LOG_DURABILITY, "none", STORAGE);
+
+    db_   = make_unique<Db>();
+    RC rc = db_->init("mvcc_purge", directory_.c_str(), "mvcc", "disk");
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to init db");
+    }
+
+    vector<AttrInfoSqlNode> attr_infos(FIELD_NUM);
+    for (int i = 0; i < FIELD_NUM; i++) {
+      attr_infos[i].name   = "field_" + to_string(i);
+      attr_infos[i].type   = AttrType::INTS;
+      attr_infos[i].length = 4;
+    }
+    rc = db_->create_table("t", attr_infos);
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to create table");
+    }
+    table_ = db_->find_table("t");
+
+    const bool purge = state.range(0) != 0;
+
+    vector<RID> rids(ROW_NUM);
+    for (int round = 0; round <= UPDATE_ROUNDS; round++) {
+      for (int begin = 0; begin < ROW_NUM; begin += ROWS_PER_TRX) {
+        execute(rids, begin, min(begin + ROWS_PER_TRX, ROW_NUM), round > 0);
+      }
+      if (purge && OB_FAIL(db_->purge())) {
+        throw runtime_error("failed to purge");
+      }
+    }
+  }
+
+  void TearDown(const State &state) override
+  {
+    db_.reset();
+    get_properties()->put(PURGE_INTERVAL_MS, PURGE_INTERVAL_MS_DEFAULT, STORAGE);
+    get_properties()->put(LOG_DURABILITY, LOG_DURABILITY_DEFAULT, STORAGE);
+    filesystem::remove_all(directory_);
+  }
+
+  /// @brief 在一个事务中插入 [begin, end) 的记录，update 为 true 时先删除原来的记录
+  void execute(vector<RID> &rids, int begin, int end, bool update)
+  {
+    TrxKit &trx_kit = db_->trx_kit();
+    Trx    *trx     = trx_kit.create_trx(db_->log_handler());
+    trx->start_if_need();
+
+    RC rc = RC::SUCCESS;
+    for (int i = begin; OB_SUCC(rc) && i < end; i++) {
+      if (update) {
+        Record record;
+        record.set_rid(rids[i]);
+        rc = trx->delete_record(table_, record);
+        if (OB_FAIL(rc)) {
+          break;
+        }
+      }
+
+      vector<Value> values(FIELD_NUM, Value(i));
+      Record        record;
+      rc = table_->make_record(values.size(), values.data(), record);
+      if (OB_SUCC(rc)) {
+        rc = trx->insert_record(table_, record);
+      }
+      if (OB_SUCC(rc)) {
+        rids[i] = record.rid();
+      }
+    }
+
+    if (OB_SUCC(rc)) {
+      rc = trx->commit();
+    }
+    trx_kit.destroy_trx(trx);
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to execute transaction");
+    }
+  }
+
+protected:
+  filesystem::path directory_{"mvcc_purge_benchmark"};
+  unique_ptr<Db>   db_;
+  Table           *table_ = nullptr;
+};
+
+BENCHMARK_DEFINE_F(MvccPurgeBenchmark, Scan)(State &state)
+{
+  TrxKit &trx_kit = db_->trx_kit();
+  for (auto _ : state) {
+    Trx *trx = trx_kit.create_trx(db_->log_handler());
+    trx->start_if_need();
+
+    RecordFileScanner scanner;
+    RC                rc    = table_->get_record_scanner(scanner, trx, ReadWriteMode::READ_ONLY);
+    int               count = 0;
+    Record            record;
+    while (OB_SUCC(rc) && OB_SUCC(rc = scanner.next(record))) {
+      count++;
+    }
+    scanner.close_scan();
+    trx->commit();
+    trx_kit.destroy_trx(trx);
+
+    if (rc != RC::RECORD_EOF || count != ROW_NUM) {
+      state.SkipWithError("failed to scan table");
+      return;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * ROW_NUM);
+  state.counters["pages"] = static_cast<double>(table_->data_buffer_pool()->page_count());
+  state.counters["purged_records"] = static_cast<double>(db_->purged_records());
+  state.SetLabel(state.range(0) != 0 ? "purge" : "no_purge");
+}
+
+BENCHMARK_REGISTER_F(MvccPurgeBenchmark, Scan)->Arg(0)->Arg(1)->Iterations(20)->Unit(kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -43,6 +43,9 @@ struct Stat
   int64_t scan_open_failed_count = 0;
   int64_t mismatch_count         = 0;
   int64_t scan_other_count       = 0;
+
+  int64_t get_success_count = 0;
+  int64_t get_other_count   = 0;
 };
 
 struct TestRecord
@@ -228,6 +231,17 @@ public:
     }
   }
 
+  void Get(const RID &rid, Stat &stat)
+  {
+    Record record;
+    RC     rc = handler_->get_record(rid, record);
+    if (rc == RC::SUCCESS) {
+      stat.get_success_count++;
+    } else {
+      stat.get_other_count++;
+    }
+  }
+
 protected:
   BufferPoolManager  bpm_{512};
   DiskBufferPool    *buffer_pool_ = nullptr;
@@ -355,6 +369,54 @@ BENCHMARK_REGISTER_F(ScanBenchmark, Scan)->Threads(10)->Arg(4 * 10000);
 
 ////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * @brief 所有页面都在内存中时按照RID读取记录
+ * @details 用来观察页帧管理器随着线程数增加的扩展性
+ */
+class PageHitBenchmark : public BenchmarkBase
+{
+public:
+  string Name() const override { return "page_hit"; }
+
+  void SetUp(const State &state) override
+  {
+    BenchmarkBase::SetUp(state);
+
+    if (0 != state.thread_index()) {
+      while (!setup_done_) {
+        this_thread::sleep_for(chrono::milliseconds(100));
+      }
+      return;
+    }
+
+    uint32_t max = GetRangeMax(state);
+    ASSERT(max > 0, "invalid argument count. %ld", state.range(0));
+    FillUp(0, max, rids_);
+    setup_done_ = true;
+  }
+
+protected:
+  volatile bool setup_done_ = false;
+  vector<RID>   rids_;
+};
+
+BENCHMARK_DEFINE_F(PageHitBenchmark, PageHit)(State &state)
+{
+  IntegerGenerator generator(0, static_cast<int>(rids_.size() - 1));
+  Stat             stat;
+
+  for (auto _ : state) {
+    Get(rids_[generator.next()], stat);
+  }
+
+  state.counters["success"] = Counter(stat.get_success_count, Counter::kIsRate);
+  state.counters["other"]   = Counter(stat.get_other_count, Counter::kIsRate);
+}
+
+BENCHMARK_REGISTER_F(PageHitBenchmark, PageHit)->ThreadRange(1, 32)->Arg(2000)->UseRealTime();
+
+////////////////////////////////////////////////////////////////////////////////
+
 struct MixtureBenchmark : public BenchmarkBase
 {
   string Name() const override { return "mixture"; }
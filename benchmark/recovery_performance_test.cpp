@@ -0,0 +1,293 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+
+#include "common/conf/ini.h"
+#include "common/ini_setting.h"
+#include "common/lang/algorithm.h"
+#include "common/lang/stdexcept.h"
+#include "common/log/log.h"
+#include "storage/db/db.h"
+#include "storage/record/record_manager.h"
+#include "storage/table/table.h"
+#include "storage/trx/trx.h"
+
+using namespace std;
+using namespace common;
+using namespace benchmark;
+
+/**
+ * @brief 不同日志量下的重启恢复时间
+ * @details 建一张表并插入一批数据，等日志落盘后把数据库目录复制一份，相当于数据库在这个时刻崩溃了。
+ * 每次迭代在复制出来的目录上初始化数据库，测量重做日志的耗时。
+ * 第一个参数是插入的记录数，也就是日志的条数。第二个参数表示是否有检查点：
+ * - 0: 没有检查点，需要从头重做所有的日志；
+ * - 1: 最后 TAIL_RECORD_NUM 条记录之前执行一次 sync，所有页面落盘并推进检查点，只需要重做检查点之后的日志。
+ */
+class RecoveryBenchmark : public Fixture
+{
+public:
+  static constexpr int FIELD_NUM       = 4;
+  static constexpr int TAIL_RECORD_NUM = 1000;
+
+  void SetUp(const State &state) override
+  {
+    LoggerFactory::init_default("recovery.log", LOG_LEVEL_WARN);
+
+    filesystem::remove_all(directory_);
+    filesystem::create_directories(directory_ / "source");
+
+    const int  record_num = static_cast<int>(state.range(0));
+    const bool checkpoint = state.range(1) != 0;
+
+    auto db = make_unique<Db>();
+    RC   rc = db->init(dbname_, (directory_ / "source").c_str(), "vacuous", "disk");
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to init db");
+    }
+
+    vector<AttrInfoSqlNode> attr_infos(FIELD_NUM);
+    for (int i = 0; i < FIELD_NUM; i++) {
+      attr_infos[i].name   = "field_" + to_string(i);
+      attr_infos[i].type   = AttrType::INTS;
+      attr_infos[i].length = 4;
+    }
+    rc = db->create_table("t", attr_infos);
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to create table");
+    }
+
+    Table *table = db->find_table("t");
+    for (int i = 0; i < record_num; i++) {
+      if (checkpoint && i == record_num - TAIL_RECORD_NUM) {
+        rc = db->sync();
+        if (OB_FAIL(rc)) {
+          throw runtime_error("failed to sync db");
+        }
+      }
+
+      vector<Value> values(FIELD_NUM, Value(i));
+      Record        record;
+      rc = table->make_record(values.size(), values.data(), record);
+      if (OB_SUCC(rc)) {
+        rc = table->insert_record(record);
+      }
+      if (OB_FAIL(rc)) {
+        throw runtime_error("failed to insert record");
+      }
+    }
+
+    current_lsn_ = db->log_handler().current_lsn();
+    rc           = db->log_handler().wait_lsn(current_lsn_);
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to wait lsn");
+    }
+
+    filesystem::copy(directory_ / "source", directory_ / "image", filesystem::copy_options::recursive);
+    check_point_lsn_ = db->check_point_lsn();
+  }
+
+  void TearDown(const State &state) override { filesystem::remove_all(directory_); }
+
+protected:
+  filesystem::path directory_{"recovery_benchmark"};
+  const char      *dbname_          = "recovery";
+  LSN              current_lsn_     = 0;
+  LSN              check_point_lsn_ = 0;
+};
+
+BENCHMARK_DEFINE_F(RecoveryBenchmark, Recover)(State &state)
+{
+  const filesystem::path db_path = directory_ / "recover";
+  for (auto _ : state) {
+    state.PauseTiming();
+    filesystem::remove_all(db_path);
+    filesystem::copy(directory_ / "image", db_path, filesystem::copy_options::recursive);
+    auto db = make_unique<Db>();
+    state.ResumeTiming();
+
+    RC rc = db->init(dbname_, db_path.c_str(), "vacuous", "disk");
+    if (OB_FAIL(rc)) {
+      state.SkipWithError("failed to recover db");
+      return;
+    }
+
+    state.PauseTiming();
+    db.reset();
+    state.ResumeTiming();
+  }
+
+  state.counters["replayed_logs"] = static_cast<double>(current_lsn_ - max(check_point_lsn_, LSN(1)) + 1);
+  state.SetLabel(state.range(1) != 0 ? "checkpoint" : "no_checkpoint");
+}
+
+BENCHMARK_REGISTER_F(RecoveryBenchmark, Recover)
+    ->ArgsProduct({{5000, 20000, 50000}, {0, 1}})
+    ->Iterations(5)
+    ->Unit(kMillisecond)
+    ->UseRealTime();
+
+/**
+ * @brief 并行重做的恢复时间
+ * @details 与 mvcc_trx_log_test 相同的场景：使用 mvcc 事务，建 TABLE_NUM 张表，每个事务向每张表插入一条记录。
+ * 所有日志落盘后把数据库目录复制一份，每次迭代在复制出来的目录上重启并重做所有的日志，重做完成后检查每张表的记录数。
+ * 第一个参数是事务个数，第二个参数是重做日志的线程数(RECOVERY_THREADS)。
+ */
+class ParallelRecoveryBenchmark : public Fixture
+{
+public:
+  static constexpr int TABLE_NUM = 10;
+  static constexpr int FIELD_NUM = 10;
+
+  void SetUp(const State &state) override
+  {
+    LoggerFactory::init_default("parallel_recovery.log", LOG_LEVEL_WARN);
+
+    filesystem::remove_all(directory_);
+    filesystem::create_directories(directory_ / "source");
+
+    trx_num_ = static_cast<int>(state.range(0));
+
+    auto db = make_unique<Db>();
+    RC   rc = db->init(dbname_, (directory_ / "source").c_str(), "mvcc", "disk");
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to init db");
+    }
+
+    vector<AttrInfoSqlNode> attr_infos(FIELD_NUM);
+    for (int i = 0; i < FIELD_NUM; i++) {
+      attr_infos[i].name   = "field_" + to_string(i);
+      attr_infos[i].type   = AttrType::INTS;
+      attr_infos[i].length = 4;
+    }
+    vector<Table *> tables;
+    for (int i = 0; i < TABLE_NUM; i++) {
+      const string table_name = "table_" + to_string(i);
+      rc                      = db->create_table(table_name.c_str(), attr_infos);
+      if (OB_SUCC(rc)) {
+        rc = db->sync();
+      }
+      if (OB_FAIL(rc)) {
+        throw runtime_error("failed to create table");
+      }
+      tables.push_back(db->find_table(table_name.c_str()));
+    }
+
+    TrxKit &trx_kit = db->trx_kit();
+    for (int i = 0; i < trx_num_; i++) {
+      Trx *trx = trx_kit.create_trx(db->log_handler());
+      trx->start_if_need();
+      for (Table *table : tables) {
+        vector<Value> values(FIELD_NUM, Value(i));
+        Record        record;
+        rc = table->make_record(values.size(), values.data(), record);
+        if (OB_SUCC(rc)) {
+          rc = trx->insert_record(table, record);
+        }
+        if (OB_FAIL(rc)) {
+          throw runtime_error("failed to insert record");
+        }
+      }
+      rc = trx->commit();
+      trx_kit.destroy_trx(trx);
+      if (OB_FAIL(rc)) {
+        throw runtime_error("failed to commit");
+      }
+    }
+
+    current_lsn_ = db->log_handler().current_lsn();
+    rc           = db->log_handler().wait_lsn(current_lsn_);
+    if (OB_FAIL(rc)) {
+      throw runtime_error("failed to wait lsn");
+    }
+
+    filesystem::copy(directory_ / "source", directory_ / "image", filesystem::copy_options::recursive);
+    check_point_lsn_ = db->check_point_lsn();
+  }
+
+  void TearDown(const State &state) override
+  {
+    get_properties()->put(RECOVERY_THREADS, RECOVERY_THREADS_DEFAULT, STORAGE);
+    filesystem::remove_all(directory_);
+  }
+
+  /// @brief 重做后每张表都应该有 trx_num_ 条记录
+  bool check(Db &db)
+  {
+    for (int i = 0; i < TABLE_NUM; i++) {
+      Table *table = db.find_table(("table_" + to_string(i)).c_str());
+      if (table == nullptr) {
+        return false;
+      }
+
+      RecordFileScanner scanner;
+      if (OB_FAIL(table->get_record_scanner(scanner, nullptr, ReadWriteMode::READ_ONLY))) {
+        return false;
+      }
+      int    count = 0;
+      Record record;
+      while (OB_SUCC(scanner.next(record))) {
+        count++;
+      }
+      if (count != trx_num_) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+protected:
+  filesystem::path directory_{"parallel_recovery_benchmark"};
+  const char      *dbname_          = "recovery";
+  int              trx_num_         = 0;
+  LSN              current_lsn_     = 0;
+  LSN              check_point_lsn_ = 0;
+};
+
+BENCHMARK_DEFINE_F(ParallelRecoveryBenchmark, Recover)(State &state)
+{
+  get_properties()->put(RECOVERY_THREADS, to_string(state.range(1)), STORAGE);
+
+  const filesystem::path db_path = directory_ / "recover";
+  for (auto _ : state) {
+    state.PauseTiming();
+    filesystem::remove_all(db_path);
+    filesystem::copy(directory_ / "image", db_path, filesystem::copy_options::recursive);
+    auto db = make_unique<Db>();
+    state.ResumeTiming();
+
+    RC rc = db->init(dbname_, db_path.c_str(), "mvcc", "disk");
+    if (OB_FAIL(rc)) {
+      state.SkipWithError("failed to recover db");
+      return;
+    }
+
+    state.PauseTiming();
+    if (!check(*db)) {
+      state.SkipWithError("records are lost after recovery");
+      return;
+    }
+    db.reset();
+    state.ResumeTiming();
+  }
+
+  state.counters["replayed_logs"] = static_cast<double>(current_lsn_ - max(check_point_lsn_, LSN(1)) + 1);
+}
+
+BENCHMARK_REGISTER_F(ParallelRecoveryBenchmark, Recover)
+    ->ArgsProduct({{2000, 10000}, {1, 2, 4, 8}})
+    ->ArgNames({"trx", "threads"})
+    ->Iterations(3)
+    ->Unit(kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -86,7 +86,7 @@ int Ini::put(const string &key, const string &value, const string &section)
 {
   map<string, string> *section_map = switch_session(section);
 
-  section_map->insert(pair<string, string>(key, value));
+  (*section_map)[key] = value;
 
   return 0;
 }
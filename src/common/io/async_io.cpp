@@ -0,0 +1,408 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#ifdef WITH_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "common/io/async_io.h"
+#include "common/lang/algorithm.h"
+#include "common/lang/chrono.h"
+#include "common/lang/condition_variable.h"
+#include "common/lang/queue.h"
+#include "common/lang/string.h"
+#include "common/lang/thread.h"
+#include "common/lang/vector.h"
+#include "common/log/log.h"
+#include "common/queue/queue.h"
+
+namespace common {
+
+int64_t AsyncIoRequest::size() const
+{
+  int64_t total = 0;
+  for (int i = 0; i < iov_count; i++) {
+    total += iovs[i].iov_len;
+  }
+  return total;
+}
+
+unique_ptr<AsyncIoEngine> AsyncIoEngine::create(const char *name, int queue_depth /*=DEFAULT_QUEUE_DEPTH*/)
+{
+  if (is_blank(name) || 0 == strcasecmp(name, "sync")) {
+    return make_unique<SyncIoEngine>();
+  }
+
+  const bool use_io_uring = 0 == strcasecmp(name, "io_uring");
+  if (!use_io_uring && 0 != strcasecmp(name, "thread_pool")) {
+    LOG_WARN("unknown async io engine: %s", name);
+    return nullptr;
+  }
+
+  if (use_io_uring) {
+#ifdef WITH_IO_URING
+    auto io_uring_engine = make_unique<IoUringEngine>();
+    RC   rc              = io_uring_engine->init(queue_depth);
+    if (OB_SUCC(rc)) {
+      return io_uring_engine;
+    }
+    LOG_WARN("failed to init io_uring, fall back to thread pool. rc=%s", strrc(rc));
+#else
+    LOG_WARN("io_uring is not compiled in(WITH_IO_URING), fall back to thread pool");
+#endif
+  }
+
+  // 线程太多没有意义，只是为了让多个IO重叠起来
+  auto thread_pool_engine = make_unique<ThreadPoolIoEngine>();
+  RC   rc                 = thread_pool_engine->init(min(queue_depth, 16));
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to init thread pool io engine, fall back to sync. rc=%s", strrc(rc));
+    return make_unique<SyncIoEngine>();
+  }
+  return thread_pool_engine;
+}
+
+void AsyncIoEngine::complete_sync(AsyncIoRequest &request, int64_t done)
+{
+  const int64_t total = request.size();
+
+  // 跳过已经完成的部分
+  vector<iovec> iovs(request.iovs, request.iovs + request.iov_count);
+  size_t        iov_index = 0;
+  auto          advance   = [&iovs, &iov_index](int64_t size) {
+    while (size > 0) {
+      if (size >= static_cast<int64_t>(iovs[iov_index].iov_len)) {
+        size -= iovs[iov_index].iov_len;
+        iov_index++;
+      } else {
+        iovs[iov_index].iov_base = static_cast<char *>(iovs[iov_index].iov_base) + size;
+        iovs[iov_index].iov_len -= size;
+        size = 0;
+      }
+    }
+  };
+  advance(done);
+
+  request.error = 0;
+  while (done < total) {
+    const int iov_count = static_cast<int>(min(iovs.size() - iov_index, static_cast<size_t>(IOV_MAX)));
+    ssize_t   ret       = 0;
+    if (request.type == AsyncIoRequest::Type::READ) {
+      ret = request.offset < 0 ? ::readv(request.fd, iovs.data() + iov_index, iov_count)
+                               : ::preadv(request.fd, iovs.data() + iov_index, iov_count, request.offset + done);
+    } else {
+      ret = request.offset < 0 ? ::writev(request.fd, iovs.data() + iov_index, iov_count)
+                               : ::pwritev(request.fd, iovs.data() + iov_index, iov_count, request.offset + done);
+    }
+
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret < 0) {
+      request.error = errno;
+      break;
+    }
+    if (ret == 0) {
+      // 读到了文件末尾
+      request.error = EIO;
+      break;
+    }
+
+    done += ret;
+    advance(ret);
+  }
+
+  request.transferred = done;
+}
+
+RC AsyncIoEngine::collect_result(span<AsyncIoRequest> requests)
+{
+  for (AsyncIoRequest &request : requests) {
+    if (request.error != 0) {
+      LOG_WARN("io request failed. fd=%d, offset=%ld, size=%ld, transferred=%ld, error=%s",
+               request.fd, request.offset, request.size(), request.transferred, strerror(request.error));
+      return request.type == AsyncIoRequest::Type::READ ? RC::IOERR_READ : RC::IOERR_WRITE;
+    }
+  }
+  return RC::SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+RC SyncIoEngine::submit_and_wait(span<AsyncIoRequest> requests)
+{
+  for (AsyncIoRequest &request : requests) {
+    complete_sync(request, 0);
+  }
+  return collect_result(requests);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief 没有任务时会等待一段时间的队列
+ * @details SimpleQueue 为空时立即返回，线程池的线程会一直空转。
+ * IO线程大部分时间都是空闲的，这里让它们在条件变量上等待。
+ */
+class IoTaskQueue : public Queue<unique_ptr<Runnable>>
+{
+public:
+  int push(value_type &&value) override
+  {
+    {
+      lock_guard<mutex> guard(mutex_);
+      queue_.push(std::move(value));
+    }
+    cond_.notify_one();
+    return 0;
+  }
+
+  int pop(value_type &value) override
+  {
+    unique_lock<mutex> guard(mutex_);
+    // 超时后返回，线程池需要检查是否已经关闭
+    if (!cond_.wait_for(guard, chrono::milliseconds(100), [this]() { return !queue_.empty(); })) {
+      return -1;
+    }
+
+    value = std::move(queue_.front());
+    queue_.pop();
+    return 0;
+  }
+
+  int size() const override
+  {
+    lock_guard<mutex> guard(mutex_);
+    return static_cast<int>(queue_.size());
+  }
+
+private:
+  mutable mutex      mutex_;
+  condition_variable cond_;
+  queue<value_type>  queue_;
+};
+
+ThreadPoolIoEngine::~ThreadPoolIoEngine()
+{
+  executor_.shutdown();
+  executor_.await_termination();
+}
+
+RC ThreadPoolIoEngine::init(int thread_num)
+{
+  thread_num = max(thread_num, 1);
+  int ret    = executor_.init("IoWorker", thread_num, thread_num, 0 /*keep_alive_time_ms*/, make_unique<IoTaskQueue>());
+  if (ret != 0) {
+    LOG_WARN("failed to init io thread pool. thread num=%d", thread_num);
+    return RC::INTERNAL;
+  }
+
+  LOG_INFO("thread pool io engine initialized. thread num=%d", thread_num);
+  return RC::SUCCESS;
+}
+
+RC ThreadPoolIoEngine::submit_and_wait(span<AsyncIoRequest> requests)
+{
+  if (requests.size() <= 1) {
+    for (AsyncIoRequest &request : requests) {
+      complete_sync(request, 0);
+    }
+    return collect_result(requests);
+  }
+
+  mutex              wait_lock;
+  condition_variable wait_cond;
+  size_t             pending = requests.size();
+
+  for (AsyncIoRequest &request : requests) {
+    AsyncIoRequest *request_ptr = &request;
+    int ret = executor_.execute([request_ptr, &wait_lock, &wait_cond, &pending]() {
+      complete_sync(*request_ptr, 0);
+
+      lock_guard<mutex> guard(wait_lock);
+      if (--pending == 0) {
+        wait_cond.notify_one();
+      }
+    });
+
+    if (ret != 0) {
+      // 线程池已经关闭，在当前线程中执行
+      complete_sync(request, 0);
+      lock_guard<mutex> guard(wait_lock);
+      pending--;
+    }
+  }
+
+  unique_lock<mutex> guard(wait_lock);
+  wait_cond.wait(guard, [&pending]() { return pending == 0; });
+  return collect_result(requests);
+}
+
+#ifdef WITH_IO_URING
+////////////////////////////////////////////////////////////////////////////////
+static int io_uring_setup(unsigned entries, io_uring_params *params)
+{
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+  return static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+IoUringEngine::~IoUringEngine()
+{
+  if (sqes_ != nullptr) {
+    ::munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+    ::munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != nullptr) {
+    ::munmap(sq_ring_, sq_ring_size_);
+  }
+  if (ring_fd_ >= 0) {
+    ::close(ring_fd_);
+  }
+}
+
+RC IoUringEngine::init(int queue_depth)
+{
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+
+  ring_fd_ = io_uring_setup(static_cast<unsigned>(max(queue_depth, 1)), &params);
+  if (ring_fd_ < 0) {
+    LOG_WARN("failed to setup io_uring. queue depth=%d, error=%s", queue_depth, strerror(errno));
+    return RC::UNSUPPORTED;
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = max(sq_ring_size_, cq_ring_size_);
+  }
+
+  void *ptr = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (ptr == MAP_FAILED) {
+    LOG_WARN("failed to mmap io_uring submission queue. error=%s", strerror(errno));
+    return RC::UNSUPPORTED;
+  }
+  sq_ring_ = ptr;
+
+  if (single_mmap) {
+    cq_ring_ = sq_ring_;
+  } else {
+    ptr = ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    if (ptr == MAP_FAILED) {
+      LOG_WARN("failed to mmap io_uring completion queue. error=%s", strerror(errno));
+      return RC::UNSUPPORTED;
+    }
+    cq_ring_ = ptr;
+  }
+
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  ptr = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (ptr == MAP_FAILED) {
+    LOG_WARN("failed to mmap io_uring submission entries. error=%s", strerror(errno));
+    return RC::UNSUPPORTED;
+  }
+  sqes_ = ptr;
+
+  char *sq = static_cast<char *>(sq_ring_);
+  char *cq = static_cast<char *>(cq_ring_);
+
+  sq_entries_ = params.sq_entries;
+  sq_head_    = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+  sq_tail_    = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  sq_mask_    = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  sq_array_   = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  cq_head_    = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  cq_tail_    = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  cq_mask_    = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  cqes_       = cq + params.cq_off.cqes;
+
+  LOG_INFO("io_uring io engine initialized. sq entries=%u, cq entries=%u", params.sq_entries, params.cq_entries);
+  return RC::SUCCESS;
+}
+
+void IoUringEngine::prepare(AsyncIoRequest &request, uint64_t index)
+{
+  const unsigned tail = *sq_tail_;
+  const unsigned slot = tail & *sq_mask_;
+
+  io_uring_sqe *sqe = static_cast<io_uring_sqe *>(sqes_) + slot;
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode    = request.type == AsyncIoRequest::Type::READ ? IORING_OP_READV : IORING_OP_WRITEV;
+  sqe->fd        = request.fd;
+  sqe->off       = request.offset < 0 ? static_cast<uint64_t>(-1) : static_cast<uint64_t>(request.offset);
+  sqe->addr      = reinterpret_cast<uint64_t>(request.iovs);
+  sqe->len       = static_cast<unsigned>(min(request.iov_count, IOV_MAX));
+  sqe->user_data = index;
+
+  sq_array_[slot] = slot;
+  // 内核看到新的tail时，提交项必须已经填写好了
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+}
+
+RC IoUringEngine::submit_and_wait(span<AsyncIoRequest> requests)
+{
+  lock_guard<mutex> guard(lock_);
+
+  const size_t total     = requests.size();
+  size_t       prepared  = 0;
+  size_t       completed = 0;
+  while (completed < total) {
+    // 在途的请求不能超过提交队列的长度，完成队列是提交队列的两倍，不会溢出
+    while (prepared < total && prepared - completed < sq_entries_) {
+      prepare(requests[prepared], prepared);
+      prepared++;
+    }
+
+    const unsigned to_submit = *sq_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    int            ret       = io_uring_enter(ring_fd_, to_submit, 1 /*min_complete*/, IORING_ENTER_GETEVENTS);
+    if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      // 已经提交的请求还可能在执行，不能直接返回，否则调用者可能释放了正在读写的内存
+      LOG_ERROR("failed to enter io_uring. error=%s", strerror(errno));
+      this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    unsigned       head = *cq_head_;
+    const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+      const io_uring_cqe &cqe     = static_cast<io_uring_cqe *>(cqes_)[head & *cq_mask_];
+      AsyncIoRequest     &request = requests[cqe.user_data];
+      if (cqe.res < 0) {
+        request.transferred = 0;
+        request.error       = -cqe.res;
+      } else if (cqe.res < request.size()) {
+        // 只完成了一部分，剩余的部分同步处理，读到文件末尾时会设置错误
+        complete_sync(request, cqe.res);
+      } else {
+        request.transferred = cqe.res;
+        request.error       = 0;
+      }
+      completed++;
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+  }
+
+  return collect_result(requests);
+}
+#endif  // WITH_IO_URING
+
+}  // namespace common
@@ -0,0 +1,189 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "common/lang/memory.h"
+#include "common/lang/mutex.h"
+#include "common/lang/span.h"
+#include "common/sys/rc.h"
+#include "common/thread/thread_pool_executor.h"
+
+namespace common {
+
+/**
+ * @brief 一个读写请求
+ * @details 对应一次 preadv/pwritev。iovs 指向的内存由调用者管理，在请求完成之前不能释放。
+ */
+struct AsyncIoRequest
+{
+  enum class Type
+  {
+    READ,
+    WRITE
+  };
+
+  Type         type      = Type::READ;
+  int          fd        = -1;
+  int64_t      offset    = 0;  ///< 文件偏移。小于0表示使用文件当前的位置，比如以 O_APPEND 方式打开的日志文件
+  const iovec *iovs      = nullptr;
+  int          iov_count = 0;
+
+  int64_t transferred = 0;  ///< 完成后设置，读写成功的字节数
+  int     error       = 0;  ///< 完成后设置，失败时的errno，0表示成功
+
+  static AsyncIoRequest read(int fd, int64_t offset, const iovec *iovs, int iov_count)
+  {
+    return AsyncIoRequest{Type::READ, fd, offset, iovs, iov_count};
+  }
+  static AsyncIoRequest write(int fd, int64_t offset, const iovec *iovs, int iov_count)
+  {
+    return AsyncIoRequest{Type::WRITE, fd, offset, iovs, iov_count};
+  }
+
+  /// @brief 请求的总字节数
+  int64_t size() const;
+};
+
+/**
+ * @brief 文件读写引擎
+ * @details buffer pool、double write buffer 和日志模块通过这个接口读写文件。
+ * 调用者一次提交一批请求，引擎负责让这些请求尽量并行执行，全部完成后再返回，
+ * 这样批量刷页面、预读等场景中多个IO可以重叠，而不是一个接一个地执行。
+ * 每个请求都会完整地读写所有数据，只写入(读取)一部分的情况由引擎内部继续处理，读到文件末尾按照失败处理。
+ * 当前支持的引擎：
+ * - sync: 在调用者线程中逐个执行，也是默认的引擎；
+ * - thread_pool: 把请求分发到一个线程池中执行；
+ * - io_uring: 使用 Linux io_uring 批量提交，需要编译时打开 WITH_IO_URING。
+ *   不支持时(比如内核版本过低或者容器禁止了相关的系统调用)退化为 thread_pool。
+ * 所有的引擎都是线程安全的，可以被多个模块共享。
+ */
+class AsyncIoEngine
+{
+public:
+  virtual ~AsyncIoEngine() = default;
+
+  virtual const char *name() const = 0;
+
+  /**
+   * @brief 提交一批请求并等待它们全部完成
+   * @details 每个请求的结果记录在请求的 transferred 和 error 中。
+   * @return 所有请求都成功时返回SUCCESS，否则返回第一个失败请求对应的错误码
+   */
+  virtual RC submit_and_wait(span<AsyncIoRequest> requests) = 0;
+
+  /// @brief 只有一个请求时的便捷接口
+  RC submit_and_wait(AsyncIoRequest &request) { return submit_and_wait(span<AsyncIoRequest>(&request, 1)); }
+
+  /**
+   * @brief 根据名称创建引擎
+   * @param name        sync、thread_pool 或 io_uring，名称为空时创建 sync 引擎
+   * @param queue_depth 最多同时执行的请求个数，对 thread_pool 来说是线程个数
+   * @return 名称不认识时返回nullptr
+   */
+  static unique_ptr<AsyncIoEngine> create(const char *name, int queue_depth = DEFAULT_QUEUE_DEPTH);
+
+  static constexpr int DEFAULT_QUEUE_DEPTH = 64;
+
+protected:
+  /**
+   * @brief 在当前线程中同步地完成请求的剩余部分
+   * @param done 已经完成的字节数
+   */
+  static void complete_sync(AsyncIoRequest &request, int64_t done);
+
+  /// @brief 汇总一批请求的结果
+  static RC collect_result(span<AsyncIoRequest> requests);
+};
+
+/**
+ * @brief 同步读写引擎
+ * @details 在调用者的线程中逐个执行请求
+ */
+class SyncIoEngine : public AsyncIoEngine
+{
+public:
+  const char *name() const override { return "sync"; }
+
+  RC submit_and_wait(span<AsyncIoRequest> requests) override;
+};
+
+/**
+ * @brief 基于线程池的读写引擎
+ * @details 不支持 io_uring 时使用。只有一个请求时直接在调用者线程中执行。
+ */
+class ThreadPoolIoEngine : public AsyncIoEngine
+{
+public:
+  virtual ~ThreadPoolIoEngine();
+
+  const char *name() const override { return "thread_pool"; }
+
+  RC init(int thread_num);
+
+  RC submit_and_wait(span<AsyncIoRequest> requests) override;
+
+private:
+  ThreadPoolExecutor executor_;
+};
+
+#ifdef WITH_IO_URING
+/**
+ * @brief 基于 io_uring 的读写引擎
+ * @details 直接使用系统调用操作 io_uring，不依赖 liburing。
+ * 所有请求共享一个 ring，一批请求一次性提交到内核，再一起等待完成，提交和收割由一把锁保护。
+ */
+class IoUringEngine : public AsyncIoEngine
+{
+public:
+  virtual ~IoUringEngine();
+
+  const char *name() const override { return "io_uring"; }
+
+  /**
+   * @brief 创建 io_uring
+   * @return 内核不支持时返回 UNSUPPORTED
+   */
+  RC init(int queue_depth);
+
+  RC submit_and_wait(span<AsyncIoRequest> requests) override;
+
+private:
+  /// @brief 把 requests[index] 放到提交队列中
+  void prepare(AsyncIoRequest &request, uint64_t index);
+
+private:
+  int ring_fd_ = -1;
+
+  void  *sq_ring_      = nullptr;
+  size_t sq_ring_size_ = 0;
+  void  *cq_ring_      = nullptr;
+  size_t cq_ring_size_ = 0;
+  void  *sqes_         = nullptr;
+  size_t sqes_size_    = 0;
+
+  unsigned  sq_entries_ = 0;
+  unsigned *sq_head_    = nullptr;
+  unsigned *sq_tail_    = nullptr;
+  unsigned *sq_mask_    = nullptr;
+  unsigned *sq_array_   = nullptr;
+  unsigned *cq_head_    = nullptr;
+  unsigned *cq_tail_    = nullptr;
+  unsigned *cq_mask_    = nullptr;
+  void     *cqes_       = nullptr;
+
+  mutex lock_;
+};
+#endif  // WITH_IO_URING
+
+}  // namespace common
@@ -12,6 +12,7 @@ See the Mulan PSL v2 for more details. */
 
 #include <algorithm>
 
+using std::binary_search;
 using std::max;
 using std::min;
 using std::swap;
@@ -36,6 +36,7 @@ using std::mutex;
 using std::once_flag;
 using std::scoped_lock;
 using std::shared_mutex;
+using std::try_to_lock;
 using std::unique_lock;
 
 namespace common {
@@ -25,3 +25,57 @@ See the Mulan PSL v2 for more details. */
 #define SOCKET_BUFFER_SIZE 8192
 
 #define SESSION_STAGE_NAME "SessionStage"
+
+//! storage settings
+#define STORAGE "STORAGE"
+// frame eviction policy of buffer pool: lru or 2q
+#define BUFFER_POOL_EVICTION_POLICY "BUFFER_POOL_EVICTION_POLICY"
+#define BUFFER_POOL_EVICTION_POLICY_DEFAULT "lru"
+// whether frames of buffer pool are backed by huge pages: 0 or 1
+#define BUFFER_POOL_HUGE_PAGE "BUFFER_POOL_HUGE_PAGE"
+#define BUFFER_POOL_HUGE_PAGE_DEFAULT "0"
+// whether frames of buffer pool are split into per NUMA node sub-arenas: 0 or 1
+#define BUFFER_POOL_NUMA_AWARE "BUFFER_POOL_NUMA_AWARE"
+#define BUFFER_POOL_NUMA_AWARE_DEFAULT "0"
+// the share of clean (or free) frames the background page cleaner tries to keep. 0 disables the page cleaner
+#define BUFFER_POOL_CLEAN_FRAME_RATIO "BUFFER_POOL_CLEAN_FRAME_RATIO"
+#define BUFFER_POOL_CLEAN_FRAME_RATIO_DEFAULT "0.1"
+// how often the background page cleaner checks the buffer pool, in milliseconds
+#define BUFFER_POOL_CLEANER_INTERVAL_MS "BUFFER_POOL_CLEANER_INTERVAL_MS"
+#define BUFFER_POOL_CLEANER_INTERVAL_MS_DEFAULT "100"
+// max pages in each of the two batches of the double write buffer
+#define DOUBLE_WRITE_BUFFER_PAGES "DOUBLE_WRITE_BUFFER_PAGES"
+#define DOUBLE_WRITE_BUFFER_PAGES_DEFAULT "64"
+// a batch of the double write buffer is flushed at least this often, in milliseconds
+#define DOUBLE_WRITE_BUFFER_FLUSH_INTERVAL_MS "DOUBLE_WRITE_BUFFER_FLUSH_INTERVAL_MS"
+#define DOUBLE_WRITE_BUFFER_FLUSH_INTERVAL_MS_DEFAULT "1000"
+// interval of the background fuzzy checkpoint, in milliseconds. 0 disables periodic checkpoints
+#define CHECKPOINT_INTERVAL_MS "CHECKPOINT_INTERVAL_MS"
+#define CHECKPOINT_INTERVAL_MS_DEFAULT "30000"
+// io engine shared by buffer pool, double write buffer and log: sync, thread_pool or io_uring
+#define IO_ENGINE "IO_ENGINE"
+#define IO_ENGINE_DEFAULT "sync"
+// durability of the redo log: none, write, fdatasync or dsync
+#define LOG_DURABILITY "LOG_DURABILITY"
+#define LOG_DURABILITY_DEFAULT "fdatasync"
+// threads replaying the redo log in parallel at restart. 0 means the number of CPUs, 1 replays in one thread
+#define RECOVERY_THREADS "RECOVERY_THREADS"
+#define RECOVERY_THREADS_DEFAULT "0"
+// compression of the redo log files: none, builtin or lz4
+#define LOG_COMPRESSION "LOG_COMPRESSION"
+#define LOG_COMPRESSION_DEFAULT "none"
+// interval of the background purge of dead mvcc record versions, in milliseconds. 0 disables it
+#define PURGE_INTERVAL_MS "PURGE_INTERVAL_MS"
+#define PURGE_INTERVAL_MS_DEFAULT "1000"
+// pages scanned by the background purge in each interval, the io budget of the purge
+#define PURGE_BATCH_PAGES "PURGE_BATCH_PAGES"
+#define PURGE_BATCH_PAGES_DEFAULT "64"
+// how long a transaction waits for a row lock held by another transaction, in milliseconds
+#define LOCK_WAIT_TIMEOUT_MS "LOCK_WAIT_TIMEOUT_MS"
+#define LOCK_WAIT_TIMEOUT_MS_DEFAULT "50000"
+// memory for sorting the keys of an index created on a table with data, in MB
+#define INDEX_BUILD_SORT_MEMORY_MB "INDEX_BUILD_SORT_MEMORY_MB"
+#define INDEX_BUILD_SORT_MEMORY_MB_DEFAULT "64"
+// how full the nodes of an index created on a table with data are packed, in (0, 1]
+#define INDEX_BUILD_FILL_FACTOR "INDEX_BUILD_FILL_FACTOR"
+#define INDEX_BUILD_FILL_FACTOR_DEFAULT "0.9"
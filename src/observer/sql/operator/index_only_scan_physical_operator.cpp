@@ -0,0 +1,105 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "sql/operator/index_only_scan_physical_operator.h"
+#include "storage/index/index.h"
+#include "storage/trx/trx.h"
+
+IndexOnlyScanPhysicalOperator::IndexOnlyScanPhysicalOperator(Table *table, Index *index,
+    const vector<Value> &left_values, bool left_inclusive, const vector<Value> &right_values, bool right_inclusive)
+    : IndexScanPhysicalOperator(
+          table, index, ReadWriteMode::READ_ONLY, left_values, left_inclusive, right_values, right_inclusive)
+{}
+
+RC IndexOnlyScanPhysicalOperator::open(Trx *trx)
+{
+  RC rc = IndexScanPhysicalOperator::open(trx);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  record_buffer_.assign(table_->table_meta().record_size(), 0);
+  index_record_.set_data(record_buffer_.data(), static_cast<int>(record_buffer_.size()));
+  record_           = &index_record_;
+  heap_fetch_count_ = 0;
+  return RC::SUCCESS;
+}
+
+void IndexOnlyScanPhysicalOperator::fill_record(const char *user_key, const char *include_data)
+{
+  int offset = 0;
+  for (const FieldMeta &field_meta : index_->field_metas()) {
+    memcpy(record_buffer_.data() + field_meta.offset(), user_key + offset, field_meta.len());
+    offset += field_meta.len();
+  }
+
+  offset = 0;
+  for (const FieldMeta &field_meta : index_->include_field_metas()) {
+    memcpy(record_buffer_.data() + field_meta.offset(), include_data + offset, field_meta.len());
+    offset += field_meta.len();
+  }
+}
+
+RC IndexOnlyScanPhysicalOperator::next()
+{
+  if (nullptr == index_scanner_) {
+    return RC::RECORD_EOF;
+  }
+
+  RID         rid;
+  const char *user_key      = nullptr;
+  const char *include_data  = nullptr;
+  bool        filter_result = false;
+  RC          rc            = RC::SUCCESS;
+  while (OB_SUCC(rc = index_scanner_->next_entry(&rid, user_key, include_data))) {
+    if (trx_->page_visible(table_, rid.page_num)) {
+      fill_record(user_key, include_data);
+      index_record_.set_rid(rid);
+      record_ = &index_record_;
+    } else {
+      // 页面上可能有未提交或者已经删除的记录，需要读取记录判断可见性
+      heap_fetch_count_++;
+      rc = record_handler_->get_record(rid, current_record_);
+      if (OB_FAIL(rc)) {
+        LOG_TRACE("failed to get record. rid=%s, rc=%s", rid.to_string().c_str(), strrc(rc));
+        return rc;
+      }
+
+      rc = trx_->visit_record(table_, current_record_, mode_);
+      if (rc == RC::RECORD_INVISIBLE) {
+        LOG_TRACE("record invisible");
+        continue;
+      } else if (OB_FAIL(rc)) {
+        return rc;
+      }
+      record_ = &current_record_;
+    }
+
+    tuple_.set_record(record_);
+    rc = filter(tuple_, filter_result);
+    if (OB_FAIL(rc)) {
+      LOG_TRACE("failed to filter record. rc=%s", strrc(rc));
+      return rc;
+    }
+
+    if (filter_result) {
+      return RC::SUCCESS;
+    }
+    LOG_TRACE("record filtered");
+  }
+
+  return rc;
+}
+
+Tuple *IndexOnlyScanPhysicalOperator::current_tuple()
+{
+  tuple_.set_record(record_);
+  return &tuple_;
+}
@@ -0,0 +1,50 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "sql/operator/index_scan_physical_operator.h"
+
+/**
+ * @brief 覆盖索引扫描物理算子
+ * @details 查询用到的字段都在索引的键值或INCLUDE字段中时，直接使用B+树叶子节点中的数据拼出记录，
+ * 不再读取表中的记录。只有记录所在的页面没有标记为对所有事务可见时，才需要读取记录判断可见性。
+ * 拼出来的记录中只有索引中的字段是有效的。
+ * @ingroup PhysicalOperator
+ */
+class IndexOnlyScanPhysicalOperator : public IndexScanPhysicalOperator
+{
+public:
+  IndexOnlyScanPhysicalOperator(Table *table, Index *index, const vector<Value> &left_values, bool left_inclusive,
+      const vector<Value> &right_values, bool right_inclusive);
+
+  virtual ~IndexOnlyScanPhysicalOperator() = default;
+
+  PhysicalOperatorType type() const override { return PhysicalOperatorType::INDEX_ONLY_SCAN; }
+
+  RC open(Trx *trx) override;
+  RC next() override;
+
+  Tuple *current_tuple() override;
+
+  /// @brief 读取过表中记录的次数
+  int64_t heap_fetch_count() const { return heap_fetch_count_; }
+
+private:
+  /// @brief 把索引中的键值和INCLUDE字段复制到 index_record_ 中对应字段的位置
+  void fill_record(const char *user_key, const char *include_data);
+
+private:
+  vector<char> record_buffer_;  ///< index_record_ 的数据
+  Record       index_record_;   ///< 使用索引中的数据拼出来的记录
+  Record      *record_ = nullptr;
+
+  int64_t heap_fetch_count_ = 0;
+};
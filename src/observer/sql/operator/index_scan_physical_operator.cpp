@@ -13,24 +13,20 @@ See the Mulan PSL v2 for more details. */
 //
 
 #include "sql/operator/index_scan_physical_operator.h"
+#include "common/lang/algorithm.h"
 #include "storage/index/index.h"
 #include "storage/trx/trx.h"
 
-IndexScanPhysicalOperator::IndexScanPhysicalOperator(Table *table, Index *index, ReadWriteMode mode, const Value *left_value,
-    bool left_inclusive, const Value *right_value, bool right_inclusive)
+IndexScanPhysicalOperator::IndexScanPhysicalOperator(Table *table, Index *index, ReadWriteMode mode,
+    const vector<Value> &left_values, bool left_inclusive, const vector<Value> &right_values, bool right_inclusive)
     : table_(table),
       index_(index),
       mode_(mode),
+      left_values_(left_values),
+      right_values_(right_values),
       left_inclusive_(left_inclusive),
       right_inclusive_(right_inclusive)
-{
-  if (left_value) {
-    left_value_ = *left_value;
-  }
-  if (right_value) {
-    right_value_ = *right_value;
-  }
-}
+{}
 
 RC IndexScanPhysicalOperator::open(Trx *trx)
 {
@@ -38,12 +34,27 @@ RC IndexScanPhysicalOperator::open(Trx *trx)
     return RC::INTERNAL;
   }
 
-  IndexScanner *index_scanner = index_->create_scanner(left_value_.data(),
-      left_value_.length(),
-      left_inclusive_,
-      right_value_.data(),
-      right_value_.length(),
-      right_inclusive_);
+  tuple_.set_schema(table_, table_->table_meta().field_metas());
+  trx_ = trx;
+
+  if (empty_range()) {
+    LOG_TRACE("empty index scan range");
+    return RC::SUCCESS;
+  }
+
+  bool         left_inclusive  = left_inclusive_;
+  bool         right_inclusive = right_inclusive_;
+  vector<char> left_key;
+  vector<char> right_key;
+  make_key(left_values_, left_inclusive, left_key);
+  make_key(right_values_, right_inclusive, right_key);
+
+  IndexScanner *index_scanner = index_->create_scanner(left_values_.empty() ? nullptr : left_key.data(),
+      static_cast<int>(left_key.size()),
+      left_inclusive,
+      right_values_.empty() ? nullptr : right_key.data(),
+      static_cast<int>(right_key.size()),
+      right_inclusive);
   if (nullptr == index_scanner) {
     LOG_WARN("failed to create index scanner");
     return RC::INTERNAL;
@@ -56,11 +67,47 @@ RC IndexScanPhysicalOperator::open(Trx *trx)
     return RC::INTERNAL;
   }
   index_scanner_ = index_scanner;
+  return RC::SUCCESS;
+}
 
-  tuple_.set_schema(table_, table_->table_meta().field_metas());
+void IndexScanPhysicalOperator::make_key(const vector<Value> &values, bool &inclusive, vector<char> &key) const
+{
+  const vector<FieldMeta> &field_metas = index_->field_metas();
+  for (size_t i = 0; i < values.size(); i++) {
+    const FieldMeta &field_meta = field_metas[i];
+    const Value     &value      = values[i];
+
+    // 截断之后的值可能与索引中的值相等，扩大扫描范围，由谓词过滤
+    if (value.length() > field_meta.len()) {
+      inclusive = true;
+    }
 
-  trx_ = trx;
-  return RC::SUCCESS;
+    if (field_metas.size() == 1) {
+      // 只有一个字段时直接使用值的内容，字符串的长度由B+树调整
+      key.assign(value.data(), value.data() + value.length());
+      return;
+    }
+
+    const int copy_len = min(value.length(), field_meta.len());
+    key.insert(key.end(), value.data(), value.data() + copy_len);
+    key.insert(key.end(), field_meta.len() - copy_len, 0);
+  }
+}
+
+bool IndexScanPhysicalOperator::empty_range() const
+{
+  if (left_values_.empty() || right_values_.empty()) {
+    return false;
+  }
+
+  const size_t compare_num = min(left_values_.size(), right_values_.size());
+  for (size_t i = 0; i < compare_num; i++) {
+    const int result = left_values_[i].compare(right_values_[i]);
+    if (result != 0) {
+      return result > 0;
+    }
+  }
+  return left_values_.size() == right_values_.size() && (!left_inclusive_ || !right_inclusive_);
 }
 
 RC IndexScanPhysicalOperator::next()
@@ -68,6 +115,10 @@ RC IndexScanPhysicalOperator::next()
   RID rid;
   RC  rc = RC::SUCCESS;
 
+  if (nullptr == index_scanner_) {
+    return RC::RECORD_EOF;
+  }
+
   bool filter_result = false;
   while (RC::SUCCESS == (rc = index_scanner_->next_entry(&rid))) {
     rc = record_handler_->get_record(rid, current_record_);
@@ -104,8 +155,10 @@ RC IndexScanPhysicalOperator::next()
 
 RC IndexScanPhysicalOperator::close()
 {
-  index_scanner_->destroy();
-  index_scanner_ = nullptr;
+  if (nullptr != index_scanner_) {
+    index_scanner_->destroy();
+    index_scanner_ = nullptr;
+  }
   return RC::SUCCESS;
 }
 
@@ -20,13 +20,14 @@ See the Mulan PSL v2 for more details. */
 
 /**
  * @brief 索引扫描物理算子
+ * @details 左右边界是索引前几个字段的值，联合索引可以只指定前缀。没有值表示没有边界。
  * @ingroup PhysicalOperator
  */
 class IndexScanPhysicalOperator : public PhysicalOperator
 {
 public:
-  IndexScanPhysicalOperator(Table *table, Index *index, ReadWriteMode mode, const Value *left_value,
-      bool left_inclusive, const Value *right_value, bool right_inclusive);
+  IndexScanPhysicalOperator(Table *table, Index *index, ReadWriteMode mode, const vector<Value> &left_values,
+      bool left_inclusive, const vector<Value> &right_values, bool right_inclusive);
 
   virtual ~IndexScanPhysicalOperator() = default;
 
@@ -42,11 +43,20 @@ public:
 
   void set_predicates(vector<unique_ptr<Expression>> &&exprs);
 
-private:
+protected:
   // 与TableScanPhysicalOperator代码相同，可以优化
   RC filter(RowTuple &tuple, bool &result);
 
-private:
+  /**
+   * @brief 把边界上各个字段的值拼接成索引的键值
+   * @param[in,out] inclusive 字符串超过字段长度被截断时，边界需要包含在内
+   */
+  void make_key(const vector<Value> &values, bool &inclusive, vector<char> &key) const;
+
+  /// @brief 左边界大于右边界时扫描范围为空
+  bool empty_range() const;
+
+protected:
   Trx               *trx_            = nullptr;
   Table             *table_          = nullptr;
   Index             *index_          = nullptr;
@@ -57,10 +67,10 @@ private:
   Record   current_record_;
   RowTuple tuple_;
 
-  Value left_value_;
-  Value right_value_;
-  bool  left_inclusive_  = false;
-  bool  right_inclusive_ = false;
+  vector<Value> left_values_;
+  vector<Value> right_values_;
+  bool          left_inclusive_  = false;
+  bool          right_inclusive_ = false;
 
   vector<unique_ptr<Expression>> predicates_;
 };
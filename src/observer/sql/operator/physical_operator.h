@@ -36,6 +36,7 @@ enum class PhysicalOperatorType
   TABLE_SCAN,
   TABLE_SCAN_VEC,
   INDEX_SCAN,
+  INDEX_ONLY_SCAN,
   NESTED_LOOP_JOIN,
   EXPLAIN,
   PREDICATE,
@@ -22,3 +22,9 @@ void TableGetLogicalOperator::set_predicates(vector<unique_ptr<Expression>> &&ex
 {
   predicates_ = std::move(exprs);
 }
+
+void TableGetLogicalOperator::set_referenced_fields(vector<const FieldMeta *> &&fields)
+{
+  referenced_fields_     = std::move(fields);
+  has_referenced_fields_ = true;
+}
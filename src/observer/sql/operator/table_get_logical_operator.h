@@ -36,10 +36,21 @@ public:
   void set_predicates(vector<unique_ptr<Expression>> &&exprs);
   auto predicates() -> vector<unique_ptr<Expression>> & { return predicates_; }
 
+  /**
+   * @brief 设置查询用到的这张表的字段
+   * @details 生成物理计划时用来判断索引是否覆盖了所有的字段。没有设置时认为用到了所有字段
+   */
+  void set_referenced_fields(vector<const FieldMeta *> &&fields);
+  bool has_referenced_fields() const { return has_referenced_fields_; }
+  const vector<const FieldMeta *> &referenced_fields() const { return referenced_fields_; }
+
 private:
   Table        *table_ = nullptr;
   ReadWriteMode mode_  = ReadWriteMode::READ_WRITE;
 
+  bool                      has_referenced_fields_ = false;
+  vector<const FieldMeta *> referenced_fields_;
+
   // 与当前表相关的过滤操作，可以尝试在遍历数据时执行
   // 这里的表达式都是比较简单的比较运算，并且左右两边都是取字段表达式或值表达式
   // 不包含复杂的表达式运算，比如加减乘除、或者conjunction expression
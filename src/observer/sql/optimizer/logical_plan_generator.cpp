@@ -14,6 +14,7 @@ See the Mulan PSL v2 for more details. */
 
 #include "sql/optimizer/logical_plan_generator.h"
 
+#include "common/lang/algorithm.h"
 #include "common/log/log.h"
 
 #include "sql/operator/calc_logical_operator.h"
@@ -93,10 +94,18 @@ RC LogicalPlanGenerator::create_plan(SelectStmt *select_stmt, unique_ptr<Logical
   unique_ptr<LogicalOperator> table_oper(nullptr);
   last_oper = &table_oper;
 
+  unordered_map<const Table *, vector<const FieldMeta *>> referenced_fields;
+  RC rc = collect_referenced_fields(select_stmt, referenced_fields);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to collect referenced fields. rc=%s", strrc(rc));
+    return rc;
+  }
+
   const vector<Table *> &tables = select_stmt->tables();
   for (Table *table : tables) {
 
-    unique_ptr<LogicalOperator> table_get_oper(new TableGetLogicalOperator(table, ReadWriteMode::READ_ONLY));
+    auto table_get_oper = make_unique<TableGetLogicalOperator>(table, ReadWriteMode::READ_ONLY);
+    table_get_oper->set_referenced_fields(std::move(referenced_fields[table]));
     if (table_oper == nullptr) {
       table_oper = std::move(table_get_oper);
     } else {
@@ -109,7 +118,7 @@ RC LogicalPlanGenerator::create_plan(SelectStmt *select_stmt, unique_ptr<Logical
 
   unique_ptr<LogicalOperator> predicate_oper;
 
-  RC rc = create_plan(select_stmt->filter_stmt(), predicate_oper);
+  rc = create_plan(select_stmt->filter_stmt(), predicate_oper);
   if (OB_FAIL(rc)) {
     LOG_WARN("failed to create predicate logical plan. rc=%s", strrc(rc));
     return rc;
@@ -147,6 +156,48 @@ RC LogicalPlanGenerator::create_plan(SelectStmt *select_stmt, unique_ptr<Logical
   return RC::SUCCESS;
 }
 
+RC LogicalPlanGenerator::collect_referenced_fields(
+    SelectStmt *select_stmt, unordered_map<const Table *, vector<const FieldMeta *>> &referenced_fields)
+{
+  auto add_field = [&referenced_fields](const Field &field) {
+    vector<const FieldMeta *> &fields = referenced_fields[field.table()];
+    if (find(fields.begin(), fields.end(), field.meta()) == fields.end()) {
+      fields.push_back(field.meta());
+    }
+  };
+
+  function<RC(unique_ptr<Expression> &)> collector = [&](unique_ptr<Expression> &expr) -> RC {
+    if (expr->type() == ExprType::FIELD) {
+      add_field(static_cast<FieldExpr *>(expr.get())->field());
+      return RC::SUCCESS;
+    }
+    return ExpressionIterator::iterate_child_expr(*expr, collector);
+  };
+
+  RC rc = RC::SUCCESS;
+  for (unique_ptr<Expression> &expr : select_stmt->query_expressions()) {
+    if (OB_FAIL(rc = collector(expr))) {
+      return rc;
+    }
+  }
+  for (unique_ptr<Expression> &expr : select_stmt->group_by()) {
+    if (OB_FAIL(rc = collector(expr))) {
+      return rc;
+    }
+  }
+
+  if (select_stmt->filter_stmt() != nullptr) {
+    for (const FilterUnit *filter_unit : select_stmt->filter_stmt()->filter_units()) {
+      for (const FilterObj *filter_obj : {&filter_unit->left(), &filter_unit->right()}) {
+        if (filter_obj->is_attr) {
+          add_field(filter_obj->field);
+        }
+      }
+    }
+  }
+  return rc;
+}
+
 RC LogicalPlanGenerator::create_plan(FilterStmt *filter_stmt, unique_ptr<LogicalOperator> &logical_operator)
 {
   RC                                  rc = RC::SUCCESS;
@@ -15,6 +15,8 @@ See the Mulan PSL v2 for more details. */
 #pragma once
 
 #include "common/lang/memory.h"
+#include "common/lang/unordered_map.h"
+#include "common/lang/vector.h"
 #include "common/sys/rc.h"
 #include "common/type/attr_type.h"
 
@@ -26,6 +28,8 @@ class InsertStmt;
 class DeleteStmt;
 class ExplainStmt;
 class LogicalOperator;
+class Table;
+class FieldMeta;
 
 class LogicalPlanGenerator
 {
@@ -45,5 +49,11 @@ private:
 
   RC create_group_by_plan(SelectStmt *select_stmt, unique_ptr<LogicalOperator> &logical_operator);
 
+  /**
+   * @brief 收集查询中每张表用到的字段，包括查询、分组和过滤条件中的字段
+   */
+  RC collect_referenced_fields(
+      SelectStmt *select_stmt, unordered_map<const Table *, vector<const FieldMeta *>> &referenced_fields);
+
   int implicit_cast_cost(AttrType from, AttrType to);
 };
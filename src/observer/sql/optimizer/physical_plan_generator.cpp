@@ -23,6 +23,7 @@ See the Mulan PSL v2 for more details. */
 #include "sql/operator/explain_physical_operator.h"
 #include "sql/operator/expr_vec_physical_operator.h"
 #include "sql/operator/group_by_vec_physical_operator.h"
+#include "sql/operator/index_only_scan_physical_operator.h"
 #include "sql/operator/index_scan_physical_operator.h"
 #include "sql/operator/insert_logical_operator.h"
 #include "sql/operator/insert_physical_operator.h"
@@ -41,6 +42,8 @@ See the Mulan PSL v2 for more details. */
 #include "sql/operator/scalar_group_by_physical_operator.h"
 #include "sql/operator/table_scan_vec_physical_operator.h"
 #include "sql/optimizer/physical_plan_generator.h"
+#include "storage/index/index.h"
+#include "storage/table/table.h"
 
 using namespace std;
 
@@ -122,72 +125,190 @@ RC PhysicalPlanGenerator::create_vec(LogicalOperator &logical_operator, unique_p
 RC PhysicalPlanGenerator::create_plan(TableGetLogicalOperator &table_get_oper, unique_ptr<PhysicalOperator> &oper)
 {
   vector<unique_ptr<Expression>> &predicates = table_get_oper.predicates();
-  // 看看是否有可以用于索引查找的表达式
+  // 看看是否有可以用于索引查找的表达式，选择能匹配最长前缀的索引
   Table *table = table_get_oper.table();
 
-  Index     *index      = nullptr;
-  ValueExpr *value_expr = nullptr;
-  for (auto &expr : predicates) {
-    if (expr->type() == ExprType::COMPARISON) {
-      auto comparison_expr = static_cast<ComparisonExpr *>(expr.get());
-      // 简单处理，就找等值查询
-      if (comparison_expr->comp() != EQUAL_TO) {
+  struct IndexChoice
+  {
+    Index        *index           = nullptr;
+    int           matched_num     = 0;
+    vector<Value> left_values;
+    vector<Value> right_values;
+    bool          left_inclusive  = true;
+    bool          right_inclusive = true;
+  };
+
+  // 只读查询用到的字段都在索引中时，即使没有匹配的谓词，扫描整个索引也比扫描表要少读很多数据
+  const bool  try_index_only = table_get_oper.read_write_mode() == ReadWriteMode::READ_ONLY &&
+                               table_get_oper.has_referenced_fields();
+  IndexChoice best;
+  IndexChoice best_covering;
+  best_covering.matched_num = -1;
+  for (Index *candidate : table->indexes()) {
+    IndexChoice choice;
+    choice.index       = candidate;
+    choice.matched_num = match_index_prefix(table,
+        *candidate,
+        predicates,
+        choice.left_values,
+        choice.left_inclusive,
+        choice.right_values,
+        choice.right_inclusive);
+
+    if (try_index_only && choice.matched_num > best_covering.matched_num &&
+        index_covers(*candidate, table_get_oper.referenced_fields())) {
+      best_covering = choice;
+    }
+    if (choice.matched_num > best.matched_num) {
+      best = std::move(choice);
+    }
+  }
+
+  // 覆盖索引匹配的前缀不比其它索引短时才使用，否则回表的代价通常比扫描更多的索引项要小
+  if (best_covering.index != nullptr && best_covering.matched_num >= best.matched_num) {
+    auto index_only_scan_oper = new IndexOnlyScanPhysicalOperator(table,
+        best_covering.index,
+        best_covering.left_values,
+        best_covering.left_inclusive,
+        best_covering.right_values,
+        best_covering.right_inclusive);
+
+    index_only_scan_oper->set_predicates(std::move(predicates));
+    oper = unique_ptr<PhysicalOperator>(index_only_scan_oper);
+    LOG_TRACE("use index only scan. index=%s, matched field num=%d",
+              best_covering.index->index_meta().name(), best_covering.matched_num);
+  } else if (best.index != nullptr) {
+    IndexScanPhysicalOperator *index_scan_oper = new IndexScanPhysicalOperator(table,
+        best.index,
+        table_get_oper.read_write_mode(),
+        best.left_values,
+        best.left_inclusive,
+        best.right_values,
+        best.right_inclusive);
+
+    index_scan_oper->set_predicates(std::move(predicates));
+    oper = unique_ptr<PhysicalOperator>(index_scan_oper);
+    LOG_TRACE("use index scan. index=%s, matched field num=%d", best.index->index_meta().name(), best.matched_num);
+  } else {
+    auto table_scan_oper = new TableScanPhysicalOperator(table, table_get_oper.read_write_mode());
+    table_scan_oper->set_predicates(std::move(predicates));
+    oper = unique_ptr<PhysicalOperator>(table_scan_oper);
+    LOG_TRACE("use table scan");
+  }
+
+  return RC::SUCCESS;
+}
+
+bool PhysicalPlanGenerator::index_covers(const Index &index, const vector<const FieldMeta *> &fields)
+{
+  auto in_index = [](const vector<FieldMeta> &index_fields, const FieldMeta *field) {
+    return any_of(index_fields.begin(), index_fields.end(), [field](const FieldMeta &index_field) {
+      return 0 == strcmp(index_field.name(), field->name());
+    });
+  };
+
+  return all_of(fields.begin(), fields.end(), [&](const FieldMeta *field) {
+    return in_index(index.field_metas(), field) || in_index(index.include_field_metas(), field);
+  });
+}
+
+int PhysicalPlanGenerator::match_index_prefix(const Table *table, const Index &index,
+    vector<unique_ptr<Expression>> &predicates, vector<Value> &left_values, bool &left_inclusive,
+    vector<Value> &right_values, bool &right_inclusive)
+{
+  const vector<FieldMeta> &field_metas = index.field_metas();
+
+  int matched_num = 0;
+  for (const FieldMeta &field_meta : field_metas) {
+    const Value *equal_value = nullptr;
+    const Value *lower_value = nullptr;
+    const Value *upper_value = nullptr;
+    bool         lower_inclusive = false;
+    bool         upper_inclusive = false;
+
+    for (auto &expr : predicates) {
+      if (expr->type() != ExprType::COMPARISON) {
         continue;
       }
 
+      auto comparison_expr = static_cast<ComparisonExpr *>(expr.get());
+
       unique_ptr<Expression> &left_expr  = comparison_expr->left();
       unique_ptr<Expression> &right_expr = comparison_expr->right();
-      // 左右比较的一边最少是一个值
-      if (left_expr->type() != ExprType::VALUE && right_expr->type() != ExprType::VALUE) {
-        continue;
-      }
 
+      // 一边是字段一边是值，值在左边时把比较符号反过来，统一成 field comp value
       FieldExpr *field_expr = nullptr;
-      if (left_expr->type() == ExprType::FIELD) {
-        ASSERT(right_expr->type() == ExprType::VALUE, "right expr should be a value expr while left is field expr");
+      ValueExpr *value_expr = nullptr;
+      CompOp     comp       = comparison_expr->comp();
+      if (left_expr->type() == ExprType::FIELD && right_expr->type() == ExprType::VALUE) {
         field_expr = static_cast<FieldExpr *>(left_expr.get());
         value_expr = static_cast<ValueExpr *>(right_expr.get());
-      } else if (right_expr->type() == ExprType::FIELD) {
-        ASSERT(left_expr->type() == ExprType::VALUE, "left expr should be a value expr while right is a field expr");
+      } else if (left_expr->type() == ExprType::VALUE && right_expr->type() == ExprType::FIELD) {
         field_expr = static_cast<FieldExpr *>(right_expr.get());
         value_expr = static_cast<ValueExpr *>(left_expr.get());
+        switch (comp) {
+          case LESS_THAN: comp = GREAT_THAN; break;
+          case LESS_EQUAL: comp = GREAT_EQUAL; break;
+          case GREAT_THAN: comp = LESS_THAN; break;
+          case GREAT_EQUAL: comp = LESS_EQUAL; break;
+          default: break;
+        }
+      } else {
+        continue;
       }
 
-      if (field_expr == nullptr) {
+      const Field &field = field_expr->field();
+      const Value &value = value_expr->get_value();
+      if (field.table() != table || 0 != strcmp(field.field_name(), field_meta.name()) ||
+          value.attr_type() != field_meta.type()) {
         continue;
       }
 
-      const Field &field = field_expr->field();
-      index              = table->find_index_by_field(field.field_name());
-      if (nullptr != index) {
+      switch (comp) {
+        case EQUAL_TO: {
+          equal_value = &value;
+        } break;
+        case GREAT_THAN:
+        case GREAT_EQUAL: {
+          lower_value     = &value;
+          lower_inclusive = comp == GREAT_EQUAL;
+        } break;
+        case LESS_THAN:
+        case LESS_EQUAL: {
+          upper_value     = &value;
+          upper_inclusive = comp == LESS_EQUAL;
+        } break;
+        default: break;
+      }
+
+      if (equal_value != nullptr) {
         break;
       }
     }
-  }
 
-  if (index != nullptr) {
-    ASSERT(value_expr != nullptr, "got an index but value expr is null ?");
-
-    const Value               &value           = value_expr->get_value();
-    IndexScanPhysicalOperator *index_scan_oper = new IndexScanPhysicalOperator(table,
-        index,
-        table_get_oper.read_write_mode(),
-        &value,
-        true /*left_inclusive*/,
-        &value,
-        true /*right_inclusive*/);
+    if (equal_value != nullptr) {
+      left_values.push_back(*equal_value);
+      right_values.push_back(*equal_value);
+      matched_num++;
+      continue;
+    }
 
-    index_scan_oper->set_predicates(std::move(predicates));
-    oper = unique_ptr<PhysicalOperator>(index_scan_oper);
-    LOG_TRACE("use index scan");
-  } else {
-    auto table_scan_oper = new TableScanPhysicalOperator(table, table_get_oper.read_write_mode());
-    table_scan_oper->set_predicates(std::move(predicates));
-    oper = unique_ptr<PhysicalOperator>(table_scan_oper);
-    LOG_TRACE("use table scan");
+    // 范围条件只能作为最后一个字段，索引中后面的字段在这个范围内不是有序的
+    if (lower_value != nullptr) {
+      left_values.push_back(*lower_value);
+      left_inclusive = lower_inclusive;
+    }
+    if (upper_value != nullptr) {
+      right_values.push_back(*upper_value);
+      right_inclusive = upper_inclusive;
+    }
+    if (lower_value != nullptr || upper_value != nullptr) {
+      matched_num++;
+    }
+    break;
   }
 
-  return RC::SUCCESS;
+  return matched_num;
 }
 
 RC PhysicalPlanGenerator::create_plan(PredicateLogicalOperator &pred_oper, unique_ptr<PhysicalOperator> &oper)
@@ -27,6 +27,8 @@ class ExplainLogicalOperator;
 class JoinLogicalOperator;
 class CalcLogicalOperator;
 class GroupByLogicalOperator;
+class Index;
+class FieldMeta;
 
 /**
  * @brief 物理计划生成器
@@ -57,4 +59,19 @@ private:
   RC create_vec_plan(TableGetLogicalOperator &logical_oper, unique_ptr<PhysicalOperator> &oper);
   RC create_vec_plan(GroupByLogicalOperator &logical_oper, unique_ptr<PhysicalOperator> &oper);
   RC create_vec_plan(ExplainLogicalOperator &logical_oper, unique_ptr<PhysicalOperator> &oper);
+
+  /**
+   * @brief 计算谓词可以匹配索引的最长前缀
+   * @details 依次匹配索引的字段，有等值条件时继续匹配下一个字段；
+   * 只有范围条件(<, <=, >, >=)时作为扫描范围的最后一个字段，不再继续匹配。
+   * 比如索引(a,b,c)上的 a=1 and b>2 匹配了两个字段，扫描范围是 ((1,2), (1)]。
+   * @param[out] left_values 左边界各个字段的值，为空表示没有左边界
+   * @param[out] right_values 右边界各个字段的值，为空表示没有右边界
+   * @return 匹配的字段个数
+   */
+  int match_index_prefix(const Table *table, const Index &index, vector<unique_ptr<Expression>> &predicates,
+      vector<Value> &left_values, bool &left_inclusive, vector<Value> &right_values, bool &right_inclusive);
+
+  /// @brief 索引的键值和INCLUDE字段是否包含了所有的字段
+  static bool index_covers(const Index &index, const vector<const FieldMeta *> &fields);
 };
@@ -172,13 +172,15 @@ struct DropTableSqlNode
  * @brief 描述一个create index语句
  * @ingroup SQLParser
  * @details 创建索引时，需要指定索引名，表名，字段名。
- * 正常的SQL语句中，一个索引可能包含了多个字段，这里仅支持一个字段。
+ * 一个索引可以包含多个字段，按照字段的顺序组成联合索引的键值。
+ * 还可以用 INCLUDE 指定一些不参与比较的字段，查询只用到索引中的字段时不需要再读取记录。
  */
 struct CreateIndexSqlNode
 {
-  string index_name;      ///< Index name
-  string relation_name;   ///< Relation name
-  string attribute_name;  ///< Attribute name
+  string         index_name;       ///< Index name
+  string         relation_name;    ///< Relation name
+  vector<string> attribute_names;  ///< Attribute names
+  vector<string> include_names;    ///< INCLUDE 的字段，只存放在索引的叶子节点中
 };
 
 /**
@@ -71,6 +71,7 @@ UnboundAggregateExpr *create_aggregate_expression(const char *aggregate_name,
         TABLE
         TABLES
         INDEX
+        INCLUDE
         CALC
         SELECT
         DESC
@@ -153,6 +154,8 @@ UnboundAggregateExpr *create_aggregate_expression(const char *aggregate_name,
 %type <condition_list>      condition_list
 %type <cstring>             storage_format
 %type <relation_list>       rel_list
+%type <relation_list>       attr_list
+%type <relation_list>       include_list
 %type <expression>          expression
 %type <expression_list>     expression_list
 %type <expression_list>     group_by
@@ -270,13 +273,40 @@ desc_table_stmt:
     ;
 
 create_index_stmt:    /*create index 语句的语法解析树*/
-    CREATE INDEX ID ON ID LBRACE ID RBRACE
+    CREATE INDEX ID ON ID LBRACE attr_list RBRACE include_list
     {
       $$ = new ParsedSqlNode(SCF_CREATE_INDEX);
       CreateIndexSqlNode &create_index = $$->create_index;
       create_index.index_name = $3;
       create_index.relation_name = $5;
-      create_index.attribute_name = $7;
+      create_index.attribute_names.swap(*$7);
+      delete $7;
+      if ($9 != nullptr) {
+        create_index.include_names.swap(*$9);
+        delete $9;
+      }
+    }
+    ;
+
+include_list:
+    /* empty */
+    {
+      $$ = nullptr;
+    }
+    | INCLUDE LBRACE attr_list RBRACE
+    {
+      $$ = $3;
+    }
+    ;
+
+attr_list:
+    ID {
+      $$ = new vector<string>();
+      $$->push_back($1);
+    }
+    | ID COMMA attr_list {
+      $$ = $3;
+      $$->insert($$->begin(), $1);
     }
     ;
 
@@ -26,10 +26,9 @@ RC CreateIndexStmt::create(Db *db, const CreateIndexSqlNode &create_index, Stmt
   stmt = nullptr;
 
   const char *table_name = create_index.relation_name.c_str();
-  if (is_blank(table_name) || is_blank(create_index.index_name.c_str()) ||
-      is_blank(create_index.attribute_name.c_str())) {
-    LOG_WARN("invalid argument. db=%p, table_name=%p, index name=%s, attribute name=%s",
-        db, table_name, create_index.index_name.c_str(), create_index.attribute_name.c_str());
+  if (is_blank(table_name) || is_blank(create_index.index_name.c_str()) || create_index.attribute_names.empty()) {
+    LOG_WARN("invalid argument. db=%p, table_name=%p, index name=%s, attribute num=%d",
+        db, table_name, create_index.index_name.c_str(), static_cast<int>(create_index.attribute_names.size()));
     return RC::INVALID_ARGUMENT;
   }
 
@@ -40,11 +39,38 @@ RC CreateIndexStmt::create(Db *db, const CreateIndexSqlNode &create_index, Stmt
     return RC::SCHEMA_TABLE_NOT_EXIST;
   }
 
-  const FieldMeta *field_meta = table->table_meta().field(create_index.attribute_name.c_str());
-  if (nullptr == field_meta) {
-    LOG_WARN("no such field in table. db=%s, table=%s, field name=%s", 
-             db->name(), table_name, create_index.attribute_name.c_str());
-    return RC::SCHEMA_FIELD_NOT_EXIST;
+  // 键值字段和INCLUDE字段都不能重复
+  vector<const FieldMeta *> all_field_metas;
+  auto find_fields = [&](const vector<string> &attribute_names, vector<const FieldMeta *> &field_metas) {
+    for (const string &attribute_name : attribute_names) {
+      const FieldMeta *field_meta = table->table_meta().field(attribute_name.c_str());
+      if (nullptr == field_meta) {
+        LOG_WARN("no such field in table. db=%s, table=%s, field name=%s", 
+                 db->name(), table_name, attribute_name.c_str());
+        return RC::SCHEMA_FIELD_NOT_EXIST;
+      }
+
+      for (const FieldMeta *other : all_field_metas) {
+        if (other == field_meta) {
+          LOG_WARN("duplicate field in index. db=%s, table=%s, field name=%s", 
+                   db->name(), table_name, attribute_name.c_str());
+          return RC::INVALID_ARGUMENT;
+        }
+      }
+      all_field_metas.push_back(field_meta);
+      field_metas.push_back(field_meta);
+    }
+    return RC::SUCCESS;
+  };
+
+  vector<const FieldMeta *> field_metas;
+  vector<const FieldMeta *> include_field_metas;
+  RC rc = find_fields(create_index.attribute_names, field_metas);
+  if (OB_SUCC(rc)) {
+    rc = find_fields(create_index.include_names, include_field_metas);
+  }
+  if (OB_FAIL(rc)) {
+    return rc;
   }
 
   Index *index = table->find_index(create_index.index_name.c_str());
@@ -53,6 +79,6 @@ RC CreateIndexStmt::create(Db *db, const CreateIndexSqlNode &create_index, Stmt
     return RC::SCHEMA_INDEX_NAME_REPEAT;
   }
 
-  stmt = new CreateIndexStmt(table, field_meta, create_index.index_name);
+  stmt = new CreateIndexStmt(table, field_metas, include_field_metas, create_index.index_name);
   return RC::SUCCESS;
 }
@@ -42,7 +42,12 @@ RC BufferPoolLogHandler::deallocate_page(PageNum page_num, LSN &lsn)
 
 RC BufferPoolLogHandler::flush_page(Page &page)
 {
-  return log_handler_.wait_lsn(page.lsn);
+  return wait_lsn(page.lsn);
+}
+
+RC BufferPoolLogHandler::wait_lsn(LSN lsn)
+{
+  return log_handler_.wait_lsn(lsn);
 }
 
 RC BufferPoolLogHandler::append_log(BufferPoolOperation::Type type, PageNum page_num, LSN &lsn)
@@ -103,6 +103,12 @@ public:
    */
   RC flush_page(Page &page);
 
+  /**
+   * @brief 等待指定的日志刷新到磁盘
+   * @details 后台刷脏时，一次等待一批页面中最大的LSN
+   */
+  RC wait_lsn(LSN lsn);
+
 private:
   RC append_log(BufferPoolOperation::Type type, PageNum page_num, LSN &lsn);
 
@@ -12,11 +12,16 @@ See the Mulan PSL v2 for more details. */
 // Created by Meiyi & Longda on 2021/4/13.
 //
 #include <errno.h>
+#include <limits.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 #include "common/io/io.h"
 #include "common/lang/mutex.h"
 #include "common/lang/algorithm.h"
+#include "common/lang/thread.h"
 #include "common/log/log.h"
 #include "common/math/crc.h"
 #include "storage/buffer/disk_buffer_pool.h"
@@ -27,6 +32,9 @@ using namespace common;
 
 static const int MEM_POOL_ITEM_NUM = 20;
 
+/// 自动设置页帧分区个数时，最多使用多少个分区
+static const int MAX_FRAME_PARTITION_NUM = 64;
+
 ////////////////////////////////////////////////////////////////////////////////
 
 string BPFileHeader::to_string() const
@@ -38,38 +46,104 @@ string BPFileHeader::to_string() const
 
 ////////////////////////////////////////////////////////////////////////////////
 
-BPFrameManager::BPFrameManager(const char *name) : allocator_(name) {}
+BPFrameManager::BPFrameManager(const char *name) : tag_(name) {}
 
-RC BPFrameManager::init(int pool_num)
+RC BPFrameManager::init(int pool_num, int partition_num /* = 1 */, const char *eviction_policy /* = "lru" */,
+    bool huge_page /* = false */, bool numa_aware /* = false */)
 {
-  int ret = allocator_.init(false, pool_num);
-  if (ret == 0) {
-    return RC::SUCCESS;
+  if (pool_num <= 0) {
+    LOG_ERROR("invalid pool num: %d, tag=%s", pool_num, tag_.c_str());
+    return RC::INVALID_ARGUMENT;
+  }
+
+  RC rc = arena_.init(static_cast<size_t>(pool_num) * DEFAULT_ITEM_NUM_PER_POOL, huge_page, numa_aware);
+  if (OB_FAIL(rc)) {
+    LOG_ERROR("failed to init frame arena. tag=%s, rc=%s", tag_.c_str(), strrc(rc));
+    return RC::NOMEM;
+  }
+
+  if (partition_num <= 0) {
+    partition_num = 1;
+  }
+
+  partitions_.clear();
+  partitions_.reserve(partition_num);
+  for (int i = 0; i < partition_num; i++) {
+    auto                 partition = make_unique<Partition>();
+    FrameEvictionPolicy *policy    = FrameEvictionPolicy::create(eviction_policy);
+    if (policy == nullptr) {
+      LOG_WARN("unknown frame eviction policy %s, use lru instead", eviction_policy);
+      policy = new LruEvictionPolicy();
+    }
+    partition->policy.reset(policy);
+    partition->free_frames.resize(arena_.node_num());
+    partitions_.push_back(std::move(partition));
+  }
+
+  // 所有的页帧轮流放到各个分区的空闲列表中
+  const size_t total_num = arena_.frame_num();
+  for (size_t i = 0; i < total_num; i++) {
+    push_free_frame(*partitions_[i % partition_num], arena_.frame(i));
   }
-  return RC::NOMEM;
+
+  LOG_INFO("frame manager init done. tag=%s, frame num=%ld, partition num=%d, eviction policy=%s, numa node num=%d",
+           tag_.c_str(), total_num, partition_num, partitions_.front()->policy->name(), arena_.node_num());
+  return RC::SUCCESS;
 }
 
 RC BPFrameManager::cleanup()
 {
-  if (frames_.count() > 0) {
+  if (frame_num() > 0) {
     return RC::INTERNAL;
   }
 
-  frames_.destroy();
+  for (unique_ptr<Partition> &partition : partitions_) {
+    partition->free_frames.clear();
+    partition->frames.clear();
+  }
+  arena_.cleanup();
   return RC::SUCCESS;
 }
 
-int BPFrameManager::purge_frames(int count, function<RC(Frame *frame)> purger)
+size_t BPFrameManager::frame_num() const
 {
-  lock_guard<mutex> lock_guard(lock_);
+  size_t num = 0;
+  for (const unique_ptr<Partition> &partition : partitions_) {
+    num += partition->frames.size();
+  }
+  return num;
+}
 
-  vector<Frame *> frames_can_purge;
+BPFrameManager::Partition &BPFrameManager::partition_of(const FrameId &frame_id)
+{
+  return *partitions_[frame_id.hash() % partitions_.size()];
+}
+
+int BPFrameManager::purge_frames(int count, function<RC(Frame *frame)> purger)
+{
   if (count <= 0) {
     count = 1;
   }
+
+  const size_t partition_num = partitions_.size();
+  const size_t start         = purge_cursor_.fetch_add(1) % partition_num;
+
+  int freed_count = 0;
+  for (size_t i = 0; i < partition_num && freed_count < count; i++) {
+    Partition &partition = *partitions_[(start + i) % partition_num];
+    freed_count += purge_partition(partition, count - freed_count, purger);
+  }
+  return freed_count;
+}
+
+int BPFrameManager::purge_partition(Partition &partition, int count, const function<RC(Frame *frame)> &purger)
+{
+  lock_guard<mutex> lock_guard(partition.lock);
+
+  vector<Frame *> frames_can_purge;
   frames_can_purge.reserve(count);
 
-  auto purge_finder = [&frames_can_purge, count](const FrameId &frame_id, Frame *const frame) {
+  auto purge_finder = [&frames_can_purge, count](Frame *frame) {
     if (frame->can_purge()) {
       frame->pin();
       frames_can_purge.push_back(frame);
@@ -80,16 +154,19 @@ int BPFrameManager::purge_frames(int count, function<RC(Frame *frame)> purger)
     return true;  // true continue to look up
   };
 
-  frames_.foreach_reverse(purge_finder);
+  partition.policy->foreach_victim(purge_finder);
+  if (frames_can_purge.empty()) {
+    return 0;
+  }
   LOG_INFO("purge frames find %ld pages total", frames_can_purge.size());
 
-  /// 当前还在frameManager的锁内，而 purger 是一个非常耗时的操作
-  /// 他需要把脏页数据刷新到磁盘上去，所以这里会极大地降低并发度
+  /// 当前还在分区的锁内，而 purger 是一个非常耗时的操作
+  /// 他需要把脏页数据刷新到磁盘上去，所以这里会降低当前分区的并发度
   int freed_count = 0;
   for (Frame *frame : frames_can_purge) {
     RC rc = purger(frame);
     if (RC::SUCCESS == rc) {
-      free_internal(frame->frame_id(), frame);
+      free_internal(partition, frame->frame_id(), frame);
       freed_count++;
     } else {
       frame->unpin();
@@ -101,85 +178,226 @@ int BPFrameManager::purge_frames(int count, function<RC(Frame *frame)> purger)
   return freed_count;
 }
 
-Frame *BPFrameManager::get(int buffer_pool_id, PageNum page_num)
+size_t BPFrameManager::collect_dirty_frames(vector<pair<LSN, FrameId>> &flush_list)
 {
-  FrameId                     frame_id(buffer_pool_id, page_num);
+  size_t dirty_num = 0;
+  for (unique_ptr<Partition> &partition : partitions_) {
+    lock_guard<mutex> lock_guard(partition->lock);
+    for (auto &[frame_id, frame] : partition->frames) {
+      if (!frame->dirty()) {
+        continue;
+      }
 
-  lock_guard<mutex> lock_guard(lock_);
-  return get_internal(frame_id);
+      dirty_num++;
+      if (frame->can_purge()) {
+        flush_list.emplace_back(frame->lsn(), frame_id);
+      }
+    }
+  }
+
+  sort(flush_list.begin(), flush_list.end(), [](const pair<LSN, FrameId> &a, const pair<LSN, FrameId> &b) {
+    return a.first < b.first;
+  });
+  return dirty_num;
 }
 
-Frame *BPFrameManager::get_internal(const FrameId &frame_id)
+LSN BPFrameManager::min_recovery_lsn(LSN max_lsn)
 {
-  Frame *frame = nullptr;
-  (void)frames_.get(frame_id, frame);
+  LSN min_lsn = max_lsn;
+  for (unique_ptr<Partition> &partition : partitions_) {
+    lock_guard<mutex> lock_guard(partition->lock);
+    for (auto &[frame_id, frame] : partition->frames) {
+      LSN rec_lsn = frame->rec_lsn();
+      if (rec_lsn == 0 && frame->dirty()) {
+        rec_lsn = frame->lsn() + 1;
+      }
+
+      if (rec_lsn != 0 && rec_lsn < min_lsn) {
+        min_lsn = rec_lsn;
+      }
+    }
+  }
+  return min_lsn;
+}
+
+RC BPFrameManager::flush_idle_frame(const FrameId &frame_id, const function<RC(Frame *frame)> &flusher, bool &flushed)
+{
+  flushed = false;
+
+  Partition        &partition = partition_of(frame_id);
+  lock_guard<mutex> lock_guard(partition.lock);
+
+  auto iter = partition.frames.find(frame_id);
+  if (iter == partition.frames.end()) {
+    return RC::SUCCESS;
+  }
+
+  Frame *frame = iter->second;
+  if (!frame->dirty() || !frame->can_purge()) {
+    return RC::SUCCESS;
+  }
+
+  frame->pin();
+  RC rc = flusher(frame);
+  frame->unpin();
+  if (OB_SUCC(rc)) {
+    flushed = true;
+  }
+  return rc;
+}
+
+Frame *BPFrameManager::get(int buffer_pool_id, PageNum page_num)
+{
+  FrameId    frame_id(buffer_pool_id, page_num);
+  Partition &partition = partition_of(frame_id);
+
+  lock_guard<mutex> lock_guard(partition.lock);
+  Frame            *frame = get_internal(partition, frame_id);
   if (frame != nullptr) {
-    frame->pin();
-    LOG_DEBUG("got a frame. frame=%s", frame->to_string().c_str());
+    ++hit_count_;
+  } else {
+    ++miss_count_;
   }
   return frame;
 }
 
-Frame *BPFrameManager::alloc(int buffer_pool_id, PageNum page_num)
+Frame *BPFrameManager::get_internal(Partition &partition, const FrameId &frame_id)
+{
+  auto iter = partition.frames.find(frame_id);
+  if (iter == partition.frames.end()) {
+    return nullptr;
+  }
+
+  Frame *frame = iter->second;
+  partition.policy->on_access(frame);
+  frame->pin();
+  LOG_DEBUG("got a frame. frame=%s", frame->to_string().c_str());
+  return frame;
+}
+
+Frame *BPFrameManager::steal_free_frame(Partition &self)
+{
+  for (unique_ptr<Partition> &partition : partitions_) {
+    if (partition.get() == &self) {
+      continue;
+    }
+
+    unique_lock<mutex> lock(partition->lock, try_to_lock);
+    if (!lock.owns_lock()) {
+      continue;
+    }
+
+    Frame *frame = pop_free_frame(*partition);
+    if (frame != nullptr) {
+      return frame;
+    }
+  }
+  return nullptr;
+}
+
+Frame *BPFrameManager::pop_free_frame(Partition &partition)
 {
-  FrameId frame_id(buffer_pool_id, page_num);
+  const int node_num     = static_cast<int>(partition.free_frames.size());
+  const int current_node = arena_.current_node();
+  for (int i = 0; i < node_num; i++) {
+    vector<Frame *> &free_frames = partition.free_frames[(current_node + i) % node_num];
+    if (!free_frames.empty()) {
+      Frame *frame = free_frames.back();
+      free_frames.pop_back();
+      return frame;
+    }
+  }
+  return nullptr;
+}
 
-  lock_guard<mutex> lock_guard(lock_);
+void BPFrameManager::push_free_frame(Partition &partition, Frame *frame)
+{
+  partition.free_frames[arena_.node_of(frame)].push_back(frame);
+}
 
-  Frame                      *frame = get_internal(frame_id);
+Frame *BPFrameManager::alloc(int buffer_pool_id, PageNum page_num, bool latched /*= false*/)
+{
+  FrameId    frame_id(buffer_pool_id, page_num);
+  Partition &partition = partition_of(frame_id);
+
+  lock_guard<mutex> lock_guard(partition.lock);
+
+  Frame *frame = get_internal(partition, frame_id);
   if (frame != nullptr) {
+    ASSERT(!latched, "the frame to load is already in memory. frame=%s", frame->to_string().c_str());
     return frame;
   }
 
-  frame = allocator_.alloc();
+  frame = pop_free_frame(partition);
+  if (frame == nullptr) {
+    frame = steal_free_frame(partition);
+  }
+
   if (frame != nullptr) {
     ASSERT(frame->pin_count() == 0, "got an invalid frame that pin count is not 0. frame=%s", 
            frame->to_string().c_str());
     frame->set_buffer_pool_id(buffer_pool_id);
     frame->set_page_num(page_num);
+    frame->clear_dirty();
     frame->pin();
-    frames_.put(frame_id, frame);
+    if (latched) {
+      frame->write_latch();
+    }
+    partition.frames.emplace(frame_id, frame);
+    partition.policy->on_insert(frame);
     LOG_DEBUG("allocate a new frame. frame=%s", frame->to_string().c_str());
   }
   return frame;
 }
 
+bool BPFrameManager::contains(int buffer_pool_id, PageNum page_num)
+{
+  FrameId    frame_id(buffer_pool_id, page_num);
+  Partition &partition = partition_of(frame_id);
+
+  lock_guard<mutex> lock_guard(partition.lock);
+  return partition.frames.find(frame_id) != partition.frames.end();
+}
+
 RC BPFrameManager::free(int buffer_pool_id, PageNum page_num, Frame *frame)
 {
-  FrameId frame_id(buffer_pool_id, page_num);
+  FrameId    frame_id(buffer_pool_id, page_num);
+  Partition &partition = partition_of(frame_id);
 
-  lock_guard<mutex> lock_guard(lock_);
-  return free_internal(frame_id, frame);
+  lock_guard<mutex> lock_guard(partition.lock);
+  return free_internal(partition, frame_id, frame);
 }
 
-RC BPFrameManager::free_internal(const FrameId &frame_id, Frame *frame)
+RC BPFrameManager::free_internal(Partition &partition, const FrameId &frame_id, Frame *frame)
 {
-  Frame                *frame_source = nullptr;
-  [[maybe_unused]] bool found        = frames_.get(frame_id, frame_source);
+  auto                   iter         = partition.frames.find(frame_id);
+  [[maybe_unused]] bool   found        = iter != partition.frames.end();
+  [[maybe_unused]] Frame *frame_source = found ? iter->second : nullptr;
   ASSERT(found && frame == frame_source && frame->pin_count() == 1,
       "failed to free frame. found=%d, frameId=%s, frame_source=%p, frame=%p, pinCount=%d, lbt=%s",
       found, frame_id.to_string().c_str(), frame_source, frame, frame->pin_count(), lbt());
 
+  partition.policy->on_remove(frame);
   frame->set_page_num(-1);
   frame->unpin();
-  frames_.remove(frame_id);
-  allocator_.free(frame);
+  frame->clear_dirty();
+  partition.frames.erase(iter);
+  push_free_frame(partition, frame);
   return RC::SUCCESS;
 }
 
 list<Frame *> BPFrameManager::find_list(int buffer_pool_id)
 {
-  lock_guard<mutex> lock_guard(lock_);
-
   list<Frame *> frames;
-  auto               fetcher = [&frames, buffer_pool_id](const FrameId &frame_id, Frame *const frame) -> bool {
-    if (buffer_pool_id == frame_id.buffer_pool_id()) {
-      frame->pin();
-      frames.push_back(frame);
+  for (unique_ptr<Partition> &partition : partitions_) {
+    lock_guard<mutex> lock_guard(partition->lock);
+    for (auto &[frame_id, frame] : partition->frames) {
+      if (buffer_pool_id == frame_id.buffer_pool_id()) {
+        frame->pin();
+        frames.push_back(frame);
+      }
     }
-    return true;
-  };
-  frames_.foreach (fetcher);
+  }
   return frames;
 }
 
@@ -188,29 +406,74 @@ BufferPoolIterator::BufferPoolIterator() {}
 BufferPoolIterator::~BufferPoolIterator() {}
 RC BufferPoolIterator::init(DiskBufferPool &bp, PageNum start_page /* = 0 */)
 {
-  bitmap_.init(bp.file_header_->bitmap, bp.file_header_->page_count);
+  buffer_pool_   = &bp;
+  end_page_num_  = bp.page_count();
+  next_page_num_ = -1;
   if (start_page <= 0) {
     current_page_num_ = -1;
   } else {
     current_page_num_ = start_page - 1;
   }
+  sequential_count_ = 0;
+  read_ahead_end_   = -1;
   return RC::SUCCESS;
 }
 
-bool BufferPoolIterator::has_next() { return bitmap_.next_setted_bit(current_page_num_ + 1) != -1; }
+bool BufferPoolIterator::has_next()
+{
+  if (next_page_num_ <= current_page_num_) {
+    next_page_num_ = buffer_pool_->next_allocated_page(current_page_num_ + 1, end_page_num_);
+  }
+  return next_page_num_ != BP_INVALID_PAGE_NUM;
+}
 
 PageNum BufferPoolIterator::next()
 {
-  PageNum next_page = bitmap_.next_setted_bit(current_page_num_ + 1);
-  if (next_page != -1) {
-    current_page_num_ = next_page;
+  if (!has_next()) {
+    return BP_INVALID_PAGE_NUM;
+  }
+
+  PageNum next_page = next_page_num_;
+  if (read_ahead_pages_ > 0) {
+    read_ahead(next_page);
   }
+  current_page_num_ = next_page;
   return next_page;
 }
 
+void BufferPoolIterator::read_ahead(PageNum page_num)
+{
+  // 中间跳过的页面太多，说明文件中的数据很稀疏，预读没有什么意义
+  if (page_num - current_page_num_ <= read_ahead_pages_) {
+    sequential_count_++;
+  } else {
+    sequential_count_ = 0;
+  }
+
+  if (sequential_count_ < SEQUENTIAL_THRESHOLD) {
+    return;
+  }
+
+  // 已经预读的页面用掉一半的时候，开始预读下一批
+  if (page_num + read_ahead_pages_ / 2 < read_ahead_end_) {
+    return;
+  }
+
+  PageNum start = max(page_num, read_ahead_end_);
+  RC      rc    = buffer_pool_->prefetch(start, read_ahead_pages_);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to read ahead. file=%s, start=%d, count=%d, rc=%s",
+             buffer_pool_->filename(), start, read_ahead_pages_, strrc(rc));
+  }
+  read_ahead_end_ = start + read_ahead_pages_;
+}
+
 RC BufferPoolIterator::reset()
 {
   current_page_num_ = 0;
+  next_page_num_    = -1;
+  sequential_count_ = 0;
+  read_ahead_end_   = -1;
   return RC::SUCCESS;
 }
 
@@ -299,6 +562,7 @@ RC DiskBufferPool::close_file()
   }
 
   disposed_pages_.clear();
+  next_free_hint_ = 0;
 
   if (close(file_desc_) < 0) {
     LOG_ERROR("Failed to close fileId:%d, fileName:%s, error:%s", file_desc_, file_name_.c_str(), strerror(errno));
@@ -313,7 +577,6 @@ RC DiskBufferPool::close_file()
 
 RC DiskBufferPool::get_this_page(PageNum page_num, Frame **frame)
 {
-  RC rc  = RC::SUCCESS;
   *frame = nullptr;
 
   Frame *used_match_frame = frame_manager_.get(id(), page_num);
@@ -324,11 +587,24 @@ RC DiskBufferPool::get_this_page(PageNum page_num, Frame **frame)
   }
 
   scoped_lock lock_guard(lock_);  // 直接加了一把大锁，其实可以根据访问的页面来细化提高并行度
+  return get_this_page_internal(page_num, frame);
+}
+
+RC DiskBufferPool::get_this_page_internal(PageNum page_num, Frame **frame)
+{
+  // 拿到锁之前，其它线程可能已经把页面加载进来了
+  Frame *used_match_frame = frame_manager_.get(id(), page_num);
+  if (used_match_frame != nullptr) {
+    used_match_frame->access();
+    *frame = used_match_frame;
+    return RC::SUCCESS;
+  }
 
   // Allocate one page and load the data into this page
   Frame *allocated_frame = nullptr;
 
-  rc = allocate_frame(page_num, &allocated_frame);
+  // 加载完成之前不让其它线程读取页面数据，包括乐观读
+  RC rc = allocate_frame(page_num, &allocated_frame, true /*latched*/);
   if (rc != RC::SUCCESS) {
     LOG_ERROR("Failed to alloc frame %s:%d, due to failed to alloc page.", file_name_.c_str(), page_num);
     return rc;
@@ -338,7 +614,9 @@ RC DiskBufferPool::get_this_page(PageNum page_num, Frame **frame)
   // allocated_frame->pin(); // pined in manager::get
   allocated_frame->access();
 
-  if ((rc = load_page(page_num, allocated_frame)) != RC::SUCCESS) {
+  rc = load_page(page_num, allocated_frame);
+  allocated_frame->write_unlatch();
+  if (OB_FAIL(rc)) {
     LOG_ERROR("Failed to load page %s:%d", file_name_.c_str(), page_num);
     purge_frame(page_num, allocated_frame);
     return rc;
@@ -350,76 +628,87 @@ RC DiskBufferPool::get_this_page(PageNum page_num, Frame **frame)
 
 RC DiskBufferPool::allocate_page(Frame **frame)
 {
-  RC rc = RC::SUCCESS;
+  scoped_lock lock_guard(lock_);
 
-  lock_.lock();
+  if (file_header_->allocated_pages < file_header_->page_count) {
+    PageNum page_num = find_free_page();
+    if (page_num != BP_INVALID_PAGE_NUM) {
+      LSN lsn = 0;
+      RC  rc  = log_handler_.allocate_page(page_num, lsn);
+      if (OB_FAIL(rc)) {
+        LOG_ERROR("Failed to log allocate page %d, rc=%s", page_num, strrc(rc));
+        // 忽略了错误
+      }
 
-  int byte = 0, bit = 0;
-  if ((file_header_->allocated_pages) < (file_header_->page_count)) {
-    // There is one free page
-    for (int i = 0; i < file_header_->page_count; i++) {
-      byte = i / 8;
-      bit  = i % 8;
-      if (((file_header_->bitmap[byte]) & (1 << bit)) == 0) {
-        (file_header_->allocated_pages)++;
-        file_header_->bitmap[byte] |= (1 << bit);
-        // TODO,  do we need clean the loaded page's data?
-        hdr_frame_->mark_dirty();
-        LSN lsn = 0;
-        rc = log_handler_.allocate_page(i, lsn);
-        if (OB_FAIL(rc)) {
-          LOG_ERROR("Failed to log allocate page %d, rc=%s", i, strrc(rc));
-          // 忽略了错误
-        }
-
-        hdr_frame_->set_lsn(lsn);
-
-        LOG_DEBUG("allocate a new page without extend buffer pool. page num=%d, buffer pool=%d", i, id());
-
-        lock_.unlock();
-        return get_this_page(i, frame);
+      // TODO,  do we need clean the loaded page's data?
+      rc = set_page_allocated(page_num, true, lsn);
+      if (OB_FAIL(rc)) {
+        return rc;
       }
+
+      file_header_->allocated_pages++;
+      hdr_frame_->set_lsn(lsn);
+      hdr_frame_->mark_dirty();
+
+      LOG_DEBUG("allocate a new page without extend buffer pool. page num=%d, buffer pool=%d", page_num, id());
+      return get_this_page_internal(page_num, frame);
     }
   }
 
-  if (file_header_->page_count >= BPFileHeader::MAX_PAGE_NUM) {
-    LOG_WARN("file buffer pool is full. page count %d, max page count %d",
-        file_header_->page_count, BPFileHeader::MAX_PAGE_NUM);
-    lock_.unlock();
+  // 扩展到了一个新的组，先分配这个组的空间映射页
+  if (BPFileHeader::is_space_map_page(file_header_->page_count)) {
+    Frame *map_frame = nullptr;
+    RC     rc        = extend_page(&map_frame);
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+    map_frame->unpin();
+  }
+
+  return extend_page(frame);
+}
+
+RC DiskBufferPool::extend_page(Frame **frame)
+{
+  if (file_header_->page_count == INT32_MAX) {
+    LOG_WARN("file buffer pool is full. page count %d", file_header_->page_count);
     return RC::BUFFERPOOL_NOBUF;
   }
 
+  const PageNum page_num = file_header_->page_count;
+
   LSN lsn = 0;
-  rc = log_handler_.allocate_page(file_header_->page_count, lsn);
+  RC  rc  = log_handler_.allocate_page(page_num, lsn);
   if (OB_FAIL(rc)) {
-    LOG_ERROR("Failed to log allocate page %d, rc=%s", file_header_->page_count, strrc(rc));
+    LOG_ERROR("Failed to log allocate page %d, rc=%s", page_num, strrc(rc));
     // 忽略了错误
   }
-  hdr_frame_->set_lsn(lsn);
 
-  PageNum page_num        = file_header_->page_count;
-  Frame  *allocated_frame = nullptr;
+  Frame *allocated_frame = nullptr;
   if ((rc = allocate_frame(page_num, &allocated_frame)) != RC::SUCCESS) {
     LOG_ERROR("Failed to allocate frame %s, due to no free page.", file_name_.c_str());
-    lock_.unlock();
     return rc;
   }
 
   LOG_INFO("allocate new page by extending bufferpool. buffer_pool_id=%d, pageNum=%d, pin=%d",
            id(), page_num, allocated_frame->pin_count());
 
+  allocated_frame->set_buffer_pool_id(id());
+  allocated_frame->access();
+  allocated_frame->clear_page();
+  allocated_frame->set_page_num(page_num);
+
   file_header_->allocated_pages++;
   file_header_->page_count++;
-
-  byte = page_num / 8;
-  bit  = page_num % 8;
-  file_header_->bitmap[byte] |= (1 << bit);
+  hdr_frame_->set_lsn(lsn);
   hdr_frame_->mark_dirty();
 
-  allocated_frame->set_buffer_pool_id(id());
-  allocated_frame->access();
-  allocated_frame->clear_page();
-  allocated_frame->set_page_num(file_header_->page_count - 1);
+  // 空间映射页记录自己的分配状态，其它页面记录在所属组的位图中
+  rc = set_page_allocated(page_num, true, lsn);
+  if (OB_FAIL(rc)) {
+    allocated_frame->unpin();
+    return rc;
+  }
 
   // Use flush operation to extension file
   if ((rc = flush_page_internal(*allocated_frame)) != RC::SUCCESS) {
@@ -428,18 +717,208 @@ RC DiskBufferPool::allocate_page(Frame **frame)
     // return tmp;
   }
 
-  lock_.unlock();
-
   *frame = allocated_frame;
   return RC::SUCCESS;
 }
 
+PageNum DiskBufferPool::find_free_page()
+{
+  if (!disposed_pages_.empty()) {
+    return *disposed_pages_.begin();
+  }
+
+  while (next_free_hint_ < file_header_->page_count) {
+    const int     group       = BPFileHeader::group_of(next_free_hint_);
+    const PageNum group_start = static_cast<PageNum>(BPFileHeader::group_start(group));
+    const PageNum group_end   = static_cast<PageNum>(
+        min(BPFileHeader::group_end(group), static_cast<int64_t>(file_header_->page_count)));
+
+    Frame *map_frame = nullptr;
+    char  *data      = nullptr;
+    RC     rc        = get_space_map(next_free_hint_, map_frame, data);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to get space map. file=%s, page=%d, rc=%s", file_name_.c_str(), next_free_hint_, strrc(rc));
+      return BP_INVALID_PAGE_NUM;
+    }
+
+    Bitmap bitmap(data, group_end - group_start);
+    int    index = bitmap.next_unsetted_bit(next_free_hint_ - group_start);
+    put_space_map(map_frame);
+
+    if (index >= 0) {
+      return group_start + index;
+    }
+    next_free_hint_ = group_end;
+  }
+  return BP_INVALID_PAGE_NUM;
+}
+
+RC DiskBufferPool::get_space_map(PageNum page_num, Frame *&frame, char *&bitmap)
+{
+  const int group = BPFileHeader::group_of(page_num);
+  if (group == 0) {
+    frame  = hdr_frame_;
+    bitmap = file_header_->bitmap;
+    return RC::SUCCESS;
+  }
+
+  const PageNum map_page = static_cast<PageNum>(BPFileHeader::group_start(group));
+  RC            rc       = get_this_page_internal(map_page, &frame);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to load space map page. file=%s, map page=%d, rc=%s", file_name_.c_str(), map_page, strrc(rc));
+    return rc;
+  }
+
+  bitmap = frame->data();
+  return RC::SUCCESS;
+}
+
+void DiskBufferPool::put_space_map(Frame *frame)
+{
+  if (frame != hdr_frame_) {
+    frame->unpin();
+  }
+}
+
+bool DiskBufferPool::is_page_allocated(PageNum page_num)
+{
+  if (page_num < 0 || page_num >= file_header_->page_count) {
+    return false;
+  }
+
+  Frame *map_frame = nullptr;
+  char  *data      = nullptr;
+  if (OB_FAIL(get_space_map(page_num, map_frame, data))) {
+    return false;
+  }
+
+  const int index     = page_num - static_cast<PageNum>(BPFileHeader::group_start(BPFileHeader::group_of(page_num)));
+  bool      allocated = Bitmap(data, index + 1).get_bit(index);
+  put_space_map(map_frame);
+  return allocated;
+}
+
+RC DiskBufferPool::set_page_allocated(PageNum page_num, bool allocated, LSN lsn)
+{
+  Frame *map_frame = nullptr;
+  char  *data      = nullptr;
+  RC     rc        = get_space_map(page_num, map_frame, data);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  const int index = page_num - static_cast<PageNum>(BPFileHeader::group_start(BPFileHeader::group_of(page_num)));
+  Bitmap    bitmap(data, index + 1);
+  if (allocated) {
+    bitmap.set_bit(index);
+    disposed_pages_.erase(page_num);
+    next_free_hint_ = max(next_free_hint_, page_num + 1);
+  } else {
+    bitmap.clear_bit(index);
+    if (page_num < next_free_hint_) {
+      disposed_pages_.insert(page_num);
+    }
+  }
+
+  map_frame->set_lsn(max(map_frame->lsn(), lsn));
+  map_frame->mark_dirty();
+  put_space_map(map_frame);
+  return RC::SUCCESS;
+}
+
+PageNum DiskBufferPool::next_allocated_page(PageNum start_page, PageNum end_page)
+{
+  scoped_lock lock_guard(lock_);
+
+  end_page = min(end_page, static_cast<PageNum>(file_header_->page_count));
+  for (PageNum page_num = max(start_page, 0); page_num < end_page;) {
+    const int     group       = BPFileHeader::group_of(page_num);
+    const PageNum group_start = static_cast<PageNum>(BPFileHeader::group_start(group));
+    const PageNum group_end   = static_cast<PageNum>(min(BPFileHeader::group_end(group), static_cast<int64_t>(end_page)));
+    if (BPFileHeader::is_space_map_page(page_num)) {
+      page_num++;
+      continue;
+    }
+
+    Frame *map_frame = nullptr;
+    char  *data      = nullptr;
+    RC     rc        = get_space_map(page_num, map_frame, data);
+    if (OB_FAIL(rc)) {
+      return BP_INVALID_PAGE_NUM;
+    }
+
+    Bitmap bitmap(data, group_end - group_start);
+    int    index = bitmap.next_setted_bit(page_num - group_start);
+    put_space_map(map_frame);
+
+    if (index >= 0) {
+      return group_start + index;
+    }
+    page_num = group_end;
+  }
+  return BP_INVALID_PAGE_NUM;
+}
+
+RC DiskBufferPool::prefetch(PageNum start_page, int count)
+{
+  const int max_count = max(static_cast<int>(frame_manager_.total_frame_num() / 4), 1);
+  count               = min(count, max_count);
+  if (start_page < 0 || count <= 0) {
+    return RC::SUCCESS;
+  }
+
+  scoped_lock lock_guard(lock_);
+
+  const PageNum end_page = min(start_page + count, static_cast<PageNum>(file_header_->page_count));
+
+  // 需要从磁盘读取的页面，按照页面编号排序
+  vector<Frame *> load_frames;
+
+  int loaded_num = 0;
+  for (PageNum page_num = start_page; page_num < end_page; page_num++) {
+    if (!is_page_allocated(page_num) || frame_manager_.contains(id(), page_num)) {
+      continue;
+    }
+
+    // 加载完成之前不让其它线程读取页面数据
+    Frame *frame = nullptr;
+    RC     rc    = allocate_frame(page_num, &frame, true /*latched*/);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to allocate frame for prefetch. file=%s, page=%d, rc=%s", file_name_.c_str(), page_num, strrc(rc));
+      load_pages(load_frames);
+      return rc;
+    }
+
+    frame->set_buffer_pool_id(id());
+    frame->access();
+
+    // 最新的数据可能还在 double write buffer 中
+    rc = dblwr_manager_.read_page(this, page_num, frame->page());
+    if (OB_SUCC(rc)) {
+      frame->write_unlatch();
+      frame->unpin();
+      loaded_num++;
+      continue;
+    }
+
+    load_frames.push_back(frame);
+  }
+
+  loaded_num += load_pages(load_frames);
+  LOG_TRACE("prefetch pages. file=%s, start=%d, count=%d, loaded=%d", file_name_.c_str(), start_page, count, loaded_num);
+  return RC::SUCCESS;
+}
+
 RC DiskBufferPool::dispose_page(PageNum page_num)
 {
   if (page_num == 0) {
     LOG_ERROR("Failed to dispose page %d, because it is the first page. filename=%s", page_num, file_name_.c_str());
     return RC::INTERNAL;
   }
+  if (BPFileHeader::is_space_map_page(page_num)) {
+    LOG_ERROR("Failed to dispose page %d, because it is a space map page. filename=%s", page_num, file_name_.c_str());
+    return RC::INTERNAL;
+  }
   
   scoped_lock lock_guard(lock_);
   Frame           *used_frame = frame_manager_.get(id(), page_num);
@@ -457,11 +936,14 @@ RC DiskBufferPool::dispose_page(PageNum page_num)
     // ignore error handle
   }
 
+  rc = set_page_allocated(page_num, false, lsn);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
   hdr_frame_->set_lsn(lsn);
   hdr_frame_->mark_dirty();
   file_header_->allocated_pages--;
-  char tmp = 1 << (page_num % 8);
-  file_header_->bitmap[page_num / 8] &= ~tmp;
   return RC::SUCCESS;
 }
 
@@ -582,15 +1064,14 @@ RC DiskBufferPool::flush_all_pages()
 
 RC DiskBufferPool::recover_page(PageNum page_num)
 {
-  int byte = 0, bit = 0;
-  byte = page_num / 8;
-  bit  = page_num % 8;
-
   scoped_lock lock_guard(lock_);
-  if (!(file_header_->bitmap[byte] & (1 << bit))) {
-    file_header_->bitmap[byte] |= (1 << bit);
+  if (!is_page_allocated(page_num)) {
+    file_header_->page_count = max(file_header_->page_count, page_num + 1);
+    RC rc = set_page_allocated(page_num, true, hdr_frame_->lsn());
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
     file_header_->allocated_pages++;
-    file_header_->page_count++;
     hdr_frame_->mark_dirty();
   }
   return RC::SUCCESS;
@@ -598,15 +1079,11 @@ RC DiskBufferPool::recover_page(PageNum page_num)
 
 RC DiskBufferPool::write_page(PageNum page_num, Page &page)
 {
-  scoped_lock lock_guard(wr_lock_);
-  int64_t     offset = ((int64_t)page_num) * sizeof(Page);
-  if (lseek(file_desc_, offset, SEEK_SET) == -1) {
-    LOG_ERROR("Failed to write page %lld of %d due to failed to seek %s.", offset, file_desc_, strerror(errno));
-    return RC::IOERR_SEEK;
-  }
-
-  if (writen(file_desc_, &page, sizeof(Page)) != 0) {
-    LOG_ERROR("Failed to write page %lld of %d due to %s.", offset, file_desc_, strerror(errno));
+  iovec          iov     = {&page, sizeof(Page)};
+  AsyncIoRequest request = AsyncIoRequest::write(file_desc_, static_cast<int64_t>(page_num) * sizeof(Page), &iov, 1);
+  RC             rc      = bp_manager_.io_engine().submit_and_wait(request);
+  if (OB_FAIL(rc)) {
+    LOG_ERROR("Failed to write page %d of %d due to %s.", page_num, file_desc_, strerror(request.error));
     return RC::IOERR_WRITE;
   }
 
@@ -616,76 +1093,164 @@ RC DiskBufferPool::write_page(PageNum page_num, Page &page)
 
 RC DiskBufferPool::redo_allocate_page(LSN lsn, PageNum page_num)
 {
-  if (hdr_frame_->lsn() >= lsn) {
-    return RC::SUCCESS;
-  }
-
   // scoped_lock lock_guard(lock_); // redo 过程中可以不加锁
-  if (page_num < file_header_->page_count) {
-    Bitmap bitmap(file_header_->bitmap, file_header_->page_count);
-    if (bitmap.get_bit(page_num)) {
+  // 文件头中的计数由文件头的lsn判断是否需要回放，页面的分配位由位图所在页面的lsn判断。
+  // 第0组的位图就在文件头中，空间映射页有自己的lsn
+  if (hdr_frame_->lsn() < lsn) {
+    if (page_num > file_header_->page_count) {
+      LOG_WARN("page %d is not continuous. file=%s, page_count=%d",
+               page_num, file_name_.c_str(), file_header_->page_count);
+      return RC::INTERNAL;
+    }
+
+    if (BPFileHeader::group_of(page_num) == 0 && page_num < file_header_->page_count &&
+        Bitmap(file_header_->bitmap, page_num + 1).get_bit(page_num)) {
       LOG_WARN("page %d has been allocated. file=%s", page_num, file_name_.c_str());
       return RC::SUCCESS;
     }
 
-    bitmap.set_bit(page_num);
+    if (page_num == file_header_->page_count) {
+      file_header_->page_count++;
+      LOG_TRACE("[redo] allocate new page. file=%s, pageNum=%d", file_name_.c_str(), page_num);
+    }
     file_header_->allocated_pages++;
+
+    if (BPFileHeader::group_of(page_num) == 0) {
+      Bitmap(file_header_->bitmap, page_num + 1).set_bit(page_num);
+      disposed_pages_.erase(page_num);
+    }
+    hdr_frame_->set_lsn(lsn);
     hdr_frame_->mark_dirty();
+  }
+
+  // 文件头可能已经落盘，但是新扩展的页面还没有写到文件中
+  RC rc = ensure_file_contains(page_num);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  if (BPFileHeader::group_of(page_num) == 0) {
     return RC::SUCCESS;
   }
 
-  if (page_num > file_header_->page_count) {
-    LOG_WARN("page %d is not continuous. file=%s, page_count=%d",
-             page_num, file_name_.c_str(), file_header_->page_count);
+  if (page_num >= file_header_->page_count) {
+    LOG_WARN("page %d is not exist. file=%s, page_count=%d", page_num, file_name_.c_str(), file_header_->page_count);
     return RC::INTERNAL;
   }
 
-  // page_num == file_header_->page_count
-  if (file_header_->page_count >= BPFileHeader::MAX_PAGE_NUM) {
-    LOG_WARN("file buffer pool is full. page count %d, max page count %d",
-        file_header_->page_count, BPFileHeader::MAX_PAGE_NUM);
-    return RC::INTERNAL;
+  if (BPFileHeader::is_space_map_page(page_num)) {
+    return init_space_map(page_num, lsn);
   }
 
-  file_header_->allocated_pages++;
-  file_header_->page_count++;
-  hdr_frame_->set_lsn(lsn);
-  hdr_frame_->mark_dirty();
-  
-  // TODO 应该检查文件是否足够大，包含了当前新分配的页面
+  Frame *map_frame = nullptr;
+  char  *data      = nullptr;
+  rc               = get_space_map(page_num, map_frame, data);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
 
-  Bitmap bitmap(file_header_->bitmap, file_header_->page_count);
-  bitmap.set_bit(page_num);
-  LOG_TRACE("[redo] allocate new page. file=%s, pageNum=%d", file_name_.c_str(), page_num);
-  return RC::SUCCESS;
+  LSN map_lsn = map_frame->lsn();
+  put_space_map(map_frame);
+  if (map_lsn >= lsn) {
+    return RC::SUCCESS;
+  }
+  return set_page_allocated(page_num, true, lsn);
 }
 
-RC DiskBufferPool::redo_deallocate_page(LSN lsn, PageNum page_num)
+RC DiskBufferPool::ensure_file_contains(PageNum page_num)
 {
-  if (hdr_frame_->lsn() >= lsn) {
+  struct stat st;
+  if (fstat(file_desc_, &st) != 0) {
+    LOG_ERROR("Failed to stat file %s, due to %s.", file_name_.c_str(), strerror(errno));
+    return RC::IOERR_ACCESS;
+  }
+
+  const off_t file_size = static_cast<off_t>(page_num + 1) * BP_PAGE_SIZE;
+  if (st.st_size >= file_size) {
     return RC::SUCCESS;
   }
 
+  if (ftruncate(file_desc_, file_size) != 0) {
+    LOG_ERROR("Failed to extend file %s to %ld bytes, due to %s.", file_name_.c_str(), file_size, strerror(errno));
+    return RC::IOERR_WRITE;
+  }
+  LOG_INFO("[redo] extend file %s to contain page %d", file_name_.c_str(), page_num);
+  return RC::SUCCESS;
+}
+
+RC DiskBufferPool::init_space_map(PageNum page_num, LSN lsn)
+{
+  Frame *frame = nullptr;
+  RC     rc    = get_this_page_internal(page_num, &frame);
+  if (OB_FAIL(rc)) {
+    // 页面还没有写到文件中
+    rc = allocate_frame(page_num, &frame);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to allocate frame for space map page. file=%s, page=%d, rc=%s",
+               file_name_.c_str(), page_num, strrc(rc));
+      return rc;
+    }
+
+    frame->set_buffer_pool_id(id());
+    frame->access();
+    frame->clear_page();
+    frame->set_page_num(page_num);
+  }
+
+  if (frame->lsn() < lsn) {
+    frame->clear_page();
+    Bitmap(frame->data(), 1).set_bit(0);
+    frame->set_lsn(lsn);
+    frame->mark_dirty();
+    LOG_TRACE("[redo] init space map page. file=%s, pageNum=%d", file_name_.c_str(), page_num);
+  }
+
+  frame->unpin();
+  return RC::SUCCESS;
+}
+
+RC DiskBufferPool::redo_deallocate_page(LSN lsn, PageNum page_num)
+{
   if (page_num >= file_header_->page_count) {
     LOG_WARN("page %d is not exist. file=%s", page_num, file_name_.c_str());
     return RC::INTERNAL;
   }
 
-  Bitmap bitmap(file_header_->bitmap, file_header_->page_count);
-  if (!bitmap.get_bit(page_num)) {
-    LOG_WARN("page %d has been deallocated. file=%s", page_num, file_name_.c_str());
-    return RC::INTERNAL;
+  Frame *map_frame = nullptr;
+  char  *data      = nullptr;
+  RC     rc        = get_space_map(page_num, map_frame, data);
+  if (OB_FAIL(rc)) {
+    return rc;
   }
 
-  bitmap.clear_bit(page_num);
-  file_header_->allocated_pages--;
-  hdr_frame_->set_lsn(lsn);
-  hdr_frame_->mark_dirty();
+  const int  index     = page_num - static_cast<PageNum>(BPFileHeader::group_start(BPFileHeader::group_of(page_num)));
+  const LSN  hdr_lsn   = hdr_frame_->lsn();
+  const LSN  map_lsn   = map_frame->lsn();
+  const bool allocated = Bitmap(data, index + 1).get_bit(index);
+  put_space_map(map_frame);
+
+  if (map_lsn < lsn) {
+    if (!allocated) {
+      LOG_WARN("page %d has been deallocated. file=%s", page_num, file_name_.c_str());
+      return RC::INTERNAL;
+    }
+
+    rc = set_page_allocated(page_num, false, lsn);
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+  }
+
+  if (hdr_lsn < lsn) {
+    file_header_->allocated_pages--;
+    hdr_frame_->set_lsn(lsn);
+    hdr_frame_->mark_dirty();
+  }
   LOG_TRACE("[redo] deallocate page. file=%s, pageNum=%d", file_name_.c_str(), page_num);
   return RC::SUCCESS;
 }
 
-RC DiskBufferPool::allocate_frame(PageNum page_num, Frame **buffer)
+RC DiskBufferPool::allocate_frame(PageNum page_num, Frame **buffer, bool latched /*= false*/)
 {
   auto purger = [this](Frame *frame) {
     if (!frame->dirty()) {
@@ -706,7 +1271,7 @@ RC DiskBufferPool::allocate_frame(PageNum page_num, Frame **buffer)
   };
 
   while (true) {
-    Frame *frame = frame_manager_.alloc(id(), page_num);
+    Frame *frame = frame_manager_.alloc(id(), page_num, latched);
     if (frame != nullptr) {
       *buffer = frame;
       LOG_DEBUG("allocate frame %p, page num %d, frame=%s", frame, page_num, frame->to_string().c_str());
@@ -714,6 +1279,7 @@ RC DiskBufferPool::allocate_frame(PageNum page_num, Frame **buffer)
     }
 
     LOG_TRACE("frames are all allocated, so we should purge some frames to get one free frame");
+    bp_manager_.wakeup_page_cleaner();
     (void)frame_manager_.purge_frames(1 /*count*/, purger);
   }
   return RC::BUFFERPOOL_NOBUF;
@@ -725,7 +1291,7 @@ RC DiskBufferPool::check_page_num(PageNum page_num)
     LOG_ERROR("Invalid pageNum:%d, file's name:%s", page_num, file_name_.c_str());
     return RC::BUFFERPOOL_INVALID_PAGE_NUM;
   }
-  if ((file_header_->bitmap[page_num / 8] & (1 << (page_num % 8))) == 0) {
+  if (!is_page_allocated(page_num)) {
     LOG_ERROR("Invalid pageNum:%d, file's name:%s", page_num, file_name_.c_str());
     return RC::BUFFERPOOL_INVALID_PAGE_NUM;
   }
@@ -740,18 +1306,13 @@ RC DiskBufferPool::load_page(PageNum page_num, Frame *frame)
     return rc;
   }
 
-  scoped_lock lock_guard(wr_lock_);
-  int64_t          offset = ((int64_t)page_num) * BP_PAGE_SIZE;
-  if (lseek(file_desc_, offset, SEEK_SET) == -1) {
-    LOG_ERROR("Failed to load page %s:%d, due to failed to lseek:%s.", file_name_.c_str(), page_num, strerror(errno));
-
-    return RC::IOERR_SEEK;
-  }
-
-  int ret = readn(file_desc_, &page, BP_PAGE_SIZE);
-  if (ret != 0) {
-    LOG_ERROR("Failed to load page %s, file_desc:%d, page num:%d, due to failed to read data:%s, ret=%d, page count=%d",
-              file_name_.c_str(), file_desc_, page_num, strerror(errno), ret, file_header_->allocated_pages);
+  iovec          iov     = {&page, BP_PAGE_SIZE};
+  AsyncIoRequest request = AsyncIoRequest::read(file_desc_, static_cast<int64_t>(page_num) * BP_PAGE_SIZE, &iov, 1);
+  rc                     = bp_manager_.io_engine().submit_and_wait(request);
+  if (OB_FAIL(rc)) {
+    LOG_ERROR("Failed to load page %s, file_desc:%d, page num:%d, due to failed to read data:%s, read=%ld, page count=%d",
+              file_name_.c_str(), file_desc_, page_num, strerror(request.error), request.transferred,
+              file_header_->allocated_pages);
     return RC::IOERR_READ;
   }
 
@@ -762,22 +1323,80 @@ RC DiskBufferPool::load_page(PageNum page_num, Frame *frame)
   return RC::SUCCESS;
 }
 
+int DiskBufferPool::load_pages(span<Frame *> frames)
+{
+  if (frames.empty()) {
+    return 0;
+  }
+
+  // 提交请求之前 iovs 的大小就确定了，请求中保存的指针不会失效
+  vector<iovec>          iovs(frames.size());
+  vector<AsyncIoRequest> requests;
+  for (size_t i = 0; i < frames.size(); i++) {
+    iovs[i].iov_base = &frames[i]->page();
+    iovs[i].iov_len  = BP_PAGE_SIZE;
+
+    const PageNum page_num = frames[i]->page_num();
+    if (!requests.empty() && page_num == frames[i - 1]->page_num() + 1 && requests.back().iov_count < IOV_MAX) {
+      requests.back().iov_count++;
+    } else {
+      requests.push_back(
+          AsyncIoRequest::read(file_desc_, static_cast<int64_t>(page_num) * BP_PAGE_SIZE, &iovs[i], 1 /*iov_count*/));
+    }
+  }
+
+  RC rc = bp_manager_.io_engine().submit_and_wait(requests);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("Failed to load some pages of %s. page count=%d, rc=%s",
+             file_name_.c_str(), static_cast<int>(frames.size()), strrc(rc));
+  }
+
+  int loaded_num = 0;
+  for (const AsyncIoRequest &request : requests) {
+    const size_t first = request.iovs - iovs.data();
+    for (size_t i = first; i < first + request.iov_count; i++) {
+      Frame *frame = frames[i];
+      frame->write_unlatch();
+      if (request.error == 0) {
+        frame->unpin();
+        loaded_num++;
+      } else {
+        // 释放页帧，下次访问时再按照一个个页面的方式读取
+        purge_frame(frame->page_num(), frame);
+      }
+    }
+  }
+
+  LOG_DEBUG("Load pages %s, file_desc:%d, requests:%d, pages:%d, loaded:%d",
+            file_name_.c_str(), file_desc_, static_cast<int>(requests.size()), static_cast<int>(frames.size()), loaded_num);
+  return loaded_num;
+}
+
 int DiskBufferPool::file_desc() const { return file_desc_; }
 
 ////////////////////////////////////////////////////////////////////////////////
-BufferPoolManager::BufferPoolManager(int memory_size /* = 0 */)
+BufferPoolManager::BufferPoolManager(int memory_size /* = 0 */, int partition_num /* = 0 */,
+    const char *eviction_policy /* = "lru" */, bool huge_page /* = false */, bool numa_aware /* = false */)
 {
   if (memory_size <= 0) {
     memory_size = MEM_POOL_ITEM_NUM * DEFAULT_ITEM_NUM_PER_POOL * BP_PAGE_SIZE;
   }
   const int pool_num = max(memory_size / BP_PAGE_SIZE / DEFAULT_ITEM_NUM_PER_POOL, 1);
-  frame_manager_.init(pool_num);
-  LOG_INFO("buffer pool manager init with memory size %d, page num: %d, pool num: %d",
-           memory_size, pool_num * DEFAULT_ITEM_NUM_PER_POOL, pool_num);
+  if (partition_num <= 0) {
+    partition_num = max(1, min(static_cast<int>(thread::hardware_concurrency()), MAX_FRAME_PARTITION_NUM));
+  }
+  frame_manager_.init(pool_num, partition_num, eviction_policy, huge_page, numa_aware);
+  LOG_INFO("buffer pool manager init with memory size %d, page num: %d, pool num: %d, partition num: %d, "
+           "huge page: %d, numa aware: %d",
+           memory_size, pool_num * DEFAULT_ITEM_NUM_PER_POOL, pool_num, partition_num, huge_page, numa_aware);
 }
 
 BufferPoolManager::~BufferPoolManager()
 {
+  if (page_cleaner_.running()) {
+    page_cleaner_.stop();
+  }
+
   unordered_map<string, DiskBufferPool *> tmp_bps;
   tmp_bps.swap(buffer_pools_);
 
@@ -871,6 +1490,9 @@ RC BufferPoolManager::close_file(const char *_file_name)
 {
   string file_name(_file_name);
 
+  // 后台刷脏线程可能正在使用这个 buffer pool，等它这一轮结束后再移除。
+  // 刷脏线程会先拿 round lock 再拿 lock_。删除 buffer pool 时会再次调用 close_file，所以不能持有 round lock
+  unique_lock<mutex> cleaner_guard(page_cleaner_.round_lock());
   lock_.lock();
 
   auto iter = buffer_pools_.find(file_name);
@@ -885,6 +1507,7 @@ RC BufferPoolManager::close_file(const char *_file_name)
   DiskBufferPool *bp = iter->second;
   buffer_pools_.erase(iter);
   lock_.unlock();
+  cleaner_guard.unlock();
 
   delete bp;
   return RC::SUCCESS;
@@ -905,6 +1528,19 @@ RC BufferPoolManager::flush_page(Frame &frame)
   return bp->flush_page(frame);
 }
 
+RC BufferPoolManager::start_page_cleaner(double clean_ratio, int interval_ms)
+{
+  return page_cleaner_.start(clean_ratio, interval_ms);
+}
+
+RC BufferPoolManager::stop_page_cleaner()
+{
+  if (!page_cleaner_.running()) {
+    return RC::SUCCESS;
+  }
+  return page_cleaner_.stop();
+}
+
 RC BufferPoolManager::get_buffer_pool(int32_t id, DiskBufferPool *&bp)
 {
   bp = nullptr;
@@ -25,15 +25,20 @@ See the Mulan PSL v2 for more details. */
 #include <time.h>
 #include <optional>
 
+#include "common/io/async_io.h"
 #include "common/lang/bitmap.h"
-#include "common/lang/lru_cache.h"
 #include "common/lang/mutex.h"
 #include "common/lang/memory.h"
+#include "common/lang/span.h"
 #include "common/lang/unordered_map.h"
+#include "common/lang/vector.h"
 #include "common/mm/mem_pool.h"
 #include "common/sys/rc.h"
 #include "common/types.h"
 #include "storage/buffer/frame.h"
+#include "storage/buffer/frame_arena.h"
+#include "storage/buffer/frame_eviction_policy.h"
+#include "storage/buffer/page_cleaner.h"
 #include "storage/buffer/page.h"
 #include "storage/buffer/buffer_pool_log.h"
 
@@ -51,27 +56,52 @@ class BufferPoolLogHandler;
 #define BP_FILE_SUB_HDR_SIZE (sizeof(BPFileSubHeader))
 
 /**
- * @brief BufferPool的文件第一个页面，存放一些元数据信息，包括了后面每页的分配信息。
+ * @brief BufferPool的文件第一个页面，存放一些元数据信息，包括了前面一部分页面的分配信息。
  * @ingroup BufferPool
- * @details
- * @code
- * TODO 1. 当前的做法，只能分配比较少的页面，你可以扩展一下，支持更多的页面或无限多的页面吗？
- *         可以参考Linux ext(n)和Windows NTFS等文件系统
- *      2. 当前使用bitmap存放页面分配情况，但是这种方法在页面非常多的时候，查找空闲页面的
- *         效率非常低，你有办法优化吗？
- * @endcode
+ * @details 文件中的页面按照编号划分成多个组，每个组的页面分配情况记录在一个位图中：
+ * - 第0组是文件开头的 HEADER_MAP_PAGES 个页面，位图就放在文件头中；
+ * - 后面每 SPACE_MAP_PAGES 个页面是一组，组内的第一个页面是空间映射页(space map page)，
+ *   整个页面的数据都是这个组的位图。空间映射页本身也算作已经分配的页面，对应的位总是1。
+ * 空间映射页在文件扩展到这个组时才分配，所以文件的大小只受页面编号范围的限制。
+ * 只包含第0组的文件与原来的格式是一样的。
  */
 struct BPFileHeader
 {
   int32_t buffer_pool_id;   //! buffer pool id
   int32_t page_count;       //! 当前文件一共有多少个页面
-  int32_t allocated_pages;  //! 已经分配了多少个页面
-  char    bitmap[0];        //! 页面分配位图, 第0个页面(就是当前页面)，总是1
+  int32_t allocated_pages;  //! 已经分配了多少个页面，包括空间映射页
+  char    bitmap[0];        //! 第0组页面的分配位图, 第0个页面(就是当前页面)，总是1
 
   /**
-   * 能够分配的最大的页面个数，即bitmap的字节数 乘以8
+   * 文件头中的位图能够记录的页面个数，即bitmap的字节数 乘以8
    */
-  static const int MAX_PAGE_NUM = (BP_PAGE_DATA_SIZE - sizeof(page_count) - sizeof(allocated_pages)) * 8;
+  static constexpr int HEADER_MAP_PAGES =
+      (BP_PAGE_DATA_SIZE - sizeof(buffer_pool_id) - sizeof(page_count) - sizeof(allocated_pages)) * 8;
+
+  /**
+   * 一个空间映射页能够记录的页面个数
+   */
+  static constexpr int SPACE_MAP_PAGES = BP_PAGE_DATA_SIZE * 8;
+
+  /// @brief 页面所在的组
+  static int group_of(PageNum page_num)
+  {
+    return page_num < HEADER_MAP_PAGES ? 0 : (page_num - HEADER_MAP_PAGES) / SPACE_MAP_PAGES + 1;
+  }
+
+  /// @brief 组内第一个页面的编号。不是第0组时，就是这个组的空间映射页
+  static int64_t group_start(int group)
+  {
+    return group == 0 ? 0 : HEADER_MAP_PAGES + static_cast<int64_t>(group - 1) * SPACE_MAP_PAGES;
+  }
+
+  /// @brief 组内最后一个页面的下一个页面编号
+  static int64_t group_end(int group) { return HEADER_MAP_PAGES + static_cast<int64_t>(group) * SPACE_MAP_PAGES; }
+
+  static bool is_space_map_page(PageNum page_num)
+  {
+    return page_num >= HEADER_MAP_PAGES && (page_num - HEADER_MAP_PAGES) % SPACE_MAP_PAGES == 0;
+  }
 
   string to_string() const;
 };
@@ -83,13 +113,31 @@ struct BPFileHeader
  * 当内存中的页帧不够用时，需要从内存中淘汰一些页帧，以便为新的页帧腾出空间。
  * 这个管理器负责为所有的BufferPool提供页帧管理服务，也就是所有的BufferPool磁盘文件
  * 在访问时都使用这个管理器映射到内存。
+ *
+ * 为了降低多线程访问时的锁冲突，页帧按照 FrameId::hash() 划分到多个分区(partition)中，
+ * 每个分区有自己的锁、淘汰策略和空闲页帧池。访问某个页面时只需要锁住它所在的分区。
+ * 淘汰哪些页帧由 FrameEvictionPolicy 决定，可以通过配置选择。
+ * 某个分区的空闲页帧用完后，会尝试从其它分区"借"一个空闲页帧，所以所有分区总的页帧数与
+ * 不分区时是一样的。
+ * 所有的页帧都放在一个 FrameArena 中。按照NUMA节点划分页帧时，每个分区的空闲页帧也按照节点分开存放，
+ * 分配时优先使用当前线程所在节点上的页帧。
  */
 class BPFrameManager
 {
 public:
   BPFrameManager(const char *tag);
 
-  RC init(int pool_num);
+  /**
+   * @brief 初始化
+   *
+   * @param pool_num 内存池的个数，每个内存池包含 DEFAULT_ITEM_NUM_PER_POOL 个页帧
+   * @param partition_num 分区个数。小于等于0时只使用一个分区
+   * @param eviction_policy 页帧淘汰策略的名称，参考 FrameEvictionPolicy::create
+   * @param huge_page 页帧是否使用大页，参考 FrameArena
+   * @param numa_aware 是否按照NUMA节点划分页帧
+   */
+  RC init(int pool_num, int partition_num = 1, const char *eviction_policy = "lru", bool huge_page = false,
+      bool numa_aware = false);
   RC cleanup();
 
   /**
@@ -114,9 +162,17 @@ public:
    *
    * @param buffer_pool_id buffer Pool标识
    * @param page_num 页面编号
+   * @param latched 是否在页帧对其它线程可见之前加上写锁。从磁盘加载页面时使用，加载完成之前
+   * 其它线程即使找到了这个页帧也读不到页面数据。调用者需要保证页面不在内存中。
    * @return Frame* 页帧指针
    */
-  Frame *alloc(int buffer_pool_id, PageNum page_num);
+  Frame *alloc(int buffer_pool_id, PageNum page_num, bool latched = false);
+
+  /**
+   * @brief 页面是否已经在内存中
+   * @details 与 get 不同，不会pin页帧，也不算作一次访问
+   */
+  bool contains(int buffer_pool_id, PageNum page_num);
 
   /**
    * 尽管frame中已经包含了buffer_pool_id和page_num，但是依然要求
@@ -130,19 +186,50 @@ public:
    * @param count 想要purge多少个页面
    * @param purger 需要在释放frame之前，对页面做些什么操作。当前是刷新脏数据到磁盘
    * @return 返回本次清理了多少个页面
+   * @details 从一个轮转的分区开始查找，当前分区找不到可以淘汰的页面时，再查找下一个分区。
+   * 每个分区内按照淘汰策略给出的顺序查找可以淘汰的页面。
    */
   int purge_frames(int count, function<RC(Frame *frame)> purger);
 
-  size_t frame_num() const { return frames_.count(); }
+  /**
+   * @brief 收集当前没有被使用的脏页
+   * @param[out] flush_list 没有被pin的脏页，按照页面LSN从小到大排序
+   * @return 所有脏页的个数，包括正在被使用的脏页
+   */
+  size_t collect_dirty_frames(vector<pair<LSN, FrameId>> &flush_list);
+
+  /**
+   * @brief 所有页帧中最小的恢复LSN，也就是重启时需要开始重做的位置
+   * @details 只是扫描内存中的页帧(dirty page table)，不会刷新任何页面，扫描期间其它线程可以继续修改页面。
+   * 已经修改但是还没有写日志的脏页，使用它当前的页面LSN加1，因为它后续的日志一定比这个大。
+   * @param max_lsn 没有更小的恢复LSN时返回这个值
+   */
+  LSN min_recovery_lsn(LSN max_lsn);
+
+  /**
+   * @brief 如果页帧是脏的并且没有被使用，就刷新它
+   * @details 刷新时持有页帧所在分区的锁，所以刷新过程中其它线程不能pin住这个页帧，
+   * 也就不会修改页面的内容。页帧刷新后依然保留在内存中。
+   * @param flusher 刷新页面的函数
+   * @param[out] flushed 是否真的刷新了页面
+   */
+  RC flush_idle_frame(const FrameId &frame_id, const function<RC(Frame *frame)> &flusher, bool &flushed);
+
+  size_t frame_num() const;
 
   /**
    * 测试使用。返回已经从内存申请的个数
    */
-  size_t total_frame_num() const { return allocator_.get_size(); }
+  size_t total_frame_num() const { return arena_.frame_num(); }
 
-private:
-  Frame *get_internal(const FrameId &frame_id);
-  RC     free_internal(const FrameId &frame_id, Frame *frame);
+  const FrameArena &arena() const { return arena_; }
+
+  int partition_num() const { return static_cast<int>(partitions_.size()); }
+
+  /// @brief 通过 get 查找页面时，页面已经在内存中的次数
+  int64_t hit_count() const { return hit_count_.load(); }
+  /// @brief 通过 get 查找页面时，页面不在内存中的次数
+  int64_t miss_count() const { return miss_count_.load(); }
 
 private:
   class BPFrameIdHasher
@@ -151,20 +238,62 @@ private:
     size_t operator()(const FrameId &frame_id) const { return frame_id.hash(); }
   };
 
-  using FrameLruCache  = common::LruCache<FrameId, Frame *, BPFrameIdHasher>;
-  using FrameAllocator = common::MemPoolSimple<Frame>;
+  using FrameMap = unordered_map<FrameId, Frame *, BPFrameIdHasher>;
+
+  /**
+   * @brief 页帧分区
+   * @details 分区内的数据都由分区自己的锁保护
+   */
+  struct Partition
+  {
+    mutex                           lock;
+    FrameMap                        frames;       ///< 当前分区正在使用的页帧
+    unique_ptr<FrameEvictionPolicy> policy;       ///< 当前分区的淘汰策略
+    vector<vector<Frame *>>         free_frames;  ///< 当前分区的空闲页帧，按照页帧所在的NUMA节点分开存放
+  };
+
+  Partition &partition_of(const FrameId &frame_id);
+
+  Frame *get_internal(Partition &partition, const FrameId &frame_id);
+  RC     free_internal(Partition &partition, const FrameId &frame_id, Frame *frame);
+
+  /**
+   * @brief 从其它分区借一个空闲页帧
+   * @details 调用时持有 self 分区的锁，为了避免死锁，这里只会 try_lock 其它分区
+   */
+  Frame *steal_free_frame(Partition &self);
+
+  /**
+   * @brief 从分区中取一个空闲页帧，优先使用当前线程所在NUMA节点上的页帧
+   * @details 调用时持有分区的锁
+   */
+  Frame *pop_free_frame(Partition &partition);
+  void   push_free_frame(Partition &partition, Frame *frame);
 
-  mutex          lock_;
-  FrameLruCache  frames_;
-  FrameAllocator allocator_;
+  int purge_partition(Partition &partition, int count, const function<RC(Frame *frame)> &purger);
+
+private:
+  vector<unique_ptr<Partition>> partitions_;
+  atomic<size_t>                purge_cursor_{0};  ///< 下一次淘汰页面时从哪个分区开始
+  atomic<int64_t>               hit_count_{0};
+  atomic<int64_t>               miss_count_{0};
+  string                        tag_;
+  FrameArena                    arena_;
 };
 
 /**
  * @brief 用于遍历BufferPool中的所有页面
  * @ingroup BufferPool
+ * @details 可以开启顺序预读。连续遍历了几个相邻的页面后，认为是在做顺序扫描，
+ * 就会调用 DiskBufferPool::prefetch 提前把后面的页面批量读到内存中，
+ * 这样就不需要每访问一个页面都同步地读一次磁盘。
  */
 class BufferPoolIterator
 {
+public:
+  /// 扫描数据时默认预读的页面个数
+  static constexpr int DEFAULT_READ_AHEAD_PAGES = 32;
+
 public:
   BufferPoolIterator();
   ~BufferPoolIterator();
@@ -174,9 +303,27 @@ public:
   PageNum next();
   RC      reset();
 
+  /**
+   * @brief 设置顺序预读的页面个数
+   * @param read_ahead_pages 每次预读的页面个数，小于等于0表示不预读
+   */
+  void set_read_ahead(int read_ahead_pages) { read_ahead_pages_ = read_ahead_pages; }
+
+private:
+  void read_ahead(PageNum page_num);
+
 private:
-  common::Bitmap bitmap_;
-  PageNum        current_page_num_ = -1;
+  /// 连续访问了多少个相邻的页面之后才开始预读
+  static constexpr int SEQUENTIAL_THRESHOLD = 2;
+
+  DiskBufferPool *buffer_pool_      = nullptr;
+  PageNum         end_page_num_     = 0;   ///< 只遍历初始化时已经存在的页面
+  PageNum         current_page_num_ = -1;
+  PageNum         next_page_num_    = -1;  ///< has_next 找到的下一个页面，不大于 current_page_num_ 时表示还没有找
+
+  int     read_ahead_pages_ = 0;   ///< 每次预读的页面个数
+  int     sequential_count_ = 0;   ///< 连续访问相邻页面的次数
+  PageNum read_ahead_end_   = -1;  ///< 小于这个编号的页面已经预读过了
 };
 
 /**
@@ -207,13 +354,29 @@ public:
    */
   RC get_this_page(PageNum page_num, Frame **frame);
 
+  /**
+   * @brief 当前文件一共有多少个页面，包括没有分配的页面
+   */
+  PageNum page_count() const { return file_header_->page_count; }
+
   /**
    * @brief 在指定文件中分配一个新的页面，并将其放入缓冲区，返回页面句柄指针。
    * @details 分配页面时，如果文件中有空闲页，就直接分配一个空闲页；
-   * 如果文件中没有空闲页，则扩展文件规模来增加新的空闲页。
+   * 如果文件中没有空闲页，则扩展文件规模来增加新的空闲页。扩展到一个新的组时，会先分配这个组的空间映射页。
+   * 查找空闲页时不会每次都从头扫描位图，参考 next_free_hint_。
    */
   RC allocate_page(Frame **frame);
 
+  /**
+   * @brief 把指定范围内的页面提前读到内存中
+   * @details 已经在内存中的页面和没有分配的页面会跳过，编号连续的页面使用一次 preadv 读取。
+   * 预读的页面不会被pin住，并且不算作一次访问，淘汰策略会把它们当作新加载的页面。
+   * 为了防止预读把其它页面都挤出去，一次最多预读四分之一的页帧。
+   * @param start_page 第一个页面编号
+   * @param count 页面个数
+   */
+  RC prefetch(PageNum start_page, int count);
+
   /**
    * @brief 释放某个页面，将此页面设置为未分配状态
    *
@@ -274,7 +437,7 @@ public:
   const char *filename() const { return file_name_.c_str(); }
 
 protected:
-  RC allocate_frame(PageNum page_num, Frame **buf);
+  RC allocate_frame(PageNum page_num, Frame **buf, bool latched = false);
 
   /**
    * 刷新指定页面到磁盘(flush)，并且释放关联的Frame
@@ -282,11 +445,78 @@ protected:
   RC purge_frame(PageNum page_num, Frame *used_frame);
   RC check_page_num(PageNum page_num);
 
+  /**
+   * @brief 与 get_this_page 相同，调用者需要持有 lock_
+   */
+  RC get_this_page_internal(PageNum page_num, Frame **frame);
+
+  /**
+   * @brief 获取记录指定页面分配情况的位图
+   * @details 调用者需要持有 lock_。位图的第0位对应页面所在组的第一个页面。
+   * 返回的页帧不是文件头时，用完之后需要调用 put_space_map
+   * @param page_num 页面编号
+   * @param[out] frame 位图所在的页帧，第0组是文件头，其它的是空间映射页
+   * @param[out] bitmap 位图的起始地址
+   */
+  RC   get_space_map(PageNum page_num, Frame *&frame, char *&bitmap);
+  void put_space_map(Frame *frame);
+
+  /**
+   * @brief 页面是否已经分配，调用者需要持有 lock_
+   */
+  bool is_page_allocated(PageNum page_num);
+
+  /**
+   * @brief 从 next_free_hint_ 开始查找一个空闲页面，调用者需要持有 lock_
+   * @return 没有空闲页面时返回 BP_INVALID_PAGE_NUM
+   */
+  PageNum find_free_page();
+
+  /**
+   * @brief 在位图中把页面标记为已分配或未分配，并维护 next_free_hint_，调用者需要持有 lock_
+   * @details 位图所在的页帧会设置上 lsn。文件头中的计数由调用者维护
+   */
+  RC set_page_allocated(PageNum page_num, bool allocated, LSN lsn);
+
+  /**
+   * @brief 扩展文件，新的页面编号是当前的 page_count，调用者需要持有 lock_
+   */
+  RC extend_page(Frame **frame);
+
+  /**
+   * @brief 初始化一个新的空间映射页，调用者需要持有 lock_
+   * @details 回放日志时页面可能还不在文件中，这时直接创建页帧
+   */
+  RC init_space_map(PageNum page_num, LSN lsn);
+
+  /**
+   * @brief 回放日志时确保文件足够大，包含指定的页面
+   * @details 扩展出来的页面可能还在 double write buffer 中没有写到文件里数据库就崩溃了，
+   * 这时把文件扩展到包含这个页面，页面内容全部为0，由后续的日志重新生成。
+   */
+  RC ensure_file_contains(PageNum page_num);
+
+  /**
+   * @brief 查找下一个已经分配的页面，跳过空间映射页
+   * @param start_page 从这个页面开始查找(包括这个页面)
+   * @param end_page 查找到这个页面之前为止
+   * @return 没有找到时返回 BP_INVALID_PAGE_NUM
+   */
+  PageNum next_allocated_page(PageNum start_page, PageNum end_page);
+
   /**
    * 加载指定页面的数据到内存中
    */
   RC load_page(PageNum page_num, Frame *frame);
 
+  /**
+   * @brief 批量加载多个页面
+   * @details 编号连续的页面合并成一个读请求，所有的请求一起提交给IO引擎。
+   * 页帧需要已经加了写锁并且按照页面编号排序。读取成功的页帧会解锁并unpin，读取失败的页帧直接释放。
+   * @return 加载成功的页面个数
+   */
+  int load_pages(span<Frame *> frames);
+
   /**
    * 如果页面是脏的，就将数据刷新到磁盘
    */
@@ -303,15 +533,19 @@ private:
   int32_t       buffer_pool_id_ = -1;
   Frame        *hdr_frame_      = nullptr;  /// 文件头页面
   BPFileHeader *file_header_    = nullptr;  /// 文件头
-  set<PageNum>  disposed_pages_;            /// 已经释放的页面
+  /// 已经释放的页面中，编号小于 next_free_hint_ 的那些。优先分配这些页面
+  set<PageNum> disposed_pages_;
+  /// 编号小于这个值并且不在 disposed_pages_ 中的页面都已经分配了，查找空闲页面时从这里开始。
+  /// 打开文件时是0，之后只会向后移动，所以分配页面的均摊开销是O(1)的
+  PageNum next_free_hint_ = 0;
 
   string file_name_;  /// 文件名
 
   common::Mutex lock_;
-  common::Mutex wr_lock_;
 
 private:
   friend class BufferPoolIterator;
+  friend class PageCleaner;
 };
 
 /**
@@ -321,7 +555,15 @@ private:
 class BufferPoolManager final
 {
 public:
-  BufferPoolManager(int memory_size = 0);
+  /**
+   * @param memory_size 页帧使用的内存大小，小于等于0时使用默认值
+   * @param partition_num 页帧管理器的分区个数，小于等于0时按照CPU核数自动设置
+   * @param eviction_policy 页帧淘汰策略，参考 FrameEvictionPolicy::create
+   * @param huge_page 页帧是否使用大页
+   * @param numa_aware 是否按照NUMA节点划分页帧
+   */
+  BufferPoolManager(int memory_size = 0, int partition_num = 0, const char *eviction_policy = "lru",
+      bool huge_page = false, bool numa_aware = false);
   ~BufferPoolManager();
 
   RC init(unique_ptr<DoubleWriteBuffer> dblwr_buffer);
@@ -332,9 +574,35 @@ public:
 
   RC flush_page(Frame &frame);
 
+  /**
+   * @brief 启动后台刷脏线程
+   * @param clean_ratio 期望的干净页帧比例
+   * @param interval_ms 后台线程检查的时间间隔
+   */
+  RC start_page_cleaner(double clean_ratio, int interval_ms);
+
+  /**
+   * @brief 停止后台刷脏线程
+   * @details 需要在关闭所有文件之前调用
+   */
+  RC stop_page_cleaner();
+
+  /**
+   * @brief 找不到空闲页帧时，唤醒后台刷脏线程
+   */
+  void wakeup_page_cleaner() { page_cleaner_.wakeup(); }
+
   BPFrameManager    &get_frame_manager() { return frame_manager_; }
+  PageCleaner       &get_page_cleaner() { return page_cleaner_; }
   DoubleWriteBuffer *get_dblwr_buffer() { return dblwr_buffer_.get(); }
 
+  /**
+   * @brief 设置读写页面使用的IO引擎
+   * @details 默认使用 sync 引擎。需要在打开文件之前设置
+   */
+  void set_io_engine(shared_ptr<common::AsyncIoEngine> io_engine) { io_engine_ = io_engine; }
+  common::AsyncIoEngine &io_engine() { return *io_engine_; }
+
   /**
    * @brief 根据ID获取对应的BufferPool对象
    * @details 在做redo时，需要根据ID获取对应的BufferPool对象，然后让bufferPool对象自己做redo
@@ -345,8 +613,10 @@ public:
 
 private:
   BPFrameManager frame_manager_{"BufPool"};
+  PageCleaner    page_cleaner_{*this, frame_manager_};
 
-  unique_ptr<DoubleWriteBuffer> dblwr_buffer_;
+  shared_ptr<common::AsyncIoEngine> io_engine_ = make_shared<common::SyncIoEngine>();
+  unique_ptr<DoubleWriteBuffer>     dblwr_buffer_;
 
   common::Mutex                            lock_;
   unordered_map<string, DiskBufferPool *>  buffer_pools_;
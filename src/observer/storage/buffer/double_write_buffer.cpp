@@ -12,12 +12,20 @@ See the Mulan PSL v2 for more details. */
 // Created by Wenbin1002 on 2024/04/16
 //
 #include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 #include "storage/buffer/double_write_buffer.h"
 #include "storage/buffer/disk_buffer_pool.h"
 #include "common/io/io.h"
+#include "common/io/async_io.h"
+#include "common/lang/algorithm.h"
+#include "common/lang/chrono.h"
 #include "common/log/log.h"
 #include "common/math/crc.h"
+#include "common/thread/thread_util.h"
 
 using namespace common;
 
@@ -44,13 +52,27 @@ const int32_t DoubleWritePage::SIZE = sizeof(DoubleWritePage);
 
 const int32_t DoubleWriteBufferHeader::SIZE = sizeof(DoubleWriteBufferHeader);
 
-DiskDoubleWriteBuffer::DiskDoubleWriteBuffer(BufferPoolManager &bp_manager, int max_pages /*=16*/) 
-  : max_pages_(max_pages), bp_manager_(bp_manager)
+DiskDoubleWriteBuffer::DiskDoubleWriteBuffer(
+    BufferPoolManager &bp_manager, int max_pages /*=16*/, int flush_interval_ms /*=1000*/)
+    : max_pages_(max_pages), flush_interval_ms_(flush_interval_ms), bp_manager_(bp_manager)
 {
+  batches_[0].slot_base = 0;
+  batches_[0].seq       = 1;
+  batches_[1].slot_base = max_pages_;
 }
 
 DiskDoubleWriteBuffer::~DiskDoubleWriteBuffer()
 {
+  if (thread_) {
+    {
+      lock_guard<mutex> guard(lock_);
+      running_ = false;
+    }
+    flush_cond_.notify_all();
+    thread_->join();
+    thread_.reset();
+  }
+
   flush_page();
   close(file_desc_);
 }
@@ -69,122 +91,290 @@ RC DiskDoubleWriteBuffer::open_file(const char *filename)
   }
 
   file_desc_ = fd;
-  return load_pages();
+  RC rc      = load_pages();
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+#ifdef CONCURRENCY
+  // 非并发编译模式下，buffer pool 等模块的锁什么都不做，只能在加入页面的线程中刷新
+  running_ = true;
+  thread_  = make_unique<thread>(&DiskDoubleWriteBuffer::thread_func, this);
+#endif
+  return RC::SUCCESS;
 }
 
-RC DiskDoubleWriteBuffer::flush_page()
+void DiskDoubleWriteBuffer::thread_func()
 {
-  sync();
+  thread_set_name("DblwrFlusher");
+  LOG_INFO("double write buffer flush thread started. max pages=%d, interval=%dms", max_pages_, flush_interval_ms_);
+
+  unique_lock<mutex> lock(lock_);
+  while (running_) {
+    flush_cond_.wait_for(lock, chrono::milliseconds(flush_interval_ms_), [this]() {
+      return !running_ || flush_requested_ || static_cast<int>(active_batch_->pages.size()) >= max_pages_;
+    });
+
+    // 被唤醒或者等待超时，只要有页面就刷新
+    flush_requested_ = false;
+    if (!active_batch_->pages.empty()) {
+      flush_batch(lock);
+    }
+  }
 
-  for (const auto &pair : dblwr_pages_) {
-    RC rc = write_page(pair.second);
-    if (rc != RC::SUCCESS) {
-      return rc;
+  LOG_INFO("double write buffer flush thread stopped. flushed batches=%ld", flushed_seq_);
+}
+
+RC DiskDoubleWriteBuffer::flush_batch(unique_lock<mutex> &lock)
+{
+  ASSERT(flushing_batch_ == nullptr, "there is a batch in flushing");
+
+  DoubleWriteBatch *batch = active_batch_;
+  active_batch_           = (batch == &batches_[0]) ? &batches_[1] : &batches_[0];
+  active_batch_->seq      = batch->seq + 1;
+  flushing_batch_         = batch;
+
+  // 刷新的批次不会再修改，可以不加锁访问
+  lock.unlock();
+  RC rc = write_batch(*batch);
+  lock.lock();
+
+  if (OB_FAIL(rc)) {
+    // 数据文件中的页面可能没有写入，把页面放回当前批次，下次刷新时重试。当前批次中的页面更新，不需要放回
+    LOG_ERROR("Failed to flush double write buffer batch. seq=%ld, pages=%d, rc=%s",
+              batch->seq, static_cast<int>(batch->pages.size()), strrc(rc));
+    for (auto iter = batch->pages.begin(); iter != batch->pages.end();) {
+      if (active_batch_->pages.count(iter->first) == 0) {
+        active_batch_->pages.emplace(iter->first, iter->second);
+        iter = batch->pages.erase(iter);
+      } else {
+        ++iter;
+      }
     }
-    pair.second->valid = false;
-    write_page_internal(pair.second);
-    delete pair.second;
+    active_batch_->buffer_pools.insert(batch->buffer_pools.begin(), batch->buffer_pools.end());
   }
 
-  dblwr_pages_.clear();
-  header_.page_cnt = 0;
+  delete_pages(*batch);
+  flush_rc_       = rc;
+  flushed_seq_    = batch->seq;
+  flushing_batch_ = nullptr;
+  flushed_cond_.notify_all();
+  return rc;
+}
 
-  return RC::SUCCESS;
+RC DiskDoubleWriteBuffer::flush_and_wait(unique_lock<mutex> &lock)
+{
+  if (active_batch_->pages.empty() && flushing_batch_ == nullptr) {
+    return RC::SUCCESS;
+  }
+
+  const int64_t target_seq = active_batch_->pages.empty() ? flushing_batch_->seq : active_batch_->seq;
+  if (thread_ && running_) {
+    flush_requested_ = true;
+    flush_cond_.notify_one();
+    flushed_cond_.wait(lock, [this, target_seq]() { return flushed_seq_ >= target_seq; });
+    return flush_rc_;
+  }
+
+  // 没有后台线程，在当前线程中刷新
+  flushed_cond_.wait(lock, [this]() { return flushing_batch_ == nullptr; });
+  if (flushed_seq_ >= target_seq) {
+    return flush_rc_;
+  }
+  return flush_batch(lock);
+}
+
+RC DiskDoubleWriteBuffer::flush_page()
+{
+  unique_lock<mutex> lock(lock_);
+  return flush_and_wait(lock);
 }
 
 RC DiskDoubleWriteBuffer::add_page(DiskBufferPool *bp, PageNum page_num, Page &page)
 {
-  scoped_lock lock_guard(lock_);
+  unique_lock<mutex> lock(lock_);
+
   DoubleWritePageKey key{bp->id(), page_num};
-  auto iter = dblwr_pages_.find(key);
-  if (iter != dblwr_pages_.end()) {
+  auto iter = active_batch_->pages.find(key);
+  if (iter != active_batch_->pages.end()) {
     iter->second->page = page;
     LOG_TRACE("[cache hit]add page into double write buffer. buffer_pool_id:%d,page_num:%d,lsn=%d, dwb size=%d",
-              bp->id(), page_num, page.lsn, static_cast<int>(dblwr_pages_.size()));
-    return write_page_internal(iter->second);
-  }
-
-  int64_t          page_cnt   = dblwr_pages_.size();
-  DoubleWritePage *dblwr_page = new DoubleWritePage(bp->id(), page_num, page_cnt, page);
-  dblwr_pages_.insert(pair<DoubleWritePageKey, DoubleWritePage *>(key, dblwr_page));
-  LOG_TRACE("insert page into double write buffer. buffer_pool_id:%d,page_num:%d,lsn=%d, dwb size:%d",
-            bp->id(), page_num, page.lsn, static_cast<int>(dblwr_pages_.size()));
-
-  RC rc = write_page_internal(dblwr_page);
-  if (OB_FAIL(rc)) {
-    LOG_WARN("failed to write page into double write buffer. rc=%s buffer_pool_id:%d,page_num:%d,lsn=%d.",
-        strrc(rc), bp->id(), page_num, page.lsn);
-    return rc;
+              bp->id(), page_num, page.lsn, static_cast<int>(active_batch_->pages.size()));
+    return RC::SUCCESS;
   }
 
-  if (page_cnt + 1 > header_.page_cnt) {
-    header_.page_cnt = page_cnt + 1;
-    if (lseek(file_desc_, 0, SEEK_SET) == -1) {
-      LOG_ERROR("Failed to add page header due to failed to seek %s.", strerror(errno));
-      return RC::IOERR_SEEK;
+  // 两个批次都满了，等待正在刷新的批次完成
+  while (static_cast<int>(active_batch_->pages.size()) >= max_pages_) {
+    if (flushing_batch_ != nullptr || (thread_ && running_)) {
+      flush_cond_.notify_one();
+      flushed_cond_.wait(lock);
+      continue;
     }
 
-    if (writen(file_desc_, &header_, sizeof(header_)) != 0) {
-      LOG_ERROR("Failed to add page header due to %s.", strerror(errno));
-      return RC::IOERR_WRITE;
-    }
-  }
-
-  if (static_cast<int>(dblwr_pages_.size()) >= max_pages_) {
-    RC rc = flush_page();
-    if (rc != RC::SUCCESS) {
+    RC rc = flush_batch(lock);
+    if (OB_FAIL(rc)) {
       LOG_ERROR("Failed to flush pages in double write buffer");
       return rc;
     }
   }
 
+  DoubleWritePage *dblwr_page = new DoubleWritePage(bp->id(), page_num, -1 /*page_index*/, page);
+  active_batch_->pages.emplace(key, dblwr_page);
+  active_batch_->buffer_pools[bp->id()] = bp;
+  LOG_TRACE("insert page into double write buffer. buffer_pool_id:%d,page_num:%d,lsn=%d, dwb size:%d",
+            bp->id(), page_num, page.lsn, static_cast<int>(active_batch_->pages.size()));
+
+  if (static_cast<int>(active_batch_->pages.size()) >= max_pages_ && thread_ && running_) {
+    flush_cond_.notify_one();
+  }
   return RC::SUCCESS;
 }
 
-RC DiskDoubleWriteBuffer::write_page_internal(DoubleWritePage *page)
+RC DiskDoubleWriteBuffer::write_batch(DoubleWriteBatch &batch)
 {
-  int32_t page_index = page->page_index;
-  int64_t offset = page_index * DoubleWritePage::SIZE + DoubleWriteBufferHeader::SIZE;
-  if (lseek(file_desc_, offset, SEEK_SET) == -1) {
-    LOG_ERROR("Failed to add page %lld of %d due to failed to seek %s.", offset, file_desc_, strerror(errno));
-    return RC::IOERR_SEEK;
+  // 按照数据文件中的顺序排列，写到数据文件时尽量顺序写
+  vector<DoubleWritePage *> pages;
+  pages.reserve(batch.pages.size());
+  for (const auto &[key, dblwr_page] : batch.pages) {
+    pages.push_back(dblwr_page);
   }
+  sort(pages.begin(), pages.end(), [](const DoubleWritePage *a, const DoubleWritePage *b) {
+    if (a->key.buffer_pool_id != b->key.buffer_pool_id) {
+      return a->key.buffer_pool_id < b->key.buffer_pool_id;
+    }
+    return a->key.page_num < b->key.page_num;
+  });
 
-  if (writen(file_desc_, page, DoubleWritePage::SIZE) != 0) {
-    LOG_ERROR("Failed to add page %lld of %d due to %s.", offset, file_desc_, strerror(errno));
+  // 一个批次的页面在当前文件中是连续存放的，可以合并成很少的几个写请求
+  vector<iovec>          iovs(pages.size());
+  vector<AsyncIoRequest> requests;
+  for (size_t i = 0; i < pages.size(); i++) {
+    DoubleWritePage *dblwr_page = pages[i];
+    dblwr_page->page_index      = batch.slot_base + static_cast<int32_t>(i);
+    dblwr_page->valid           = true;
+    iovs[i]                     = iovec{dblwr_page, static_cast<size_t>(DoubleWritePage::SIZE)};
+    if (!requests.empty() && requests.back().iov_count < IOV_MAX) {
+      requests.back().iov_count++;
+    } else {
+      requests.push_back(AsyncIoRequest::write(file_desc_, page_offset(dblwr_page), &iovs[i], 1));
+    }
+  }
+
+  iovec header_iov = {&header_, sizeof(header_)};
+  if (batch.slot_base + static_cast<int32_t>(pages.size()) > header_.page_cnt) {
+    header_.page_cnt = batch.slot_base + static_cast<int32_t>(pages.size());
+    requests.push_back(AsyncIoRequest::write(file_desc_, 0, &header_iov, 1));
+  }
+
+  RC rc = bp_manager_.io_engine().submit_and_wait(requests);
+  if (OB_FAIL(rc)) {
+    LOG_ERROR("Failed to write pages into double write buffer file. pages=%d, rc=%s",
+              static_cast<int>(pages.size()), strrc(rc));
     return RC::IOERR_WRITE;
   }
 
-  return RC::SUCCESS;
+  if (fdatasync(file_desc_) != 0) {
+    LOG_ERROR("Failed to sync double write buffer file. error=%s", strerror(errno));
+    return RC::IOERR_SYNC;
+  }
+
+  return write_pages(pages, batch.buffer_pools);
+}
+
+int64_t DiskDoubleWriteBuffer::page_offset(const DoubleWritePage *page)
+{
+  return static_cast<int64_t>(page->page_index) * DoubleWritePage::SIZE + DoubleWriteBufferHeader::SIZE;
 }
 
-RC DiskDoubleWriteBuffer::write_page(DoubleWritePage *dblwr_page)
+RC DiskDoubleWriteBuffer::write_pages(
+    span<DoubleWritePage *> pages, const unordered_map<int32_t, DiskBufferPool *> &buffer_pools)
 {
-  DiskBufferPool *disk_buffer = nullptr;
-  // skip invalid page
-  if (!dblwr_page->valid) {
-    LOG_TRACE("double write buffer write page invalid. buffer_pool_id:%d,page_num:%d,lsn=%d",
+  // 提交之前预留好空间，请求中保存的 iovec 指针不会失效
+  vector<iovec>          iovs;
+  vector<AsyncIoRequest> requests;
+  vector<int>            file_descs;  // 需要sync的数据文件
+  iovs.reserve(pages.size());
+  requests.reserve(pages.size());
+
+  for (DoubleWritePage *dblwr_page : pages) {
+    // skip invalid page
+    if (!dblwr_page->valid) {
+      LOG_TRACE("double write buffer write page invalid. buffer_pool_id:%d,page_num:%d,lsn=%d",
+                dblwr_page->key.buffer_pool_id, dblwr_page->key.page_num, dblwr_page->page.lsn);
+      continue;
+    }
+
+    DiskBufferPool *disk_buffer = nullptr;
+    auto            bp_iter     = buffer_pools.find(dblwr_page->key.buffer_pool_id);
+    if (bp_iter != buffer_pools.end()) {
+      disk_buffer = bp_iter->second;
+    } else {
+      RC rc = bp_manager_.get_buffer_pool(dblwr_page->key.buffer_pool_id, disk_buffer);
+      ASSERT(OB_SUCC(rc) && disk_buffer != nullptr, "failed to get disk buffer pool of %d", dblwr_page->key.buffer_pool_id);
+    }
+
+    LOG_TRACE("double write buffer write page. buffer_pool_id:%d,page_num:%d,lsn=%d",
               dblwr_page->key.buffer_pool_id, dblwr_page->key.page_num, dblwr_page->page.lsn);
-    return RC::SUCCESS;
+
+    iovs.push_back(iovec{&dblwr_page->page, sizeof(Page)});
+    requests.push_back(AsyncIoRequest::write(
+        disk_buffer->file_desc(), static_cast<int64_t>(dblwr_page->key.page_num) * sizeof(Page), &iovs.back(), 1));
+    if (find(file_descs.begin(), file_descs.end(), disk_buffer->file_desc()) == file_descs.end()) {
+      file_descs.push_back(disk_buffer->file_desc());
+    }
+  }
+
+  // 不同的页面写到不同的位置，可以同时进行
+  RC rc = bp_manager_.io_engine().submit_and_wait(requests);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("Failed to write pages in double write buffer to disk buffer pool. rc=%s", strrc(rc));
+    return rc;
+  }
+
+  // 数据文件落盘之后才能把 double write buffer 中的页面标记为无效，否则数据页写了一半时无法恢复
+  for (int fd : file_descs) {
+    if (fdatasync(fd) != 0) {
+      LOG_WARN("Failed to sync data file. fd=%d, error=%s", fd, strerror(errno));
+      return RC::IOERR_SYNC;
+    }
   }
-  RC rc = bp_manager_.get_buffer_pool(dblwr_page->key.buffer_pool_id, disk_buffer);
-  ASSERT(OB_SUCC(rc) && disk_buffer != nullptr, "failed to get disk buffer pool of %d", dblwr_page->key.buffer_pool_id);
 
-  LOG_TRACE("double write buffer write page. buffer_pool_id:%d,page_num:%d,lsn=%d",
-            dblwr_page->key.buffer_pool_id, dblwr_page->key.page_num, dblwr_page->page.lsn);
+  // 页面都已经写到数据文件中了，double write buffer 文件中对应的页面不再需要。只需要重写页面前面的标识
+  iovs.clear();
+  requests.clear();
+  for (DoubleWritePage *dblwr_page : pages) {
+    if (dblwr_page->page_index < 0) {
+      continue;
+    }
+    dblwr_page->valid = false;
+    iovs.push_back(iovec{dblwr_page, offsetof(DoubleWritePage, page)});
+    requests.push_back(AsyncIoRequest::write(file_desc_, page_offset(dblwr_page), &iovs.back(), 1));
+  }
 
-  return disk_buffer->write_page(dblwr_page->key.page_num, dblwr_page->page);
+  rc = bp_manager_.io_engine().submit_and_wait(requests);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("Failed to invalidate pages in double write buffer file. rc=%s", strrc(rc));
+  }
+  return RC::SUCCESS;
 }
 
 RC DiskDoubleWriteBuffer::read_page(DiskBufferPool *bp, PageNum page_num, Page &page)
 {
-  scoped_lock lock_guard(lock_);
+  lock_guard<mutex> lock_guard(lock_);
   DoubleWritePageKey key{bp->id(), page_num};
-  auto iter = dblwr_pages_.find(key);
-  if (iter != dblwr_pages_.end()) {
-    page = iter->second->page;
-    LOG_TRACE("double write buffer read page success. bp id=%d, page_num:%d, lsn:%d", bp->id(), page_num, page.lsn);
-    return RC::SUCCESS;
+
+  // 当前批次中的页面比刷新批次中的新
+  for (DoubleWriteBatch *batch : {active_batch_, flushing_batch_}) {
+    if (batch == nullptr) {
+      continue;
+    }
+
+    auto iter = batch->pages.find(key);
+    if (iter != batch->pages.end()) {
+      page = iter->second->page;
+      LOG_TRACE("double write buffer read page success. bp id=%d, page_num:%d, lsn:%d", bp->id(), page_num, page.lsn);
+      return RC::SUCCESS;
+    }
   }
 
   return RC::BUFFERPOOL_INVALID_PAGE_NUM;
@@ -192,46 +382,27 @@ RC DiskDoubleWriteBuffer::read_page(DiskBufferPool *bp, PageNum page_num, Page &
 
 RC DiskDoubleWriteBuffer::clear_pages(DiskBufferPool *buffer_pool)
 {
-  vector<DoubleWritePage *> spec_pages;
-  
-  auto remove_pred = [&spec_pages, buffer_pool](const pair<DoubleWritePageKey, DoubleWritePage *> &pair) {
-    DoubleWritePage *dbl_page = pair.second;
-    if (buffer_pool->id() == dbl_page->key.buffer_pool_id) {
-      spec_pages.push_back(dbl_page);
-      return true;
-    }
-    return false;
-  };
-
-  lock_.lock();
-  erase_if(dblwr_pages_, remove_pred);
-  lock_.unlock();
-
-  LOG_INFO("clear pages in double write buffer. file name=%s, page count=%d",
-           buffer_pool->filename(), spec_pages.size());
-
-  // 页面从小到大排序，防止出现小页面还没有写入，而页面编号更大的seek失败的情况
-  sort(spec_pages.begin(), spec_pages.end(), [](DoubleWritePage *a, DoubleWritePage *b) {
-    return a->key.page_num < b->key.page_num;
-  });
-
-  RC rc = RC::SUCCESS;
-  for (DoubleWritePage *dbl_page : spec_pages) {
-    rc = buffer_pool->write_page(dbl_page->key.page_num, dbl_page->page);
-    if (OB_FAIL(rc)) {
-      LOG_WARN("Failed to write page %s:%d to disk buffer pool. rc=%s",
-               buffer_pool->filename(), dbl_page->key.page_num, strrc(rc));
-      break;
-    }
-    dbl_page->valid = false;
-    write_page_internal(dbl_page);
+  // buffer pool 关闭之后就找不到了，把所有页面都写到数据文件中。
+  // 其它 buffer pool 的页面也会一起写入，这只会让它们提前落盘
+  unique_lock<mutex> lock(lock_);
+  RC                 rc = flush_and_wait(lock);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("Failed to write pages of %s to disk buffer pool. rc=%s", buffer_pool->filename(), strrc(rc));
   }
 
-  for_each(spec_pages.begin(), spec_pages.end(), [](DoubleWritePage *dbl_page) { delete dbl_page; });
-
+  LOG_INFO("clear pages in double write buffer. file name=%s", buffer_pool->filename());
   return RC::SUCCESS;
 }
 
+void DiskDoubleWriteBuffer::delete_pages(DoubleWriteBatch &batch)
+{
+  for (auto &[key, dblwr_page] : batch.pages) {
+    delete dblwr_page;
+  }
+  batch.pages.clear();
+  batch.buffer_pools.clear();
+}
+
 RC DiskDoubleWriteBuffer::load_pages()
 {
   if (file_desc_ < 0) {
@@ -239,7 +410,7 @@ RC DiskDoubleWriteBuffer::load_pages()
     return RC::BUFFERPOOL_OPEN;
   }
 
-  if (!dblwr_pages_.empty()) {
+  if (!active_batch_->pages.empty()) {
     LOG_ERROR("Failed to load pages, due to double write buffer is not empty. opened?");
     return RC::BUFFERPOOL_OPEN;
   }
@@ -256,6 +427,7 @@ RC DiskDoubleWriteBuffer::load_pages()
     return RC::IOERR_READ;
   }
 
+  auto &dblwr_pages = active_batch_->pages;
   for (int page_num = 0; page_num < header_.page_cnt; page_num++) {
     int64_t offset = ((int64_t)page_num) * DoubleWritePage::SIZE + DoubleWriteBufferHeader::SIZE;
 
@@ -276,21 +448,48 @@ RC DiskDoubleWriteBuffer::load_pages()
     }
 
     const CheckSum check_sum = crc32(page.data, BP_PAGE_DATA_SIZE);
-    if (check_sum == page.check_sum) {
-      DoubleWritePageKey key = dblwr_page->key;
-      dblwr_pages_.insert(pair<DoubleWritePageKey, DoubleWritePage *>(key, dblwr_page.release()));
-    } else {
+    if (check_sum != page.check_sum) {
       LOG_TRACE("got a page with an invalid checksum. on disk:%d, in memory:%d", page.check_sum, check_sum);
+      continue;
+    }
+    if (!dblwr_page->valid) {
+      // 已经写到数据文件中了
+      continue;
+    }
+
+    // 页面放到当前批次中，恢复时一起写到数据文件里。两个批次中可能都有同一个页面，保留最新的
+    dblwr_page->page_index  = -1;
+    DoubleWritePageKey key  = dblwr_page->key;
+    auto               iter = dblwr_pages.find(key);
+    if (iter == dblwr_pages.end()) {
+      dblwr_pages.emplace(key, dblwr_page.release());
+    } else if (iter->second->page.lsn < page.lsn) {
+      delete iter->second;
+      iter->second = dblwr_page.release();
     }
   }
 
-  LOG_INFO("double write buffer load pages done. page num=%d", dblwr_pages_.size());
+  LOG_INFO("double write buffer load pages done. page num=%d", active_batch_->pages.size());
   return RC::SUCCESS;
 }
 
 RC DiskDoubleWriteBuffer::recover()
 {
-  return flush_page();
+  unique_lock<mutex> lock(lock_);
+  RC                 rc = flush_and_wait(lock);
+  if (OB_FAIL(rc)) {
+    LOG_ERROR("Failed to write recovered pages of double write buffer. rc=%s", strrc(rc));
+    return rc;
+  }
+
+  // 恢复的页面写入时换了位置，原来位置上的页面依然是有效的，清空文件防止下次启动时再次恢复旧的页面
+  flushed_cond_.wait(lock, [this]() { return flushing_batch_ == nullptr; });
+  if (ftruncate(file_desc_, 0) != 0) {
+    LOG_ERROR("Failed to truncate double write buffer file. error=%s", strerror(errno));
+    return RC::IOERR_WRITE;
+  }
+  header_.page_cnt = 0;
+  return RC::SUCCESS;
 }
 
 ////////////////////////////////////////////////////////////////
@@ -14,7 +14,11 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include "common/lang/condition_variable.h"
+#include "common/lang/memory.h"
 #include "common/lang/mutex.h"
+#include "common/lang/span.h"
+#include "common/lang/thread.h"
 #include "common/lang/unordered_map.h"
 #include "common/types.h"
 #include "common/sys/rc.h"
@@ -70,6 +74,21 @@ struct DoubleWritePageKeyHash
   }
 };
 
+/**
+ * @brief 一批等待写入磁盘的页面
+ * @details double write buffer 中有两个批次，一个接收新的页面，另一个正在写入磁盘。
+ */
+struct DoubleWriteBatch
+{
+  unordered_map<DoubleWritePageKey, DoubleWritePage *, DoubleWritePageKeyHash> pages;
+
+  /// 页面所属的buffer pool。关闭buffer pool时会先从 BufferPoolManager 中移除，所以不能再按照ID查找
+  unordered_map<int32_t, DiskBufferPool *> buffer_pools;
+
+  int     slot_base = 0;  ///< 这一批页面在 double write buffer 文件中的起始页索引
+  int64_t seq       = 0;  ///< 批次的序号，每次切换批次时增加
+};
+
 /**
  * @brief 页面二次缓冲区，为了解决页面原子写入的问题
  * @ingroup BufferPool
@@ -80,7 +99,21 @@ struct DoubleWritePageKeyHash
  * 当我们从磁盘中读取页面时，会校验页面的checksum，如果校验失败，则说明页面写入不完整，这时候可以从
  * DoubleWriteBuffer中读取数据。
  *
- * @note 每次都要保证，不管在内存中还是在文件中，这里的数据都是最新的，都比Buffer pool中的数据要新
+ * 页面按照批次写入磁盘，内存中有两个批次，组成一个流水线：
+ * - 当前批次接收新加入的页面，同一个页面多次加入时只保留最新的数据；
+ * - 刷新批次先整体顺序写入 double write buffer 文件并 fdatasync，再写入各自的数据文件，
+ *   数据文件 fdatasync 之后，把 double write buffer 文件中的页面标记为无效。
+ * 刷新批次写入磁盘的过程中，当前批次可以继续接收页面，只有两个批次都满了的时候加入页面才需要等待。
+ * 两个批次在 double write buffer 文件中使用不同的区域，刷新时一个批次不会覆盖另一个批次的数据。
+ *
+ * 在以下情况下切换批次并刷新：
+ * - 当前批次中的页面数达到 max_pages；
+ * - 距离上次刷新超过 flush_interval_ms；
+ * - 显式调用 flush_page，比如做检查点时。
+ * 编译时打开 CONCURRENCY 时由后台线程刷新，否则在加入页面的线程中刷新，也不会按照时间刷新。
+ *
+ * @note 每次都要保证，这里的数据比Buffer pool对应的数据文件中的数据要新。
+ * 页面还在内存中的批次时，读取页面会直接使用这里的数据。
  */
 class DiskDoubleWriteBuffer : public DoubleWriteBuffer
 {
@@ -89,24 +122,25 @@ public:
    * @brief 构造函数
    *
    * @param bp_manager 关联的buffer pool manager
-   * @param max_pages  内存中保存的最大页面数
+   * @param max_pages  每个批次最多保存的页面数
+   * @param flush_interval_ms 后台线程刷新的时间间隔，单位毫秒
    */
-  DiskDoubleWriteBuffer(BufferPoolManager &bp_manager, int max_pages = 16);
+  DiskDoubleWriteBuffer(BufferPoolManager &bp_manager, int max_pages = 16, int flush_interval_ms = 1000);
   virtual ~DiskDoubleWriteBuffer();
 
   /**
-   * 打开磁盘中的共享表空间文件
+   * 打开磁盘中的共享表空间文件，并启动后台刷新线程
    */
   RC open_file(const char *filename);
 
   /**
-   * 将buffer中的页全部写入磁盘，并且清空buffer
-   * TODO 目前的解决方案是等buffer装满后再刷盘，可能会导致程序卡住一段时间
+   * @brief 将buffer中的页全部写入磁盘，并且清空buffer
+   * @details 等待调用时已经加入的页面都写到数据文件中，检查点等要求页面落盘的场景使用
    */
   RC flush_page();
 
   /**
-   * 将页面加入buffer，并且写入磁盘中的共享表空间
+   * 将页面加入buffer，当前批次满了之后触发刷新
    */
   RC add_page(DiskBufferPool *bp, PageNum page_num, Page &page) override;
 
@@ -114,6 +148,7 @@ public:
 
   /**
    * @brief 清空所有与指定buffer pool关联的页面
+   * @details 会把所有页面都刷新到磁盘中
    */
   RC clear_pages(DiskBufferPool *bp) override;
 
@@ -122,32 +157,67 @@ public:
    */
   RC recover();
 
+  /// @brief 已经刷新的批次数
+  int64_t flushed_batch_count() const { return flushed_seq_; }
+
 private:
   /**
-   * 将buffer中的页面写入对应的磁盘
+   * @brief 切换批次并把切换下来的批次写入磁盘
+   * @details 调用时需要加锁，并且没有正在刷新的批次。写入磁盘时会释放锁
    */
-  RC write_page(DoubleWritePage *page);
+  RC flush_batch(unique_lock<mutex> &lock);
 
   /**
-   * 将页面写到当前double write buffer文件中
-   * @details 每次页面更新都应该写入到磁盘中。保证double write buffer
-   * 内存和文件中的数据都是最新的。
+   * @brief 等待调用时当前批次中的页面都写入磁盘
+   * @details 调用时需要加锁
    */
-  RC write_page_internal(DoubleWritePage *page);
+  RC flush_and_wait(unique_lock<mutex> &lock);
+
+  /**
+   * @brief 将一个批次写入磁盘
+   * @details 先写到当前文件中并且fdatasync，再调用 write_pages 写到数据文件中
+   */
+  RC write_batch(DoubleWriteBatch &batch);
+
+  /**
+   * @brief 将buffer中的页面写入对应的磁盘
+   * @details 所有页面一起提交给IO引擎，全部写入成功并fdatasync后，再把它们在当前文件中标记为无效
+   * @param buffer_pools 页面所属的buffer pool，找不到时根据页面中记录的ID查找
+   */
+  RC write_pages(span<DoubleWritePage *> pages, const unordered_map<int32_t, DiskBufferPool *> &buffer_pools);
+
+  /// @brief 页面在当前double write buffer文件中的偏移
+  static int64_t page_offset(const DoubleWritePage *page);
 
   /**
    * @brief 将磁盘文件中的内容加载到内存中。在启动时调用
    */
   RC load_pages();
 
+  void thread_func();
+
+  static void delete_pages(DoubleWriteBatch &batch);
+
 private:
-  int                     file_desc_ = -1;
-  int                     max_pages_ = 0;
-  common::Mutex           lock_;
+  int                     file_desc_         = -1;
+  int                     max_pages_         = 0;
+  int                     flush_interval_ms_ = 0;
   BufferPoolManager      &bp_manager_;
   DoubleWriteBufferHeader header_;
 
-  unordered_map<DoubleWritePageKey, DoubleWritePage *, DoubleWritePageKeyHash> dblwr_pages_;
+  mutex              lock_;
+  condition_variable flush_cond_;    ///< 通知后台线程刷新
+  condition_variable flushed_cond_;  ///< 一个批次刷新完成
+
+  DoubleWriteBatch  batches_[2];
+  DoubleWriteBatch *active_batch_   = &batches_[0];  ///< 接收新页面的批次
+  DoubleWriteBatch *flushing_batch_ = nullptr;       ///< 正在写入磁盘的批次
+  int64_t           flushed_seq_    = 0;             ///< 已经写入磁盘的最大批次序号
+  RC                flush_rc_       = RC::SUCCESS;   ///< 最近一次刷新的结果
+  bool              flush_requested_ = false;
+
+  unique_ptr<thread> thread_;
+  bool               running_ = false;
 };
 
 class VacuousDoubleWriteBuffer : public DoubleWriteBuffer
@@ -76,9 +76,14 @@ void Frame::write_latch(intptr_t xid)
 
   lock_.lock();
 
+  if (++write_recursive_count_ == 1) {
+    // 版本号变成奇数之后才能修改页面，乐观读的线程就能发现页面正在被修改
+    version_.store(version_.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+  }
+
 #ifdef DEBUG
   write_locker_ = xid;
-  ++write_recursive_count_;
   TRACE("frame write lock success."
         "this=%p, pin=%d, frameId=%s, write locker=%lx(recursive=%d), xid=%lx, lbt=%s",
         this, pin_count_.load(), frame_id_.to_string().c_str(), write_locker_, write_recursive_count_, xid, lbt());
@@ -107,6 +112,7 @@ void Frame::write_unlatch(intptr_t xid)
 
   if (--write_recursive_count_ == 0) {
     write_locker_ = 0;
+    version_.store(version_.load(memory_order_relaxed) + 1, memory_order_release);
   }
   debug_lock_.unlock();
 
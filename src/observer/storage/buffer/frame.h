@@ -104,7 +104,20 @@ public:
    * 序列号要小，那就可以从日志中读取这些更大序列号的日志，做重做操作，将页面恢复到最新状态，也就是redo。
    */
   LSN  lsn() const { return page_.lsn; }
-  void set_lsn(LSN lsn) { page_.lsn = lsn; }
+  void set_lsn(LSN lsn)
+  {
+    page_.lsn    = lsn;
+    LSN expected = 0;
+    rec_lsn_.compare_exchange_strong(expected, lsn);
+  }
+
+  /**
+   * @brief 恢复LSN(recovery LSN)
+   * @details 页面上次刷到磁盘之后，第一条修改日志的LSN。页面刷新到磁盘(clear_dirty)之后清零。
+   * 重启时只要从所有页面最小的恢复LSN开始重做，就能找回所有没有落盘的修改，参考 BPFrameManager::min_recovery_lsn。
+   * 为0时表示页面还没有写过日志。
+   */
+  LSN rec_lsn() const { return rec_lsn_.load(); }
 
   /**
    * @brief 页面校验和
@@ -126,14 +139,18 @@ public:
    * @details 如果修改了页面的内容，则应调用此函数，
    * 以便该页面被淘汰出缓冲区时系统将新的页面数据写入磁盘文件
    */
-  void mark_dirty() { dirty_ = true; }
+  void mark_dirty() { dirty_.store(true); }
 
   /**
    * @brief 重置“脏”标记
-   * @details 如果页面已经被写入磁盘文件，则应调用此函数。
+   * @details 如果页面已经被写入磁盘文件，则应调用此函数。恢复LSN也会一起清除。
    */
-  void clear_dirty() { dirty_ = false; }
-  bool dirty() const { return dirty_; }
+  void clear_dirty()
+  {
+    dirty_.store(false);
+    rec_lsn_.store(0);
+  }
+  bool dirty() const { return dirty_.load(); }
 
   char *data() { return page_.data; }
 
@@ -166,13 +183,39 @@ public:
   void read_unlatch();
   void read_unlatch(intptr_t xid);
 
+  /**
+   * @brief 开始一次乐观读
+   * @details 页帧维护了一个版本号，加写锁和释放写锁时各增加一次，所以持有写锁期间版本号是奇数。
+   * 乐观读不加锁，先记下版本号，然后直接读取页面内容，最后调用 optimistic_read_validate 校验版本号。
+   * 版本号没有变化说明读取期间没有人修改过页面，读到的内容是一致的，否则需要丢弃读到的内容重新读取。
+   * 读取期间读到的内容可能是不完整的，使用时不能越界访问。调用者需要pin住页面。
+   * @param[out] version 当前的版本号
+   * @return 当前有人持有写锁时返回false
+   */
+  bool optimistic_read_begin(uint64_t &version) const
+  {
+    version = version_.load(memory_order_acquire);
+    return (version & 1) == 0;
+  }
+
+  /**
+   * @brief 校验乐观读期间页面是否被修改过
+   * @param version optimistic_read_begin 返回的版本号
+   */
+  bool optimistic_read_validate(uint64_t version) const
+  {
+    atomic_thread_fence(memory_order_acquire);
+    return version_.load(memory_order_relaxed) == version;
+  }
+
   string to_string() const;
 
 private:
   friend class BufferPool;
 
-  bool          dirty_ = false;
+  atomic<bool>  dirty_{false};  ///< 后台刷脏线程会读取其它线程正在使用的页帧的脏标识
   atomic<int>   pin_count_{0};
+  atomic<LSN>   rec_lsn_{0};  ///< 检查点会读取其它线程正在使用的页帧的恢复LSN
   unsigned long acc_time_ = 0;
   FrameId       frame_id_;
   Page          page_;
@@ -180,10 +223,13 @@ private:
   /// 在非并发编译时，加锁解锁动作将什么都不做
   common::RecursiveSharedMutex lock_;
 
+  /// 乐观读使用的版本号，只在最外层的写锁加锁和解锁时修改
+  atomic<uint64_t> version_{0};
+
   /// 使用一些手段来做测试，提前检测出头疼的死锁问题
   /// 如果编译时没有增加调试选项，这些代码什么都不做
   common::DebugMutex           debug_lock_;
   intptr_t                     write_locker_          = 0;
-  int                          write_recursive_count_ = 0;
+  int                          write_recursive_count_ = 0;  ///< 持有写锁的线程才会修改
   unordered_map<intptr_t, int> read_lockers_;
 };
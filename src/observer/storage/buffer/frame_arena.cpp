@@ -0,0 +1,185 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <errno.h>
+#include <new>
+#include <linux/mempolicy.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "storage/buffer/frame_arena.h"
+#include "common/lang/algorithm.h"
+#include "common/lang/fstream.h"
+#include "common/lang/string.h"
+#include "common/lang/vector.h"
+#include "common/log/log.h"
+
+/// MAP_HUGETLB 使用的默认大页大小
+static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+FrameArena::~FrameArena() { cleanup(); }
+
+RC FrameArena::init(size_t frame_num, bool huge_page, bool numa_aware)
+{
+  if (memory_ != nullptr) {
+    LOG_WARN("frame arena has been initialized");
+    return RC::INTERNAL;
+  }
+
+  if (frame_num == 0) {
+    LOG_WARN("invalid frame num: 0");
+    return RC::INVALID_ARGUMENT;
+  }
+
+  os_page_size_ = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  memory_size_  = frame_num * sizeof(Frame);
+
+  if (huge_page) {
+    const size_t size = (memory_size_ + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (memory != MAP_FAILED) {
+      memory_       = memory;
+      memory_size_  = size;
+      os_page_size_ = HUGE_PAGE_SIZE;
+      use_hugetlb_  = true;
+    } else {
+      LOG_INFO("failed to mmap huge pages, fallback to transparent huge pages. size=%ld, error=%s",
+               size, strerror(errno));
+    }
+  }
+
+  if (memory_ == nullptr) {
+    memory_size_ = (memory_size_ + os_page_size_ - 1) / os_page_size_ * os_page_size_;
+    void *memory = mmap(nullptr, memory_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+      LOG_ERROR("failed to mmap frame arena. size=%ld, error=%s", memory_size_, strerror(errno));
+      memory_size_ = 0;
+      return RC::NOMEM;
+    }
+    memory_ = memory;
+
+    if (huge_page && madvise(memory_, memory_size_, MADV_HUGEPAGE) != 0) {
+      LOG_INFO("failed to advise transparent huge pages. error=%s", strerror(errno));
+    }
+  }
+
+  frames_    = static_cast<Frame *>(memory_);
+  frame_num_ = frame_num;
+
+  node_num_        = numa_aware ? max(system_node_num(), 1) : 1;
+  frames_per_node_ = (frame_num_ + node_num_ - 1) / node_num_;
+  if (node_num_ > 1) {
+    bind_nodes();
+  }
+
+  // 绑定节点之后再触发缺页，内存才会分配在指定的节点上
+  prefault();
+
+  for (size_t i = 0; i < frame_num_; i++) {
+    new (&frames_[i]) Frame();
+  }
+
+  LOG_INFO("frame arena init done. frame num=%ld, memory size=%ld, page size=%ld, hugetlb=%d, node num=%d",
+           frame_num_, memory_size_, os_page_size_, use_hugetlb_, node_num_);
+  return RC::SUCCESS;
+}
+
+void FrameArena::cleanup()
+{
+  if (memory_ == nullptr) {
+    return;
+  }
+
+  for (size_t i = 0; i < frame_num_; i++) {
+    frames_[i].~Frame();
+  }
+
+  if (munmap(memory_, memory_size_) != 0) {
+    LOG_WARN("failed to munmap frame arena. error=%s", strerror(errno));
+  }
+
+  memory_      = nullptr;
+  memory_size_ = 0;
+  frames_      = nullptr;
+  frame_num_   = 0;
+}
+
+void FrameArena::bind_nodes()
+{
+  const size_t node_bytes = frames_per_node_ * sizeof(Frame);
+  for (int node = 0; node < node_num_; node++) {
+    // mbind 要求起始地址按照页面对齐，节点之间边界上的页面属于前一个节点
+    size_t begin = (node * node_bytes + os_page_size_ - 1) / os_page_size_ * os_page_size_;
+    size_t end   = min((node + 1) * node_bytes, memory_size_);
+    end          = node == node_num_ - 1 ? memory_size_ : (end + os_page_size_ - 1) / os_page_size_ * os_page_size_;
+    if (begin >= end) {
+      continue;
+    }
+
+    vector<unsigned long> node_mask(node / (sizeof(unsigned long) * 8) + 1, 0);
+    node_mask[node / (sizeof(unsigned long) * 8)] |= 1UL << (node % (sizeof(unsigned long) * 8));
+
+    long ret = syscall(SYS_mbind,
+        static_cast<char *>(memory_) + begin,
+        end - begin,
+        MPOL_BIND,
+        node_mask.data(),
+        node_mask.size() * sizeof(unsigned long) * 8 + 1,
+        0);
+    if (ret != 0) {
+      LOG_WARN("failed to bind frame arena to numa node. node=%d, error=%s", node, strerror(errno));
+    }
+  }
+}
+
+void FrameArena::prefault()
+{
+  char *memory = static_cast<char *>(memory_);
+  for (size_t offset = 0; offset < memory_size_; offset += os_page_size_) {
+    memory[offset] = 0;
+  }
+}
+
+int FrameArena::current_node() const
+{
+  if (node_num_ == 1) {
+    return 0;
+  }
+
+  unsigned cpu  = 0;
+  unsigned node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+    return 0;
+  }
+  return static_cast<int>(node) % node_num_;
+}
+
+int FrameArena::system_node_num()
+{
+  // 格式类似于 0-1,3
+  ifstream file("/sys/devices/system/node/online");
+  string   online;
+  if (!file || !getline(file, online)) {
+    return 1;
+  }
+
+  vector<string> ranges;
+  common::split_string(online, ",", ranges);
+
+  int max_node = 0;
+  for (const string &range : ranges) {
+    size_t pos  = range.find('-');
+    string last = (pos == string::npos) ? range : range.substr(pos + 1);
+    max_node    = max(max_node, atoi(last.c_str()));
+  }
+  return max_node + 1;
+}
@@ -0,0 +1,80 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <stddef.h>
+
+#include "common/sys/rc.h"
+#include "storage/buffer/frame.h"
+
+/**
+ * @brief 存放所有页帧的一块连续内存
+ * @ingroup BufferPool
+ * @details 所有的页帧在初始化时一次性通过 mmap 申请出来，并且提前触发缺页，运行过程中不会再申请内存。
+ * 可以选择：
+ * - 使用大页(huge page)：优先使用 MAP_HUGETLB，系统没有预留大页时退化为普通页面并通过
+ *   madvise(MADV_HUGEPAGE) 提示内核使用透明大页。大页可以减少访问页帧时的TLB缺失；
+ * - 按照NUMA节点划分：内存平均分成多个子区域，每个子区域绑定到一个NUMA节点上。
+ *   BPFrameManager 分配空闲页帧时优先使用当前线程所在节点上的页帧，
+ *   也就是页帧按照加载页面的线程划分到各个节点上，避免跨节点访问内存。
+ * 只有一个NUMA节点或者没有打开这个选项时，所有的页帧都属于节点0。
+ */
+class FrameArena
+{
+public:
+  FrameArena() = default;
+  ~FrameArena();
+
+  /**
+   * @brief 申请内存并构造页帧
+   * @param frame_num 页帧个数
+   * @param huge_page 是否使用大页
+   * @param numa_aware 是否按照NUMA节点划分页帧
+   */
+  RC   init(size_t frame_num, bool huge_page, bool numa_aware);
+  void cleanup();
+
+  size_t frame_num() const { return frame_num_; }
+  Frame *frame(size_t index) { return &frames_[index]; }
+
+  int  node_num() const { return node_num_; }
+  bool use_hugetlb() const { return use_hugetlb_; }
+
+  /// @brief 页帧所在的NUMA节点
+  int node_of(const Frame *frame) const
+  {
+    return node_num_ == 1 ? 0 : static_cast<int>((frame - frames_) / frames_per_node_);
+  }
+
+  /// @brief 当前线程所在的NUMA节点
+  int current_node() const;
+
+  /// @brief 系统中NUMA节点的个数
+  static int system_node_num();
+
+private:
+  /// 按照NUMA节点绑定内存，失败时只是打印日志
+  void bind_nodes();
+
+  /// 提前触发缺页，运行时访问页帧就不会再有缺页中断
+  void prefault();
+
+private:
+  void  *memory_       = nullptr;
+  size_t memory_size_  = 0;
+  size_t os_page_size_ = 0;  ///< 实际使用的页面大小，使用 MAP_HUGETLB 时是大页的大小
+  bool   use_hugetlb_  = false;
+
+  Frame *frames_          = nullptr;
+  size_t frame_num_       = 0;
+  int    node_num_        = 1;
+  size_t frames_per_node_ = 0;
+};
@@ -0,0 +1,159 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "storage/buffer/frame_eviction_policy.h"
+#include "common/lang/algorithm.h"
+#include "common/lang/string.h"
+#include "common/log/log.h"
+
+FrameEvictionPolicy *FrameEvictionPolicy::create(const char *name)
+{
+  if (common::is_blank(name) || 0 == strcasecmp(name, "lru")) {
+    return new LruEvictionPolicy();
+  } else if (0 == strcasecmp(name, "2q")) {
+    return new TwoQueueEvictionPolicy();
+  }
+
+  LOG_WARN("unknown frame eviction policy: %s", name);
+  return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void LruEvictionPolicy::on_insert(Frame *frame)
+{
+  lru_list_.push_front(frame);
+  entries_[frame] = lru_list_.begin();
+}
+
+void LruEvictionPolicy::on_access(Frame *frame)
+{
+  auto iter = entries_.find(frame);
+  if (iter == entries_.end()) {
+    return;
+  }
+
+  lru_list_.splice(lru_list_.begin(), lru_list_, iter->second);
+}
+
+void LruEvictionPolicy::on_remove(Frame *frame)
+{
+  auto iter = entries_.find(frame);
+  if (iter == entries_.end()) {
+    return;
+  }
+
+  lru_list_.erase(iter->second);
+  entries_.erase(iter);
+}
+
+void LruEvictionPolicy::foreach_victim(const function<bool(Frame *)> &func)
+{
+  for (auto iter = lru_list_.rbegin(); iter != lru_list_.rend(); ++iter) {
+    if (!func(*iter)) {
+      break;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TwoQueueEvictionPolicy::on_insert(Frame *frame)
+{
+  Entry entry;
+
+  auto ghost_iter = a1out_index_.find(frame->frame_id());
+  if (ghost_iter != a1out_index_.end()) {
+    // 刚淘汰不久又被加载回来，认为是热点页面
+    a1out_.erase(ghost_iter->second);
+    a1out_index_.erase(ghost_iter);
+
+    am_.push_front(frame);
+    entry.hot  = true;
+    entry.iter = am_.begin();
+  } else {
+    a1in_.push_front(frame);
+    entry.hot  = false;
+    entry.iter = a1in_.begin();
+  }
+
+  entries_[frame] = entry;
+  max_resident_   = max(max_resident_, entries_.size());
+}
+
+void TwoQueueEvictionPolicy::on_access(Frame *frame)
+{
+  auto iter = entries_.find(frame);
+  if (iter == entries_.end()) {
+    return;
+  }
+
+  Entry &entry = iter->second;
+  if (entry.hot) {
+    am_.splice(am_.begin(), am_, entry.iter);
+  } else {
+    // 扫描每次只会访问页面一次，被访问第二次的页面认为是热点页面
+    am_.splice(am_.begin(), a1in_, entry.iter);
+    entry.hot = true;
+  }
+}
+
+void TwoQueueEvictionPolicy::on_remove(Frame *frame)
+{
+  auto iter = entries_.find(frame);
+  if (iter == entries_.end()) {
+    return;
+  }
+
+  if (iter->second.hot) {
+    am_.erase(iter->second.iter);
+  } else {
+    a1in_.erase(iter->second.iter);
+    remember_evicted(frame->frame_id());
+  }
+  entries_.erase(iter);
+}
+
+void TwoQueueEvictionPolicy::remember_evicted(const FrameId &frame_id)
+{
+  if (a1out_index_.find(frame_id) != a1out_index_.end()) {
+    return;
+  }
+
+  a1out_.push_front(frame_id);
+  a1out_index_[frame_id] = a1out_.begin();
+
+  const size_t max_ghost_num = max(static_cast<size_t>(max_resident_ * A1OUT_RATIO), static_cast<size_t>(1));
+  while (a1out_.size() > max_ghost_num) {
+    a1out_index_.erase(a1out_.back());
+    a1out_.pop_back();
+  }
+}
+
+void TwoQueueEvictionPolicy::foreach_victim(const function<bool(Frame *)> &func)
+{
+  auto visit = [&func](list<Frame *> &frames) {
+    for (auto iter = frames.rbegin(); iter != frames.rend(); ++iter) {
+      if (!func(*iter)) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  // A1in 超过一定比例时优先淘汰 A1in，否则优先淘汰 Am
+  if (a1in_.size() > static_cast<size_t>(entries_.size() * A1IN_RATIO)) {
+    if (visit(a1in_)) {
+      visit(am_);
+    }
+  } else {
+    if (visit(am_)) {
+      visit(a1in_);
+    }
+  }
+}
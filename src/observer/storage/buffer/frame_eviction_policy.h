@@ -0,0 +1,122 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "common/lang/functional.h"
+#include "common/lang/list.h"
+#include "common/lang/unordered_map.h"
+#include "storage/buffer/frame.h"
+
+/**
+ * @brief 页帧淘汰策略
+ * @ingroup BufferPool
+ * @details 页帧管理器在内存不足时需要淘汰一些页帧，淘汰哪些页帧由淘汰策略决定。
+ * 淘汰策略只负责记录页帧的访问情况，并给出淘汰的先后顺序，不负责页帧的分配与释放。
+ * 每个页帧分区都有一个独立的淘汰策略对象，所有的接口都在分区锁内调用，因此不需要考虑并发。
+ */
+class FrameEvictionPolicy
+{
+public:
+  virtual ~FrameEvictionPolicy() = default;
+
+  virtual const char *name() const = 0;
+
+  /// @brief 页帧刚刚与某个页面关联，即页面被加载到内存中
+  virtual void on_insert(Frame *frame) = 0;
+
+  /// @brief 已经在内存中的页面又被访问了一次
+  virtual void on_access(Frame *frame) = 0;
+
+  /// @brief 页帧被淘汰或释放，不再与当前页面关联
+  virtual void on_remove(Frame *frame) = 0;
+
+  /**
+   * @brief 按照淘汰的优先顺序遍历页帧
+   * @param func 返回false时停止遍历
+   */
+  virtual void foreach_victim(const function<bool(Frame *)> &func) = 0;
+
+  /**
+   * @brief 根据名称创建淘汰策略
+   * @details 当前支持 lru 和 2q。名称不认识时返回nullptr
+   */
+  static FrameEvictionPolicy *create(const char *name);
+};
+
+/**
+ * @brief 最近最少使用淘汰策略
+ * @ingroup BufferPool
+ * @details 一次全表扫描就可能把B+树的内部节点等热点页面全部淘汰掉
+ */
+class LruEvictionPolicy : public FrameEvictionPolicy
+{
+public:
+  const char *name() const override { return "lru"; }
+
+  void on_insert(Frame *frame) override;
+  void on_access(Frame *frame) override;
+  void on_remove(Frame *frame) override;
+  void foreach_victim(const function<bool(Frame *)> &func) override;
+
+private:
+  list<Frame *>                                 lru_list_;  ///< 头部是最近访问的页帧
+  unordered_map<Frame *, list<Frame *>::iterator> entries_;
+};
+
+/**
+ * @brief 2Q 淘汰策略
+ * @ingroup BufferPool
+ * @details 参考 Johnson & Shasha, "2Q: A Low Overhead High Performance Buffer Management
+ * Replacement Algorithm"。
+ * 第一次加载的页面放在先进先出的 A1in 队列中，在 A1in 中再次被访问时，移动到按照LRU管理的 Am 队列中。
+ * A1in 中的页面被淘汰后，页面编号会记录在 A1out 中(不占用页帧)，如果页面很快又被加载，
+ * 也认为它是一个热点页面，直接放到 Am 队列中。
+ * 全表扫描只会访问每个页面一次，这些页面只会经过 A1in 队列，不会把 Am 中的热点页面挤出去。
+ */
+class TwoQueueEvictionPolicy : public FrameEvictionPolicy
+{
+public:
+  const char *name() const override { return "2q"; }
+
+  void on_insert(Frame *frame) override;
+  void on_access(Frame *frame) override;
+  void on_remove(Frame *frame) override;
+  void foreach_victim(const function<bool(Frame *)> &func) override;
+
+private:
+  void remember_evicted(const FrameId &frame_id);
+
+private:
+  class FrameIdHasher
+  {
+  public:
+    size_t operator()(const FrameId &frame_id) const { return frame_id.hash(); }
+  };
+
+  struct Entry
+  {
+    bool                     hot = false;  ///< 是否在 Am 队列中
+    list<Frame *>::iterator iter;
+  };
+
+  /// A1in 在所有页帧中最多占的比例，超过后优先淘汰 A1in 中的页面
+  static constexpr double A1IN_RATIO = 0.25;
+  /// A1out 能记录的页面个数相对当前页帧个数的比例
+  static constexpr double A1OUT_RATIO = 0.5;
+
+  list<Frame *>                  a1in_;  ///< 头部是最新加载的页帧
+  list<Frame *>                  am_;    ///< 头部是最近访问的页帧
+  unordered_map<Frame *, Entry> entries_;
+
+  list<FrameId>                                                  a1out_;  ///< 头部是最近淘汰的页面
+  unordered_map<FrameId, list<FrameId>::iterator, FrameIdHasher> a1out_index_;
+  size_t                                                         max_resident_ = 0;
+};
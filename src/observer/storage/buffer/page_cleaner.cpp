@@ -0,0 +1,208 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "storage/buffer/page_cleaner.h"
+#include "common/lang/algorithm.h"
+#include "common/lang/chrono.h"
+#include "common/lang/unordered_map.h"
+#include "common/lang/vector.h"
+#include "common/log/log.h"
+#include "common/thread/thread_util.h"
+#include "storage/buffer/disk_buffer_pool.h"
+
+using namespace common;
+
+static int64_t current_time_ms()
+{
+  return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+PageCleaner::PageCleaner(BufferPoolManager &bp_manager, BPFrameManager &frame_manager)
+    : bp_manager_(bp_manager), frame_manager_(frame_manager)
+{}
+
+PageCleaner::~PageCleaner()
+{
+  if (thread_) {
+    stop();
+  }
+}
+
+RC PageCleaner::start(double clean_ratio, int interval_ms)
+{
+  if (thread_) {
+    LOG_ERROR("page cleaner has been started");
+    return RC::INTERNAL;
+  }
+
+#ifndef CONCURRENCY
+  // 非并发编译模式下，double write buffer 等模块的锁什么都不做，不能在后台线程中刷页面
+  LOG_WARN("page cleaner is not supported without CONCURRENCY");
+  return RC::UNSUPPORTED;
+#endif
+
+  if (clean_ratio <= 0 || clean_ratio > 1 || interval_ms <= 0) {
+    LOG_ERROR("invalid page cleaner arguments. clean ratio=%f, interval=%dms", clean_ratio, interval_ms);
+    return RC::INVALID_ARGUMENT;
+  }
+
+  target_clean_ratio_   = clean_ratio;
+  interval_ms_          = interval_ms;
+  last_metrics_count_   = flushed_page_count_.load();
+  last_metrics_time_ms_ = current_time_ms();
+
+  running_.store(true);
+  thread_ = make_unique<thread>(&PageCleaner::thread_func, this);
+  LOG_INFO("page cleaner started. clean ratio=%f, interval=%dms", clean_ratio, interval_ms);
+  return RC::SUCCESS;
+}
+
+RC PageCleaner::stop()
+{
+  if (!thread_) {
+    LOG_ERROR("page cleaner has not been started");
+    return RC::INTERNAL;
+  }
+
+  {
+    lock_guard<mutex> lock(wait_lock_);
+    running_.store(false);
+  }
+  wait_cond_.notify_all();
+
+  thread_->join();
+  thread_.reset();
+  LOG_INFO("page cleaner stopped. flushed pages=%ld", flushed_page_count_.load());
+  return RC::SUCCESS;
+}
+
+void PageCleaner::wakeup()
+{
+  if (!running_.load()) {
+    return;
+  }
+
+  {
+    lock_guard<mutex> lock(wait_lock_);
+    wakeup_ = true;
+  }
+  wait_cond_.notify_one();
+}
+
+void PageCleaner::thread_func()
+{
+  thread_set_name("PageCleaner");
+  LOG_INFO("page cleaner thread started");
+
+  while (running_.load()) {
+    run_once(target_clean_ratio_);
+    update_metrics();
+
+    unique_lock<mutex> lock(wait_lock_);
+    wait_cond_.wait_for(lock, chrono::milliseconds(interval_ms_), [this]() { return wakeup_ || !running_.load(); });
+    wakeup_ = false;
+  }
+
+  LOG_INFO("page cleaner thread stopped");
+}
+
+int PageCleaner::run_once(double clean_ratio)
+{
+  lock_guard<mutex> round_guard(round_lock_);
+
+  const size_t total_num = frame_manager_.total_frame_num();
+  if (total_num == 0) {
+    return 0;
+  }
+
+  vector<pair<LSN, FrameId>> flush_list;
+  const size_t               dirty_num = frame_manager_.collect_dirty_frames(flush_list);
+  clean_ratio_.store(1.0 - static_cast<double>(dirty_num) / total_num);
+
+  const size_t max_dirty_num = static_cast<size_t>(total_num * (1.0 - clean_ratio));
+  if (dirty_num <= max_dirty_num) {
+    return 0;
+  }
+
+  const size_t flush_num = min({dirty_num - max_dirty_num, flush_list.size(), size_t(MAX_FLUSH_PAGES_PER_ROUND)});
+  flush_list.resize(flush_num);
+
+  // 先等待所有页面的日志都刷新到磁盘，这样在分区锁内刷新页面时就不需要再等待日志了
+  unordered_map<int32_t, pair<DiskBufferPool *, LSN>> buffer_pools;
+  for (auto &[lsn, frame_id] : flush_list) {
+    auto iter = buffer_pools.find(frame_id.buffer_pool_id());
+    if (iter == buffer_pools.end()) {
+      DiskBufferPool *bp = nullptr;
+      RC              rc = bp_manager_.get_buffer_pool(frame_id.buffer_pool_id(), bp);
+      if (OB_FAIL(rc)) {
+        bp = nullptr;
+      }
+      buffer_pools.emplace(frame_id.buffer_pool_id(), pair<DiskBufferPool *, LSN>(bp, lsn));
+    } else if (lsn > iter->second.second) {
+      iter->second.second = lsn;
+    }
+  }
+
+  for (auto &[buffer_pool_id, bp_lsn] : buffer_pools) {
+    DiskBufferPool *bp = bp_lsn.first;
+    if (bp == nullptr) {
+      continue;
+    }
+
+    RC rc = bp->log_handler_.wait_lsn(bp_lsn.second);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to wait lsn before flushing pages. buffer pool id=%d, lsn=%ld, rc=%s",
+               buffer_pool_id, bp_lsn.second, strrc(rc));
+      bp_lsn.first = nullptr;
+    }
+  }
+
+  int flushed_num = 0;
+  for (auto &[lsn, frame_id] : flush_list) {
+    DiskBufferPool *bp = buffer_pools[frame_id.buffer_pool_id()].first;
+    if (bp == nullptr) {
+      continue;
+    }
+
+    bool flushed = false;
+    RC   rc      = frame_manager_.flush_idle_frame(
+        frame_id, [bp](Frame *frame) { return bp->flush_page_internal(*frame); }, flushed);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to flush page. frame id=%s, rc=%s", frame_id.to_string().c_str(), strrc(rc));
+      break;
+    }
+
+    if (flushed) {
+      flushed_num++;
+    }
+  }
+
+  flushed_page_count_ += flushed_num;
+  clean_ratio_.store(1.0 - static_cast<double>(dirty_num - flushed_num) / total_num);
+  LOG_DEBUG("page cleaner flushed %d pages. dirty=%ld, total=%ld", flushed_num, dirty_num, total_num);
+  return flushed_num;
+}
+
+void PageCleaner::update_metrics()
+{
+  const int64_t now        = current_time_ms();
+  const int64_t elapsed_ms = now - last_metrics_time_ms_;
+  if (elapsed_ms < METRICS_PERIOD_MS) {
+    return;
+  }
+
+  const int64_t flushed_count = flushed_page_count_.load();
+  flush_rate_.store(static_cast<double>(flushed_count - last_metrics_count_) * 1000 / elapsed_ms);
+  last_metrics_count_   = flushed_count;
+  last_metrics_time_ms_ = now;
+
+  LOG_INFO("page cleaner metrics. flush rate=%.2f pages/s, clean ratio=%.4f, dirty ratio=%.4f, flushed pages=%ld",
+           flush_rate(), clean_ratio(), dirty_ratio(), flushed_count);
+}
@@ -0,0 +1,117 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "common/lang/atomic.h"
+#include "common/lang/condition_variable.h"
+#include "common/lang/memory.h"
+#include "common/lang/mutex.h"
+#include "common/lang/thread.h"
+#include "common/sys/rc.h"
+
+class BufferPoolManager;
+class BPFrameManager;
+
+/**
+ * @brief 后台刷脏页
+ * @ingroup BufferPool
+ * @details 页帧不够用时，需要淘汰一些页帧，如果被淘汰的页帧是脏的，就要先把它写到磁盘上，
+ * 这个写磁盘的动作会由前台请求来承担。
+ * PageCleaner 在后台启动一个线程，定期检查内存中干净页帧(包括空闲页帧)的比例，
+ * 如果比例低于设定值，就按照页面LSN从小到大的顺序(flush list)把没有在使用的脏页刷到磁盘上，
+ * 这样淘汰页帧时大部分都是干净的页面，直接释放即可。
+ * 刷新页面之前，会先等待页面LSN对应的日志刷新到磁盘(LogHandler::wait_lsn)，以满足WAL的要求。
+ * 刷新的页面依然保留在内存中，不会影响淘汰策略。
+ * 只有在CONCURRENCY编译模式下才能启动后台线程，否则 double write buffer 等模块的锁不会生效。
+ */
+class PageCleaner
+{
+public:
+  PageCleaner(BufferPoolManager &bp_manager, BPFrameManager &frame_manager);
+  ~PageCleaner();
+
+  /**
+   * @brief 启动后台线程
+   * @param clean_ratio 期望的干净页帧比例，取值范围 (0, 1]
+   * @param interval_ms 后台线程两次检查之间的时间间隔
+   */
+  RC start(double clean_ratio, int interval_ms);
+
+  /**
+   * @brief 停止后台线程，并等待线程结束
+   */
+  RC stop();
+
+  bool running() const { return running_.load(); }
+
+  /**
+   * @brief 唤醒后台线程立即检查一次
+   * @details 前台请求找不到空闲页帧时调用
+   */
+  void wakeup();
+
+  /**
+   * @brief 执行一轮刷脏
+   * @details 后台线程每次醒来执行一次。没有启动后台线程时也可以直接调用，测试使用。
+   * @param clean_ratio 期望的干净页帧比例
+   * @return 本轮刷新的页面个数
+   */
+  int run_once(double clean_ratio);
+
+  /**
+   * @brief 与 BufferPoolManager::close_file 互斥
+   * @details 刷脏时需要通过ID找到 DiskBufferPool 对象，关闭文件时持有这把锁，
+   * 防止刷脏过程中 DiskBufferPool 对象被删除。
+   */
+  mutex &round_lock() { return round_lock_; }
+
+  /// @brief 累计刷新的页面个数
+  int64_t flushed_page_count() const { return flushed_page_count_.load(); }
+  /// @brief 最近一个统计周期内每秒刷新的页面个数
+  double flush_rate() const { return flush_rate_.load(); }
+  /// @brief 最近一次检查时干净页帧(包括空闲页帧)的比例
+  double clean_ratio() const { return clean_ratio_.load(); }
+  /// @brief 最近一次检查时脏页帧的比例
+  double dirty_ratio() const { return 1.0 - clean_ratio_.load(); }
+
+private:
+  void thread_func();
+
+  /// @brief 更新刷新速率，并定期把统计信息打印到日志中
+  void update_metrics();
+
+private:
+  /// 每一轮最多刷新的页面个数，防止一次持续太长时间
+  static constexpr int MAX_FLUSH_PAGES_PER_ROUND = 256;
+  /// 刷新速率的统计周期
+  static constexpr int METRICS_PERIOD_MS = 10 * 1000;
+
+  BufferPoolManager &bp_manager_;
+  BPFrameManager    &frame_manager_;
+
+  unique_ptr<thread> thread_;
+  atomic_bool        running_{false};
+  double             target_clean_ratio_ = 0.0;
+  int                interval_ms_        = 0;
+
+  mutex              wait_lock_;  ///< 配合条件变量使用
+  condition_variable wait_cond_;
+  bool               wakeup_ = false;
+
+  mutex round_lock_;
+
+  atomic<int64_t> flushed_page_count_{0};
+  atomic<double>  flush_rate_{0.0};
+  atomic<double>  clean_ratio_{1.0};
+
+  int64_t last_metrics_count_   = 0;
+  int64_t last_metrics_time_ms_ = 0;
+};
@@ -49,7 +49,12 @@ RC DiskLogHandler::stop()
     return RC::INTERNAL;
   }
 
-  running_.store(false);
+  {
+    lock_guard guard(flush_mutex_);
+    running_.store(false);
+  }
+  flush_request_cond_.notify_one();
+  flushed_cond_.notify_all();
 
   LOG_INFO("log handler stopped");
   return RC::SUCCESS;
@@ -89,6 +94,11 @@ RC DiskLogHandler::replay(LogReplayer &replayer, LSN start_lsn)
     return rc;
   }
 
+  // 从检查点开始重做时，检查点之后可能没有任何日志，LSN 不能比检查点记录的小
+  if (start_lsn > 0 && max_lsn < start_lsn - 1) {
+    max_lsn = start_lsn - 1;
+  }
+
   rc = entry_buffer_.init(max_lsn);
   if (OB_FAIL(rc)) {
     LOG_WARN("failed to init log entry buffer. rc=%s", strrc(rc));
@@ -133,12 +143,30 @@ RC DiskLogHandler::iterate(function<RC(LogEntry&)> consumer, LSN start_lsn)
   return RC::SUCCESS;
 }
 
-RC DiskLogHandler::_append(LSN &lsn, LogModule module, vector<char> &&data)
+RC DiskLogHandler::recycle(LSN lsn)
+{
+  int removed_count = 0;
+  RC  rc            = file_manager_.recycle_files(lsn, removed_count);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to recycle clog files. lsn=%ld, rc=%s", lsn, strrc(rc));
+    return rc;
+  }
+
+  LOG_INFO("recycle clog files done. lsn=%ld, removed files=%d", lsn, removed_count);
+  return RC::SUCCESS;
+}
+
+RC DiskLogHandler::_append(LSN &lsn, LogModule module, span<const char> data)
 {
   ASSERT(running_.load(), "log handler is not running. lsn=%ld, module=%s, size=%d", 
         lsn, module.name(), data.size());
 
-  RC rc = entry_buffer_.append(lsn, module, std::move(data));
+  // 缓冲区快满时提前唤醒刷日志线程，避免追加日志的线程等待空间
+  if (entry_buffer_.bytes() >= entry_buffer_.capacity() / 2) {
+    flush_request_cond_.notify_one();
+  }
+
+  RC rc = entry_buffer_.append(lsn, module, data);
   if (OB_FAIL(rc)) {
     LOG_WARN("failed to append log entry to buffer. rc=%s", strrc(rc));
     return rc;
@@ -149,11 +177,14 @@ RC DiskLogHandler::_append(LSN &lsn, LogModule module, vector<char> &&data)
 
 RC DiskLogHandler::wait_lsn(LSN lsn)
 {
-  // 直接强制等待。在生产系统中，我们可能会使用条件变量来等待。
-  while (running_.load() && current_flushed_lsn() < lsn) {
-    this_thread::sleep_for(chrono::milliseconds(100));
+  if (current_flushed_lsn() >= lsn) {
+    return RC::SUCCESS;
   }
 
+  unique_lock lock(flush_mutex_);
+  flush_request_cond_.notify_one();
+  flushed_cond_.wait(lock, [this, lsn]() { return !running_.load() || current_flushed_lsn() >= lsn; });
+
   if (current_flushed_lsn() >= lsn) {
     return RC::SUCCESS;
   } else {
@@ -161,18 +192,45 @@ RC DiskLogHandler::wait_lsn(LSN lsn)
   }
 }
 
+RC DiskLogHandler::wait_commit_lsn(LSN lsn)
+{
+  if (durability_ == LogDurability::NONE) {
+    return RC::SUCCESS;
+  }
+  return wait_lsn(lsn);
+}
+
+void DiskLogHandler::wait_for_flush_request()
+{
+  unique_lock lock(flush_mutex_);
+  flush_request_cond_.wait_for(
+      lock, chrono::milliseconds(100), [this]() { return !running_.load() || entry_buffer_.entry_number() > 0; });
+}
+
+void DiskLogHandler::notify_flushed()
+{
+  // 加锁保证等待的线程要么已经在等待，要么还没有检查条件，不会错过通知
+  {
+    lock_guard guard(flush_mutex_);
+  }
+  flushed_cond_.notify_all();
+}
+
 void DiskLogHandler::thread_func()
 {
   /*
-  这个线程一直不停的循环，检查日志缓冲区中是否有日志在内存中，如果在内存中就刷新到磁盘。
-  这种做法很粗暴简单，与生产数据库的做法不同。生产数据库通常会在内存达到一定量，或者一定时间
-  之后，会刷新一下磁盘。这样做的好处是减少磁盘的IO次数，提高性能。
+  这个线程把缓冲区中的日志刷新到磁盘。每次取走缓冲区中所有的日志，一次写入并按照持久化级别同步一次，
+  在这次刷盘期间追加的日志会在下一次一起刷盘，这样并发提交的事务可以共享一次磁盘同步，也就是组提交。
+  缓冲区为空时在条件变量上等待，提交事务调用 wait_lsn 时会唤醒这个线程。
   */
   thread_set_name("LogHandler");
   LOG_INFO("log handler thread started");
 
   LogFileWriter file_writer;
-  
+  file_writer.set_io_engine(io_engine_.get());
+  file_writer.set_durability(durability_);
+  file_writer.set_compression(compression_);
+
   RC rc = RC::SUCCESS;
   while (running_.load() || entry_buffer_.entry_number() > 0) {
     if (!file_writer.valid() || rc == RC::LOG_FILE_FULL) {
@@ -198,11 +256,18 @@ void DiskLogHandler::thread_func()
       LOG_WARN("failed to flush log entry buffer. rc=%s", strrc(rc));
     }
 
+    if (flush_count > 0) {
+      raw_bytes_.store(file_writer.raw_bytes());
+      written_bytes_.store(file_writer.written_bytes());
+      notify_flushed();
+    }
+
     if (flush_count == 0 && rc == RC::SUCCESS) {
-      this_thread::sleep_for(chrono::milliseconds(100));
+      wait_for_flush_request();
       continue;
     }
   }
 
+  notify_flushed();
   LOG_INFO("log handler thread stopped");
 }
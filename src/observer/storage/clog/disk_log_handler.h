@@ -20,6 +20,9 @@ See the Mulan PSL v2 for more details. */
 #include "common/lang/deque.h"
 #include "common/lang/memory.h"
 #include "common/lang/thread.h"
+#include "common/lang/mutex.h"
+#include "common/lang/condition_variable.h"
+#include "common/lang/atomic.h"
 #include "storage/clog/log_module.h"
 #include "storage/clog/log_file.h"
 #include "storage/clog/log_buffer.h"
@@ -31,7 +34,9 @@ class LogReplayer;
  * @brief 对外提供服务的CLog模块
  * @ingroup CLog
  * @details 该模块负责日志的写入、读取、回放等功能。
- * 会在后台开启一个线程，一直尝试刷新内存中的日志到磁盘。
+ * 会在后台开启一个线程，刷新内存中的日志到磁盘。
+ * 提交事务时使用组提交(group commit)：等待日志落盘的线程唤醒刷日志线程后在条件变量上等待，
+ * 刷日志线程每次把缓冲区中所有的日志一起写入并按照持久化级别同步一次(默认 fdatasync)，然后唤醒所有等待的线程。
  * 所有的CLog日志文件都存放在指定的目录下，每个日志文件按照日志条数来划分。
  * 调用的顺序应该是：
  * @code {.cpp}
@@ -92,25 +97,60 @@ public:
 
   /**
    * @brief 等待指定的日志刷盘
-   *
+   * @details 唤醒刷日志线程，然后等待日志落盘。同时等待的多个线程的日志会一起落盘。
    * @param lsn 想要等待的日志
    */
   RC wait_lsn(LSN lsn) override;
 
+  /**
+   * @brief 提交事务时等待日志
+   * @details 持久化级别是 NONE 时不等待，日志由后台线程写入，其它级别与 wait_lsn 相同
+   */
+  RC wait_commit_lsn(LSN lsn) override;
+
+  /**
+   * @brief 删除所有日志都小于lsn的日志文件
+   * @details 正在写入的最后一个日志文件总是保留
+   */
+  RC recycle(LSN lsn) override;
+
   /// @brief 当前的LSN
   LSN current_lsn() const override { return entry_buffer_.current_lsn(); }
   /// @brief 当前刷新到哪个日志
   LSN current_flushed_lsn() const { return entry_buffer_.flushed_lsn(); }
 
+  /**
+   * @brief 设置写日志文件使用的IO引擎
+   * @details 需要在 start 之前调用
+   */
+  void set_io_engine(shared_ptr<common::AsyncIoEngine> io_engine) override { io_engine_ = io_engine; }
+
+  /**
+   * @brief 设置日志的持久化级别
+   * @details 需要在 start 之前调用
+   */
+  void set_durability(LogDurability durability) override { durability_ = durability; }
+
+  /**
+   * @brief 设置写入日志文件时使用的压缩算法
+   * @details 需要在 start 之前调用
+   */
+  void set_compression(LogCompression compression) override { compression_ = compression; }
+
+  /// @brief 启动以来写入文件的日志字节数(压缩前)
+  int64_t raw_bytes() const { return raw_bytes_.load(); }
+  /// @brief 启动以来实际写入文件的字节数(压缩后)
+  int64_t written_bytes() const { return written_bytes_.load(); }
+
 private:
   /**
    * @brief 在缓存中增加一条日志
    *
    * @param[out] lsn    返回的LSN
    * @param[in] module  日志模块
-   * @param[in] data    日志数据。具体的数据由各个模块自己定义
+   * @param[in] data    日志数据。具体的数据由各个模块自己定义，会直接复制到缓冲区中
    */
-  RC _append(LSN &lsn, LogModule module, vector<char> &&data) override;
+  RC _append(LSN &lsn, LogModule module, span<const char> data) override;
 
 private:
   /**
@@ -118,6 +158,16 @@ private:
    */
   void thread_func();
 
+  /**
+   * @brief 刷日志线程等待新的刷盘请求
+   * @details 缓冲区中有日志时直接返回，否则等待 wait_lsn 或 stop 的唤醒，最多等待一段时间。
+   * 不等待落盘的日志(比如没有提交的事务产生的日志)依靠超时来刷新。
+   */
+  void wait_for_flush_request();
+
+  /// @brief 一批日志落盘后唤醒等待的线程
+  void notify_flushed();
+
 private:
   unique_ptr<thread> thread_;          /// 刷新日志的线程
   atomic_bool        running_{false};  /// 是否还要继续运行
@@ -126,4 +176,16 @@ private:
   LogEntryBuffer entry_buffer_;  /// 缓存日志
 
   string path_;  /// 日志文件存放的目录
+
+  mutex              flush_mutex_;        /// 配合下面的条件变量使用
+  condition_variable flush_request_cond_; /// 唤醒刷日志线程
+  condition_variable flushed_cond_;       /// 日志落盘后唤醒等待的线程
+
+  shared_ptr<common::AsyncIoEngine> io_engine_;  /// 写日志文件使用的IO引擎，为空时同步写入
+
+  LogDurability  durability_  = LogDurability::FDATASYNC;  /// 日志的持久化级别
+  LogCompression compression_ = LogCompression::NONE;      /// 日志的压缩算法
+
+  atomic<int64_t> raw_bytes_{0};      /// 写入文件的日志字节数(压缩前)
+  atomic<int64_t> written_bytes_{0};  /// 实际写入文件的字节数(压缩后)
 };
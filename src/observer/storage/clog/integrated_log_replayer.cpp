@@ -12,9 +12,136 @@ See the Mulan PSL v2 for more details. */
 // Created by wangyunlai on 2024/02/04
 //
 
+#include "common/lang/condition_variable.h"
+#include "common/lang/deque.h"
+#include "common/lang/mutex.h"
+#include "common/lang/thread.h"
+#include "common/thread/thread_util.h"
 #include "storage/clog/integrated_log_replayer.h"
 #include "storage/clog/log_entry.h"
 
+using namespace common;
+
+/**
+ * @brief 并行回放时的一个回放线程
+ * @details 按照分发的顺序回放日志。队列中的日志太多时，分发线程会等待，避免把所有日志都读到内存中
+ */
+class IntegratedLogReplayer::Worker
+{
+public:
+  static constexpr size_t MAX_QUEUE_SIZE = 4096;
+  static constexpr size_t BATCH_SIZE     = 64;
+
+  Worker(IntegratedLogReplayer &owner, int index) : owner_(owner), index_(index)
+  {
+    thread_ = thread(&Worker::thread_func, this);
+  }
+
+  ~Worker() { stop(); }
+
+  /**
+   * @brief 分发线程把日志先放到一个批次中，攒够 BATCH_SIZE 条再放到队列，减少加锁和唤醒的次数
+   */
+  void push(LogEntry &&entry)
+  {
+    batch_.push_back(std::move(entry));
+    if (batch_.size() >= BATCH_SIZE) {
+      flush_batch();
+    }
+  }
+
+  /// @brief 把还没有满的批次放到队列中
+  void flush_batch()
+  {
+    if (batch_.empty()) {
+      return;
+    }
+
+    unique_lock lock(lock_);
+    space_cond_.wait(lock, [this]() { return queue_.size() < MAX_QUEUE_SIZE; });
+    const bool was_empty = queue_.empty();
+    for (LogEntry &entry : batch_) {
+      queue_.push_back(std::move(entry));
+    }
+    batch_.clear();
+    if (was_empty) {
+      work_cond_.notify_one();
+    }
+  }
+
+  /// @brief 等待队列中的日志都回放完成
+  void wait_idle()
+  {
+    flush_batch();
+
+    unique_lock lock(lock_);
+    space_cond_.wait(lock, [this]() { return queue_.empty() && !busy_; });
+  }
+
+  void stop()
+  {
+    flush_batch();
+    {
+      lock_guard guard(lock_);
+      running_ = false;
+    }
+    work_cond_.notify_one();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+private:
+  void thread_func()
+  {
+    thread_set_name(("Redo" + to_string(index_)).c_str());
+
+    deque<LogEntry> entries;
+    while (true) {
+      {
+        unique_lock lock(lock_);
+        busy_ = false;
+        space_cond_.notify_all();
+        work_cond_.wait(lock, [this]() { return !queue_.empty() || !running_; });
+        if (queue_.empty()) {
+          break;
+        }
+        // 一次取走队列中所有的日志，减少加锁的次数
+        entries.swap(queue_);
+        busy_ = true;
+        space_cond_.notify_all();
+      }
+
+      for (LogEntry &entry : entries) {
+        // 出错后不再回放，等分发线程把错误返回给调用者
+        if (OB_FAIL(owner_.worker_error_.load())) {
+          break;
+        }
+        RC rc = owner_.replay_in_place(entry);
+        if (OB_FAIL(rc)) {
+          LOG_WARN("failed to replay log entry. entry=%s, rc=%s", entry.to_string().c_str(), strrc(rc));
+          owner_.set_error(rc);
+        }
+      }
+      entries.clear();
+    }
+  }
+
+private:
+  IntegratedLogReplayer &owner_;
+  int                    index_ = 0;
+
+  mutex              lock_;
+  condition_variable work_cond_;   ///< 有新的日志或者需要停止
+  condition_variable space_cond_;  ///< 队列有空间或者回放完了所有日志
+  deque<LogEntry>    queue_;
+  deque<LogEntry>    batch_;            ///< 只有分发线程访问
+  bool               busy_    = false;  ///< 是否正在回放从队列中取走的日志
+  bool               running_ = true;
+
+  thread thread_;
+};
+
 IntegratedLogReplayer::IntegratedLogReplayer(BufferPoolManager &bpm)
     : buffer_pool_log_replayer_(bpm),
       record_log_replayer_(bpm),
@@ -29,20 +156,131 @@ IntegratedLogReplayer::IntegratedLogReplayer(BufferPoolManager &bpm, unique_ptr<
       trx_log_replayer_(std::move(trx_log_replayer))
 {}
 
+IntegratedLogReplayer::IntegratedLogReplayer(
+    BufferPoolManager &bpm, unique_ptr<LogReplayer> trx_log_replayer, int worker_num)
+    : IntegratedLogReplayer(bpm, std::move(trx_log_replayer))
+{
+#ifndef CONCURRENCY
+  // buffer pool 等模块的锁只有在CONCURRENCY编译模式下才会生效
+  if (worker_num > 1) {
+    LOG_INFO("parallel redo is not supported without CONCURRENCY, replay logs in one thread");
+    worker_num = 1;
+  }
+#endif
+
+  if (worker_num > 1) {
+    for (int i = 0; i < worker_num; i++) {
+      workers_.push_back(make_unique<Worker>(*this, i));
+    }
+    LOG_INFO("replay logs with %d threads", worker_num);
+  }
+}
+
+IntegratedLogReplayer::~IntegratedLogReplayer() { stop_workers(); }
+
 RC IntegratedLogReplayer::replay(const LogEntry &entry)
+{
+  if (workers_.empty()) {
+    return replay_in_place(entry);
+  }
+
+  RC rc = worker_error_.load();
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  switch (entry.module().id()) {
+    case LogModule::Id::BUFFER_POOL: {
+      rc = wait_workers();
+      if (OB_FAIL(rc)) {
+        return rc;
+      }
+      return buffer_pool_log_replayer_.replay(entry);
+    }
+
+    case LogModule::Id::RECORD_MANAGER: {
+      if (entry.payload_size() < RecordLogHeader::SIZE) {
+        LOG_WARN("invalid record log entry. entry=%s", entry.to_string().c_str());
+        return RC::INVALID_ARGUMENT;
+      }
+      auto header = reinterpret_cast<const RecordLogHeader *>(entry.data());
+      return dispatch(entry, header->buffer_pool_id, header->page_num);
+    }
+
+    case LogModule::Id::BPLUS_TREE: {
+      // 一条B+树日志可能修改多个页面，同一个索引的日志都由一个线程回放
+      int32_t buffer_pool_id = -1;
+      if (entry.payload_size() < static_cast<int32_t>(sizeof(buffer_pool_id))) {
+        LOG_WARN("invalid bplus tree log entry. entry=%s", entry.to_string().c_str());
+        return RC::INVALID_ARGUMENT;
+      }
+      memcpy(&buffer_pool_id, entry.data(), sizeof(buffer_pool_id));
+      return dispatch(entry, buffer_pool_id, BP_INVALID_PAGE_NUM);
+    }
+
+    default: return replay_in_place(entry);
+  }
+}
+
+RC IntegratedLogReplayer::replay_in_place(const LogEntry &entry)
 {
   switch (entry.module().id()) {
     case LogModule::Id::BUFFER_POOL: return buffer_pool_log_replayer_.replay(entry);
     case LogModule::Id::RECORD_MANAGER: return record_log_replayer_.replay(entry);
     case LogModule::Id::BPLUS_TREE: return bplus_tree_log_replayer_.replay(entry);
-    case LogModule::Id::TRANSACTION: return trx_log_replayer_->replay(entry);
+    case LogModule::Id::TRANSACTION: return trx_log_replayer_ ? trx_log_replayer_->replay(entry) : RC::INVALID_ARGUMENT;
     default: return RC::INVALID_ARGUMENT;
   }
 }
 
+RC IntegratedLogReplayer::dispatch(const LogEntry &entry, int32_t buffer_pool_id, int32_t page_num)
+{
+  // 日志数据在调用返回后就失效了，需要复制一份
+  LogEntry entry_copy;
+  RC       rc = entry_copy.init(entry.lsn(), entry.module(), vector<char>(entry.data(), entry.data() + entry.payload_size()));
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(buffer_pool_id)) << 32) | static_cast<uint32_t>(page_num);
+  key *= 0x9E3779B97F4A7C15ULL;  // 连续的页号分散到不同的线程
+  workers_[(key >> 32) % workers_.size()]->push(std::move(entry_copy));
+  return RC::SUCCESS;
+}
+
+RC IntegratedLogReplayer::wait_workers()
+{
+  for (auto &worker : workers_) {
+    worker->wait_idle();
+  }
+  return worker_error_.load();
+}
+
+void IntegratedLogReplayer::stop_workers()
+{
+  for (auto &worker : workers_) {
+    worker->stop();
+  }
+  workers_.clear();
+}
+
+void IntegratedLogReplayer::set_error(RC rc)
+{
+  RC expected = RC::SUCCESS;
+  worker_error_.compare_exchange_strong(expected, rc);
+}
+
 RC IntegratedLogReplayer::on_done()
 {
-  RC rc = buffer_pool_log_replayer_.on_done();
+  // 回滚未提交的事务会修改页面，需要先等所有的日志回放完
+  RC rc = wait_workers();
+  stop_workers();
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to replay logs in parallel. rc=%s", strrc(rc));
+    return rc;
+  }
+
+  rc = buffer_pool_log_replayer_.on_done();
   if (OB_FAIL(rc)) {
     LOG_WARN("failed to do buffer pool log replay. rc=%s", strrc(rc));
     return rc;
@@ -59,7 +297,7 @@ RC IntegratedLogReplayer::on_done()
     return rc;
   }
 
-  rc = trx_log_replayer_->on_done();
+  rc = trx_log_replayer_ ? trx_log_replayer_->on_done() : RC::SUCCESS;
   if (OB_FAIL(rc)) {
     LOG_WARN("failed to do mvcc trx log replay. rc=%s", strrc(rc));
     return rc;
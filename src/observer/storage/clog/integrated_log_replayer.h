@@ -14,6 +14,9 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include "common/lang/atomic.h"
+#include "common/lang/memory.h"
+#include "common/lang/vector.h"
 #include "storage/clog/log_replayer.h"
 #include "storage/buffer/buffer_pool_log.h"
 #include "storage/record/record_log.h"
@@ -25,7 +28,13 @@ class BufferPoolManager;
 /**
  * @brief 整体日志回放类
  * @ingroup Clog
- * @details 负责回放所有日志，是其它各模块日志回放的分发器
+ * @details 负责回放所有日志，是其它各模块日志回放的分发器。
+ * 可以指定多个回放线程并行回放(只在CONCURRENCY编译模式下生效)：调用 replay 的线程负责分发日志，
+ * record manager 的日志按照 (buffer_pool_id, page_num) 分配给回放线程，B+树的一条日志会修改同一个索引文件的多个页面，
+ * 按照 buffer_pool_id 分配。同一个页面的日志总是由同一个线程按照LSN顺序回放。
+ * buffer pool 的日志(分配、释放页面)会修改文件头和空间映射页，后面其它页面的日志又依赖页面已经分配，
+ * 所以是一个屏障：等所有线程回放完前面的日志后，在分发线程中回放。
+ * 事务日志的回放只修改内存中的事务状态，直接在分发线程中按顺序回放，on_done 回滚未提交的事务前会等待所有线程结束。
  */
 class IntegratedLogReplayer : public LogReplayer
 {
@@ -44,7 +53,14 @@ public:
    * 区别于另一个构造函数，这个构造函数可以指定不同的事务日志回放器。比如进程启动时可以指定选择使用VacuousTrx还是MvccTrx。
    */
   IntegratedLogReplayer(BufferPoolManager &bpm, unique_ptr<LogReplayer> trx_log_replayer);
-  virtual ~IntegratedLogReplayer() = default;
+
+  /**
+   * @brief 构造函数
+   * @details 指定并行回放的线程个数。小于等于1或者没有打开CONCURRENCY编译选项时，在调用 replay 的线程中回放
+   * @param worker_num 回放线程个数
+   */
+  IntegratedLogReplayer(BufferPoolManager &bpm, unique_ptr<LogReplayer> trx_log_replayer, int worker_num);
+  virtual ~IntegratedLogReplayer();
 
   //! @copydoc LogReplayer::replay
   RC replay(const LogEntry &entry) override;
@@ -52,9 +68,33 @@ public:
   //! @copydoc LogReplayer::on_done
   RC on_done() override;
 
+  /// @brief 并行回放的线程个数，0表示在调用 replay 的线程中回放
+  int worker_num() const { return static_cast<int>(workers_.size()); }
+
+private:
+  class Worker;
+
+  /// @brief 在当前线程中回放一条日志
+  RC replay_in_place(const LogEntry &entry);
+
+  /// @brief 把日志交给 key 对应的回放线程
+  RC dispatch(const LogEntry &entry, int32_t buffer_pool_id, int32_t page_num);
+
+  /// @brief 等待所有回放线程回放完已经分发的日志，返回回放过程中的第一个错误
+  RC wait_workers();
+
+  /// @brief 停止所有回放线程
+  void stop_workers();
+
+  /// @brief 记录回放线程遇到的第一个错误
+  void set_error(RC rc);
+
 private:
   BufferPoolLogReplayer   buffer_pool_log_replayer_;  ///< 缓冲池日志回放器
   RecordLogReplayer       record_log_replayer_;       ///< record manager 日志回放器
   BplusTreeLogReplayer    bplus_tree_log_replayer_;   ///< bplus tree 日志回放器
   unique_ptr<LogReplayer> trx_log_replayer_;          ///< trx 日志回放器
+
+  vector<unique_ptr<Worker>> workers_;                  ///< 并行回放的线程
+  atomic<RC>                 worker_error_{RC::SUCCESS};  ///< 回放线程遇到的第一个错误
 };
\ No newline at end of file
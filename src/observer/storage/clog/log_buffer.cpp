@@ -14,93 +14,187 @@ See the Mulan PSL v2 for more details. */
 
 #include "storage/clog/log_buffer.h"
 #include "storage/clog/log_file.h"
-#include "common/lang/chrono.h"
+#include "common/lang/algorithm.h"
 
 using namespace common;
 
+LogEntryBuffer::LogEntryBuffer() { init(0); }
+
 RC LogEntryBuffer::init(LSN lsn, int32_t max_bytes /*= 0*/)
 {
-  current_lsn_.store(lsn);
-  flushed_lsn_.store(lsn);
+  if (lsn < 0 || lsn >= (LSN(1) << LSN_BITS) - 1) {
+    LOG_WARN("lsn is out of range. lsn=%ld, lsn bits=%d", lsn, LSN_BITS);
+    return RC::INVALID_ARGUMENT;
+  }
 
-  if (max_bytes > 0) {
-    max_bytes_ = max_bytes;
+  int64_t capacity = max_bytes > 0 ? max_bytes : DEFAULT_CAPACITY;
+  capacity         = max(capacity, static_cast<int64_t>(LogEntry::max_size()));
+  capacity         = min(capacity, MAX_CAPACITY);
+  if (capacity != capacity_) {
+    data_     = make_unique<char[]>(capacity);
+    capacity_ = capacity;
   }
+  if (!written_slots_) {
+    written_slots_ = make_unique<atomic<LSN>[]>(SLOT_NUMBER);
+  }
+  for (int64_t i = 0; i < SLOT_NUMBER; i++) {
+    written_slots_[i].store(0);
+  }
+
+  reserved_.store(static_cast<uint64_t>(lsn) << POS_BITS);
+  flushed_pos_.store(0);
+  flushed_lsn_.store(lsn);
   return RC::SUCCESS;
 }
 
 RC LogEntryBuffer::append(LSN &lsn, LogModule::Id module_id, vector<char> &&data)
 {
-  return append(lsn, LogModule(module_id), std::move(data));
+  return append(lsn, LogModule(module_id), span<const char>(data));
 }
 
 RC LogEntryBuffer::append(LSN &lsn, LogModule module, vector<char> &&data)
 {
-  /// 控制当前buffer使用的内存
-  /// 简单粗暴，强制原地等待
-  /// 但是如果当前想要新插入的日志比较大，不会做控制。所以理论上容纳的最大buffer内存是2*max_bytes_
-  while (bytes_.load() >= max_bytes_) {
-    this_thread::sleep_for(chrono::milliseconds(10));
+  return append(lsn, module, span<const char>(data));
+}
+
+RC LogEntryBuffer::append(LSN &lsn, LogModule module, span<const char> data)
+{
+  if (static_cast<int64_t>(data.size()) > LogEntry::max_payload_size()) {
+    LOG_WARN("log entry size is too large. size=%ld, max_payload_size=%d", data.size(), LogEntry::max_payload_size());
+    return RC::INVALID_ARGUMENT;
   }
 
-  LogEntry entry;
-  RC rc = entry.init(lsn, module, std::move(data));
-  if (OB_FAIL(rc)) {
-    LOG_WARN("failed to init log entry. rc=%s", strrc(rc));
-    return rc;
+  const int64_t total_size = LogHeader::SIZE + static_cast<int64_t>(data.size());
+
+  // 同时预留LSN和内存。缓冲区放不下时等待刷盘线程释放空间
+  uint64_t reserved = reserved_.load();
+  int64_t  pos      = 0;
+  while (true) {
+    const int64_t flushed_pos = flushed_pos_.load();
+    pos                       = reserved_pos(reserved, flushed_pos);
+    if (pos - flushed_pos > capacity_) {
+      // 读取 reserved 之后其它线程又预留并刷盘了，还原出的位置是错误的，重新读取
+      reserved = reserved_.load();
+      continue;
+    }
+    const uint64_t new_lsn = (reserved >> POS_BITS) + 1;
+    if (pos + total_size - flushed_pos > capacity_ ||
+        static_cast<LSN>(new_lsn) - flushed_lsn_.load() > SLOT_NUMBER) {
+      wait_for_space(pos + total_size - capacity_, static_cast<LSN>(new_lsn) - SLOT_NUMBER);
+      reserved = reserved_.load();
+      continue;
+    }
+
+    const uint64_t new_reserved = (new_lsn << POS_BITS) | (static_cast<uint64_t>(pos + total_size) & POS_MASK);
+    if (reserved_.compare_exchange_weak(reserved, new_reserved)) {
+      lsn = static_cast<LSN>(new_lsn);
+      break;
+    }
   }
 
-  lock_guard guard(mutex_);
-  lsn = ++current_lsn_;
-  entry.set_lsn(lsn);
+  LogHeader header;
+  header.lsn       = lsn;
+  header.size      = static_cast<int32_t>(data.size());
+  header.module_id = module.index();
+  copy_in(pos, &header, LogHeader::SIZE);
+  copy_in(pos + LogHeader::SIZE, data.data(), data.size());
 
-  entries_.push_back(std::move(entry));
-  bytes_ += entry.total_size();
+  written_slots_[lsn % SLOT_NUMBER].store(lsn, memory_order_release);
   return RC::SUCCESS;
 }
 
+void LogEntryBuffer::wait_for_space(int64_t pos, LSN lsn)
+{
+  unique_lock lock(space_mutex_);
+  space_waiters_++;
+  space_cond_.wait(lock, [this, pos, lsn]() { return flushed_pos_.load() >= pos && flushed_lsn_.load() >= lsn; });
+  space_waiters_--;
+}
+
 RC LogEntryBuffer::flush(LogFileWriter &writer, int &count)
 {
   count = 0;
 
-  while (entry_number() > 0) {
-    LogEntry entry;
-    {
-      lock_guard guard(mutex_);
-      if (entries_.empty()) {
-        break;
-      }
-
-      LogEntry &front_entry = entries_.front();
-      ASSERT(front_entry.lsn() > 0 && front_entry.payload_size() > 0, "invalid log entry");
-      entry = std::move(entries_.front());
-      ASSERT(entry.payload_size() > 0 && entry.lsn() > 0, "invalid log entry");
-      entries_.pop_front();
-      bytes_ -= entry.total_size();
-    }
-    
-    RC rc = writer.write(entry);
-    if (OB_FAIL(rc)) {
-      lock_guard guard(mutex_);
-      entries_.emplace_front(std::move(entry));
-      LogEntry &front_entry = entries_.front();
-      ASSERT(front_entry.lsn() > 0 && front_entry.payload_size() > 0, "invalid log entry");
-      return rc;
-    } else {
-      ++count;
-      flushed_lsn_ = entry.lsn();
-    }
+  // 只有刷盘线程会修改 flushed_pos_ 和 flushed_lsn_
+  const int64_t begin     = flushed_pos_.load();
+  const LSN     first_lsn = flushed_lsn_.load() + 1;
+  if (written_slots_[first_lsn % SLOT_NUMBER].load(memory_order_acquire) != first_lsn) {
+    return RC::SUCCESS;
+  }
+  if (first_lsn > writer.end_lsn()) {
+    return RC::LOG_FILE_FULL;
+  }
+
+  // 找到连续写完的、当前文件能放下的最后一条日志
+  LSN     last_lsn = first_lsn - 1;
+  int64_t stop     = begin;
+  while (last_lsn < writer.end_lsn() &&
+         written_slots_[(last_lsn + 1) % SLOT_NUMBER].load(memory_order_acquire) == last_lsn + 1) {
+    LogHeader header;
+    copy_out(stop, &header, LogHeader::SIZE);
+    ASSERT(header.lsn == last_lsn + 1 && header.size >= 0, "invalid log entry in buffer. expected lsn=%ld, header=%s",
+           last_lsn + 1, header.to_string().c_str());
+    last_lsn = header.lsn;
+    stop += LogHeader::SIZE + header.size;
+  }
+  const bool more_entries = last_lsn == writer.end_lsn() && current_lsn() > last_lsn;
+
+  const int64_t begin_offset = begin % capacity_;
+  const int64_t size         = stop - begin;
+  iovec         iovs[2];
+  int           iov_count = 1;
+  if (begin_offset + size <= capacity_) {
+    iovs[0] = {data_.get() + begin_offset, static_cast<size_t>(size)};
+  } else {
+    iovs[0]   = {data_.get() + begin_offset, static_cast<size_t>(capacity_ - begin_offset)};
+    iovs[1]   = {data_.get(), static_cast<size_t>(size - (capacity_ - begin_offset))};
+    iov_count = 2;
+  }
+
+  RC rc = writer.write(span<const iovec>(iovs, iov_count), first_lsn, last_lsn);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  count = static_cast<int>(last_lsn - first_lsn + 1);
+  flushed_lsn_.store(last_lsn);
+  flushed_pos_.store(stop);
+
+  if (space_waiters_.load() > 0) {
+    lock_guard guard(space_mutex_);
+    space_cond_.notify_all();
+  }
+
+  return more_entries ? RC::LOG_FILE_FULL : RC::SUCCESS;
+}
+
+void LogEntryBuffer::copy_in(int64_t pos, const void *src, int64_t size)
+{
+  const int64_t offset = pos % capacity_;
+  const int64_t first  = min(size, capacity_ - offset);
+  memcpy(data_.get() + offset, src, first);
+  if (first < size) {
+    memcpy(data_.get(), static_cast<const char *>(src) + first, size - first);
+  }
+}
+
+void LogEntryBuffer::copy_out(int64_t pos, void *dst, int64_t size) const
+{
+  const int64_t offset = pos % capacity_;
+  const int64_t first  = min(size, capacity_ - offset);
+  memcpy(dst, data_.get() + offset, first);
+  if (first < size) {
+    memcpy(static_cast<char *>(dst) + first, data_.get(), size - first);
   }
-  
-  return RC::SUCCESS;
 }
 
 int64_t LogEntryBuffer::bytes() const
 {
-  return bytes_.load();
+  const int64_t flushed_pos = flushed_pos_.load();
+  return reserved_pos(reserved_.load(), flushed_pos) - flushed_pos;
 }
 
 int32_t LogEntryBuffer::entry_number() const
 {
-  return entries_.size();
+  return static_cast<int32_t>(current_lsn() - flushed_lsn());
 }
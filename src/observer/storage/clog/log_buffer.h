@@ -18,7 +18,9 @@ See the Mulan PSL v2 for more details. */
 #include "common/types.h"
 #include "common/lang/mutex.h"
 #include "common/lang/vector.h"
-#include "common/lang/deque.h"
+#include "common/lang/condition_variable.h"
+#include "common/lang/memory.h"
+#include "common/lang/span.h"
 #include "common/lang/atomic.h"
 #include "storage/clog/log_module.h"
 #include "storage/clog/log_entry.h"
@@ -29,15 +31,29 @@ class LogFileWriter;
  * @brief 日志数据缓冲区
  * @ingroup CLog
  * @details 缓存一部分日志在内存中而不是直接写入磁盘。
- * 这里的缓存没有考虑高性能操作，比如使用预分配内存、环形缓冲池等。
- * 在生产数据库中，通常会使用预分配内存形式的缓存来提高性能，并且可以减少内存碎片。
+ * 缓冲区是一块预先分配的环形内存，日志按照LSN的顺序连续存放，格式与日志文件中的相同(日志头紧跟日志数据)。
+ * 追加日志时不加锁：
+ * - 使用一次CAS同时预留LSN和一段内存，保证LSN的顺序与内存中的顺序一致；
+ * - 直接把日志头和数据序列化到预留的内存中；
+ * - 在这条日志LSN对应的槽位上记录日志已经写完，不需要等待前面的日志。
+ * 刷盘线程从上次刷盘的位置开始按照LSN检查槽位，把连续写完的日志(回绕时是两段内存)一次写入文件。
+ * 缓冲区满或者没有刷盘的日志条数达到槽位个数时，追加日志的线程在条件变量上等待刷盘线程释放空间。
+ *
+ * 为了用一个64位的原子变量同时记录LSN和预留位置，高 LSN_BITS 位是LSN，低 POS_BITS 位是
+ * 预留位置对 2^POS_BITS 取模的结果。预留位置与刷盘位置的差值不会超过缓冲区大小，所以可以还原出完整的位置。
  */
 class LogEntryBuffer
 {
 public:
-  LogEntryBuffer()  = default;
+  /// @brief 分配默认大小的缓冲区，LSN从1开始
+  LogEntryBuffer();
   ~LogEntryBuffer() = default;
 
+  /**
+   * @brief 初始化
+   * @param lsn 当前最大的LSN，新的日志从 lsn + 1 开始
+   * @param max_bytes 缓冲区大小，0表示使用默认值。至少能容纳一条最大的日志
+   */
   RC init(LSN lsn, int32_t max_bytes = 0);
 
   /**
@@ -45,10 +61,11 @@ public:
    */
   RC append(LSN &lsn, LogModule::Id module_id, vector<char> &&data);
   RC append(LSN &lsn, LogModule module, vector<char> &&data);
+  RC append(LSN &lsn, LogModule module, span<const char> data);
 
   /**
    * @brief 刷新缓冲区中的日志到磁盘
-   *
+   * @details 一次写入所有已经写完的日志，超过当前文件最大LSN的日志留在缓冲区中，这时返回 LOG_FILE_FULL
    * @param file_handle 使用它来写文件
    * @param count 刷了多少条日志
    */
@@ -64,16 +81,51 @@ public:
    */
   int32_t entry_number() const;
 
-  LSN current_lsn() const { return current_lsn_.load(); }
+  /// @brief 缓冲区大小
+  int64_t capacity() const { return capacity_; }
+
+  LSN current_lsn() const { return static_cast<LSN>(reserved_.load() >> POS_BITS); }
   LSN flushed_lsn() const { return flushed_lsn_.load(); }
 
 private:
-  mutex           mutex_;  /// 当前数据结构一定会在多线程中访问，所以强制使用有效的锁，而不是有条件生效的common::Mutex
-  deque<LogEntry> entries_;  /// 日志缓冲区
-  atomic<int64_t> bytes_;    /// 当前缓冲区中的日志数据大小
+  /// @brief 根据当前的刷盘位置还原出预留位置
+  int64_t reserved_pos(uint64_t reserved, int64_t flushed_pos) const
+  {
+    return flushed_pos + static_cast<int64_t>(((reserved & POS_MASK) - static_cast<uint64_t>(flushed_pos)) & POS_MASK);
+  }
+
+  /// @brief 等待刷盘线程把缓冲区刷到 pos 这个位置，并且至少刷到 lsn 这条日志
+  void wait_for_space(int64_t pos, LSN lsn);
+
+  /// @brief 从 pos 开始复制数据到缓冲区，到达末尾时回绕
+  void copy_in(int64_t pos, const void *src, int64_t size);
+  /// @brief 从 pos 开始复制缓冲区中的数据，到达末尾时回绕
+  void copy_out(int64_t pos, void *dst, int64_t size) const;
+
+private:
+  static constexpr int      POS_BITS = 26;
+  static constexpr int      LSN_BITS = 64 - POS_BITS;
+  static constexpr uint64_t POS_MASK = (uint64_t(1) << POS_BITS) - 1;
+
+  /// 默认缓冲区大小，能放下一条最大的日志
+  static constexpr int64_t DEFAULT_CAPACITY = 8 * 1024 * 1024;
+  /// 预留位置与刷盘位置的差值必须能用 POS_BITS 位表示
+  static constexpr int64_t MAX_CAPACITY = int64_t(1) << (POS_BITS - 1);
+  /// 槽位个数，也是缓冲区中最多容纳的日志条数
+  static constexpr int64_t SLOT_NUMBER = 64 * 1024;
+
+  unique_ptr<char[]> data_;  /// 环形缓冲区
+  int64_t            capacity_ = 0;
+
+  atomic<uint64_t> reserved_{0};     /// 已经预留的LSN和位置，参考类的说明
+  atomic<int64_t>  flushed_pos_{0};  /// 这个位置之前的日志都已经落盘，内存可以复用
+  atomic<LSN>      flushed_lsn_{0};
 
-  atomic<LSN> current_lsn_{0};
-  atomic<LSN> flushed_lsn_{0};
+  /// 日志写完后，把 lsn % SLOT_NUMBER 这个槽位设置为它的LSN
+  unique_ptr<atomic<LSN>[]> written_slots_;
 
-  int32_t max_bytes_ = 4 * 1024 * 1024;  /// 缓冲区最大字节数
+  /// 缓冲区满时等待使用。当前数据结构一定会在多线程中访问，所以强制使用有效的锁，而不是有条件生效的common::Mutex
+  mutex              space_mutex_;
+  condition_variable space_cond_;
+  atomic<int32_t>    space_waiters_{0};
 };
@@ -0,0 +1,265 @@
+/* Copyright (c) 2021-2022 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <string.h>
+#include <strings.h>
+
+#ifdef WITH_LZ4
+#include <lz4.h>
+#endif
+
+#include "common/lang/string.h"
+#include "common/log/log.h"
+#include "storage/clog/log_compressor.h"
+
+using namespace common;
+
+const int32_t LogCompressedHeader::SIZE = sizeof(LogCompressedHeader);
+
+RC log_compression_from_string(const char *name, LogCompression &compression)
+{
+  if (is_blank(name) || 0 == strcasecmp(name, "none")) {
+    compression = LogCompression::NONE;
+  } else if (0 == strcasecmp(name, "builtin")) {
+    compression = LogCompression::BUILTIN;
+  } else if (0 == strcasecmp(name, "lz4")) {
+#ifdef WITH_LZ4
+    compression = LogCompression::LZ4;
+#else
+    LOG_WARN("lz4 is not compiled in(WITH_LZ4), use builtin log compression");
+    compression = LogCompression::BUILTIN;
+#endif
+  } else {
+    LOG_WARN("unknown log compression: %s", name);
+    return RC::INVALID_ARGUMENT;
+  }
+  return RC::SUCCESS;
+}
+
+const char *log_compression_name(LogCompression compression)
+{
+  switch (compression) {
+    case LogCompression::NONE: return "none";
+    case LogCompression::BUILTIN: return "builtin";
+    case LogCompression::LZ4: return "lz4";
+  }
+  return "unknown";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 内置的压缩算法
+// 一个简单的LZ77：用哈希表找到前面出现过的4字节，匹配尽量长的数据。
+// 压缩后的数据是一系列的 (字面量长度, 字面量, 匹配长度, 匹配距离)，长度和距离使用varint编码，
+// 最后一组的匹配长度是0，没有匹配距离。
+// 日志中有大量重复的日志头、页面中的空闲空间和相似的记录，这个简单的算法就有不错的效果。
+namespace {
+
+constexpr int    HASH_BITS    = 14;
+constexpr int    MIN_MATCH    = 4;
+constexpr size_t MAX_DISTANCE = 64 * 1024;
+
+inline uint32_t read32(const char *p)
+{
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint32_t hash32(uint32_t v) { return (v * 2654435761U) >> (32 - HASH_BITS); }
+
+inline char *put_varint(char *p, uint64_t v)
+{
+  while (v >= 0x80) {
+    *p++ = static_cast<char>(v | 0x80);
+    v >>= 7;
+  }
+  *p++ = static_cast<char>(v);
+  return p;
+}
+
+inline size_t varint_size(uint64_t v)
+{
+  size_t n = 1;
+  while (v >= 0x80) {
+    v >>= 7;
+    n++;
+  }
+  return n;
+}
+
+inline bool get_varint(const char *&p, const char *end, uint64_t &v)
+{
+  v = 0;
+  for (int shift = 0; shift < 64 && p < end; shift += 7) {
+    uint8_t byte = static_cast<uint8_t>(*p++);
+    v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t builtin_max_compressed_size(size_t raw_size)
+{
+  // 只有比编码更长的匹配才会使用，额外的开销只有字面量长度的varint
+  return raw_size + raw_size / 64 + 32;
+}
+
+size_t builtin_compress(const char *src, size_t size, char *dst)
+{
+  vector<int32_t> table(1 << HASH_BITS, -1);
+
+  char  *out    = dst;
+  size_t anchor = 0;
+  size_t pos    = 0;
+  while (pos + MIN_MATCH <= size) {
+    const uint32_t value     = read32(src + pos);
+    const uint32_t h         = hash32(value);
+    const int32_t  candidate = table[h];
+    table[h]                 = static_cast<int32_t>(pos);
+
+    if (candidate < 0 || pos - candidate > MAX_DISTANCE || read32(src + candidate) != value) {
+      pos++;
+      continue;
+    }
+
+    size_t match_len = MIN_MATCH;
+    while (pos + match_len < size && src[candidate + match_len] == src[pos + match_len]) {
+      match_len++;
+    }
+    const size_t distance = pos - candidate;
+    if (match_len < varint_size(match_len) + varint_size(distance) + 2) {
+      pos++;
+      continue;
+    }
+
+    const size_t literal_len = pos - anchor;
+    out                      = put_varint(out, literal_len);
+    memcpy(out, src + anchor, literal_len);
+    out += literal_len;
+    out = put_varint(out, match_len);
+    out = put_varint(out, distance);
+
+    pos += match_len;
+    anchor = pos;
+  }
+
+  const size_t literal_len = size - anchor;
+  out                      = put_varint(out, literal_len);
+  memcpy(out, src + anchor, literal_len);
+  out += literal_len;
+  out = put_varint(out, 0);
+  return out - dst;
+}
+
+bool builtin_decompress(const char *src, size_t size, char *dst, size_t dst_size)
+{
+  const char *in     = src;
+  const char *in_end = src + size;
+  size_t      pos    = 0;
+  while (true) {
+    uint64_t literal_len = 0;
+    if (!get_varint(in, in_end, literal_len) || literal_len > static_cast<uint64_t>(in_end - in) ||
+        literal_len > dst_size - pos) {
+      return false;
+    }
+    memcpy(dst + pos, in, literal_len);
+    in += literal_len;
+    pos += literal_len;
+
+    uint64_t match_len = 0;
+    if (!get_varint(in, in_end, match_len)) {
+      return false;
+    }
+    if (match_len == 0) {
+      return in == in_end && pos == dst_size;
+    }
+
+    uint64_t distance = 0;
+    if (!get_varint(in, in_end, distance) || distance == 0 || distance > pos || match_len > dst_size - pos) {
+      return false;
+    }
+    // 匹配的数据可能和要写入的数据重叠，只能逐个字节复制
+    const char *from = dst + pos - distance;
+    for (uint64_t i = 0; i < match_len; i++) {
+      dst[pos + i] = from[i];
+    }
+    pos += match_len;
+  }
+}
+
+}  // namespace
+
+size_t LogCompressor::max_compressed_size(LogCompression compression, size_t raw_size)
+{
+  switch (compression) {
+#ifdef WITH_LZ4
+    case LogCompression::LZ4: return LZ4_compressBound(static_cast<int>(raw_size));
+#endif
+    default: return builtin_max_compressed_size(raw_size);
+  }
+}
+
+RC LogCompressor::compress(LogCompression compression, span<const char> src, vector<char> &dst)
+{
+  dst.resize(max_compressed_size(compression, src.size()));
+  switch (compression) {
+    case LogCompression::BUILTIN: {
+      dst.resize(builtin_compress(src.data(), src.size(), dst.data()));
+    } break;
+
+#ifdef WITH_LZ4
+    case LogCompression::LZ4: {
+      int ret = LZ4_compress_default(src.data(), dst.data(), static_cast<int>(src.size()), static_cast<int>(dst.size()));
+      if (ret <= 0) {
+        LOG_WARN("failed to compress log with lz4. size=%ld, ret=%d", src.size(), ret);
+        return RC::INTERNAL;
+      }
+      dst.resize(ret);
+    } break;
+#endif
+
+    default: {
+      LOG_WARN("unsupported log compression: %s", log_compression_name(compression));
+      return RC::INVALID_ARGUMENT;
+    }
+  }
+  return RC::SUCCESS;
+}
+
+RC LogCompressor::decompress(LogCompression compression, span<const char> src, span<char> dst)
+{
+  switch (compression) {
+    case LogCompression::BUILTIN: {
+      if (!builtin_decompress(src.data(), src.size(), dst.data(), dst.size())) {
+        LOG_WARN("failed to decompress log. compressed size=%ld, raw size=%ld", src.size(), dst.size());
+        return RC::LOG_ENTRY_INVALID;
+      }
+    } break;
+
+#ifdef WITH_LZ4
+    case LogCompression::LZ4: {
+      int ret = LZ4_decompress_safe(src.data(), dst.data(), static_cast<int>(src.size()), static_cast<int>(dst.size()));
+      if (ret != static_cast<int>(dst.size())) {
+        LOG_WARN("failed to decompress log with lz4. compressed size=%ld, raw size=%ld, ret=%d",
+                 src.size(), dst.size(), ret);
+        return RC::LOG_ENTRY_INVALID;
+      }
+    } break;
+#endif
+
+    default: {
+      LOG_WARN("unsupported log compression: %d", static_cast<int>(compression));
+      return RC::LOG_ENTRY_INVALID;
+    }
+  }
+  return RC::SUCCESS;
+}
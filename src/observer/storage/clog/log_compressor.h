@@ -0,0 +1,80 @@
+/* Copyright (c) 2021-2022 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "common/sys/rc.h"
+#include "common/types.h"
+#include "common/lang/span.h"
+#include "common/lang/vector.h"
+
+/**
+ * @brief 日志压缩算法
+ * @ingroup CLog
+ */
+enum class LogCompression : int32_t
+{
+  NONE,     ///< 不压缩
+  BUILTIN,  ///< 内置的LZ77压缩，不依赖第三方库
+  LZ4,      ///< LZ4，编译时没有找到lz4库(WITH_LZ4)时使用 BUILTIN
+};
+
+/**
+ * @brief 从配置的名字解析压缩算法
+ * @details 名字是 none、builtin 或 lz4，不区分大小写，空字符串表示 none。
+ * 没有编译lz4时，lz4 会被替换成 builtin
+ */
+RC log_compression_from_string(const char *name, LogCompression &compression);
+
+/// @brief 压缩算法的名字
+const char *log_compression_name(LogCompression compression);
+
+/**
+ * @brief 一批压缩后的日志
+ * @ingroup CLog
+ * @details 日志文件中，一批连续的日志(日志头和日志数据)压缩后作为一条模块为 COMPRESSED 的日志写入，
+ * 日志头的LSN是这批日志中最后一条日志的LSN，这样按照LSN查找日志的逻辑不需要修改。
+ * 日志数据的开头是这个结构，后面紧跟压缩后的数据。读取日志文件时会解压出原来的日志，上层看不到压缩的日志。
+ */
+struct LogCompressedHeader
+{
+  int32_t compression;  ///< 压缩算法，LogCompression
+  int32_t raw_size;     ///< 压缩前的大小
+  LSN     first_lsn;    ///< 第一条日志的LSN
+
+  static const int32_t SIZE;
+};
+
+/**
+ * @brief 日志压缩和解压
+ * @ingroup CLog
+ */
+class LogCompressor
+{
+public:
+  /// @brief 压缩后最大的大小
+  static size_t max_compressed_size(LogCompression compression, size_t raw_size);
+
+  /**
+   * @brief 压缩数据
+   * @param compression 压缩算法，不能是 NONE
+   * @param[in] src 需要压缩的数据
+   * @param[out] dst 压缩后的数据，会覆盖原来的内容
+   */
+  static RC compress(LogCompression compression, span<const char> src, vector<char> &dst);
+
+  /**
+   * @brief 解压数据
+   * @param compression 压缩算法
+   * @param[in] src 压缩后的数据
+   * @param[out] dst 解压后的数据，大小必须和压缩前的大小一致
+   */
+  static RC decompress(LogCompression compression, span<const char> src, span<char> dst);
+};
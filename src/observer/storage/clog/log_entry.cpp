@@ -42,9 +42,11 @@ LogEntry::LogEntry(LogEntry &&other)
 {
   header_ = other.header_;
   data_ = std::move(other.data_);
+  payload_ = other.payload_;  // vector 移动后数据的地址不变
 
   other.header_.lsn = 0;
   other.header_.size = 0;
+  other.payload_ = nullptr;
 }
 
 LogEntry &LogEntry::operator=(LogEntry &&other)
@@ -55,9 +57,11 @@ LogEntry &LogEntry::operator=(LogEntry &&other)
 
   header_ = other.header_;
   data_ = std::move(other.data_);
+  payload_ = other.payload_;
 
   other.header_.lsn = 0;
   other.header_.size = 0;
+  other.payload_ = nullptr;
 
   return *this;
 }
@@ -78,6 +82,22 @@ RC LogEntry::init(LSN lsn, LogModule module, vector<char> &&data)
   header_.module_id = module.index();
   header_.size = static_cast<int32_t>(data.size());
   data_ = std::move(data);
+  payload_ = data_.data();
+  return RC::SUCCESS;
+}
+
+RC LogEntry::init_view(LSN lsn, LogModule module, span<const char> data)
+{
+  if (static_cast<int64_t>(data.size()) > max_payload_size()) {
+    LOG_DEBUG("log entry size is too large. size=%d, max_payload_size=%d", data.size(), max_payload_size());
+    return RC::INVALID_ARGUMENT;
+  }
+
+  header_.lsn = lsn;
+  header_.module_id = module.index();
+  header_.size = static_cast<int32_t>(data.size());
+  data_.clear();
+  payload_ = data.data();
   return RC::SUCCESS;
 }
 
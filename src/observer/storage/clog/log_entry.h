@@ -20,6 +20,7 @@ See the Mulan PSL v2 for more details. */
 #include "common/lang/vector.h"
 #include "common/lang/string.h"
 #include "common/lang/memory.h"
+#include "common/lang/span.h"
 
 /**
  * @brief 描述一条日志头
@@ -70,8 +71,16 @@ public:
   RC init(LSN lsn, LogModule::Id module_id, vector<char> &&data);
   RC init(LSN lsn, LogModule module, vector<char> &&data);
 
+  /**
+   * @brief 使用外部的数据初始化日志，不复制数据
+   * @details 读取日志文件时使用，数据直接指向映射到内存中的文件，只在遍历日志的回调期间有效。
+   * 需要在回调之后继续使用日志时(比如交给其它线程重做)，要自己复制一份数据
+   */
+  RC init_view(LSN lsn, LogModule module, span<const char> data);
+
   const LogHeader &header() const { return header_; }
-  const char      *data() const { return data_.data(); }
+  const char      *data() const { return payload_; }
+  span<const char> payload() const { return span<const char>(payload_, header_.size); }
   int32_t          payload_size() const { return header_.size; }
   int32_t          total_size() const { return LogHeader::SIZE + header_.size; }
 
@@ -84,6 +93,7 @@ public:
   string to_string() const;
 
 private:
-  LogHeader    header_;  /// 日志头
-  vector<char> data_;    /// 日志数据
+  LogHeader    header_;              /// 日志头
+  vector<char> data_;                /// 日志数据，init_view 初始化的日志没有自己的数据
+  const char  *payload_ = nullptr;  /// 日志数据的位置，指向 data_ 或者外部的数据
 };
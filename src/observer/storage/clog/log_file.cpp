@@ -13,18 +13,100 @@ See the Mulan PSL v2 for more details. */
 //
 
 #include <fcntl.h>
+#include <limits.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "common/lang/string_view.h"
 #include "common/lang/charconv.h"
+#include "common/lang/algorithm.h"
+#include "common/lang/vector.h"
+#include "common/lang/string.h"
 #include "common/log/log.h"
 #include "storage/clog/log_file.h"
 #include "storage/clog/log_entry.h"
+#include "storage/clog/log_compressor.h"
 #include "common/io/io.h"
+#include "common/io/async_io.h"
 
 using namespace common;
 
+RC log_durability_from_string(const char *name, LogDurability &durability)
+{
+  if (is_blank(name) || 0 == strcasecmp(name, "fdatasync")) {
+    durability = LogDurability::FDATASYNC;
+  } else if (0 == strcasecmp(name, "none")) {
+    durability = LogDurability::NONE;
+  } else if (0 == strcasecmp(name, "write")) {
+    durability = LogDurability::WRITE;
+  } else if (0 == strcasecmp(name, "dsync")) {
+    durability = LogDurability::DSYNC;
+  } else {
+    LOG_WARN("unknown log durability: %s", name);
+    return RC::INVALID_ARGUMENT;
+  }
+  return RC::SUCCESS;
+}
+
+const char *log_durability_name(LogDurability durability)
+{
+  switch (durability) {
+    case LogDurability::NONE: return "none";
+    case LogDurability::WRITE: return "write";
+    case LogDurability::FDATASYNC: return "fdatasync";
+    case LogDurability::DSYNC: return "dsync";
+  }
+  return "unknown";
+}
+
+/**
+ * @brief 解压一条 COMPRESSED 日志的数据，得到原来的一批日志
+ * @details 会检查解压出来的数据是由完整的日志组成的
+ */
+static RC decompress_entries(span<const char> data, vector<char> &raw_data)
+{
+  LogCompressedHeader compressed_header;
+  if (data.size() < static_cast<size_t>(LogCompressedHeader::SIZE)) {
+    return RC::LOG_ENTRY_INVALID;
+  }
+  memcpy(&compressed_header, data.data(), LogCompressedHeader::SIZE);
+  if (compressed_header.raw_size < 0 || compressed_header.raw_size > LogEntry::max_size()) {
+    return RC::LOG_ENTRY_INVALID;
+  }
+
+  raw_data.resize(compressed_header.raw_size);
+  RC rc = LogCompressor::decompress(static_cast<LogCompression>(compressed_header.compression),
+      data.subspan(LogCompressedHeader::SIZE), span<char>(raw_data));
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  LogHeader header;
+  for (size_t pos = 0; pos < raw_data.size(); pos += LogHeader::SIZE + header.size) {
+    if (pos + LogHeader::SIZE > raw_data.size()) {
+      return RC::LOG_ENTRY_INVALID;
+    }
+    memcpy(&header, raw_data.data() + pos, LogHeader::SIZE);
+    if (header.size < 0 || pos + LogHeader::SIZE + header.size > raw_data.size()) {
+      return RC::LOG_ENTRY_INVALID;
+    }
+  }
+  return RC::SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LogFileReader
+
+LogFileReader::~LogFileReader() { (void)close(); }
+
 RC LogFileReader::open(const char *filename)
 {
+  if (fd_ >= 0) {
+    return RC::FILE_OPEN;
+  }
+
   filename_ = filename;
 
   fd_ = ::open(filename, O_RDONLY);
@@ -33,7 +115,30 @@ RC LogFileReader::open(const char *filename)
     return RC::FILE_OPEN;
   }
 
-  LOG_INFO("open file success. filename=%s, fd=%d", filename, fd_);
+  struct stat st;
+  if (fstat(fd_, &st) != 0) {
+    LOG_WARN("stat file failed. filename=%s, error=%s", filename, strerror(errno));
+    (void)close();
+    return RC::IOERR_READ;
+  }
+  size_ = st.st_size;
+
+  // 空文件不能映射
+  if (size_ > 0) {
+    void *addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (MAP_FAILED == addr) {
+      LOG_WARN("mmap file failed. filename=%s, size=%ld, error=%s", filename, size_, strerror(errno));
+      (void)close();
+      return RC::IOERR_READ;
+    }
+    data_ = static_cast<const char *>(addr);
+    (void)madvise(addr, size_, MADV_SEQUENTIAL);
+  }
+
+  load_footer();
+
+  LOG_INFO("open file success. filename=%s, fd=%d, size=%ld, index entries=%d", 
+           filename, fd_, size_, static_cast<int>(index_.size()));
   return RC::SUCCESS;
 }
 
@@ -43,44 +148,108 @@ RC LogFileReader::close()
     return RC::FILE_NOT_OPENED;
   }
 
+  if (data_ != nullptr) {
+    munmap(const_cast<char *>(data_), size_);
+    data_ = nullptr;
+  }
+  size_     = 0;
+  data_end_ = 0;
+  index_.clear();
+
   ::close(fd_);
   fd_ = -1;
   return RC::SUCCESS;
 }
 
+void LogFileReader::load_footer()
+{
+  data_end_ = size_;
+  index_.clear();
+
+  LogFileFooter footer;
+  if (size_ < static_cast<int64_t>(LogHeader::SIZE + sizeof(footer))) {
+    return;
+  }
+
+  memcpy(&footer, data_ + size_ - sizeof(footer), sizeof(footer));
+  const int64_t index_size = static_cast<int64_t>(footer.index_count) * sizeof(LogFileIndexEntry);
+  if (footer.magic != LogFileFooter::MAGIC || footer.index_count < 0 || footer.index_offset < LogHeader::SIZE ||
+      footer.index_offset + index_size + static_cast<int64_t>(sizeof(footer)) != size_) {
+    return;
+  }
+
+  LogHeader header;
+  memcpy(&header, data_ + footer.index_offset - LogHeader::SIZE, LogHeader::SIZE);
+  if (header.lsn != 0) {
+    return;
+  }
+
+  index_.resize(footer.index_count);
+  memcpy(index_.data(), data_ + footer.index_offset, index_size);
+  data_end_ = footer.index_offset - LogHeader::SIZE;
+}
+
 RC LogFileReader::iterate(function<RC(LogEntry &)> callback, LSN start_lsn /*=0*/)
 {
-  RC rc = skip_to(start_lsn);
+  if (fd_ < 0) {
+    return RC::FILE_NOT_OPENED;
+  }
+
+  int64_t offset = 0;
+  RC      rc     = skip_to(start_lsn, offset);
   if (OB_FAIL(rc)) {
     return rc;
   }
 
+  if (offset < data_end_) {
+    // 按照页对齐，提前读入后面所有的日志
+    const int64_t page_size    = getpagesize();
+    const int64_t advise_begin = offset / page_size * page_size;
+    (void)madvise(const_cast<char *>(data_) + advise_begin, data_end_ - advise_begin, MADV_WILLNEED);
+  }
+
   LogHeader header;
-  while (true) {
-    int ret = readn(fd_, reinterpret_cast<char *>(&header), LogHeader::SIZE);
-    if (0 != ret) {
-      if (-1 == ret) {
-        // EOF
-        break;
-      }
-      LOG_WARN("read file failed. filename=%s, ret = %d, error=%s", filename_.c_str(), ret, strerror(errno));
-      return RC::IOERR_READ;
+  LogEntry  entry;
+  while (offset + LogHeader::SIZE <= data_end_) {
+    memcpy(&header, data_ + offset, LogHeader::SIZE);
+
+    // 预分配的空间都是0，没有LSN为0的日志
+    if (0 == header.lsn) {
+      break;
     }
 
     if (header.size < 0 || header.size > LogEntry::max_payload_size()) {
-      LOG_WARN("invalid log entry size. filename=%s, size=%d", filename_.c_str(), header.size);
+      LOG_WARN("invalid log entry size. filename=%s, offset=%ld, size=%d", filename_.c_str(), offset, header.size);
       return RC::IOERR_READ;
     }
 
-    vector<char> data(header.size);
-    ret = readn(fd_, data.data(), header.size);
-    if (0 != ret) {
-      LOG_WARN("read file failed. filename=%s, size=%d, ret=%d, error=%s", filename_.c_str(), header.size, ret, strerror(errno));
-      return RC::IOERR_READ;
+    // 没有写完整的日志，见 LogFileWriter::find_end
+    if (offset + LogHeader::SIZE + header.size > data_end_) {
+      LOG_WARN("incomplete log entry, treat as the end of log. filename=%s, offset=%ld, lsn=%ld, size=%d",
+               filename_.c_str(), offset, header.lsn, header.size);
+      break;
     }
 
-    LogEntry entry;
-    entry.init(header.lsn, LogModule(header.module_id), std::move(data));
+    span<const char> payload(data_ + offset + LogHeader::SIZE, header.size);
+    offset += LogHeader::SIZE + header.size;
+
+    if (header.module_id == static_cast<int32_t>(LogModule::Id::COMPRESSED)) {
+      // 解压失败说明这批日志没有写完整就崩溃了，后面不会再有日志，见 LogFileWriter::find_end
+      vector<char> raw_data;
+      if (OB_FAIL(decompress_entries(payload, raw_data))) {
+        LOG_WARN("incomplete compressed log entries, treat as the end of log. filename=%s, lsn=%ld",
+                 filename_.c_str(), header.lsn);
+        break;
+      }
+
+      rc = iterate_compressed(raw_data, callback, start_lsn);
+      if (OB_FAIL(rc)) {
+        return rc;
+      }
+      continue;
+    }
+
+    entry.init_view(header.lsn, LogModule(header.module_id), payload);
     rc = callback(entry);
     if (OB_FAIL(rc)) {
       LOG_INFO("iterate log entry failed. entry=%s, rc=%s", entry.to_string().c_str(), strrc(rc));
@@ -92,53 +261,61 @@ RC LogFileReader::iterate(function<RC(LogEntry &)> callback, LSN start_lsn /*=0*
   return RC::SUCCESS;
 }
 
-RC LogFileReader::skip_to(LSN start_lsn)
+RC LogFileReader::iterate_compressed(const vector<char> &raw_data, function<RC(LogEntry &)> &callback, LSN start_lsn)
 {
-  if (fd_ < 0) {
-    return RC::FILE_NOT_OPENED;
+  LogHeader header;
+  LogEntry  entry;
+  for (size_t pos = 0; pos < raw_data.size(); pos += LogHeader::SIZE + header.size) {
+    memcpy(&header, raw_data.data() + pos, LogHeader::SIZE);
+
+    // 压缩的一批日志中可能有一部分在 start_lsn 之前
+    if (header.lsn < start_lsn) {
+      continue;
+    }
+
+    entry.init_view(
+        header.lsn, LogModule(header.module_id), span<const char>(raw_data.data() + pos + LogHeader::SIZE, header.size));
+    RC rc = callback(entry);
+    if (OB_FAIL(rc)) {
+      LOG_INFO("iterate log entry failed. entry=%s, rc=%s", entry.to_string().c_str(), strrc(rc));
+      return rc;
+    }
+    LOG_TRACE("redo log iterate entry success. entry=%s", entry.to_string().c_str());
   }
+  return RC::SUCCESS;
+}
+
+RC LogFileReader::skip_to(LSN start_lsn, int64_t &offset)
+{
+  offset = 0;
 
-  off_t pos = lseek(fd_, 0, SEEK_SET);
-  if (off_t(-1) == pos) {
-    LOG_WARN("seek file failed. seek to the beginning. filename=%s, error=%s", filename_.c_str(), strerror(errno));
-    return RC::IOERR_SEEK;
+  // 最后一个不大于 start_lsn 的索引项
+  auto iter = upper_bound(index_.begin(), index_.end(), start_lsn, 
+      [](LSN lsn, const LogFileIndexEntry &index_entry) { return lsn < index_entry.lsn; });
+  if (iter != index_.begin()) {
+    offset = prev(iter)->offset;
   }
 
   LogHeader header;
-  while (true) {
-    int ret = readn(fd_, reinterpret_cast<char *>(&header), LogHeader::SIZE);
-    if (0 != ret) {
-      if (-1 == ret) {
-        // EOF
-        break;
-      }
-      LOG_WARN("read file failed. filename=%s, ret = %d, error=%s", filename_.c_str(), ret, strerror(errno));
-      return RC::IOERR_READ;
-    }
+  while (offset + LogHeader::SIZE <= data_end_) {
+    memcpy(&header, data_ + offset, LogHeader::SIZE);
 
-    if (header.lsn >= start_lsn) {
-      off_t pos = lseek(fd_, -LogHeader::SIZE, SEEK_CUR);
-      if (off_t(-1) == pos) {
-        LOG_WARN("seek file failed. skip back log header. filename=%s, error=%s", filename_.c_str(), strerror(errno));
-        return RC::IOERR_SEEK;
-      }
+    // 到了预分配空间，日志头留给 iterate 判断
+    if (header.lsn >= start_lsn || 0 == header.lsn) {
       break;
     }
 
     if (header.size < 0 || header.size > LogEntry::max_payload_size()) {
-      LOG_WARN("invalid log entry size. filename=%s, size=%d", filename_.c_str(), header.size);
+      LOG_WARN("invalid log entry size. filename=%s, offset=%ld, size=%d", filename_.c_str(), offset, header.size);
       return RC::IOERR_READ;
     }
 
-    pos = lseek(fd_, header.size, SEEK_CUR);
-    if (off_t(-1) == pos) {
-      LOG_WARN("seek file failed. skip log entry payload. filename=%s, error=%s", filename_.c_str(), strerror(errno));
-      return RC::IOERR_SEEK;
-    }
+    offset += LogHeader::SIZE + header.size;
   }
 
   return RC::SUCCESS;
 }
+
 ////////////////////////////////////////////////////////////////////////////////
 // LogFileWriter
 LogFileWriter::~LogFileWriter()
@@ -146,22 +323,142 @@ LogFileWriter::~LogFileWriter()
   (void)this->close();
 }
 
-RC LogFileWriter::open(const char *filename, int end_lsn)
+RC LogFileWriter::open(const char *filename, int end_lsn, int64_t preallocate_size /*=0*/)
 {
   if (fd_ >= 0) {
     return RC::FILE_OPEN;
   }
 
-  filename_ = filename;
-  end_lsn_ = end_lsn;
-
-  fd_ = ::open(filename, O_WRONLY | O_APPEND | O_CREAT | O_SYNC, 0644);
+  filename_         = filename;
+  end_lsn_          = end_lsn;
+  last_lsn_         = 0;
+  offset_           = 0;
+  file_size_        = 0;
+  preallocate_size_ = max<int64_t>(preallocate_size, 0);
+  index_.clear();
+
+  // 打开时需要读取已经写入的日志。使用 pwritev 在指定位置写入，不使用 O_APPEND。O_DSYNC 时每次写入返回时已经落盘
+  int flags = O_RDWR | O_CREAT;
+  if (durability_ == LogDurability::DSYNC) {
+    flags |= O_DSYNC;
+  }
+  fd_ = ::open(filename, flags, 0644);
   if (fd_ < 0) {
     LOG_WARN("open file failed. filename=%s, error=%s", filename, strerror(errno));
     return RC::FILE_OPEN;
   }
 
-  LOG_INFO("open file success. filename=%s, fd=%d", filename, fd_);
+  struct stat st;
+  if (fstat(fd_, &st) != 0) {
+    LOG_WARN("stat file failed. filename=%s, error=%s", filename, strerror(errno));
+    (void)close();
+    return RC::IOERR_READ;
+  }
+  file_size_ = st.st_size;
+
+  RC rc = find_end();
+  if (OB_SUCC(rc) && !full()) {
+    rc = reserve(max<int64_t>(preallocate_size_ - offset_, 0));
+  }
+  if (OB_FAIL(rc)) {
+    (void)close();
+    return rc;
+  }
+
+  LOG_INFO("open file success. filename=%s, fd=%d, offset=%ld, last_lsn=%d, file size=%ld, durability=%s",
+           filename, fd_, offset_, last_lsn_, file_size_, log_durability_name(durability_));
+  return RC::SUCCESS;
+}
+
+RC LogFileWriter::find_end()
+{
+  LogHeader header;
+  while (offset_ + LogHeader::SIZE <= file_size_) {
+    ssize_t ret = ::pread(fd_, &header, LogHeader::SIZE, offset_);
+    if (ret != LogHeader::SIZE) {
+      if (ret < 0) {
+        LOG_WARN("read file failed. filename=%s, offset=%ld, error=%s", filename_.c_str(), offset_, strerror(errno));
+        return RC::IOERR_READ;
+      }
+      break;
+    }
+
+    // 预分配的空间，或者没有写完整的日志，都从这里开始覆盖
+    if (0 == header.lsn || header.lsn <= last_lsn_ || header.size < 0 || header.size > LogEntry::max_payload_size() ||
+        offset_ + LogHeader::SIZE + header.size > file_size_) {
+      break;
+    }
+
+    // 压缩的日志可能只写了一部分，不能解压的日志也从这里开始覆盖
+    if (header.module_id == static_cast<int32_t>(LogModule::Id::COMPRESSED)) {
+      vector<char> data(header.size);
+      vector<char> raw_data;
+      ret = ::pread(fd_, data.data(), header.size, offset_ + LogHeader::SIZE);
+      if (ret != header.size || OB_FAIL(decompress_entries(data, raw_data))) {
+        LOG_WARN("incomplete compressed log entries. filename=%s, offset=%ld, lsn=%ld",
+                 filename_.c_str(), offset_, header.lsn);
+        break;
+      }
+    }
+
+    add_index_entry(last_lsn_ + 1, offset_);
+    offset_ += LogHeader::SIZE + header.size;
+    last_lsn_ = static_cast<int>(header.lsn);
+  }
+  return RC::SUCCESS;
+}
+
+void LogFileWriter::add_index_entry(LSN first_lsn, int64_t offset)
+{
+  const int64_t last_offset = index_.empty() ? 0 : index_.back().offset;
+  if (offset - last_offset >= INDEX_INTERVAL) {
+    index_.push_back({first_lsn, offset});
+  }
+}
+
+bool LogFileWriter::has_footer() const
+{
+  LogFileFooter footer;
+  if (file_size_ < offset_ + LogHeader::SIZE + static_cast<int64_t>(sizeof(footer))) {
+    return false;
+  }
+
+  ssize_t ret = ::pread(fd_, &footer, sizeof(footer), file_size_ - sizeof(footer));
+  return ret == static_cast<ssize_t>(sizeof(footer)) && footer.magic == LogFileFooter::MAGIC &&
+         footer.index_offset == offset_ + LogHeader::SIZE;
+}
+
+RC LogFileWriter::write_footer()
+{
+  LogHeader header;
+  header.lsn       = 0;
+  header.size      = static_cast<int32_t>(index_.size() * sizeof(LogFileIndexEntry) + sizeof(LogFileFooter));
+  header.module_id = 0;
+
+  LogFileFooter footer;
+  footer.index_offset = offset_ + LogHeader::SIZE;
+  footer.index_count  = static_cast<int32_t>(index_.size());
+  footer.magic        = LogFileFooter::MAGIC;
+
+  iovec iovs[] = {
+      {&header, static_cast<size_t>(LogHeader::SIZE)},
+      {index_.data(), index_.size() * sizeof(LogFileIndexEntry)},
+      {&footer, sizeof(footer)},
+  };
+  RC rc = write_at(iovs, sizeof(iovs) / sizeof(iovs[0]), LogHeader::SIZE + header.size);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  // 去掉预分配但是没有用到的空间，尾部在文件的最后
+  if (ftruncate(fd_, offset_) != 0 || fdatasync(fd_) != 0) {
+    LOG_WARN("failed to truncate log file. filename=%s, size=%ld, error=%s", filename_.c_str(), offset_, strerror(errno));
+    return RC::IOERR_WRITE;
+  }
+  file_size_ = offset_;
+
+  LOG_INFO("write log file footer. filename=%s, size=%ld, index entries=%d", 
+           filename_.c_str(), offset_, footer.index_count);
   return RC::SUCCESS;
 }
 
@@ -171,15 +468,195 @@ RC LogFileWriter::close()
     return RC::FILE_NOT_OPENED;
   }
 
+  // 写满的文件不会再写入，可以写入索引。没有写满的文件重启后还会继续写，不写索引
+  if (full() && !has_footer()) {
+    RC rc = write_footer();
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to write log file footer. filename=%s, rc=%s", filename_.c_str(), strrc(rc));
+    }
+  }
+
+  // 不在每次写入时同步的级别，至少在切换文件和关闭时同步一次
+  if (durability_ == LogDurability::NONE || durability_ == LogDurability::WRITE) {
+    if (fdatasync(fd_) != 0) {
+      LOG_WARN("sync log file failed. filename=%s, error=%s", filename_.c_str(), strerror(errno));
+    }
+  }
+
   ::close(fd_);
   fd_ = -1;
   return RC::SUCCESS;
 }
 
+RC LogFileWriter::reserve(int64_t size)
+{
+  if (preallocate_size_ <= 0 || offset_ + size <= file_size_) {
+    return RC::SUCCESS;
+  }
+
+  // 不需要保留文件大小(FALLOC_FL_KEEP_SIZE)，读取日志时遇到0就停止
+  const int64_t new_size = max(offset_ + size, file_size_ + preallocate_size_);
+  int           ret      = ::fallocate(fd_, 0, file_size_, new_size - file_size_);
+  if (ret != 0) {
+    if (errno == EOPNOTSUPP || errno == ENOSYS) {
+      LOG_INFO("fallocate is not supported, disable preallocation. filename=%s", filename_.c_str());
+      preallocate_size_ = 0;
+      return RC::SUCCESS;
+    }
+    LOG_WARN("preallocate log file failed. filename=%s, size=%ld, error=%s", 
+             filename_.c_str(), new_size, strerror(errno));
+    return RC::IOERR_WRITE;
+  }
+
+  LOG_TRACE("preallocate log file. filename=%s, size=%ld -> %ld", filename_.c_str(), file_size_, new_size);
+  file_size_ = new_size;
+  return RC::SUCCESS;
+}
+
+RC LogFileWriter::write_at(const iovec *iovs, int iov_count, int64_t size)
+{
+  RC rc = reserve(size);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  /// WARNING 这里需要处理日志写一半的情况
+  /// 写失败时不移动写入位置，下次写入会覆盖写了一半的日志
+  static SyncIoEngine sync_io_engine;
+  AsyncIoEngine      *io_engine = io_engine_ != nullptr ? io_engine_ : &sync_io_engine;
+
+  AsyncIoRequest request = AsyncIoRequest::write(fd_, offset_, iovs, iov_count);
+  rc                     = io_engine->submit_and_wait(request);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("write log entries failed. filename=%s, offset=%ld, size=%ld, written=%ld, error=%s", 
+             filename_.c_str(), offset_, size, request.transferred, strerror(request.error));
+    return RC::IOERR_WRITE;
+  }
+
+  offset_ += size;
+  if (offset_ > file_size_) {
+    file_size_ = offset_;
+  }
+  return RC::SUCCESS;
+}
+
+RC LogFileWriter::write_entries(const iovec *iovs, int iov_count, int64_t size, LSN first_lsn)
+{
+  const int64_t offset = offset_;
+  if (compression_ == LogCompression::NONE || size < MIN_COMPRESS_SIZE) {
+    RC rc = write_at(iovs, iov_count, size);
+    if (OB_SUCC(rc)) {
+      raw_bytes_ += size;
+      written_bytes_ += size;
+      add_index_entry(first_lsn, offset);
+    }
+    return rc;
+  }
+
+  raw_buffer_.resize(size);
+  char *buffer = raw_buffer_.data();
+  for (int i = 0; i < iov_count; i++) {
+    memcpy(buffer, iovs[i].iov_base, iovs[i].iov_len);
+    buffer += iovs[i].iov_len;
+  }
+
+  // 按照日志的边界切分成多个批次，每个批次压缩成一条日志
+  output_buffer_.clear();
+  RC        rc              = RC::SUCCESS;
+  int64_t   batch_begin     = 0;
+  int64_t   pos             = 0;
+  LSN       batch_first_lsn = 0;
+  LSN       batch_last_lsn  = 0;
+  LogHeader header;
+  while (pos < size) {
+    memcpy(&header, raw_buffer_.data() + pos, LogHeader::SIZE);
+    const int64_t entry_size = LogHeader::SIZE + header.size;
+    if (header.size < 0 || pos + entry_size > size) {
+      LOG_WARN("invalid log entries to write. filename=%s, lsn=%ld, size=%d", filename_.c_str(), header.lsn, header.size);
+      return RC::INVALID_ARGUMENT;
+    }
+
+    if (pos > batch_begin && pos + entry_size - batch_begin > MAX_COMPRESS_BATCH_SIZE) {
+      rc = compress_batch(span<const char>(raw_buffer_.data() + batch_begin, pos - batch_begin), batch_first_lsn, batch_last_lsn);
+      if (OB_FAIL(rc)) {
+        return rc;
+      }
+      batch_begin = pos;
+    }
+
+    if (pos == batch_begin) {
+      batch_first_lsn = header.lsn;
+    }
+    batch_last_lsn = header.lsn;
+    pos += entry_size;
+  }
+
+  rc = compress_batch(span<const char>(raw_buffer_.data() + batch_begin, pos - batch_begin), batch_first_lsn, batch_last_lsn);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  iovec iov{output_buffer_.data(), output_buffer_.size()};
+  rc = write_at(&iov, 1, static_cast<int64_t>(output_buffer_.size()));
+  if (OB_SUCC(rc)) {
+    raw_bytes_ += size;
+    written_bytes_ += static_cast<int64_t>(output_buffer_.size());
+    add_index_entry(first_lsn, offset);
+  }
+  return rc;
+}
+
+RC LogFileWriter::compress_batch(span<const char> batch, LSN first_lsn, LSN last_lsn)
+{
+  if (static_cast<int64_t>(batch.size()) >= MIN_COMPRESS_SIZE) {
+    RC rc = LogCompressor::compress(compression_, batch, compress_buffer_);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to compress log entries, write them uncompressed. filename=%s, range=[%ld, %ld], rc=%s",
+               filename_.c_str(), first_lsn, last_lsn, strrc(rc));
+    }
+
+    const int64_t payload_size = LogCompressedHeader::SIZE + static_cast<int64_t>(compress_buffer_.size());
+    if (OB_SUCC(rc) && LogHeader::SIZE + payload_size < static_cast<int64_t>(batch.size())) {
+      // 使用最后一条日志的LSN，查找日志和打开文件时扫描日志的逻辑都不需要关心是否压缩
+      LogHeader header;
+      header.lsn       = last_lsn;
+      header.size      = static_cast<int32_t>(payload_size);
+      header.module_id = static_cast<int32_t>(LogModule::Id::COMPRESSED);
+
+      LogCompressedHeader compressed_header;
+      compressed_header.compression = static_cast<int32_t>(compression_);
+      compressed_header.raw_size    = static_cast<int32_t>(batch.size());
+      compressed_header.first_lsn   = first_lsn;
+
+      const char *header_data            = reinterpret_cast<const char *>(&header);
+      const char *compressed_header_data = reinterpret_cast<const char *>(&compressed_header);
+      output_buffer_.insert(output_buffer_.end(), header_data, header_data + LogHeader::SIZE);
+      output_buffer_.insert(
+          output_buffer_.end(), compressed_header_data, compressed_header_data + LogCompressedHeader::SIZE);
+      output_buffer_.insert(output_buffer_.end(), compress_buffer_.begin(), compress_buffer_.end());
+      return RC::SUCCESS;
+    }
+  }
+
+  output_buffer_.insert(output_buffer_.end(), batch.begin(), batch.end());
+  return RC::SUCCESS;
+}
+
 RC LogFileWriter::write(LogEntry &entry)
 {
+  int count = 0;
+  return write(span<LogEntry>(&entry, 1), count);
+}
+
+RC LogFileWriter::write(span<LogEntry> entries, int &count)
+{
+  count = 0;
+  if (entries.empty()) {
+    return RC::SUCCESS;
+  }
+
   // 一个日志文件写的日志条数是有限制的
-  if (entry.lsn() > end_lsn_) {
+  if (entries.front().lsn() > end_lsn_) {
     return RC::LOG_FILE_FULL;
   }
 
@@ -187,30 +664,96 @@ RC LogFileWriter::write(LogEntry &entry)
     return RC::FILE_NOT_OPENED;
   }
 
-  if (entry.lsn() <= last_lsn_) {
+  if (entries.front().lsn() <= last_lsn_) {
     LOG_WARN("write log entry failed. lsn is too small. filename=%s, last_lsn=%ld, entry=%s", 
-             filename_.c_str(), last_lsn_, entry.to_string().c_str());
+             filename_.c_str(), last_lsn_, entries.front().to_string().c_str());
     return RC::INVALID_ARGUMENT;
   }
 
-  /// WARNING 这里需要处理日志写一半的情况
-  /// 日志只写成功一部分到文件中非常难处理
-  int ret = writen(fd_, reinterpret_cast<const char *>(&entry.header()), LogHeader::SIZE);
-  if (0 != ret) {
-    LOG_WARN("write log entry header failed. filename=%s, ret = %d, error=%s, entry=%s", 
-             filename_.c_str(), ret, strerror(errno), entry.to_string().c_str());
-    return RC::IOERR_WRITE;
+  size_t write_num = 0;
+  while (write_num < entries.size() && entries[write_num].lsn() <= end_lsn_) {
+    write_num++;
   }
 
-  ret = writen(fd_, entry.data(), entry.payload_size());
-  if (0 != ret) {
-    LOG_WARN("write log entry payload failed. filename=%s, ret = %d, error=%s, entry=%s", 
-             filename_.c_str(), ret, strerror(errno), entry.to_string().c_str());
-    return RC::IOERR_WRITE;
+  // 追加写必须按顺序执行，一次只提交一个请求
+  const size_t  max_entries_per_write = IOV_MAX / 2;
+  vector<iovec> iovs;
+  iovs.reserve(min(write_num, max_entries_per_write) * 2);
+  for (size_t begin = 0; begin < write_num; begin += max_entries_per_write) {
+    const size_t end = min(write_num, begin + max_entries_per_write);
+
+    iovs.clear();
+    int64_t size = 0;
+    for (size_t i = begin; i < end; i++) {
+      LogEntry &entry = entries[i];
+      iovs.push_back({const_cast<LogHeader *>(&entry.header()), static_cast<size_t>(LogHeader::SIZE)});
+      iovs.push_back({const_cast<char *>(entry.data()), static_cast<size_t>(entry.payload_size())});
+      size += entry.total_size();
+    }
+
+    RC rc = write_entries(iovs.data(), static_cast<int>(iovs.size()), size, entries[begin].lsn());
+    if (OB_FAIL(rc)) {
+      LOG_WARN("write log entries failed. filename=%s, first entry=%s, entry number=%d", 
+               filename_.c_str(), entries[begin].to_string().c_str(), static_cast<int>(end - begin));
+      return rc;
+    }
+  }
+
+  RC rc = sync(entries[write_num - 1].lsn());
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  count = static_cast<int>(write_num);
+  LOG_TRACE("write log entries success. filename=%s, count=%d, last lsn=%ld", filename_.c_str(), count, last_lsn_);
+  return write_num < entries.size() ? RC::LOG_FILE_FULL : RC::SUCCESS;
+}
+
+RC LogFileWriter::write(span<const iovec> data, LSN first_lsn, LSN last_lsn)
+{
+  if (first_lsn > end_lsn_) {
+    return RC::LOG_FILE_FULL;
+  }
+
+  if (fd_ < 0) {
+    return RC::FILE_NOT_OPENED;
+  }
+
+  if (first_lsn <= last_lsn_ || last_lsn < first_lsn || last_lsn > end_lsn_) {
+    LOG_WARN("write log entries failed. invalid lsn range. filename=%s, last_lsn=%ld, end_lsn=%ld, range=[%ld, %ld]",
+             filename_.c_str(), last_lsn_, end_lsn_, first_lsn, last_lsn);
+    return RC::INVALID_ARGUMENT;
   }
 
-  last_lsn_ = entry.lsn();
-  LOG_TRACE("write log entry success. filename=%s, entry=%s", filename_.c_str(), entry.to_string().c_str());
+  int64_t size = 0;
+  for (const iovec &iov : data) {
+    size += static_cast<int64_t>(iov.iov_len);
+  }
+
+  RC rc = write_entries(data.data(), static_cast<int>(data.size()), size, first_lsn);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("write log entries failed. filename=%s, range=[%ld, %ld]", filename_.c_str(), first_lsn, last_lsn);
+    return rc;
+  }
+
+  rc = sync(last_lsn);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  LOG_TRACE("write log entries success. filename=%s, range=[%ld, %ld]", filename_.c_str(), first_lsn, last_lsn);
+  return RC::SUCCESS;
+}
+
+RC LogFileWriter::sync(LSN last_lsn)
+{
+  // O_DSYNC 的写入返回时已经落盘，NONE 和 WRITE 不同步
+  if (durability_ == LogDurability::FDATASYNC && fdatasync(fd_) != 0) {
+    LOG_WARN("sync log file failed. filename=%s, error=%s", filename_.c_str(), strerror(errno));
+    return RC::IOERR_SYNC;
+  }
+
+  last_lsn_ = last_lsn;
   return RC::SUCCESS;
 }
 
@@ -296,6 +839,7 @@ RC LogFileManager::get_lsn_from_filename(const string &filename, LSN &lsn)
 
 RC LogFileManager::list_files(vector<string> &files, LSN start_lsn)
 {
+  lock_guard<mutex> guard(lock_);
   files.clear();
 
   // 这里的代码是AI自动生成的
@@ -311,7 +855,9 @@ RC LogFileManager::list_files(vector<string> &files, LSN start_lsn)
 
 RC LogFileManager::last_file(LogFileWriter &file_writer)
 {
+  unique_lock<mutex> guard(lock_);
   if (log_files_.empty()) {
+    guard.unlock();
     return next_file(file_writer);
   }
 
@@ -319,11 +865,13 @@ RC LogFileManager::last_file(LogFileWriter &file_writer)
 
   auto last_file_item = log_files_.rbegin();
   return file_writer.open(last_file_item->second.c_str(), 
-                          last_file_item->first + max_entry_number_per_file_ - 1);
+                          last_file_item->first + max_entry_number_per_file_ - 1,
+                          max_entry_number_per_file_ * PREALLOCATE_ENTRY_SIZE);
 }
 
 RC LogFileManager::next_file(LogFileWriter &file_writer)
 {
+  lock_guard<mutex> guard(lock_);
   file_writer.close();
 
   LSN lsn = 0;
@@ -335,5 +883,31 @@ RC LogFileManager::next_file(LogFileWriter &file_writer)
   filesystem::path file_path = directory_ / filename;
   log_files_.emplace(lsn, file_path);
 
-  return file_writer.open(file_path.c_str(), lsn + max_entry_number_per_file_ - 1);
+  return file_writer.open(
+      file_path.c_str(), lsn + max_entry_number_per_file_ - 1, max_entry_number_per_file_ * PREALLOCATE_ENTRY_SIZE);
+}
+
+RC LogFileManager::recycle_files(LSN lsn, int &removed_count)
+{
+  removed_count = 0;
+
+  lock_guard<mutex> guard(lock_);
+  while (log_files_.size() > 1) {
+    auto iter = log_files_.begin();
+    if (iter->first + max_entry_number_per_file_ > lsn) {
+      break;
+    }
+
+    error_code ec;
+    filesystem::remove(iter->second, ec);
+    if (ec) {
+      LOG_WARN("failed to remove log file. file=%s, error=%s", iter->second.c_str(), ec.message().c_str());
+      return RC::FILE_REMOVE;
+    }
+
+    LOG_INFO("log file recycled. file=%s, lsn=%ld", iter->second.c_str(), lsn);
+    log_files_.erase(iter);
+    removed_count++;
+  }
+  return RC::SUCCESS;
 }
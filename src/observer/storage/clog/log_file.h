@@ -14,43 +14,122 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include <sys/uio.h>
+
 #include "common/sys/rc.h"
 #include "common/types.h"
 #include "common/lang/map.h"
+#include "common/lang/mutex.h"
 #include "common/lang/functional.h"
 #include "common/lang/filesystem.h"
 #include "common/lang/fstream.h"
 #include "common/lang/string.h"
+#include "common/lang/span.h"
+#include "common/lang/vector.h"
+#include "storage/clog/log_compressor.h"
 
 class LogEntry;
 
+namespace common {
+class AsyncIoEngine;
+}
+
+/**
+ * @brief 日志的持久化级别
+ * @ingroup CLog
+ * @details 决定日志写入文件后是否同步到磁盘，以及提交事务时是否等待日志写入。
+ * 越往后越可靠，也越慢。NONE 和 WRITE 在操作系统崩溃或掉电时可能丢失已经提交的事务，
+ * 同时数据页可能比日志先落盘，只适合测试或者可以容忍丢数据的场景。
+ */
+enum class LogDurability
+{
+  NONE,       ///< 提交时不等待日志，由后台线程写入文件，不同步到磁盘
+  WRITE,      ///< 提交时等待日志写入操作系统的 page cache，不同步到磁盘。进程崩溃不会丢失日志
+  FDATASYNC,  ///< 每批日志写入后执行一次 fdatasync，默认值
+  DSYNC,      ///< 日志文件以 O_DSYNC 方式打开，每次写入返回时已经落盘，不再单独同步
+};
+
+/**
+ * @brief 从配置的名字解析持久化级别
+ * @details 名字是 none、write、fdatasync 或 dsync，不区分大小写，空字符串表示默认值 fdatasync
+ */
+RC log_durability_from_string(const char *name, LogDurability &durability);
+
+/// @brief 持久化级别的名字
+const char *log_durability_name(LogDurability durability);
+
+/**
+ * @brief 日志文件稀疏索引中的一项
+ * @ingroup CLog
+ * @details 文件中 offset 之前的日志，LSN都小于 lsn。查找某个LSN时从不大于它的最后一个索引项开始扫描
+ */
+struct LogFileIndexEntry
+{
+  LSN     lsn;
+  int64_t offset;
+};
+
+/**
+ * @brief 日志文件的尾部
+ * @ingroup CLog
+ * @details 日志文件写满关闭时，在最后一条日志后面写入一个LSN为0的日志头(读取日志时遇到它就结束)，
+ * 然后是稀疏索引 LogFileIndexEntry 数组，最后是这个结构，并把文件截断到这里。
+ * 没有写满的文件，或者写满后还没有来得及写尾部就崩溃的文件，没有索引，读取时从头扫描。
+ */
+struct LogFileFooter
+{
+  int64_t  index_offset;  ///< 索引在文件中的位置
+  int32_t  index_count;   ///< 索引项的个数
+  uint32_t magic;         ///< 固定为 MAGIC，用来识别尾部
+
+  static constexpr uint32_t MAGIC = 0x4C4F4758;  // "LOGX"
+};
+
 /**
- * @brief 负责处理一个日志文件，包括读取和写入
+ * @brief 负责读取一个日志文件
  * @ingroup CLog
- * @details 日志文件中的日志是按照LSN从小到大排列的
+ * @details 日志文件中的日志是按照LSN从小到大排列的。
+ * 整个文件映射到内存中(mmap)并提示内核顺序读取，遍历日志时不复制日志数据，
+ * 交给回调的日志直接指向映射的内存，见 LogEntry::init_view。
  */
 class LogFileReader
 {
 public:
-  LogFileReader()  = default;
-  ~LogFileReader() = default;
+  LogFileReader() = default;
+  ~LogFileReader();
 
   RC open(const char *filename);
   RC close();
 
+  /**
+   * @brief 遍历文件中不小于 start_lsn 的日志
+   * @details 回调拿到的日志数据只在回调期间有效
+   */
   RC iterate(function<RC(LogEntry &)> callback, LSN start_lsn = 0);
 
 private:
+  /// @brief 读取文件尾部的稀疏索引，没有尾部时日志一直到文件末尾
+  void load_footer();
+
   /**
-   * @brief 跳到第一条不小于start_lsn的日志
-   *
+   * @brief 找到第一条不小于start_lsn的日志
+   * @details 有索引时先在索引中二分查找，再从找到的位置扫描
    * @param start_lsn 期望开始的第一条日志的LSN
+   * @param[out] offset 这条日志在文件中的位置
    */
-  RC skip_to(LSN start_lsn);
+  RC skip_to(LSN start_lsn, int64_t &offset);
+
+  /// @brief 遍历一条 COMPRESSED 日志解压出来的日志，对其中不小于 start_lsn 的日志调用 callback
+  RC iterate_compressed(const vector<char> &raw_data, function<RC(LogEntry &)> &callback, LSN start_lsn);
 
 private:
   int    fd_ = -1;
   string filename_;
+
+  const char               *data_     = nullptr;  /// 映射到内存中的文件
+  int64_t                   size_     = 0;        /// 文件的大小
+  int64_t                   data_end_ = 0;        /// 日志数据的结束位置，有尾部时是尾部的开始位置
+  vector<LogFileIndexEntry> index_;               /// 文件尾部的稀疏索引
 };
 
 /**
@@ -65,17 +144,66 @@ public:
 
   /**
    * @brief 打开一个日志文件
+   * @details 文件已经存在时，从头扫描找到最后一条完整的日志，后续的日志紧接着它写入。
+   * 预分配的空间都是0，遇到LSN为0的日志头就认为到了日志的末尾。
    * @param filename 日志文件名
    * @param end_lsn 当前日志文件允许的最大LSN（包含）
+   * @param preallocate_size 文件预分配的字节数，0表示不预分配。空间不够时每次再扩展这么多
    */
-  RC open(const char *filename, int end_lsn);
+  RC open(const char *filename, int end_lsn, int64_t preallocate_size = 0);
 
-  /// @brief 关闭当前文件
+  /**
+   * @brief 关闭当前文件
+   * @details 写满的文件会在最后写入稀疏索引，并去掉没有用到的预分配空间，见 LogFileFooter
+   */
   RC close();
 
-  /// @brief 写入一条日志
+  /// @brief 写入一条日志，返回时日志已经按照持久化级别写入
   RC write(LogEntry &entry);
 
+  /**
+   * @brief 写入一批日志，返回时写入的日志已经按照持久化级别写入
+   * @details 所有日志使用一次 pwritev 写入文件(超过 IOV_MAX 时分成多次)，然后按照持久化级别同步一次。
+   * 超过当前文件允许的最大LSN的日志不会写入，这时返回 LOG_FILE_FULL。
+   * @param entries 按照LSN从小到大排列的日志
+   * @param[out] count 写入了多少条日志
+   */
+  RC write(span<LogEntry> entries, int &count);
+
+  /**
+   * @brief 写入一段已经序列化好的日志，返回时日志已经按照持久化级别写入
+   * @details data 中是按照LSN顺序排列的完整日志(日志头紧跟日志数据)，与文件中的格式相同，
+   * 可能分成多段，比如环形缓冲区回绕时。所有数据使用一次 pwritev 写入，然后按照持久化级别同步一次。
+   * @param data      日志数据
+   * @param first_lsn 第一条日志的LSN
+   * @param last_lsn  最后一条日志的LSN，不能超过当前文件允许的最大LSN
+   */
+  RC write(span<const iovec> data, LSN first_lsn, LSN last_lsn);
+
+  /**
+   * @brief 设置写文件使用的IO引擎
+   * @details 没有设置时，在当前线程中同步写入
+   */
+  void set_io_engine(common::AsyncIoEngine *io_engine) { io_engine_ = io_engine; }
+
+  /**
+   * @brief 设置持久化级别
+   * @details 需要在打开文件之前设置，DSYNC 会影响打开文件的方式
+   */
+  void set_durability(LogDurability durability) { durability_ = durability; }
+
+  /**
+   * @brief 设置日志的压缩算法
+   * @details 每次写入的一批日志按照原来的格式拼接后压缩，作为一条 COMPRESSED 日志写入，见 LogCompressedHeader。
+   * 太小的批次或者压缩后没有变小的数据按照原样写入，所以同一个文件中可以同时存在压缩和没有压缩的日志
+   */
+  void set_compression(LogCompression compression) { compression_ = compression; }
+
+  /// @brief 累计写入的日志字节数(压缩前)
+  int64_t raw_bytes() const { return raw_bytes_; }
+  /// @brief 累计实际写入文件的字节数(压缩后)
+  int64_t written_bytes() const { return written_bytes_; }
+
   /**
    * @brief 当前文件是否已经打开
    */
@@ -90,11 +218,75 @@ public:
 
   const char *filename() const { return filename_.c_str(); }
 
+  /// @brief 当前文件允许写入的最大LSN
+  LSN end_lsn() const { return end_lsn_; }
+
+private:
+  /// @brief 从头扫描已经存在的日志，找到写入的位置和最后一条日志的LSN，同时重建稀疏索引
+  RC find_end();
+
+  /**
+   * @brief 距离上一个索引项足够远时增加一个索引项
+   * @param first_lsn 从 offset 开始的第一条日志的LSN，offset 之前的日志LSN都比它小
+   */
+  void add_index_entry(LSN first_lsn, int64_t offset);
+
+  /// @brief 文件写满后写入索引和尾部，见 LogFileFooter
+  RC write_footer();
+
+  /// @brief 文件是否已经有尾部，重新打开写满的文件时不需要再写
+  bool has_footer() const;
+
+  /**
+   * @brief 保证文件有足够的空间写入 size 字节
+   * @details 使用 fallocate 预先分配空间，写日志时就不需要分配磁盘块和修改文件大小。
+   * 文件系统不支持 fallocate 时不再预分配
+   */
+  RC reserve(int64_t size);
+
+  /// @brief 在当前位置写入一段日志
+  RC write_at(const iovec *iovs, int iov_count, int64_t size);
+
+  /**
+   * @brief 写入一段完整的日志，需要时先压缩
+   * @details 压缩时把数据拼接到一起，按照日志的边界切分成不超过 MAX_COMPRESS_BATCH_SIZE 的批次分别压缩
+   */
+  RC write_entries(const iovec *iovs, int iov_count, int64_t size, LSN first_lsn);
+
+  /// @brief 压缩一批日志并追加到 output_buffer_，压缩没有效果时追加原始数据
+  RC compress_batch(span<const char> batch, LSN first_lsn, LSN last_lsn);
+
+  /// @brief 小于这个大小的一批日志不压缩
+  static constexpr int64_t MIN_COMPRESS_SIZE = 256;
+  /// @brief 每条压缩日志最多包含的原始数据大小。单条日志超过这个大小时单独压缩
+  static constexpr int64_t MAX_COMPRESS_BATCH_SIZE = 1024 * 1024;
+  /// @brief 稀疏索引两项之间至少间隔的字节数
+  static constexpr int64_t INDEX_INTERVAL = 16 * 1024;
+
+  /// @brief 写入后按照持久化级别刷盘，并更新最后一条日志的LSN
+  RC sync(LSN last_lsn);
+
 private:
   string filename_;       /// 日志文件名
   int    fd_       = -1;  /// 日志文件描述符
   int    last_lsn_ = 0;   /// 写入的最后一条日志LSN
   int    end_lsn_  = 0;   /// 当前日志文件中允许写入的最大的LSN，包括这条日志
+
+  int64_t offset_           = 0;  /// 下一条日志写入的位置
+  int64_t file_size_        = 0;  /// 文件当前的大小，包括预分配的空间
+  int64_t preallocate_size_ = 0;  /// 每次预分配的字节数，0表示不预分配
+
+  LogDurability          durability_ = LogDurability::FDATASYNC;  /// 持久化级别
+  common::AsyncIoEngine *io_engine_  = nullptr;                   /// 写文件使用的IO引擎
+
+  LogCompression compression_   = LogCompression::NONE;  /// 日志压缩算法
+  int64_t        raw_bytes_     = 0;                     /// 累计写入的日志字节数(压缩前)
+  int64_t        written_bytes_ = 0;                     /// 累计写入文件的字节数(压缩后)
+  vector<char>   raw_buffer_;                            /// 压缩时拼接日志使用的缓冲区
+  vector<char>   compress_buffer_;                       /// 一批日志压缩后的数据
+  vector<char>   output_buffer_;                         /// 最终写入文件的数据
+
+  vector<LogFileIndexEntry> index_;  /// 稀疏索引，文件写满关闭时写入文件尾部
 };
 
 /**
@@ -102,6 +294,7 @@ private:
  * @ingroup CLog
  * @details 日志文件都在某个目录下，使用固定的前缀加上日志文件的第一个LSN作为文件名。
  * 每个日志文件没有最大字节数要求，但是以固定条数的日志为一个文件，这样方便查找。
+ * 新的日志文件会按照条数估算大小预先分配空间，见 PREALLOCATE_ENTRY_SIZE。
  */
 class LogFileManager
 {
@@ -137,6 +330,14 @@ public:
    */
   RC next_file(LogFileWriter &file_writer);
 
+  /**
+   * @brief 回收不再需要的日志文件
+   * @details 删除所有日志都小于lsn的日志文件。最后一个日志文件可能正在写入，总是会保留。
+   * @param lsn 重启时开始重做的LSN，通常是检查点记录的最小恢复LSN
+   * @param[out] removed_count 删除的文件个数
+   */
+  RC recycle_files(LSN lsn, int &removed_count);
+
 private:
   /**
    * @brief 从文件名称中获取LSN
@@ -144,6 +345,9 @@ private:
    */
   static RC get_lsn_from_filename(const string &filename, LSN &lsn);
 
+  /// @brief 预分配日志文件时估算的每条日志的平均大小
+  static constexpr int64_t PREALLOCATE_ENTRY_SIZE = 256;
+
 private:
   static constexpr const char *file_prefix_ = "clog_";
   static constexpr const char *file_suffix_ = ".log";
@@ -151,5 +355,6 @@ private:
   filesystem::path directory_;                  /// 日志文件存放的目录
   int              max_entry_number_per_file_;  /// 一个文件最大允许存放多少条日志
 
+  mutex                      lock_;       /// 保护 log_files_，检查点线程回收文件时日志线程可能正在创建文件
   map<LSN, filesystem::path> log_files_;  /// 日志文件名和第一个LSN的映射
 };
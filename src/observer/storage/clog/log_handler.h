@@ -20,6 +20,7 @@ See the Mulan PSL v2 for more details. */
 #include "common/lang/memory.h"
 #include "common/lang/span.h"
 #include "common/lang/vector.h"
+#include "storage/clog/log_file.h"
 #include "storage/clog/log_module.h"
 
 /**
@@ -29,6 +30,10 @@ See the Mulan PSL v2 for more details. */
 class LogReplayer;
 class LogEntry;
 
+namespace common {
+class AsyncIoEngine;
+}
+
 /**
  * @brief 对外提供服务的CLog模块
  * @ingroup CLog
@@ -96,12 +101,45 @@ public:
 
   virtual LSN current_lsn() const = 0;
 
+  /**
+   * @brief 回收不再需要的日志
+   * @details 检查点完成后调用，小于lsn的日志在重启时不会再重做，可以删除。
+   * 不写文件的日志模块可以忽略
+   * @param lsn 重启时开始重做的LSN
+   */
+  virtual RC recycle(LSN lsn) { return RC::SUCCESS; }
+
+  /**
+   * @brief 设置写日志文件使用的IO引擎
+   * @details 通常与 buffer pool 共享同一个引擎。不写文件的日志模块可以忽略
+   */
+  virtual void set_io_engine(shared_ptr<common::AsyncIoEngine> io_engine) {}
+
+  /**
+   * @brief 设置日志的持久化级别
+   * @details 需要在 start 之前调用。不写文件的日志模块可以忽略
+   */
+  virtual void set_durability(LogDurability durability) {}
+
+  /**
+   * @brief 设置写入日志文件时使用的压缩算法
+   * @details 需要在 start 之前调用。不写文件的日志模块可以忽略
+   */
+  virtual void set_compression(LogCompression compression) {}
+
+  /**
+   * @brief 提交事务时等待日志
+   * @details 与 wait_lsn 不同，是否等待由持久化级别决定。wait_lsn 总是等待日志写入文件，
+   * 刷数据页之前需要用它保证先写日志
+   */
+  virtual RC wait_commit_lsn(LSN lsn) { return wait_lsn(lsn); }
+
   static RC create(const char *name, LogHandler *&handler);
 
 private:
   /**
    * @brief 写入一条日志
-   * @details 子类应该重现实现这个函数
+   * @details 子类应该重现实现这个函数。日志数据只在调用期间有效，需要的话子类自己复制一份
    */
-  virtual RC _append(LSN &lsn, LogModule module, vector<char> &&data) = 0;
+  virtual RC _append(LSN &lsn, LogModule module, span<const char> data) = 0;
 };
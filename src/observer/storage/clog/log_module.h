@@ -28,7 +28,8 @@ public:
     BUFFER_POOL,     /// 缓冲池
     BPLUS_TREE,      /// B+树
     RECORD_MANAGER,  /// 记录管理
-    TRANSACTION      /// 事务
+    TRANSACTION,     /// 事务
+    COMPRESSED       /// 一批压缩后的日志，只在日志文件中出现，读取时会解压成原来的日志
   };
 
 public:
@@ -45,6 +46,7 @@ public:
       case Id::BPLUS_TREE: return "BPLUS_TREE";
       case Id::RECORD_MANAGER: return "RECORD_MANAGER";
       case Id::TRANSACTION: return "TRANSACTION";
+      case Id::COMPRESSED: return "COMPRESSED";
       default: return "UNKNOWN";
     }
   }
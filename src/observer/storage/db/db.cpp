@@ -17,10 +17,15 @@ See the Mulan PSL v2 for more details. */
 #include <fcntl.h>
 #include <sys/stat.h>
 
+#include "common/conf/ini.h"
+#include "common/io/async_io.h"
+#include "common/lang/chrono.h"
 #include "common/lang/string.h"
 #include "common/log/log.h"
 #include "common/os/path.h"
 #include "common/global_context.h"
+#include "common/ini_setting.h"
+#include "common/thread/thread_util.h"
 #include "storage/common/meta_util.h"
 #include "storage/table/table.h"
 #include "storage/table/table_meta.h"
@@ -32,6 +37,14 @@ using namespace common;
 
 Db::~Db()
 {
+  stop_purger();
+  stop_checkpointer();
+
+  if (buffer_pool_manager_) {
+    // 后台刷脏线程会访问表的 buffer pool，需要在关闭表之前停掉
+    buffer_pool_manager_->stop_page_cleaner();
+  }
+
   for (auto &iter : opened_tables_) {
     delete iter.second;
   }
@@ -67,8 +80,36 @@ RC Db::init(const char *name, const char *dbpath, const char *trx_kit_name, cons
 
   trx_kit_.reset(trx_kit);
 
-  buffer_pool_manager_ = make_unique<BufferPoolManager>();
-  auto dblwr_buffer    = make_unique<DiskDoubleWriteBuffer>(*buffer_pool_manager_);
+  string eviction_policy =
+      get_properties()->get(BUFFER_POOL_EVICTION_POLICY, BUFFER_POOL_EVICTION_POLICY_DEFAULT, STORAGE);
+  int huge_page  = 0;
+  int numa_aware = 0;
+  str_to_val(get_properties()->get(BUFFER_POOL_HUGE_PAGE, BUFFER_POOL_HUGE_PAGE_DEFAULT, STORAGE), huge_page);
+  str_to_val(get_properties()->get(BUFFER_POOL_NUMA_AWARE, BUFFER_POOL_NUMA_AWARE_DEFAULT, STORAGE), numa_aware);
+  buffer_pool_manager_ = make_unique<BufferPoolManager>(
+      0 /*memory_size*/, 0 /*partition_num*/, eviction_policy.c_str(), huge_page != 0, numa_aware != 0);
+
+  // buffer pool、double write buffer 和日志共享同一个IO引擎
+  string io_engine_name = get_properties()->get(IO_ENGINE, IO_ENGINE_DEFAULT, STORAGE);
+  shared_ptr<AsyncIoEngine> io_engine = AsyncIoEngine::create(io_engine_name.c_str());
+  if (io_engine == nullptr) {
+    LOG_ERROR("Failed to create io engine: %s", io_engine_name.c_str());
+    return RC::INVALID_ARGUMENT;
+  }
+  LOG_INFO("use io engine %s", io_engine->name());
+  buffer_pool_manager_->set_io_engine(io_engine);
+
+  int dblwr_pages       = 0;
+  int dblwr_interval_ms = 0;
+  str_to_val(get_properties()->get(DOUBLE_WRITE_BUFFER_PAGES, DOUBLE_WRITE_BUFFER_PAGES_DEFAULT, STORAGE), dblwr_pages);
+  str_to_val(get_properties()->get(
+                 DOUBLE_WRITE_BUFFER_FLUSH_INTERVAL_MS, DOUBLE_WRITE_BUFFER_FLUSH_INTERVAL_MS_DEFAULT, STORAGE),
+      dblwr_interval_ms);
+  if (dblwr_pages <= 0 || dblwr_interval_ms <= 0) {
+    LOG_ERROR("invalid double write buffer config. pages=%d, interval=%dms", dblwr_pages, dblwr_interval_ms);
+    return RC::INVALID_ARGUMENT;
+  }
+  auto dblwr_buffer = make_unique<DiskDoubleWriteBuffer>(*buffer_pool_manager_, dblwr_pages, dblwr_interval_ms);
 
   const char      *double_write_buffer_filename  = "dblwr.db";
   filesystem::path double_write_buffer_file_path = filesystem::path(dbpath) / double_write_buffer_filename;
@@ -93,6 +134,27 @@ RC Db::init(const char *name, const char *dbpath, const char *trx_kit_name, cons
     return rc;
   }
   log_handler_.reset(tmp_log_handler);
+  log_handler_->set_io_engine(io_engine);
+
+  LogDurability durability = LogDurability::FDATASYNC;
+  string durability_name = get_properties()->get(LOG_DURABILITY, LOG_DURABILITY_DEFAULT, STORAGE);
+  rc = log_durability_from_string(durability_name.c_str(), durability);
+  if (OB_FAIL(rc)) {
+    LOG_ERROR("invalid log durability: %s", durability_name.c_str());
+    return rc;
+  }
+  LOG_INFO("use log durability %s", log_durability_name(durability));
+  log_handler_->set_durability(durability);
+
+  LogCompression compression = LogCompression::NONE;
+  string compression_name = get_properties()->get(LOG_COMPRESSION, LOG_COMPRESSION_DEFAULT, STORAGE);
+  rc = log_compression_from_string(compression_name.c_str(), compression);
+  if (OB_FAIL(rc)) {
+    LOG_ERROR("invalid log compression: %s", compression_name.c_str());
+    return rc;
+  }
+  LOG_INFO("use log compression %s", log_compression_name(compression));
+  log_handler_->set_compression(compression);
 
   rc = log_handler_->init(clog_path.c_str());
   if (OB_FAIL(rc)) {
@@ -131,6 +193,24 @@ RC Db::init(const char *name, const char *dbpath, const char *trx_kit_name, cons
     return rc;
   }
 
+  rc = init_page_cleaner();
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to init page cleaner. dbpath=%s, rc=%s", dbpath, strrc(rc));
+    return rc;
+  }
+
+  rc = init_checkpointer();
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to init checkpointer. dbpath=%s, rc=%s", dbpath, strrc(rc));
+    return rc;
+  }
+
+  rc = init_purger();
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to init purger. dbpath=%s, rc=%s", dbpath, strrc(rc));
+    return rc;
+  }
+
   return rc;
 }
 
@@ -228,7 +308,13 @@ void Db::all_tables(vector<string> &table_names) const
 
 RC Db::sync()
 {
-  RC rc = RC::SUCCESS;
+  // 先把提交的事务回写到记录上，这些修改也会随着表一起刷到磁盘
+  RC rc = trx_kit_->cleanup();
+  if (OB_FAIL(rc)) {
+    LOG_ERROR("Failed to cleanup committed trxes. db=%s, rc=%s", name_.c_str(), strrc(rc));
+    return rc;
+  }
+
   // 调用所有表的sync函数刷新数据到磁盘
   for (const auto &table_pair : opened_tables_) {
     Table *table = table_pair.second;
@@ -255,16 +341,60 @@ RC Db::sync()
     return rc;
   }
 
-  check_point_lsn_ = current_lsn;
-  rc               = flush_meta();
+  // 所有的页面都已经刷到磁盘上，检查点会直接推进到当前LSN之后
+  rc = checkpoint();
   if (OB_FAIL(rc)) {
-    LOG_ERROR("Failed to flush meta. db=%s, rc=%d:%s", name_.c_str(), rc, strrc(rc));
+    LOG_ERROR("Failed to do checkpoint. db=%s, rc=%d:%s", name_.c_str(), rc, strrc(rc));
     return rc;
   }
   LOG_INFO("Successfully sync db. db=%s", name_.c_str());
   return rc;
 }
 
+RC Db::checkpoint()
+{
+  lock_guard<mutex> guard(checkpoint_lock_);
+
+  // 先拿到当前的LSN再扫描页帧，扫描期间产生的日志一定比它大
+  const LSN current_lsn = log_handler_->current_lsn();
+  LSN       recovery_lsn = buffer_pool_manager_->get_frame_manager().min_recovery_lsn(current_lsn + 1);
+  // 还没有结束，或者提交后还没有回写记录的事务，重启时需要重做它们的日志
+  recovery_lsn = trx_kit_->min_recovery_lsn(recovery_lsn);
+
+  // 扫描之前刷出去的页面可能还在 double write buffer 中，等它们真正落盘之后才能推进检查点
+  auto dblwr_buffer = static_cast<DiskDoubleWriteBuffer *>(buffer_pool_manager_->get_dblwr_buffer());
+  RC   rc           = dblwr_buffer->flush_page();
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to flush double write buffer. db=%s, rc=%s", name_.c_str(), strrc(rc));
+    return rc;
+  }
+
+  // 修改了页面但是还没有写日志的脏页会给出一个比较小的恢复LSN，这时保留原来的检查点即可
+  if (recovery_lsn <= check_point_lsn_) {
+    LOG_DEBUG("checkpoint is not advanced. db=%s, check_point_lsn=%ld, recovery_lsn=%ld",
+              name_.c_str(), check_point_lsn_, recovery_lsn);
+    return RC::SUCCESS;
+  }
+
+  const LSN old_check_point_lsn = check_point_lsn_;
+  check_point_lsn_              = recovery_lsn;
+  rc                            = flush_meta();
+  if (OB_FAIL(rc)) {
+    check_point_lsn_ = old_check_point_lsn;
+    LOG_WARN("failed to flush meta. db=%s, rc=%s", name_.c_str(), strrc(rc));
+    return rc;
+  }
+
+  // 日志文件删除失败不影响检查点，下次检查点还会再尝试
+  rc = log_handler_->recycle(check_point_lsn_);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to recycle logs. db=%s, lsn=%ld, rc=%s", name_.c_str(), check_point_lsn_, strrc(rc));
+  }
+
+  LOG_INFO("checkpoint done. db=%s, check_point_lsn=%ld, current_lsn=%ld", name_.c_str(), check_point_lsn_, current_lsn);
+  return RC::SUCCESS;
+}
+
 RC Db::recover()
 {
   LOG_TRACE("db recover begin. check_point_lsn=%d", check_point_lsn_);
@@ -275,8 +405,15 @@ RC Db::recover()
     return RC::INTERNAL;
   }
 
-  IntegratedLogReplayer log_replayer(*buffer_pool_manager_, unique_ptr<LogReplayer>(trx_log_replayer));
-  RC                    rc = log_handler_->replay(log_replayer, check_point_lsn_ /*start_lsn*/);
+  int recovery_threads = 0;
+  str_to_val(get_properties()->get(RECOVERY_THREADS, RECOVERY_THREADS_DEFAULT, STORAGE), recovery_threads);
+  if (recovery_threads <= 0) {
+    recovery_threads = static_cast<int>(thread::hardware_concurrency());
+  }
+
+  IntegratedLogReplayer log_replayer(
+      *buffer_pool_manager_, unique_ptr<LogReplayer>(trx_log_replayer), recovery_threads);
+  RC rc = log_handler_->replay(log_replayer, check_point_lsn_ /*start_lsn*/);
   if (OB_FAIL(rc)) {
     LOG_WARN("failed to replay log. rc=%s", strrc(rc));
     return rc;
@@ -358,6 +495,15 @@ RC Db::flush_meta()
 
   string buffer = to_string(check_point_lsn_);
   int    n      = write(fd, buffer.c_str(), buffer.size());
+  // 重命名之前先保证数据已经落盘，否则机器崩溃后可能看到一个空文件
+  if (n >= 0 && fsync(fd) != 0) {
+    LOG_ERROR("Failed to sync db meta file. db=%s, file=%s, errno=%s",
+              name_.c_str(), temp_meta_file_path.c_str(), strerror(errno));
+    close(fd);
+    return RC::IOERR_SYNC;
+  }
+  close(fd);
+
   if (n < 0) {
     LOG_ERROR("Failed to write db meta file. db=%s, file=%s, errno=%s", 
               name_.c_str(), temp_meta_file_path.c_str(), strerror(errno));
@@ -383,6 +529,225 @@ RC Db::flush_meta()
   return rc;
 }
 
+RC Db::init_page_cleaner()
+{
+  double clean_ratio = 0;
+  int    interval_ms = 0;
+
+  string clean_ratio_str =
+      get_properties()->get(BUFFER_POOL_CLEAN_FRAME_RATIO, BUFFER_POOL_CLEAN_FRAME_RATIO_DEFAULT, STORAGE);
+  string interval_ms_str =
+      get_properties()->get(BUFFER_POOL_CLEANER_INTERVAL_MS, BUFFER_POOL_CLEANER_INTERVAL_MS_DEFAULT, STORAGE);
+  if (!str_to_val(clean_ratio_str, clean_ratio) || !str_to_val(interval_ms_str, interval_ms)) {
+    LOG_ERROR("invalid page cleaner config. clean ratio=%s, interval=%s", clean_ratio_str.c_str(), interval_ms_str.c_str());
+    return RC::INVALID_ARGUMENT;
+  }
+
+  if (clean_ratio <= 0) {
+    LOG_INFO("page cleaner is disabled");
+    return RC::SUCCESS;
+  }
+
+  RC rc = buffer_pool_manager_->start_page_cleaner(clean_ratio, interval_ms);
+  if (rc == RC::UNSUPPORTED) {
+    // 非并发编译模式下只能在淘汰页面时刷脏页
+    return RC::SUCCESS;
+  }
+  return rc;
+}
+
+RC Db::init_checkpointer()
+{
+  string interval_ms_str = get_properties()->get(CHECKPOINT_INTERVAL_MS, CHECKPOINT_INTERVAL_MS_DEFAULT, STORAGE);
+  if (!str_to_val(interval_ms_str, checkpoint_interval_ms_) || checkpoint_interval_ms_ < 0) {
+    LOG_ERROR("invalid checkpoint interval: %s", interval_ms_str.c_str());
+    return RC::INVALID_ARGUMENT;
+  }
+
+  if (checkpoint_interval_ms_ == 0) {
+    LOG_INFO("periodic checkpoint is disabled");
+    return RC::SUCCESS;
+  }
+
+#ifndef CONCURRENCY
+  // 非并发编译模式下，double write buffer 等模块的锁什么都不做，只在 sync 时做检查点
+  LOG_INFO("periodic checkpoint is not supported without CONCURRENCY");
+  return RC::SUCCESS;
+#endif
+
+  checkpoint_running_ = true;
+  checkpoint_thread_  = make_unique<thread>(&Db::checkpoint_thread_func, this);
+  LOG_INFO("checkpointer started. interval=%dms", checkpoint_interval_ms_);
+  return RC::SUCCESS;
+}
+
+void Db::stop_checkpointer()
+{
+  if (!checkpoint_thread_) {
+    return;
+  }
+
+  {
+    lock_guard<mutex> lock(checkpoint_wait_lock_);
+    checkpoint_running_ = false;
+  }
+  checkpoint_cond_.notify_all();
+
+  checkpoint_thread_->join();
+  checkpoint_thread_.reset();
+  LOG_INFO("checkpointer stopped. db=%s", name_.c_str());
+}
+
+void Db::checkpoint_thread_func()
+{
+  thread_set_name("Checkpointer");
+  LOG_INFO("checkpointer thread started. db=%s", name_.c_str());
+
+  unique_lock<mutex> lock(checkpoint_wait_lock_);
+  while (checkpoint_running_) {
+    checkpoint_cond_.wait_for(
+        lock, chrono::milliseconds(checkpoint_interval_ms_), [this]() { return !checkpoint_running_; });
+    if (!checkpoint_running_) {
+      break;
+    }
+
+    lock.unlock();
+    RC rc = checkpoint();
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to do checkpoint. db=%s, rc=%s", name_.c_str(), strrc(rc));
+    }
+    lock.lock();
+  }
+
+  LOG_INFO("checkpointer thread stopped. db=%s", name_.c_str());
+}
+
+RC Db::purge(int max_pages)
+{
+  lock_guard<mutex> guard(purge_lock_);
+
+  if (max_pages <= 0) {
+    // 从头把所有的表都清理一遍
+    purge_table_id_ = 0;
+    purge_page_num_ = BP_INVALID_PAGE_NUM;
+    max_pages       = numeric_limits<int>::max();
+  }
+
+  // 删除还没有回写的记录上 end xid 是负数，先回写才能判断出哪些记录可以清理
+  RC rc = trx_kit_->cleanup();
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to cleanup committed trxes. db=%s, rc=%s", name_.c_str(), strrc(rc));
+    return rc;
+  }
+
+  int     total_pages    = 0;
+  int64_t total_purged   = 0;
+  int32_t visited_tables = 0;  // 避免所有的表都是空的时候一直循环
+  while (total_pages < max_pages && visited_tables < next_table_id_) {
+    if (purge_table_id_ >= next_table_id_) {
+      purge_table_id_ = 0;
+      purge_page_num_ = BP_INVALID_PAGE_NUM;
+    }
+
+    Table *table = find_table(purge_table_id_);
+    if (table != nullptr) {
+      int page_count = 0;
+      int purged     = 0;
+      rc = trx_kit_->purge(table, purge_page_num_, max_pages - total_pages, page_count, purged);
+      if (OB_FAIL(rc)) {
+        LOG_WARN("failed to purge table. db=%s, table=%s, rc=%s", name_.c_str(), table->name(), strrc(rc));
+        break;
+      }
+      total_pages += page_count;
+      total_purged += purged;
+    } else {
+      purge_page_num_ = BP_INVALID_PAGE_NUM;
+    }
+
+    if (purge_page_num_ == BP_INVALID_PAGE_NUM) {
+      purge_table_id_++;
+      visited_tables++;
+    }
+  }
+
+  purged_records_ += total_purged;
+  if (total_purged > 0) {
+    LOG_INFO("purge done. db=%s, pages=%d, purged records=%ld", name_.c_str(), total_pages, total_purged);
+  }
+  return rc;
+}
+
+RC Db::init_purger()
+{
+  string interval_ms_str = get_properties()->get(PURGE_INTERVAL_MS, PURGE_INTERVAL_MS_DEFAULT, STORAGE);
+  if (!str_to_val(interval_ms_str, purge_interval_ms_) || purge_interval_ms_ < 0) {
+    LOG_ERROR("invalid purge interval: %s", interval_ms_str.c_str());
+    return RC::INVALID_ARGUMENT;
+  }
+
+  string batch_pages_str = get_properties()->get(PURGE_BATCH_PAGES, PURGE_BATCH_PAGES_DEFAULT, STORAGE);
+  if (!str_to_val(batch_pages_str, purge_batch_pages_) || purge_batch_pages_ <= 0) {
+    LOG_ERROR("invalid purge batch pages: %s", batch_pages_str.c_str());
+    return RC::INVALID_ARGUMENT;
+  }
+
+  if (purge_interval_ms_ == 0) {
+    LOG_INFO("background purge is disabled");
+    return RC::SUCCESS;
+  }
+
+#ifndef CONCURRENCY
+  // 非并发编译模式下，记录和索引的锁什么都不做，不能在后台线程中删除记录
+  LOG_INFO("background purge is not supported without CONCURRENCY");
+  return RC::SUCCESS;
+#endif
+
+  purge_running_ = true;
+  purge_thread_  = make_unique<thread>(&Db::purge_thread_func, this);
+  LOG_INFO("purger started. interval=%dms, batch pages=%d", purge_interval_ms_, purge_batch_pages_);
+  return RC::SUCCESS;
+}
+
+void Db::stop_purger()
+{
+  if (!purge_thread_) {
+    return;
+  }
+
+  {
+    lock_guard<mutex> lock(purge_wait_lock_);
+    purge_running_ = false;
+  }
+  purge_cond_.notify_all();
+
+  purge_thread_->join();
+  purge_thread_.reset();
+  LOG_INFO("purger stopped. db=%s", name_.c_str());
+}
+
+void Db::purge_thread_func()
+{
+  thread_set_name("Purger");
+  LOG_INFO("purger thread started. db=%s", name_.c_str());
+
+  unique_lock<mutex> lock(purge_wait_lock_);
+  while (purge_running_) {
+    purge_cond_.wait_for(lock, chrono::milliseconds(purge_interval_ms_), [this]() { return !purge_running_; });
+    if (!purge_running_) {
+      break;
+    }
+
+    lock.unlock();
+    RC rc = purge(purge_batch_pages_);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to purge. db=%s, rc=%s", name_.c_str(), strrc(rc));
+    }
+    lock.lock();
+  }
+
+  LOG_INFO("purger thread stopped. db=%s", name_.c_str());
+}
+
 RC Db::init_dblwr_buffer()
 {
   auto dblwr_buffer = static_cast<DiskDoubleWriteBuffer *>(buffer_pool_manager_->get_dblwr_buffer());
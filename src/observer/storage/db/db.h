@@ -20,6 +20,10 @@ See the Mulan PSL v2 for more details. */
 #include "common/lang/unordered_map.h"
 #include "common/lang/memory.h"
 #include "common/lang/span.h"
+#include "common/lang/mutex.h"
+#include "common/lang/atomic.h"
+#include "common/lang/condition_variable.h"
+#include "common/lang/thread.h"
 #include "sql/parser/parse_defs.h"
 #include "storage/buffer/disk_buffer_pool.h"
 #include "storage/clog/disk_log_handler.h"
@@ -87,6 +91,29 @@ public:
    */
   RC sync();
 
+  /**
+   * @brief 执行一次模糊检查点(fuzzy checkpoint)
+   * @details 不会刷新脏页，也不要求没有正在进行的事务。从内存中的所有页帧找出最小的恢复LSN，
+   * 等 double write buffer 中的页面落盘后，把它作为检查点记录到元数据中，然后回收之前的日志文件。
+   * 重启时从检查点开始重做。后台线程会定期调用，参考 CHECKPOINT_INTERVAL_MS 配置项。
+   */
+  RC checkpoint();
+
+  /**
+   * @brief 清理旧版本的记录
+   * @details 从上次结束的位置开始，依次清理每张表中已经删除并且对所有事务都不可见的记录，以及它们的索引项，
+   * 清理出来的空间可以被之后插入的记录使用，扫描表时也不用再访问这些记录。
+   * 后台线程会定期调用，每次最多访问 PURGE_BATCH_PAGES 个页面，参考 PURGE_INTERVAL_MS 配置项。
+   * @param max_pages 最多访问多少个页面，小于等于0表示把所有的表都清理一遍
+   */
+  RC purge(int max_pages = 0);
+
+  /// @brief 已经清理掉的记录个数
+  int64_t purged_records() const { return purged_records_.load(); }
+
+  /// @brief 重启时开始重做日志的LSN
+  LSN check_point_lsn() const { return check_point_lsn_; }
+
   /// @brief 获取当前数据库的日志处理器
   LogHandler &log_handler();
 
@@ -104,12 +131,27 @@ private:
 
   /// @brief 初始化元数据。在数据库初始化的时候，加载元数据
   RC init_meta();
-  /// @brief 刷新数据库的元数据到磁盘中。每次执行sync时会执行此操作
+  /// @brief 刷新数据库的元数据到磁盘中。每次执行检查点时会执行此操作
   RC flush_meta();
 
   /// @brief 初始化数据库的double buffer pool
   RC init_dblwr_buffer();
 
+  /// @brief 按照配置启动后台刷脏线程
+  RC init_page_cleaner();
+
+  /// @brief 按照配置启动后台检查点线程
+  RC init_checkpointer();
+  /// @brief 停止后台检查点线程，并等待线程结束
+  void stop_checkpointer();
+  void checkpoint_thread_func();
+
+  /// @brief 按照配置启动后台清理旧版本记录的线程
+  RC init_purger();
+  /// @brief 停止后台清理线程，并等待线程结束
+  void stop_purger();
+  void purge_thread_func();
+
 private:
   string                         name_;                 ///< 数据库名称
   string                         path_;                 ///< 数据库文件存放的目录
@@ -121,5 +163,23 @@ private:
   /// 给每个table都分配一个ID，用来记录日志。这里假设所有的DDL都不会并发操作，所以相关的数据都不上锁
   int32_t next_table_id_ = 0;
 
-  LSN check_point_lsn_ = 0;  ///< 当前数据库的检查点LSN。会记录到磁盘中。
+  LSN check_point_lsn_ = 0;  ///< 当前数据库的检查点LSN，也就是重启时开始重做的位置。会记录到磁盘中。
+
+  mutex              checkpoint_lock_;  ///< 保证同一时间只有一个检查点在执行
+  unique_ptr<thread> checkpoint_thread_;
+  mutex              checkpoint_wait_lock_;  ///< 配合条件变量使用
+  condition_variable checkpoint_cond_;
+  bool               checkpoint_running_     = false;
+  int                checkpoint_interval_ms_ = 0;
+
+  mutex              purge_lock_;  ///< 保证同一时间只有一个清理在执行，同时保护下面的清理位置
+  int32_t            purge_table_id_ = 0;                   ///< 下次从哪张表开始清理
+  PageNum            purge_page_num_ = BP_INVALID_PAGE_NUM;  ///< 下次从表的哪个页面开始清理
+  atomic<int64_t>    purged_records_{0};
+  unique_ptr<thread> purge_thread_;
+  mutex              purge_wait_lock_;  ///< 配合条件变量使用
+  condition_variable purge_cond_;
+  bool               purge_running_     = false;
+  int                purge_interval_ms_ = 0;
+  int                purge_batch_pages_ = 0;
 };
@@ -14,6 +14,7 @@ See the Mulan PSL v2 for more details. */
 //
 
 #include "storage/index/bplus_tree.h"
+#include "common/lang/algorithm.h"
 #include "common/lang/lower_bound.h"
 #include "common/log/log.h"
 #include "common/global_context.h"
@@ -36,9 +37,9 @@ int calc_internal_page_capacity(int attr_length)
   return capacity;
 }
 
-int calc_leaf_page_capacity(int attr_length)
+int calc_leaf_page_capacity(int attr_length, int include_length)
 {
-  int item_size = attr_length + sizeof(RID) + sizeof(RID);
+  int item_size = attr_length + sizeof(RID) + sizeof(RID) + include_length;
   int capacity  = ((int)BP_PAGE_DATA_SIZE - LeafIndexNode::HEADER_SIZE) / item_size;
   return capacity;
 }
@@ -61,8 +62,8 @@ int IndexNodeHandler::key_size() const { return header_.key_length; }
 
 int IndexNodeHandler::value_size() const
 {
-  // return header_.value_size;
-  return sizeof(RID);
+  // 叶子节点的值是RID和INCLUDE字段，内部节点的值是页号，见 InternalIndexNodeHandler::value_size
+  return sizeof(RID) + header_.include_length;
 }
 
 int IndexNodeHandler::item_size() const { return key_size() + value_size(); }
@@ -228,7 +229,10 @@ int LeafIndexNodeHandler::lookup(const KeyComparator &comparator, const char *ke
   const int                    size = this->size();
   common::BinaryIterator<char> iter_begin(item_size(), __key_at(0));
   common::BinaryIterator<char> iter_end(item_size(), __key_at(size));
-  common::BinaryIterator<char> iter = lower_bound(iter_begin, iter_end, key, comparator, found);
+  // 二分查找要比较很多次，使用特化的比较器，只在这里判断一次类型
+  common::BinaryIterator<char> iter = comparator.visit([&](const auto &key_comparator) {
+    return lower_bound(iter_begin, iter_end, key, key_comparator, found);
+  });
   return iter - iter_begin;
 }
 
@@ -526,7 +530,9 @@ int InternalIndexNodeHandler::lookup(const KeyComparator &comparator, const char
 
   common::BinaryIterator<char> iter_begin(item_size(), __key_at(1));
   common::BinaryIterator<char> iter_end(item_size(), __key_at(size));
-  common::BinaryIterator<char> iter = lower_bound(iter_begin, iter_end, key, comparator, found);
+  common::BinaryIterator<char> iter = comparator.visit([&](const auto &key_comparator) {
+    return lower_bound(iter_begin, iter_end, key, key_comparator, found);
+  });
   int                          ret  = static_cast<int>(iter - iter_begin) + 1;
   if (insert_position) {
     *insert_position = ret;
@@ -799,6 +805,30 @@ RC BplusTreeHandler::create(LogHandler &log_handler,
                             int attr_length, 
                             int internal_max_size /* = -1*/,
                             int leaf_max_size /* = -1 */)
+{
+  return this->create(log_handler, bpm, file_name, vector<AttrType>{attr_type}, vector<int>{attr_length},
+      internal_max_size, leaf_max_size);
+}
+
+RC BplusTreeHandler::create(LogHandler &log_handler,
+            DiskBufferPool &buffer_pool,
+            AttrType attr_type,
+            int attr_length,
+            int internal_max_size /* = -1 */,
+            int leaf_max_size /* = -1 */)
+{
+  return this->create(log_handler, buffer_pool, vector<AttrType>{attr_type}, vector<int>{attr_length},
+      internal_max_size, leaf_max_size);
+}
+
+RC BplusTreeHandler::create(LogHandler &log_handler,
+                            BufferPoolManager &bpm,
+                            const char *file_name, 
+                            const vector<AttrType> &attr_types, 
+                            const vector<int> &attr_lengths, 
+                            int internal_max_size /* = -1*/,
+                            int leaf_max_size /* = -1 */,
+                            int include_length /* = 0 */)
 {
   RC rc = bpm.create_file(file_name);
   if (OB_FAIL(rc)) {
@@ -816,7 +846,7 @@ RC BplusTreeHandler::create(LogHandler &log_handler,
   }
   LOG_INFO("Successfully open index file %s.", file_name);
 
-  rc = this->create(log_handler, *bp, attr_type, attr_length, internal_max_size, leaf_max_size);
+  rc = this->create(log_handler, *bp, attr_types, attr_lengths, internal_max_size, leaf_max_size, include_length);
   if (OB_FAIL(rc)) {
     bpm.close_file(file_name);
     return rc;
@@ -828,16 +858,32 @@ RC BplusTreeHandler::create(LogHandler &log_handler,
 
 RC BplusTreeHandler::create(LogHandler &log_handler,
             DiskBufferPool &buffer_pool,
-            AttrType attr_type,
-            int attr_length,
+            const vector<AttrType> &attr_types,
+            const vector<int> &attr_lengths,
             int internal_max_size /* = -1 */,
-            int leaf_max_size /* = -1 */)
+            int leaf_max_size /* = -1 */,
+            int include_length /* = 0 */)
 {
+  const int attr_num = static_cast<int>(attr_types.size());
+  if (attr_num == 0 || attr_num > MAX_INDEX_ATTR_NUM || attr_lengths.size() != attr_types.size()) {
+    LOG_WARN("invalid attributes of b+tree. attr num=%d, max attr num=%d", attr_num, MAX_INDEX_ATTR_NUM);
+    return RC::INVALID_ARGUMENT;
+  }
+  if (include_length < 0) {
+    LOG_WARN("invalid include length of b+tree. include length=%d", include_length);
+    return RC::INVALID_ARGUMENT;
+  }
+
+  int attr_length = 0;
+  for (int length : attr_lengths) {
+    attr_length += length;
+  }
+
   if (internal_max_size < 0) {
     internal_max_size = calc_internal_page_capacity(attr_length);
   }
   if (leaf_max_size < 0) {
-    leaf_max_size = calc_leaf_page_capacity(attr_length);
+    leaf_max_size = calc_leaf_page_capacity(attr_length, include_length);
   }
 
   log_handler_      = &log_handler;
@@ -865,7 +911,13 @@ RC BplusTreeHandler::create(LogHandler &log_handler,
   IndexFileHeader *file_header   = (IndexFileHeader *)pdata;
   file_header->attr_length       = attr_length;
   file_header->key_length        = attr_length + sizeof(RID);
-  file_header->attr_type         = attr_type;
+  file_header->attr_type         = attr_types[0];
+  file_header->attr_num          = attr_num;
+  for (int i = 0; i < attr_num; i++) {
+    file_header->attr_types[i]   = attr_types[i];
+    file_header->attr_lengths[i] = attr_lengths[i];
+  }
+  file_header->include_length    = include_length;
   file_header->internal_max_size = internal_max_size;
   file_header->leaf_max_size     = leaf_max_size;
   file_header->root_page         = BP_INVALID_PAGE_NUM;
@@ -885,8 +937,8 @@ RC BplusTreeHandler::create(LogHandler &log_handler,
     return RC::NOMEM;
   }
 
-  key_comparator_.init(file_header->attr_type, file_header->attr_length);
-  key_printer_.init(file_header->attr_type, file_header->attr_length);
+  key_comparator_.init(file_header_.attr_num, file_header_.attr_types, file_header_.attr_lengths);
+  key_printer_.init(file_header_.attr_num, file_header_.attr_types, file_header_.attr_lengths);
 
   /*
   虽然我们针对B+树记录了WAL，但是我们记录的都是逻辑日志，并没有记录某个页面如何修改的物理日志。
@@ -943,6 +995,7 @@ RC BplusTreeHandler::open(LogHandler &log_handler, DiskBufferPool &buffer_pool)
 
   char *pdata = frame->data();
   memcpy(&file_header_, pdata, sizeof(IndexFileHeader));
+  file_header_.init_single_attr_if_absent();
   header_dirty_     = false;
   disk_buffer_pool_ = &buffer_pool;
   log_handler_      = &log_handler;
@@ -957,8 +1010,8 @@ RC BplusTreeHandler::open(LogHandler &log_handler, DiskBufferPool &buffer_pool)
   // close old page_handle
   buffer_pool.unpin_page(frame);
 
-  key_comparator_.init(file_header_.attr_type, file_header_.attr_length);
-  key_printer_.init(file_header_.attr_type, file_header_.attr_length);
+  key_comparator_.init(file_header_.attr_num, file_header_.attr_types, file_header_.attr_lengths);
+  key_printer_.init(file_header_.attr_num, file_header_.attr_types, file_header_.attr_lengths);
   LOG_INFO("Successfully open index");
   return RC::SUCCESS;
 }
@@ -1186,8 +1239,14 @@ bool BplusTreeHandler::is_empty() const { return file_header_.root_page == BP_IN
 
 RC BplusTreeHandler::find_leaf(BplusTreeMiniTransaction &mtr, BplusTreeOperationType op, const char *key, Frame *&frame)
 {
-  auto child_page_getter = [this, key](InternalIndexNodeHandler &internal_node) {
-    return internal_node.value_at(internal_node.lookup(key_comparator_, key));
+  return find_leaf(mtr, op, key, key_comparator_, frame);
+}
+
+RC BplusTreeHandler::find_leaf(BplusTreeMiniTransaction &mtr, BplusTreeOperationType op, const char *key,
+    const KeyComparator &comparator, Frame *&frame)
+{
+  auto child_page_getter = [&comparator, key](InternalIndexNodeHandler &internal_node) {
+    return internal_node.value_at(internal_node.lookup(comparator, key));
   };
   return find_leaf_internal(mtr, op, child_page_getter, frame);
 }
@@ -1201,6 +1260,18 @@ RC BplusTreeHandler::left_most_page(BplusTreeMiniTransaction &mtr, Frame *&frame
 RC BplusTreeHandler::find_leaf_internal(BplusTreeMiniTransaction &mtr, BplusTreeOperationType op,
     const function<PageNum(InternalIndexNodeHandler &)> &child_page_getter, Frame *&frame)
 {
+  if (op == BplusTreeOperationType::READ) {
+    // 只读操作先尝试乐观读，多次冲突后再使用crabing protocol，避免有大量并发修改时一直重试
+    for (int i = 0; i < OPTIMISTIC_READ_RETRY_TIMES; i++) {
+      bool restart = false;
+      RC   rc      = optimistic_find_leaf(mtr, child_page_getter, frame, restart);
+      if (!restart) {
+        return rc;
+      }
+    }
+    LOG_TRACE("optimistic read failed too many times, fallback to crabing protocol");
+  }
+
   LatchMemo &latch_memo = mtr.latch_memo();
 
   // root locked
@@ -1236,6 +1307,88 @@ RC BplusTreeHandler::find_leaf_internal(BplusTreeMiniTransaction &mtr, BplusTree
   return RC::SUCCESS;
 }
 
+RC BplusTreeHandler::optimistic_find_leaf(BplusTreeMiniTransaction &mtr,
+    const function<PageNum(InternalIndexNodeHandler &)> &child_page_getter, Frame *&frame, bool &restart)
+{
+  LatchMemo &latch_memo = mtr.latch_memo();
+
+  restart           = false;
+  auto restart_read = [&latch_memo, &restart]() {
+    latch_memo.release_to(latch_memo.memo_point());
+    restart = true;
+    return RC::SUCCESS;
+  };
+
+  // 根节点的页面号需要在根锁的保护下读取。拿到根节点的版本号之后就可以释放根锁了，
+  // 因为之后根节点分裂或者调整都会修改原来的根节点页面，版本号校验会失败
+  latch_memo.slatch(&root_lock_);
+  if (is_empty()) {
+    return RC::EMPTY;
+  }
+
+  int memo_point = latch_memo.memo_point();
+  RC  rc         = latch_memo.get_page(file_header_.root_page, frame);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to fetch root page. page id=%d, rc=%d:%s", file_header_.root_page, rc, strrc(rc));
+    return rc;
+  }
+
+  uint64_t version = 0;
+  if (!frame->optimistic_read_begin(version)) {
+    return restart_read();
+  }
+  latch_memo.release_to(memo_point);
+
+  while (true) {
+    IndexNode *node    = (IndexNode *)frame->data();
+    const bool is_leaf = node->is_leaf;
+    if (!frame->optimistic_read_validate(version)) {
+      return restart_read();
+    }
+    if (is_leaf) {
+      break;
+    }
+
+    // 页面可能正在被修改，先检查键值个数，防止读取时越界
+    InternalIndexNodeHandler internal_node(mtr, file_header_, frame);
+    const int                size = internal_node.size();
+    if (size < 0 || size > file_header_.internal_max_size) {
+      return restart_read();
+    }
+
+    PageNum child_page = child_page_getter(internal_node);
+    if (!frame->optimistic_read_validate(version)) {
+      return restart_read();
+    }
+
+    Frame         *parent_frame   = frame;
+    const uint64_t parent_version = version;
+
+    memo_point = latch_memo.memo_point();
+    rc         = latch_memo.get_page(child_page, frame);
+    if (OB_FAIL(rc)) {
+      if (!parent_frame->optimistic_read_validate(parent_version)) {
+        return restart_read();
+      }
+      LOG_WARN("Failed to load page page_num:%d. rc=%s", child_page, strrc(rc));
+      return rc;
+    }
+
+    // 拿到子节点的版本号之后父节点依然没有变化，说明这时父节点还指向这个子节点
+    if (!frame->optimistic_read_begin(version) || !parent_frame->optimistic_read_validate(parent_version)) {
+      return restart_read();
+    }
+    latch_memo.release_to(memo_point);
+  }
+
+  // 调用者会在读锁的保护下访问叶子节点
+  latch_memo.slatch(frame);
+  if (!frame->optimistic_read_validate(version)) {
+    return restart_read();
+  }
+  return RC::SUCCESS;
+}
+
 RC BplusTreeHandler::crabing_protocal_fetch_page(
     BplusTreeMiniTransaction &mtr, BplusTreeOperationType op, PageNum page_num, bool is_root_node, Frame *&frame)
 {
@@ -1258,7 +1411,7 @@ RC BplusTreeHandler::crabing_protocal_fetch_page(
   return rc;
 }
 
-RC BplusTreeHandler::insert_entry_into_leaf_node(BplusTreeMiniTransaction &mtr, Frame *frame, const char *key, const RID *rid)
+RC BplusTreeHandler::insert_entry_into_leaf_node(BplusTreeMiniTransaction &mtr, Frame *frame, const char *key, const char *value)
 {
   LeafIndexNodeHandler leaf_node(mtr, file_header_, frame);
   bool                 exists          = false;  // 该数据是否已经存在指定的叶子节点中了
@@ -1269,7 +1422,7 @@ RC BplusTreeHandler::insert_entry_into_leaf_node(BplusTreeMiniTransaction &mtr,
   }
 
   if (leaf_node.size() < leaf_node.max_size()) {
-    leaf_node.insert(insert_position, key, (const char *)rid);
+    leaf_node.insert(insert_position, key, value);
     frame->mark_dirty();
     // disk_buffer_pool_->unpin_page(frame); // unpin pages 由latch memo 来操作
     return RC::SUCCESS;
@@ -1288,9 +1441,9 @@ RC BplusTreeHandler::insert_entry_into_leaf_node(BplusTreeMiniTransaction &mtr,
   leaf_node.set_next_page(new_frame->page_num());
 
   if (insert_position < leaf_node.size()) {
-    leaf_node.insert(insert_position, key, (const char *)rid);
+    leaf_node.insert(insert_position, key, value);
   } else {
-    new_index_node.insert(insert_position - leaf_node.size(), key, (const char *)rid);
+    new_index_node.insert(insert_position - leaf_node.size(), key, value);
   }
 
   return insert_entry_into_parent(mtr, frame, new_frame, new_index_node.key_at(0));
@@ -1433,11 +1586,12 @@ RC BplusTreeHandler::recover_init_header_page(BplusTreeMiniTransaction &mtr, Fra
   IndexFileHeader *file_header = reinterpret_cast<IndexFileHeader *>(frame->data());
   memcpy(file_header, &header, sizeof(IndexFileHeader));
   file_header_ = header;
+  file_header_.init_single_attr_if_absent();
   header_dirty_ = false;
   frame->mark_dirty();
 
-  key_comparator_.init(file_header_.attr_type, file_header_.attr_length);
-  key_printer_.init(file_header_.attr_type, file_header_.attr_length);
+  key_comparator_.init(file_header_.attr_num, file_header_.attr_types, file_header_.attr_lengths);
+  key_printer_.init(file_header_.attr_num, file_header_.attr_types, file_header_.attr_lengths);
 
   return RC::SUCCESS;
 }
@@ -1456,7 +1610,7 @@ void BplusTreeHandler::update_root_page_num_locked(BplusTreeMiniTransaction &mtr
   LOG_DEBUG("set root page to %d", root_page_num);
 }
 
-RC BplusTreeHandler::create_new_tree(BplusTreeMiniTransaction &mtr, const char *key, const RID *rid)
+RC BplusTreeHandler::create_new_tree(BplusTreeMiniTransaction &mtr, const char *key, const char *value)
 {
   RC rc = RC::SUCCESS;
   if (file_header_.root_page != BP_INVALID_PAGE_NUM) {
@@ -1475,7 +1629,7 @@ RC BplusTreeHandler::create_new_tree(BplusTreeMiniTransaction &mtr, const char *
 
   LeafIndexNodeHandler leaf_node(mtr, file_header_, frame);
   leaf_node.init_empty();
-  leaf_node.insert(0, key, (const char *)rid);
+  leaf_node.insert(0, key, value);
   update_root_page_num_locked(mtr, frame->page_num());
   frame->mark_dirty();
 
@@ -1495,7 +1649,7 @@ MemPoolItem::item_unique_ptr BplusTreeHandler::make_key(const char *user_key, co
   return key;
 }
 
-RC BplusTreeHandler::insert_entry(const char *user_key, const RID *rid)
+RC BplusTreeHandler::insert_entry(const char *user_key, const RID *rid, const char *include_data)
 {
   if (user_key == nullptr || rid == nullptr) {
     LOG_WARN("Invalid arguments, key is empty or rid is empty");
@@ -1514,10 +1668,22 @@ RC BplusTreeHandler::insert_entry(const char *user_key, const RID *rid)
 
   char *key = static_cast<char *>(pkey.get());
 
+  // 叶子节点中的值是RID，后面跟着INCLUDE字段
+  const char  *value = reinterpret_cast<const char *>(rid);
+  vector<char> value_buffer;
+  if (file_header_.include_length > 0) {
+    value_buffer.resize(sizeof(RID) + file_header_.include_length, 0);
+    memcpy(value_buffer.data(), rid, sizeof(RID));
+    if (include_data != nullptr) {
+      memcpy(value_buffer.data() + sizeof(RID), include_data, file_header_.include_length);
+    }
+    value = value_buffer.data();
+  }
+
   if (is_empty()) {
     root_lock_.lock();
     if (is_empty()) {
-      rc = create_new_tree(mtr, key, rid);
+      rc = create_new_tree(mtr, key, value);
       root_lock_.unlock();
       return rc;
     }
@@ -1532,7 +1698,7 @@ RC BplusTreeHandler::insert_entry(const char *user_key, const RID *rid)
     return rc;
   }
 
-  rc = insert_entry_into_leaf_node(mtr, frame, key, rid);
+  rc = insert_entry_into_leaf_node(mtr, frame, key, value);
   if (OB_FAIL(rc)) {
     LOG_TRACE("Failed to insert into leaf of index, rid:%s. rc=%s", rid->to_string().c_str(), strrc(rc));
     return rc;
@@ -1839,13 +2005,27 @@ RC BplusTreeScanner::open(const char *left_user_key, int left_len, bool left_inc
 
   LatchMemo &latch_memo = mtr_.latch_memo();
 
+  // 边界包含了前几个字段，联合索引可以只指定前缀
+  int left_attr_num  = 0;
+  int right_attr_num = 0;
+  if (left_user_key) {
+    left_attr_num = key_attr_num(left_len);
+  }
+  if (right_user_key) {
+    right_attr_num = key_attr_num(right_len);
+  }
+  if (left_attr_num < 0 || right_attr_num < 0) {
+    LOG_WARN("invalid key length. left len=%d, right len=%d", left_len, right_len);
+    return RC::INVALID_ARGUMENT;
+  }
+
   // 校验输入的键值是否是合法范围
   if (left_user_key && right_user_key) {
-    const auto &attr_comparator = tree_handler_.key_comparator_.attr_comparator();
-    const int   result          = attr_comparator(left_user_key, right_user_key);
+    const KeyComparator comparator = tree_handler_.key_comparator_.prefix(min(left_attr_num, right_attr_num));
+    const int           result     = comparator.attr_comparator()(left_user_key, right_user_key);
     if (result > 0 ||  // left < right
                        // left == right but is (left,right)/[left,right) or (left,right]
-        (result == 0 && (left_inclusive == false || right_inclusive == false))) {
+        (result == 0 && left_attr_num == right_attr_num && (left_inclusive == false || right_inclusive == false))) {
       return RC::INVALID_ARGUMENT;
     }
   }
@@ -1865,35 +2045,18 @@ RC BplusTreeScanner::open(const char *left_user_key, int left_len, bool left_inc
     iter_index_ = 0;
   } else {
 
-    char *fixed_left_key = const_cast<char *>(left_user_key);
-    if (tree_handler_.file_header_.attr_type == AttrType::CHARS) {
-      bool should_inclusive_after_fix = false;
-      rc = fix_user_key(left_user_key, left_len, true /*greater*/, &fixed_left_key, &should_inclusive_after_fix);
-      if (OB_FAIL(rc)) {
-        LOG_WARN("failed to fix left user key. rc=%s", strrc(rc));
-        return rc;
-      }
-
-      if (should_inclusive_after_fix) {
-        left_inclusive = true;
-      }
-    }
-
     MemPoolItem::item_unique_ptr left_pkey;
-    if (left_inclusive) {
-      left_pkey = tree_handler_.make_key(fixed_left_key, *RID::min());
-    } else {
-      left_pkey = tree_handler_.make_key(fixed_left_key, *RID::max());
+    KeyComparator                left_comparator;
+    rc = make_bound_key(
+        left_user_key, left_len, left_attr_num, true /*want_greater*/, left_inclusive, left_pkey, left_comparator);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to make left key. rc=%s", strrc(rc));
+      return rc;
     }
 
     const char *left_key = (const char *)left_pkey.get();
 
-    if (fixed_left_key != left_user_key) {
-      delete[] fixed_left_key;
-      fixed_left_key = nullptr;
-    }
-
-    rc = tree_handler_.find_leaf(mtr_, BplusTreeOperationType::READ, left_key, current_frame_);
+    rc = tree_handler_.find_leaf(mtr_, BplusTreeOperationType::READ, left_key, left_comparator, current_frame_);
     if (rc == RC::EMPTY) {
       rc             = RC::SUCCESS;
       current_frame_ = nullptr;
@@ -1904,7 +2067,7 @@ RC BplusTreeScanner::open(const char *left_user_key, int left_len, bool left_inc
     }
 
     LeafIndexNodeHandler left_node(mtr_, tree_handler_.file_header_, current_frame_);
-    int                  left_index = left_node.lookup(tree_handler_.key_comparator_, left_key);
+    int                  left_index = left_node.lookup(left_comparator, left_key);
     // lookup 返回的是适合插入的位置，还需要判断一下是否在合适的边界范围内
     if (left_index >= left_node.size()) {  // 超出了当前页，就需要向后移动一个位置
       const PageNum next_page_num = left_node.next_page();
@@ -1930,36 +2093,73 @@ RC BplusTreeScanner::open(const char *left_user_key, int left_len, bool left_inc
   if (nullptr == right_user_key) {
     right_key_ = nullptr;
   } else {
+    rc = make_bound_key(right_user_key, right_len, right_attr_num, false /*want_greater*/, right_inclusive,
+        right_key_, right_comparator_);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to make right key. rc=%s", strrc(rc));
+      return rc;
+    }
+  }
 
-    char *fixed_right_key          = const_cast<char *>(right_user_key);
-    bool  should_include_after_fix = false;
-    if (tree_handler_.file_header_.attr_type == AttrType::CHARS) {
-      rc = fix_user_key(right_user_key, right_len, false /*want_greater*/, &fixed_right_key, &should_include_after_fix);
-      if (OB_FAIL(rc)) {
-        LOG_WARN("failed to fix right user key. rc=%s", strrc(rc));
-        return rc;
-      }
+  if (touch_end()) {
+    current_frame_ = nullptr;
+  }
 
-      if (should_include_after_fix) {
-        right_inclusive = true;
-      }
+  return RC::SUCCESS;
+}
+
+int BplusTreeScanner::key_attr_num(int key_len) const
+{
+  const IndexFileHeader &header = tree_handler_.file_header_;
+  if (header.attr_num == 1) {
+    return 1;
+  }
+
+  int length = 0;
+  for (int i = 0; i < header.attr_num; i++) {
+    length += header.attr_lengths[i];
+    if (length == key_len) {
+      return i + 1;
     }
-    if (right_inclusive) {
-      right_key_ = tree_handler_.make_key(fixed_right_key, *RID::max());
-    } else {
-      right_key_ = tree_handler_.make_key(fixed_right_key, *RID::min());
+  }
+  return -1;
+}
+
+RC BplusTreeScanner::make_bound_key(const char *user_key, int key_len, int attr_num, bool want_greater,
+    bool &inclusive, MemPoolItem::item_unique_ptr &key, KeyComparator &comparator)
+{
+  const IndexFileHeader &header    = tree_handler_.file_header_;
+  char                  *fixed_key = const_cast<char *>(user_key);
+  if (header.attr_num == 1 && header.attr_type == AttrType::CHARS) {
+    bool should_inclusive_after_fix = false;
+    RC   rc = fix_user_key(user_key, key_len, want_greater, &fixed_key, &should_inclusive_after_fix);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to fix user key. rc=%s", strrc(rc));
+      return rc;
     }
 
-    if (fixed_right_key != right_user_key) {
-      delete[] fixed_right_key;
-      fixed_right_key = nullptr;
+    if (should_inclusive_after_fix) {
+      inclusive = true;
     }
+  } else if (attr_num < header.attr_num) {
+    // 前缀之后的字段不参与比较，填0即可
+    fixed_key = new char[header.attr_length];
+    memcpy(fixed_key, user_key, key_len);
+    memset(fixed_key + key_len, 0, header.attr_length - key_len);
   }
 
-  if (touch_end()) {
-    current_frame_ = nullptr;
+  // 左边界包含在内时从前缀相同的最小RID开始，不包含时从最大RID之后开始，右边界相反
+  if (inclusive == want_greater) {
+    key = tree_handler_.make_key(fixed_key, *RID::min());
+  } else {
+    key = tree_handler_.make_key(fixed_key, *RID::max());
   }
 
+  if (fixed_key != user_key) {
+    delete[] fixed_key;
+  }
+
+  comparator = tree_handler_.key_comparator_.prefix(attr_num);
   return RC::SUCCESS;
 }
 
@@ -1969,6 +2169,17 @@ void BplusTreeScanner::fetch_item(RID &rid)
   memcpy(&rid, node.value_at(iter_index_), sizeof(rid));
 }
 
+RC BplusTreeScanner::next_entry(RID &rid, const char *&user_key, const char *&include_data)
+{
+  RC rc = next_entry(rid);
+  if (OB_SUCC(rc)) {
+    LeafIndexNodeHandler node(mtr_, tree_handler_.file_header_, current_frame_);
+    user_key     = node.key_at(iter_index_);
+    include_data = node.value_at(iter_index_) + sizeof(RID);
+  }
+  return rc;
+}
+
 bool BplusTreeScanner::touch_end()
 {
   if (right_key_ == nullptr) {
@@ -1978,7 +2189,7 @@ bool BplusTreeScanner::touch_end()
   LeafIndexNodeHandler node(mtr_, tree_handler_.file_header_, current_frame_);
 
   const char *this_key       = node.key_at(iter_index_);
-  int         compare_result = tree_handler_.key_comparator_(this_key, static_cast<char *>(right_key_.get()));
+  int         compare_result = right_comparator_(this_key, static_cast<char *>(right_key_.get()));
   return compare_result > 0;
 }
 
@@ -19,10 +19,13 @@ See the Mulan PSL v2 for more details. */
 
 #include <string.h>
 
+#include "common/defs.h"
 #include "common/lang/comparator.h"
 #include "common/lang/memory.h"
 #include "common/lang/sstream.h"
 #include "common/lang/functional.h"
+#include "common/lang/type_traits.h"
+#include "common/lang/vector.h"
 #include "common/log/log.h"
 #include "sql/parser/parse_defs.h"
 #include "storage/buffer/disk_buffer_pool.h"
@@ -50,23 +53,25 @@ enum class BplusTreeOperationType
 };
 
 /**
- * @brief 属性比较(BplusTree)
+ * @brief 联合索引最多包含的字段个数
  * @ingroup BPlusTree
  */
-class AttrComparator
+static constexpr int MAX_INDEX_ATTR_NUM = 8;
+
+/**
+ * @brief 通用的属性比较(BplusTree)
+ * @details 构造 Value 之后按照类型比较，每次比较都要分配内存，只用于没有特化比较器的类型。
+ * @ingroup BPlusTree
+ */
+class GenericAttrComparator
 {
 public:
-  void init(AttrType type, int length)
-  {
-    attr_type_   = type;
-    attr_length_ = length;
-  }
+  GenericAttrComparator(AttrType type, int length) : attr_type_(type), attr_length_(length) {}
 
   int attr_length() const { return attr_length_; }
 
   int operator()(const char *v1, const char *v2) const
   {
-    // TODO: optimized the comparison
     Value left;
     left.set_type(attr_type_);
     left.set_data(v1, attr_length_);
@@ -81,17 +86,175 @@ private:
   int      attr_length_;
 };
 
+/**
+ * @brief 整数属性比较(BplusTree)
+ * @ingroup BPlusTree
+ */
+class IntAttrComparator
+{
+public:
+  int attr_length() const { return sizeof(int32_t); }
+
+  int operator()(const char *v1, const char *v2) const
+  {
+    // 键值在页面中不一定是对齐的
+    int32_t left;
+    int32_t right;
+    memcpy(&left, v1, sizeof(left));
+    memcpy(&right, v2, sizeof(right));
+    return (left > right) - (left < right);
+  }
+};
+
+/**
+ * @brief 浮点数属性比较(BplusTree)
+ * @details 与 FloatType::compare 一样，差值在 EPSILON 之内认为相等
+ * @ingroup BPlusTree
+ */
+class FloatAttrComparator
+{
+public:
+  int attr_length() const { return sizeof(float); }
+
+  int operator()(const char *v1, const char *v2) const
+  {
+    float left;
+    float right;
+    memcpy(&left, v1, sizeof(left));
+    memcpy(&right, v2, sizeof(right));
+    const float diff = left - right;
+    return (diff > EPSILON) - (diff < -EPSILON);
+  }
+};
+
+/**
+ * @brief 定长字符串属性比较(BplusTree)
+ * @details 字符串不足定长时以 '\0' 结尾，与 CharType::compare 一样，较短的字符串较小
+ * @ingroup BPlusTree
+ */
+class CharAttrComparator
+{
+public:
+  explicit CharAttrComparator(int length) : attr_length_(length) {}
+
+  int attr_length() const { return attr_length_; }
+
+  int operator()(const char *v1, const char *v2) const
+  {
+    const int result = strncmp(v1, v2, attr_length_);
+    return (result > 0) - (result < 0);
+  }
+
+private:
+  int attr_length_;
+};
+
+/**
+ * @brief 属性比较(BplusTree)
+ * @details 按照属性类型分派到特化的比较器上。
+ * 比较很多次的场景，比如节点内的二分查找，使用 visit 拿到特化的比较器，避免每次比较都判断类型。
+ * @ingroup BPlusTree
+ */
+class AttrComparator
+{
+public:
+  void init(AttrType type, int length)
+  {
+    attr_type_   = type;
+    attr_length_ = length;
+  }
+
+  AttrType attr_type() const { return attr_type_; }
+  int      attr_length() const { return attr_length_; }
+
+  /**
+   * @brief 使用当前类型特化的比较器调用 func
+   */
+  template <typename Func>
+  decltype(auto) visit(Func &&func) const
+  {
+    switch (attr_type_) {
+      case AttrType::INTS: return func(IntAttrComparator());
+      case AttrType::FLOATS: return func(FloatAttrComparator());
+      case AttrType::CHARS: return func(CharAttrComparator(attr_length_));
+      default: return func(GenericAttrComparator(attr_type_, attr_length_));
+    }
+  }
+
+  int operator()(const char *v1, const char *v2) const
+  {
+    return visit([v1, v2](const auto &comparator) { return comparator(v1, v2); });
+  }
+
+private:
+  AttrType attr_type_   = AttrType::UNDEFINED;
+  int      attr_length_ = 0;
+};
+
+/**
+ * @brief 联合索引的属性比较(BplusTree)
+ * @details 联合索引的属性由多个字段依次拼接而成，按照字段的顺序逐个比较。
+ * 可以只比较前面几个字段，按照前缀查找时使用。
+ * @ingroup BPlusTree
+ */
+class CompositeAttrComparator
+{
+public:
+  void init(int attr_num, const AttrType *attr_types, const int *attr_lengths)
+  {
+    attr_num_    = attr_num;
+    compare_num_ = attr_num;
+    attr_length_ = 0;
+    for (int i = 0; i < attr_num; i++) {
+      attrs_[i].init(attr_types[i], attr_lengths[i]);
+      offsets_[i] = attr_length_;
+      attr_length_ += attr_lengths[i];
+    }
+  }
+
+  /**
+   * @brief 只比较前 compare_num 个字段
+   */
+  void set_compare_num(int compare_num) { compare_num_ = compare_num; }
+
+  int                   attr_num() const { return attr_num_; }
+  int                   compare_num() const { return compare_num_; }
+  const AttrComparator &attr(int index) const { return attrs_[index]; }
+  int                   attr_offset(int index) const { return offsets_[index]; }
+
+  /// @brief 所有字段的长度之和。即使只比较部分字段，RID也在所有字段之后
+  int attr_length() const { return attr_length_; }
+
+  int operator()(const char *v1, const char *v2) const
+  {
+    for (int i = 0; i < compare_num_; i++) {
+      const int result = attrs_[i](v1 + offsets_[i], v2 + offsets_[i]);
+      if (result != 0) {
+        return result;
+      }
+    }
+    return 0;
+  }
+
+private:
+  int            attr_num_    = 0;
+  int            compare_num_ = 0;
+  int            attr_length_ = 0;
+  AttrComparator attrs_[MAX_INDEX_ATTR_NUM];
+  int            offsets_[MAX_INDEX_ATTR_NUM] = {0};
+};
+
 /**
  * @brief 键值比较(BplusTree)
  * @details BplusTree的键值除了字段属性，还有RID，是为了避免属性值重复而增加的。
+ * @tparam AttrComparatorT 属性比较器
  * @ingroup BPlusTree
  */
-class KeyComparator
+template <typename AttrComparatorT>
+class KeyComparatorT
 {
 public:
-  void init(AttrType type, int length) { attr_comparator_.init(type, length); }
-
-  const AttrComparator &attr_comparator() const { return attr_comparator_; }
+  explicit KeyComparatorT(const AttrComparatorT &attr_comparator) : attr_comparator_(attr_comparator) {}
 
   int operator()(const char *v1, const char *v2) const
   {
@@ -106,7 +269,56 @@ public:
   }
 
 private:
-  AttrComparator attr_comparator_;
+  AttrComparatorT attr_comparator_;
+};
+
+/**
+ * @brief 键值比较(BplusTree)
+ * @details 与 AttrComparator 一样，可以直接比较，也可以使用 visit 拿到特化的 KeyComparatorT。
+ * 只有一个字段时按照字段类型特化，联合索引使用 CompositeAttrComparator 逐个字段比较。
+ * @ingroup BPlusTree
+ */
+class KeyComparator
+{
+public:
+  void init(AttrType type, int length) { attr_comparator_.init(1, &type, &length); }
+  void init(int attr_num, const AttrType *attr_types, const int *attr_lengths)
+  {
+    attr_comparator_.init(attr_num, attr_types, attr_lengths);
+  }
+
+  const CompositeAttrComparator &attr_comparator() const { return attr_comparator_; }
+
+  /**
+   * @brief 只比较前 attr_num 个字段和RID的比较器
+   * @details 查找前缀时，键值中前缀之后的字段没有意义，前缀相同的键值按照RID比较，
+   * 与 RID::min()/RID::max() 一起使用就可以找到前缀的边界
+   */
+  KeyComparator prefix(int attr_num) const
+  {
+    KeyComparator comparator(*this);
+    comparator.attr_comparator_.set_compare_num(attr_num);
+    return comparator;
+  }
+
+  template <typename Func>
+  decltype(auto) visit(Func &&func) const
+  {
+    if (attr_comparator_.attr_num() == 1) {
+      return attr_comparator_.attr(0).visit([&func](const auto &attr_comparator) {
+        return func(KeyComparatorT<decay_t<decltype(attr_comparator)>>(attr_comparator));
+      });
+    }
+    return func(KeyComparatorT<CompositeAttrComparator>(attr_comparator_));
+  }
+
+  int operator()(const char *v1, const char *v2) const
+  {
+    return visit([v1, v2](const auto &comparator) { return comparator(v1, v2); });
+  }
+
+private:
+  CompositeAttrComparator attr_comparator_;
 };
 
 /**
@@ -142,29 +354,54 @@ private:
 class KeyPrinter
 {
 public:
-  void init(AttrType type, int length) { attr_printer_.init(type, length); }
-
-  const AttrPrinter &attr_printer() const { return attr_printer_; }
+  void init(AttrType type, int length) { init(1, &type, &length); }
+  void init(int attr_num, const AttrType *attr_types, const int *attr_lengths)
+  {
+    attr_printers_.resize(attr_num);
+    attr_length_ = 0;
+    for (int i = 0; i < attr_num; i++) {
+      attr_printers_[i].init(attr_types[i], attr_lengths[i]);
+      attr_length_ += attr_lengths[i];
+    }
+  }
 
   string operator()(const char *v) const
   {
     stringstream ss;
-    ss << "{key:" << attr_printer_(v) << ",";
+    ss << "{key:";
+    // 联合索引的多个字段放在括号中
+    if (attr_printers_.size() > 1) {
+      ss << "(";
+    }
+    int offset = 0;
+    for (size_t i = 0; i < attr_printers_.size(); i++) {
+      if (i != 0) {
+        ss << ",";
+      }
+      ss << attr_printers_[i](v + offset);
+      offset += attr_printers_[i].attr_length();
+    }
+    if (attr_printers_.size() > 1) {
+      ss << ")";
+    }
+    ss << ",";
 
-    const RID *rid = (const RID *)(v + attr_printer_.attr_length());
+    const RID *rid = (const RID *)(v + attr_length_);
     ss << "rid:{" << rid->to_string() << "}}";
     return ss.str();
   }
 
 private:
-  AttrPrinter attr_printer_;
+  vector<AttrPrinter> attr_printers_;
+  int                 attr_length_ = 0;
 };
 
 /**
  * @brief the meta information of bplus tree
  * @ingroup BPlusTree
  * @details this is the first page of bplus tree.
- * only one field can be supported, can you extend it to multi-fields?
+ * 联合索引的键值由多个字段依次拼接而成，attr_length 是所有字段的长度之和。
+ * 叶子节点的值除了RID，还可以附带 include_length 字节的INCLUDE字段，它们不参与比较，内部节点中也不存放。
  */
 struct IndexFileHeader
 {
@@ -173,12 +410,28 @@ struct IndexFileHeader
     memset(this, 0, sizeof(IndexFileHeader));
     root_page = BP_INVALID_PAGE_NUM;
   }
-  PageNum  root_page;          ///< 根节点在磁盘中的页号
-  int32_t  internal_max_size;  ///< 内部节点最大的键值对数
-  int32_t  leaf_max_size;      ///< 叶子节点最大的键值对数
-  int32_t  attr_length;        ///< 键值的长度
-  int32_t  key_length;         ///< attr length + sizeof(RID)
-  AttrType attr_type;          ///< 键值的类型
+  PageNum  root_page;                         ///< 根节点在磁盘中的页号
+  int32_t  internal_max_size;                 ///< 内部节点最大的键值对数
+  int32_t  leaf_max_size;                     ///< 叶子节点最大的键值对数
+  int32_t  attr_length;                       ///< 键值的长度
+  int32_t  key_length;                        ///< attr length + sizeof(RID)
+  AttrType attr_type;                         ///< 第一个字段的类型
+  int32_t  attr_num;                          ///< 键值包含的字段个数
+  AttrType attr_types[MAX_INDEX_ATTR_NUM];    ///< 每个字段的类型
+  int32_t  attr_lengths[MAX_INDEX_ATTR_NUM];  ///< 每个字段的长度
+  int32_t  include_length;                    ///< 叶子节点中附带的INCLUDE字段的长度
+
+  /**
+   * @brief 只支持一个字段时创建的文件没有记录 attr_num，从 attr_type 和 attr_length 中补上
+   */
+  void init_single_attr_if_absent()
+  {
+    if (attr_num == 0) {
+      attr_num        = 1;
+      attr_types[0]   = attr_type;
+      attr_lengths[0] = attr_length;
+    }
+  }
 
   const string to_string() const
   {
@@ -187,6 +440,8 @@ struct IndexFileHeader
     ss << "attr_length:" << attr_length << ","
        << "key_length:" << key_length << ","
        << "attr_type:" << attr_type_to_string(attr_type) << ","
+       << "attr_num:" << attr_num << ","
+       << "include_length:" << include_length << ","
        << "root_page:" << root_page << ","
        << "internal_max_size:" << internal_max_size << ","
        << "leaf_max_size:" << leaf_max_size << ";";
@@ -222,7 +477,7 @@ struct IndexNode
  * @endcode
  * the key is in format: the key value of record and rid.
  * so the key in leaf page must be unique.
- * the value is rid.
+ * the value is rid, followed by the include columns if any.
  * can you implenment a cluster index ?
  */
 struct LeafIndexNode : public IndexNode
@@ -464,6 +719,18 @@ public:
   RC create(LogHandler &log_handler, DiskBufferPool &buffer_pool, AttrType attr_type, int attr_length,
       int internal_max_size = -1, int leaf_max_size = -1);
 
+  /**
+   * @brief 创建一个联合索引的B+树
+   * @details 键值由多个字段依次拼接而成，按照字段的顺序比较，最多 MAX_INDEX_ATTR_NUM 个字段
+   * @param attr_types 每个字段的类型
+   * @param attr_lengths 每个字段的长度
+   * @param include_length 叶子节点中附带的INCLUDE字段的长度，参考 insert_entry
+   */
+  RC create(LogHandler &log_handler, BufferPoolManager &bpm, const char *file_name, const vector<AttrType> &attr_types,
+      const vector<int> &attr_lengths, int internal_max_size = -1, int leaf_max_size = -1, int include_length = 0);
+  RC create(LogHandler &log_handler, DiskBufferPool &buffer_pool, const vector<AttrType> &attr_types,
+      const vector<int> &attr_lengths, int internal_max_size = -1, int leaf_max_size = -1, int include_length = 0);
+
   /**
    * @brief 打开一个B+树
    * @param log_handler 记录日志
@@ -482,9 +749,10 @@ public:
    * @brief 此函数向IndexHandle对应的索引中插入一个索引项。
    * @details 参数user_key指向要插入的属性值，参数rid标识该索引项对应的元组，
    * 即向索引中插入一个值为（user_key，rid）的键值对
+   * @param include_data 与RID一起存放在叶子节点中的INCLUDE字段，长度是 include_length，没有时可以为空
    * @note 这里假设user_key的内存大小与attr_length 一致
    */
-  RC insert_entry(const char *user_key, const RID *rid);
+  RC insert_entry(const char *user_key, const RID *rid, const char *include_data = nullptr);
 
   /**
    * @brief 从IndexHandle句柄对应的索引中删除一个值为（user_key，rid）的索引项
@@ -554,6 +822,12 @@ protected:
    */
   RC find_leaf(BplusTreeMiniTransaction &mtr, BplusTreeOperationType op, const char *key, Frame *&frame);
 
+  /**
+   * @brief 使用指定的比较器查找叶子节点，比如只比较前缀的比较器
+   */
+  RC find_leaf(BplusTreeMiniTransaction &mtr, BplusTreeOperationType op, const char *key,
+      const KeyComparator &comparator, Frame *&frame);
+
   /**
    * @brief 找到最左边的叶子节点
    */
@@ -568,6 +842,16 @@ protected:
   RC find_leaf_internal(BplusTreeMiniTransaction &mtr, BplusTreeOperationType op,
       const function<PageNum(InternalIndexNodeHandler &)> &child_page_getter, Frame *&frame);
 
+  /**
+   * @brief 使用乐观读的方式查找叶子节点
+   * @details 遍历内部节点时不加锁，只pin住页面，读取子节点之后校验页帧的版本号(参考 Frame::optimistic_read_begin)。
+   * 找到叶子节点后给叶子节点加上读锁，与 crabing protocol 返回的结果一样。
+   * 版本号校验失败时，释放已经获取的所有页面，并设置 restart，调用者需要重新查找。
+   * @param[out] restart 是否需要重新查找
+   */
+  RC optimistic_find_leaf(BplusTreeMiniTransaction &mtr,
+      const function<PageNum(InternalIndexNodeHandler &)> &child_page_getter, Frame *&frame, bool &restart);
+
   /**
    * @brief 使用crabing protocol 获取页面
    */
@@ -614,13 +898,14 @@ protected:
 
   /**
    * @brief 在叶子节点插入一个元素
+   * @param value 叶子节点中的值，即RID和INCLUDE字段
    */
-  RC insert_entry_into_leaf_node(BplusTreeMiniTransaction &mtr, Frame *frame, const char *pkey, const RID *rid);
+  RC insert_entry_into_leaf_node(BplusTreeMiniTransaction &mtr, Frame *frame, const char *pkey, const char *value);
 
   /**
    * @brief 创建一个新的B+树
    */
-  RC create_new_tree(BplusTreeMiniTransaction &mtr, const char *key, const RID *rid);
+  RC create_new_tree(BplusTreeMiniTransaction &mtr, const char *key, const char *value);
 
   /**
    * @brief 更新根节点的页号
@@ -636,6 +921,9 @@ private:
   common::MemPoolItem::item_unique_ptr make_key(const char *user_key, const RID &rid);
 
 protected:
+  /// 乐观读查找叶子节点的最大重试次数，超过之后使用 crabing protocol
+  static constexpr int OPTIMISTIC_READ_RETRY_TIMES = 3;
+
   LogHandler     *log_handler_      = nullptr;  /// 日志处理器
   DiskBufferPool *disk_buffer_pool_ = nullptr;  /// 磁盘缓冲池
   bool            header_dirty_     = false;    /// 是否需要更新头页面
@@ -653,6 +941,7 @@ protected:
 private:
   friend class BplusTreeScanner;
   friend class BplusTreeTester;
+  friend class BplusTreeBulkLoader;
 };
 
 /**
@@ -673,6 +962,8 @@ public:
    * @param right_user_key 扫描范围的右边界。如果是null，则没有右边界
    * @param right_len right_user_key 的内存大小(只有在变长字段中才会关注)
    * @param right_inclusive 右边界的值是否包含在内
+   * @details 联合索引可以只指定前几个字段作为边界，这时 left_len/right_len 是这几个字段的长度之和，
+   * 比如索引(a,b)上按照 a=1 and b>2 扫描，左边界是(1,2)，右边界是(1)。
    * TODO 重构参数表示方法
    */
   RC open(const char *left_user_key, int left_len, bool left_inclusive, const char *right_user_key, int right_len,
@@ -689,6 +980,15 @@ public:
    */
   RC next_entry(RID &rid);
 
+  /**
+   * @brief 获取下一条记录，同时返回叶子节点中的键值和INCLUDE字段
+   * @details 覆盖索引扫描时使用，不需要再去读取记录。
+   * 返回的指针指向叶子页面，在下一次调用 next_entry 之前有效
+   * @param[out] user_key 键值，长度是 attr_length
+   * @param[out] include_data INCLUDE字段，长度是 include_length
+   */
+  RC next_entry(RID &rid, const char *&user_key, const char *&include_data);
+
   /**
    * @brief 关闭当前扫描器
    * @details 可以不调用，在析构函数时会自动执行
@@ -701,6 +1001,22 @@ private:
    */
   RC fix_user_key(const char *user_key, int key_len, bool want_greater, char **fixed_key, bool *should_inclusive);
 
+  /**
+   * @brief 边界包含了前几个字段
+   * @details 联合索引的 key_len 必须是前几个字段的长度之和，否则返回 -1
+   */
+  int key_attr_num(int key_len) const;
+
+  /**
+   * @brief 把用户传入的边界转换成完整的键值
+   * @details 前缀之后的字段填0，再按照是否包含边界拼上最小或最大的RID
+   * @param attr_num 边界包含的字段个数
+   * @param[in,out] inclusive 修正后边界是否包含在内
+   * @param[out] comparator 与边界比较时使用的比较器，只比较边界中包含的字段
+   */
+  RC make_bound_key(const char *user_key, int key_len, int attr_num, bool want_greater, bool &inclusive,
+      common::MemPoolItem::item_unique_ptr &key, KeyComparator &comparator);
+
   void fetch_item(RID &rid);
 
   /**
@@ -718,6 +1034,7 @@ private:
   Frame *current_frame_ = nullptr;
 
   common::MemPoolItem::item_unique_ptr right_key_;
+  KeyComparator                        right_comparator_;  ///< 与右边界比较，只比较右边界中包含的字段
   int                                  iter_index_    = -1;
   bool                                 first_emitted_ = false;
 };
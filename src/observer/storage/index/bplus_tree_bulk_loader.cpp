@@ -0,0 +1,403 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <string.h>
+
+#include "storage/index/bplus_tree_bulk_loader.h"
+#include "common/lang/algorithm.h"
+#include "common/lang/filesystem.h"
+#include "common/lang/fstream.h"
+#include "common/lang/queue.h"
+#include "common/log/log.h"
+
+/**
+ * @brief 顺序读取一个排好序的临时文件
+ */
+class BplusTreeBulkLoader::RunReader
+{
+public:
+  RunReader(const string &file_name, int entry_length, int64_t buffer_size)
+      : entry_length_(entry_length), buffer_(max<int64_t>(buffer_size / entry_length, 1) * entry_length)
+  {
+    file_.open(file_name, ios_base::in | ios_base::binary);
+  }
+
+  /// @brief 读取下一个键值。没有数据时返回 RECORD_EOF
+  RC next()
+  {
+    offset_ += entry_length_;
+    if (offset_ < length_) {
+      return RC::SUCCESS;
+    }
+
+    if (!file_.is_open() || file_.eof()) {
+      return RC::RECORD_EOF;
+    }
+
+    file_.read(buffer_.data(), buffer_.size());
+    if (file_.bad()) {
+      LOG_WARN("failed to read sort run file. error=%s", strerror(errno));
+      return RC::IOERR_READ;
+    }
+
+    offset_ = 0;
+    length_ = file_.gcount() / entry_length_ * entry_length_;
+    return length_ > 0 ? RC::SUCCESS : RC::RECORD_EOF;
+  }
+
+  const char *key() const { return buffer_.data() + offset_; }
+
+private:
+  ifstream     file_;
+  int          entry_length_ = 0;
+  vector<char> buffer_;
+  int64_t      offset_ = 0;
+  int64_t      length_ = 0;
+};
+
+BplusTreeBulkLoader::BplusTreeBulkLoader(
+    BplusTreeHandler &handler, const string &tmp_file_prefix, int64_t memory_limit, double fill_factor)
+    : handler_(handler),
+      mtr_(handler),
+      tmp_file_prefix_(tmp_file_prefix),
+      memory_limit_(memory_limit),
+      fill_factor_(fill_factor),
+      key_length_(handler.file_header().key_length),
+      entry_length_(handler.file_header().key_length + handler.file_header().include_length)
+{
+  mtr_.logger().set_need_log(false);
+}
+
+BplusTreeBulkLoader::~BplusTreeBulkLoader()
+{
+  for (const string &run_file : run_files_) {
+    error_code ec;
+    filesystem::remove(run_file, ec);
+  }
+}
+
+RC BplusTreeBulkLoader::add(const char *user_key, const RID &rid, const char *include_data)
+{
+  // 每个键值除了自己占用的空间，排序时还需要一个指针
+  const int64_t entry_memory = entry_length_ + static_cast<int64_t>(sizeof(const char *));
+  if (!buffer_.empty() && static_cast<int64_t>(buffer_.size()) / entry_length_ * entry_memory >= memory_limit_) {
+    RC rc = spill();
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+  }
+
+  const int attr_length = handler_.file_header().attr_length;
+  buffer_.insert(buffer_.end(), user_key, user_key + attr_length);
+  buffer_.insert(buffer_.end(), reinterpret_cast<const char *>(&rid), reinterpret_cast<const char *>(&rid + 1));
+  const int include_length = handler_.file_header().include_length;
+  if (include_data != nullptr) {
+    buffer_.insert(buffer_.end(), include_data, include_data + include_length);
+  } else {
+    buffer_.resize(buffer_.size() + include_length, 0);
+  }
+  key_count_++;
+  return RC::SUCCESS;
+}
+
+void BplusTreeBulkLoader::sort_buffer()
+{
+  sorted_.clear();
+  sorted_.reserve(buffer_.size() / entry_length_);
+  for (size_t offset = 0; offset < buffer_.size(); offset += entry_length_) {
+    sorted_.push_back(buffer_.data() + offset);
+  }
+
+  handler_.key_comparator_.visit([this](const auto &comparator) {
+    sort(sorted_.begin(), sorted_.end(), [&comparator](const char *left, const char *right) {
+      return comparator(left, right) < 0;
+    });
+  });
+}
+
+RC BplusTreeBulkLoader::spill()
+{
+  sort_buffer();
+
+  string   run_file = tmp_file_prefix_ + "." + std::to_string(run_files_.size());
+  ofstream file(run_file, ios_base::out | ios_base::binary | ios_base::trunc);
+  if (!file.is_open()) {
+    LOG_WARN("failed to create sort run file. file=%s, error=%s", run_file.c_str(), strerror(errno));
+    return RC::IOERR_OPEN;
+  }
+  run_files_.push_back(run_file);
+
+  for (const char *entry : sorted_) {
+    file.write(entry, entry_length_);
+  }
+  file.close();
+  if (file.fail()) {
+    LOG_WARN("failed to write sort run file. file=%s, error=%s", run_file.c_str(), strerror(errno));
+    return RC::IOERR_WRITE;
+  }
+
+  LOG_INFO("spill sorted keys to file. file=%s, keys=%zu", run_file.c_str(), sorted_.size());
+  sorted_.clear();
+  buffer_.clear();
+  return RC::SUCCESS;
+}
+
+RC BplusTreeBulkLoader::merge()
+{
+  // 排序的内存不再使用，平均分给每个临时文件做读缓存
+  buffer_.clear();
+  buffer_.shrink_to_fit();
+  sorted_.shrink_to_fit();
+
+  const int64_t     buffer_size = memory_limit_ / static_cast<int64_t>(run_files_.size());
+  vector<RunReader> readers;
+  readers.reserve(run_files_.size());
+  for (const string &run_file : run_files_) {
+    readers.emplace_back(run_file, entry_length_, buffer_size);
+  }
+
+  return handler_.key_comparator_.visit([this, &readers](const auto &comparator) {
+    auto greater = [&comparator, &readers](int left, int right) {
+      return comparator(readers[left].key(), readers[right].key()) > 0;
+    };
+    priority_queue<int, vector<int>, decltype(greater)> heap(greater);
+
+    RC rc = RC::SUCCESS;
+    for (int i = 0; i < static_cast<int>(readers.size()); i++) {
+      // 读取第一个键值
+      rc = readers[i].next();
+      if (OB_SUCC(rc)) {
+        heap.push(i);
+      } else if (rc != RC::RECORD_EOF) {
+        return rc;
+      }
+    }
+
+    while (!heap.empty()) {
+      const int index = heap.top();
+      heap.pop();
+      rc = build_add(readers[index].key());
+      if (OB_FAIL(rc)) {
+        return rc;
+      }
+
+      rc = readers[index].next();
+      if (OB_SUCC(rc)) {
+        heap.push(index);
+      } else if (rc != RC::RECORD_EOF) {
+        return rc;
+      }
+    }
+    return RC::SUCCESS;
+  });
+}
+
+RC BplusTreeBulkLoader::finish()
+{
+  if (handler_.file_header().root_page != BP_INVALID_PAGE_NUM) {
+    LOG_WARN("cannot bulk load a non-empty bplus tree. root page=%d", handler_.file_header().root_page);
+    return RC::INTERNAL;
+  }
+
+  if (key_count_ == 0) {
+    return RC::SUCCESS;
+  }
+
+  RC rc = build_begin();
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  if (run_files_.empty()) {
+    sort_buffer();
+    for (const char *key : sorted_) {
+      rc = build_add(key);
+      if (OB_FAIL(rc)) {
+        break;
+      }
+    }
+  } else {
+    if (!buffer_.empty()) {
+      rc = spill();
+    }
+    if (OB_SUCC(rc)) {
+      rc = merge();
+    }
+  }
+
+  RC end_rc = build_end();
+  if (OB_SUCC(rc)) {
+    rc = end_rc;
+  }
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to bulk load bplus tree. rc=%s", strrc(rc));
+    return rc;
+  }
+
+  // 没有记录B+树的日志，直接把整棵树刷到磁盘
+  rc = handler_.sync();
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to sync bplus tree after bulk load. rc=%s", strrc(rc));
+    return rc;
+  }
+
+  LOG_INFO("bulk load bplus tree done. keys=%ld, runs=%d, levels=%d",
+           key_count_, run_count(), static_cast<int>(levels_.size()));
+  return RC::SUCCESS;
+}
+
+int64_t BplusTreeBulkLoader::node_count(int64_t item_count, int max_size) const
+{
+  const int64_t target = max(static_cast<int64_t>(max_size * fill_factor_), static_cast<int64_t>(1));
+  int64_t       count  = (item_count + target - 1) / target;
+
+  // 平均分配之后每个节点不能少于半满，否则就少用几个节点
+  const int64_t min_size = max_size - max_size / 2;
+  if (count > 1 && item_count / count < min_size) {
+    count = max(item_count / min_size, static_cast<int64_t>(1));
+  }
+  return count;
+}
+
+RC BplusTreeBulkLoader::build_begin()
+{
+  const IndexFileHeader &header = handler_.file_header();
+
+  // 从叶子节点开始，计算每一层的节点个数，直到某一层只有一个节点，就是根节点
+  levels_.clear();
+  int64_t item_count = key_count_;
+  while (true) {
+    Level level;
+    level.item_count = item_count;
+    level.node_count = node_count(item_count, levels_.empty() ? header.leaf_max_size : header.internal_max_size);
+    levels_.push_back(level);
+    if (level.node_count == 1) {
+      break;
+    }
+    item_count = level.node_count;
+  }
+
+  item_.resize(key_length_ + max(sizeof(RID) + header.include_length, sizeof(PageNum)));
+  return RC::SUCCESS;
+}
+
+RC BplusTreeBulkLoader::build_add(const char *key)
+{
+  // 叶子节点的值就是键值中的RID，以及紧跟在键值后面的INCLUDE字段
+  return add_to_level(0, key, key + handler_.file_header().attr_length);
+}
+
+RC BplusTreeBulkLoader::add_to_level(int level_index, const char *key, const char *value)
+{
+  Level &level = levels_[level_index];
+  RC     rc    = RC::SUCCESS;
+  if (level.frame == nullptr || IndexNodeHandler(mtr_, handler_.file_header(), level.frame).size() == level.node_size) {
+    rc = start_node(level_index, key);
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+  }
+
+  const bool leaf = level_index == 0;
+  if (leaf) {
+    LeafIndexNodeHandler node(mtr_, handler_.file_header(), level.frame);
+    memcpy(item_.data(), key, key_length_);
+    memcpy(item_.data() + key_length_, value, node.value_size());
+    return node.recover_insert_items(node.size(), item_.data(), 1);
+  }
+
+  InternalIndexNodeHandler node(mtr_, handler_.file_header(), level.frame);
+  // 内部节点的第一个键值查找时不使用，但与分裂时一样保留子节点的第一个键值，删除时会用它来定位父节点中的位置
+  memcpy(item_.data(), key, key_length_);
+  memcpy(item_.data() + key_length_, value, sizeof(PageNum));
+  return node.recover_insert_items(node.size(), item_.data(), 1);
+}
+
+RC BplusTreeBulkLoader::start_node(int level_index, const char *key)
+{
+  Level          &level       = levels_[level_index];
+  DiskBufferPool &buffer_pool = handler_.buffer_pool();
+  const bool      leaf        = level_index == 0;
+
+  if (level.node_index + 1 >= level.node_count) {
+    LOG_WARN("too many nodes in level %d. node count=%ld", level_index, level.node_count);
+    return RC::INTERNAL;
+  }
+
+  Frame *frame = nullptr;
+  RC     rc    = buffer_pool.allocate_page(&frame);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to allocate page while bulk loading. rc=%s", strrc(rc));
+    return rc;
+  }
+
+  level.node_index++;
+  level.node_size = static_cast<int>(level.item_count / level.node_count +
+                                     (level.node_index < level.item_count % level.node_count ? 1 : 0));
+
+  if (leaf) {
+    LeafIndexNodeHandler node(mtr_, handler_.file_header(), frame);
+    node.init_empty();
+  } else {
+    InternalIndexNodeHandler node(mtr_, handler_.file_header(), frame);
+    node.init_empty();
+  }
+
+  if (level.frame != nullptr) {
+    if (leaf) {
+      LeafIndexNodeHandler prev_node(mtr_, handler_.file_header(), level.frame);
+      prev_node.set_next_page(frame->page_num());
+    }
+    level.frame->mark_dirty();
+    buffer_pool.unpin_page(level.frame);
+  }
+  level.frame = frame;
+  frame->mark_dirty();
+
+  // 新节点的第一个键值放到父节点中，最上面一层只有一个节点，就是根节点
+  if (level_index + 1 < static_cast<int>(levels_.size())) {
+    const PageNum page_num = frame->page_num();
+    rc = add_to_level(level_index + 1, key, reinterpret_cast<const char *>(&page_num));
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+
+    IndexNodeHandler node(mtr_, handler_.file_header(), frame);
+    rc = node.set_parent_page_num(levels_[level_index + 1].frame->page_num());
+  } else {
+    // 构建完成后 sync 把文件头写到头页面上
+    handler_.file_header_.root_page = frame->page_num();
+    handler_.header_dirty_          = true;
+  }
+  return rc;
+}
+
+RC BplusTreeBulkLoader::build_end()
+{
+  RC rc = RC::SUCCESS;
+  for (int i = 0; i < static_cast<int>(levels_.size()); i++) {
+    Level &level = levels_[i];
+    if (level.frame == nullptr) {
+      continue;
+    }
+
+    if (OB_SUCC(rc) && (level.node_index + 1 != level.node_count ||
+                           IndexNodeHandler(mtr_, handler_.file_header(), level.frame).size() != level.node_size)) {
+      LOG_WARN("bulk load ended unexpectedly. level=%d, node index=%ld, node count=%ld",
+               i, level.node_index, level.node_count);
+      rc = RC::INTERNAL;
+    }
+
+    level.frame->mark_dirty();
+    handler_.buffer_pool().unpin_page(level.frame);
+    level.frame = nullptr;
+  }
+  return rc;
+}
@@ -0,0 +1,106 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "common/lang/string.h"
+#include "common/lang/vector.h"
+#include "common/sys/rc.h"
+#include "storage/index/bplus_tree.h"
+
+/**
+ * @brief 批量构建B+树
+ * @ingroup BPlusTree
+ * @details 给已经有数据的表创建索引时，逐条插入的每一条都要从根节点开始查找、分裂节点并记录日志。
+ * 批量构建先把所有的键值(属性+RID，以及附带的INCLUDE字段)排好序，再从叶子节点开始自底向上构建B+树：
+ * - 内存中最多缓存 memory_limit 字节的键值，超过之后排序并写到一个临时文件中，最后多路归并；
+ * - 每一层的节点个数按照填充率提前算好，键值平均分配到各个节点上，除了根节点每个节点都不少于半满；
+ * - 节点写满一个就链接到前一个叶子节点，同时把第一个键值放到父节点中，各层节点都只写一遍；
+ * - 不记录B+树的日志，构建完成后把整棵树刷到磁盘。
+ * 只能在空的B+树上使用，构建过程中不能有其它线程访问这棵树。
+ */
+class BplusTreeBulkLoader
+{
+public:
+  /**
+   * @param handler 空的B+树
+   * @param tmp_file_prefix 临时文件的路径前缀，排序时会创建 prefix.0、prefix.1 等文件，结束后删除
+   * @param memory_limit 排序使用的内存大小
+   * @param fill_factor 节点的填充率，取值范围 (0, 1]
+   */
+  BplusTreeBulkLoader(
+      BplusTreeHandler &handler, const string &tmp_file_prefix, int64_t memory_limit, double fill_factor);
+  ~BplusTreeBulkLoader();
+
+  /**
+   * @brief 添加一个键值
+   * @param include_data 叶子节点中附带的INCLUDE字段，没有时可以为空
+   * @note user_key 的长度与索引的属性长度一致
+   */
+  RC add(const char *user_key, const RID &rid, const char *include_data = nullptr);
+
+  /**
+   * @brief 排序所有的键值，构建B+树并刷盘
+   */
+  RC finish();
+
+  int64_t key_count() const { return key_count_; }
+  /// @brief 排序时写了多少个临时文件
+  int run_count() const { return static_cast<int>(run_files_.size()); }
+
+private:
+  class RunReader;
+
+  /**
+   * @brief 正在构建的一层节点
+   */
+  struct Level
+  {
+    int64_t item_count = 0;        ///< 这一层所有节点的元素个数之和
+    int64_t node_count = 0;        ///< 这一层的节点个数
+    int64_t node_index = -1;       ///< 当前正在填充的节点是第几个
+    int     node_size  = 0;        ///< 当前节点要放入的元素个数
+    Frame  *frame      = nullptr;  ///< 当前正在填充的节点
+  };
+
+  /// @brief 排序内存中的键值
+  void sort_buffer();
+  /// @brief 排序内存中的键值并写到一个新的临时文件中
+  RC spill();
+  /// @brief 归并所有的临时文件，依次构建B+树
+  RC merge();
+
+  RC build_begin();
+  RC build_add(const char *key);
+  RC build_end();
+
+  /// @brief 计算一层有多少个节点
+  int64_t node_count(int64_t item_count, int max_size) const;
+
+  RC add_to_level(int level_index, const char *key, const char *value);
+  RC start_node(int level_index, const char *key);
+
+private:
+  BplusTreeHandler        &handler_;
+  BplusTreeMiniTransaction mtr_;
+  string                   tmp_file_prefix_;
+  int64_t                  memory_limit_ = 0;
+  double                   fill_factor_  = 1.0;
+  int                      key_length_   = 0;
+  int                      entry_length_ = 0;  ///< 排序的每个元素的长度，键值加上INCLUDE字段
+
+  int64_t              key_count_ = 0;
+  vector<char>         buffer_;     ///< 还没有排序的键值
+  vector<const char *> sorted_;     ///< 排序后的键值，指向 buffer_
+  vector<string>       run_files_;  ///< 排好序的临时文件
+
+  vector<Level> levels_;
+  vector<char>  item_;  ///< 组装节点中的一个元素
+};
@@ -13,66 +13,113 @@ See the Mulan PSL v2 for more details. */
 //
 
 #include "storage/index/bplus_tree_index.h"
+#include "common/conf/ini.h"
+#include "common/ini_setting.h"
+#include "common/lang/string.h"
 #include "common/log/log.h"
+#include "storage/index/bplus_tree_bulk_loader.h"
 #include "storage/table/table.h"
 #include "storage/db/db.h"
 
 BplusTreeIndex::~BplusTreeIndex() noexcept { close(); }
 
-RC BplusTreeIndex::create(Table *table, const char *file_name, const IndexMeta &index_meta, const FieldMeta &field_meta)
+/**
+ * @brief 按照索引元数据中记录的名字找到INCLUDE字段
+ */
+static RC find_include_fields(Table *table, const IndexMeta &index_meta, vector<const FieldMeta *> &include_field_metas)
+{
+  for (const string &field_name : index_meta.include_fields()) {
+    const FieldMeta *field_meta = table->table_meta().field(field_name.c_str());
+    if (nullptr == field_meta) {
+      LOG_WARN("no such include field. index=%s, field=%s", index_meta.name(), field_name.c_str());
+      return RC::SCHEMA_FIELD_MISSING;
+    }
+    include_field_metas.push_back(field_meta);
+  }
+  return RC::SUCCESS;
+}
+
+RC BplusTreeIndex::create(
+    Table *table, const char *file_name, const IndexMeta &index_meta, const vector<const FieldMeta *> &field_metas)
 {
   if (inited_) {
-    LOG_WARN("Failed to create index due to the index has been created before. file_name:%s, index:%s, field:%s",
-        file_name, index_meta.name(), index_meta.field());
+    LOG_WARN("Failed to create index due to the index has been created before. file_name:%s, index:%s",
+        file_name, index_meta.name());
     return RC::RECORD_OPENNED;
   }
 
-  Index::init(index_meta, field_meta);
+  vector<const FieldMeta *> include_field_metas;
+  RC rc = find_include_fields(table, index_meta, include_field_metas);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  Index::init(index_meta, field_metas, include_field_metas);
+
+  vector<AttrType> attr_types;
+  vector<int>      attr_lengths;
+  for (const FieldMeta *field_meta : field_metas) {
+    attr_types.push_back(field_meta->type());
+    attr_lengths.push_back(field_meta->len());
+  }
+
+  int include_length = 0;
+  for (const FieldMeta *field_meta : include_field_metas) {
+    include_length += field_meta->len();
+  }
 
   BufferPoolManager &bpm = table->db()->buffer_pool_manager();
-  RC rc = index_handler_.create(table->db()->log_handler(), bpm, file_name, field_meta.type(), field_meta.len());
+  rc = index_handler_.create(table->db()->log_handler(), bpm, file_name, attr_types, attr_lengths,
+      -1 /*internal_max_size*/, -1 /*leaf_max_size*/, include_length);
   if (RC::SUCCESS != rc) {
-    LOG_WARN("Failed to create index_handler, file_name:%s, index:%s, field:%s, rc:%s",
-        file_name, index_meta.name(), index_meta.field(), strrc(rc));
+    LOG_WARN("Failed to create index_handler, file_name:%s, index:%s, rc:%s",
+        file_name, index_meta.name(), strrc(rc));
     return rc;
   }
 
   inited_ = true;
   table_  = table;
-  LOG_INFO("Successfully create index, file_name:%s, index:%s, field:%s",
-    file_name, index_meta.name(), index_meta.field());
+  LOG_INFO("Successfully create index, file_name:%s, index:%s, field num:%d",
+    file_name, index_meta.name(), index_meta.field_num());
   return RC::SUCCESS;
 }
 
-RC BplusTreeIndex::open(Table *table, const char *file_name, const IndexMeta &index_meta, const FieldMeta &field_meta)
+RC BplusTreeIndex::open(
+    Table *table, const char *file_name, const IndexMeta &index_meta, const vector<const FieldMeta *> &field_metas)
 {
   if (inited_) {
-    LOG_WARN("Failed to open index due to the index has been initedd before. file_name:%s, index:%s, field:%s",
-        file_name, index_meta.name(), index_meta.field());
+    LOG_WARN("Failed to open index due to the index has been initedd before. file_name:%s, index:%s",
+        file_name, index_meta.name());
     return RC::RECORD_OPENNED;
   }
 
-  Index::init(index_meta, field_meta);
+  vector<const FieldMeta *> include_field_metas;
+  RC rc = find_include_fields(table, index_meta, include_field_metas);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  Index::init(index_meta, field_metas, include_field_metas);
 
   BufferPoolManager &bpm = table->db()->buffer_pool_manager();
-  RC rc = index_handler_.open(table->db()->log_handler(), bpm, file_name);
+  rc = index_handler_.open(table->db()->log_handler(), bpm, file_name);
   if (RC::SUCCESS != rc) {
-    LOG_WARN("Failed to open index_handler, file_name:%s, index:%s, field:%s, rc:%s",
-        file_name, index_meta.name(), index_meta.field(), strrc(rc));
+    LOG_WARN("Failed to open index_handler, file_name:%s, index:%s, rc:%s",
+        file_name, index_meta.name(), strrc(rc));
     return rc;
   }
 
   inited_ = true;
   table_  = table;
-  LOG_INFO("Successfully open index, file_name:%s, index:%s, field:%s",
-    file_name, index_meta.name(), index_meta.field());
+  LOG_INFO("Successfully open index, file_name:%s, index:%s, field num:%d",
+    file_name, index_meta.name(), index_meta.field_num());
   return RC::SUCCESS;
 }
 
 RC BplusTreeIndex::close()
 {
   if (inited_) {
-    LOG_INFO("Begin to close index, index:%s, field:%s", index_meta_.name(), index_meta_.field());
+    LOG_INFO("Begin to close index, index:%s", index_meta_.name());
     index_handler_.close();
     inited_ = false;
   }
@@ -80,14 +127,96 @@ RC BplusTreeIndex::close()
   return RC::SUCCESS;
 }
 
+const char *BplusTreeIndex::make_user_key(const char *record, vector<char> &key_buffer) const
+{
+  if (field_metas_.size() == 1) {
+    return record + field_metas_[0].offset();
+  }
+
+  key_buffer.resize(index_handler_.file_header().attr_length);
+  int offset = 0;
+  for (const FieldMeta &field_meta : field_metas_) {
+    memcpy(key_buffer.data() + offset, record + field_meta.offset(), field_meta.len());
+    offset += field_meta.len();
+  }
+  return key_buffer.data();
+}
+
+const char *BplusTreeIndex::make_include_data(const char *record, vector<char> &include_buffer) const
+{
+  if (include_field_metas_.empty()) {
+    return nullptr;
+  }
+
+  include_buffer.resize(index_handler_.file_header().include_length);
+  int offset = 0;
+  for (const FieldMeta &field_meta : include_field_metas_) {
+    memcpy(include_buffer.data() + offset, record + field_meta.offset(), field_meta.len());
+    offset += field_meta.len();
+  }
+  return include_buffer.data();
+}
+
 RC BplusTreeIndex::insert_entry(const char *record, const RID *rid)
 {
-  return index_handler_.insert_entry(record + field_meta_.offset(), rid);
+  vector<char> key_buffer;
+  vector<char> include_buffer;
+  return index_handler_.insert_entry(
+      make_user_key(record, key_buffer), rid, make_include_data(record, include_buffer));
 }
 
 RC BplusTreeIndex::delete_entry(const char *record, const RID *rid)
 {
-  return index_handler_.delete_entry(record + field_meta_.offset(), rid);
+  vector<char> key_buffer;
+  return index_handler_.delete_entry(make_user_key(record, key_buffer), rid);
+}
+
+RC BplusTreeIndex::bulk_load(RecordFileScanner &scanner, const string &tmp_file_prefix)
+{
+  int64_t memory_mb  = 0;
+  string  memory_str = common::get_properties()->get(
+      INDEX_BUILD_SORT_MEMORY_MB, INDEX_BUILD_SORT_MEMORY_MB_DEFAULT, STORAGE);
+  if (!common::str_to_val(memory_str, memory_mb) || memory_mb <= 0) {
+    LOG_ERROR("invalid index build sort memory: %s", memory_str.c_str());
+    return RC::INVALID_ARGUMENT;
+  }
+
+  double fill_factor = 0;
+  string fill_factor_str = common::get_properties()->get(
+      INDEX_BUILD_FILL_FACTOR, INDEX_BUILD_FILL_FACTOR_DEFAULT, STORAGE);
+  if (!common::str_to_val(fill_factor_str, fill_factor) || fill_factor <= 0 || fill_factor > 1) {
+    LOG_ERROR("invalid index build fill factor: %s", fill_factor_str.c_str());
+    return RC::INVALID_ARGUMENT;
+  }
+
+  BplusTreeBulkLoader loader(index_handler_, tmp_file_prefix, memory_mb * 1024 * 1024, fill_factor);
+
+  RC           rc = RC::SUCCESS;
+  Record       record;
+  vector<char> key_buffer;
+  vector<char> include_buffer;
+  while (OB_SUCC(rc = scanner.next(record))) {
+    rc = loader.add(make_user_key(record.data(), key_buffer), record.rid(),
+        make_include_data(record.data(), include_buffer));
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to add key to bulk loader. index=%s, rc=%s", index_meta_.name(), strrc(rc));
+      return rc;
+    }
+  }
+  if (rc != RC::RECORD_EOF) {
+    LOG_WARN("failed to scan records while bulk loading index. index=%s, rc=%s", index_meta_.name(), strrc(rc));
+    return rc;
+  }
+
+  rc = loader.finish();
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to bulk load index. index=%s, rc=%s", index_meta_.name(), strrc(rc));
+    return rc;
+  }
+
+  LOG_INFO("bulk load index done. index=%s, keys=%ld, sort runs=%d",
+           index_meta_.name(), loader.key_count(), loader.run_count());
+  return RC::SUCCESS;
 }
 
 IndexScanner *BplusTreeIndex::create_scanner(
@@ -118,6 +247,11 @@ RC BplusTreeIndexScanner::open(
 
 RC BplusTreeIndexScanner::next_entry(RID *rid) { return tree_scanner_.next_entry(*rid); }
 
+RC BplusTreeIndexScanner::next_entry(RID *rid, const char *&user_key, const char *&include_data)
+{
+  return tree_scanner_.next_entry(*rid, user_key, include_data);
+}
+
 RC BplusTreeIndexScanner::destroy()
 {
   delete this;
@@ -27,13 +27,23 @@ public:
   BplusTreeIndex() = default;
   virtual ~BplusTreeIndex() noexcept;
 
-  RC create(Table *table, const char *file_name, const IndexMeta &index_meta, const FieldMeta &field_meta) override;
-  RC open(Table *table, const char *file_name, const IndexMeta &index_meta, const FieldMeta &field_meta) override;
+  RC create(Table *table, const char *file_name, const IndexMeta &index_meta,
+      const vector<const FieldMeta *> &field_metas) override;
+  RC open(Table *table, const char *file_name, const IndexMeta &index_meta,
+      const vector<const FieldMeta *> &field_metas) override;
   RC close();
 
   RC insert_entry(const char *record, const RID *rid) override;
   RC delete_entry(const char *record, const RID *rid) override;
 
+  /**
+   * @brief 把表中已有的记录批量插入刚创建的空索引
+   * @details 排序所有的键值之后自底向上构建B+树，参考 BplusTreeBulkLoader
+   * @param scanner 遍历表中的记录
+   * @param tmp_file_prefix 排序使用的临时文件的路径前缀
+   */
+  RC bulk_load(RecordFileScanner &scanner, const string &tmp_file_prefix);
+
   /**
    * 扫描指定范围的数据
    */
@@ -42,6 +52,18 @@ public:
 
   RC sync() override;
 
+private:
+  /**
+   * @brief 从记录中取出索引的键值
+   * @details 只有一个字段时直接指向记录中的字段，联合索引把各个字段依次拷贝到 key_buffer 中
+   */
+  const char *make_user_key(const char *record, vector<char> &key_buffer) const;
+
+  /**
+   * @brief 从记录中取出INCLUDE字段，依次拷贝到 include_buffer 中。没有INCLUDE字段时返回空
+   */
+  const char *make_include_data(const char *record, vector<char> &include_buffer) const;
+
 private:
   bool             inited_ = false;
   Table           *table_  = nullptr;
@@ -59,6 +81,7 @@ public:
   ~BplusTreeIndexScanner() noexcept override;
 
   RC next_entry(RID *rid) override;
+  RC next_entry(RID *rid, const char *&user_key, const char *&include_data) override;
   RC destroy() override;
 
   RC open(const char *left_key, int left_len, bool left_inclusive, const char *right_key, int right_len,
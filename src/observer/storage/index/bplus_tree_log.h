@@ -127,6 +127,12 @@ public:
    */
   RC set_parent_page(IndexNodeHandler &node_handler, PageNum page_num, PageNum old_page_num);
 
+  /**
+   * @brief 设置是否记录日志
+   * @details 批量构建B+树时不记录每个页面的修改，构建完成后直接把页面刷到磁盘
+   */
+  void set_need_log(bool need_log) { need_log_ = need_log; }
+
   /**
    * @brief 提交。表示整个操作成功
    */
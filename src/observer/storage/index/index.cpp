@@ -14,9 +14,17 @@ See the Mulan PSL v2 for more details. */
 
 #include "storage/index/index.h"
 
-RC Index::init(const IndexMeta &index_meta, const FieldMeta &field_meta)
+RC Index::init(const IndexMeta &index_meta, const vector<const FieldMeta *> &field_metas,
+    const vector<const FieldMeta *> &include_field_metas)
 {
   index_meta_ = index_meta;
-  field_meta_ = field_meta;
+  field_metas_.clear();
+  for (const FieldMeta *field_meta : field_metas) {
+    field_metas_.push_back(*field_meta);
+  }
+  include_field_metas_.clear();
+  for (const FieldMeta *field_meta : include_field_metas) {
+    include_field_metas_.push_back(*field_meta);
+  }
   return RC::SUCCESS;
 }
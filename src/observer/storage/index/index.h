@@ -40,11 +40,13 @@ public:
   Index()          = default;
   virtual ~Index() = default;
 
-  virtual RC create(Table *table, const char *file_name, const IndexMeta &index_meta, const FieldMeta &field_meta)
+  virtual RC create(Table *table, const char *file_name, const IndexMeta &index_meta,
+      const vector<const FieldMeta *> &field_metas)
   {
     return RC::UNSUPPORTED;
   }
-  virtual RC open(Table *table, const char *file_name, const IndexMeta &index_meta, const FieldMeta &field_meta)
+  virtual RC open(Table *table, const char *file_name, const IndexMeta &index_meta,
+      const vector<const FieldMeta *> &field_metas)
   {
     return RC::UNSUPPORTED;
   }
@@ -53,6 +55,11 @@ public:
 
   const IndexMeta &index_meta() const { return index_meta_; }
 
+  /// @brief 索引包含的字段，按照键值中的顺序排列
+  const vector<FieldMeta> &field_metas() const { return field_metas_; }
+  /// @brief 不参与比较，只存放在索引中的字段
+  const vector<FieldMeta> &include_field_metas() const { return include_field_metas_; }
+
   /**
    * @brief 插入一条数据
    *
@@ -72,6 +79,7 @@ public:
   /**
    * @brief 创建一个索引数据的扫描器
    *
+   * @details 键值是各个字段的值依次拼接而成的，联合索引的边界可以只包含前面几个字段
    * @param left_key 要扫描的左边界
    * @param left_len 左边界的长度
    * @param left_inclusive 是否包含左边界
@@ -89,11 +97,13 @@ public:
   virtual RC sync() = 0;
 
 protected:
-  RC init(const IndexMeta &index_meta, const FieldMeta &field_meta);
+  RC init(const IndexMeta &index_meta, const vector<const FieldMeta *> &field_metas,
+      const vector<const FieldMeta *> &include_field_metas = {});
 
 protected:
-  IndexMeta index_meta_;  ///< 索引的元数据
-  FieldMeta field_meta_;  ///< 当前实现仅考虑一个字段的索引
+  IndexMeta         index_meta_;           ///< 索引的元数据
+  vector<FieldMeta> field_metas_;          ///< 索引包含的字段
+  vector<FieldMeta> include_field_metas_;  ///< 索引中附带的INCLUDE字段
 };
 
 /**
@@ -112,4 +122,10 @@ public:
    */
   virtual RC next_entry(RID *rid) = 0;
   virtual RC destroy()            = 0;
+
+  /**
+   * @brief 遍历元素数据，同时返回索引中存放的键值和INCLUDE字段
+   * @details 覆盖索引扫描时使用。返回的指针在下一次调用 next_entry 之前有效
+   */
+  virtual RC next_entry(RID *rid, const char *&user_key, const char *&include_data) { return RC::UNSUPPORTED; }
 };
@@ -21,51 +21,137 @@ See the Mulan PSL v2 for more details. */
 
 const static Json::StaticString FIELD_NAME("name");
 const static Json::StaticString FIELD_FIELD_NAME("field_name");
+const static Json::StaticString FIELD_FIELD_NAMES("field_names");
+const static Json::StaticString FIELD_INCLUDE_FIELD_NAMES("include_field_names");
 
-RC IndexMeta::init(const char *name, const FieldMeta &field)
+static RC fields_from_json(
+    const TableMeta &table, const char *index_name, const Json::Value &fields_value, vector<const FieldMeta *> &fields)
+{
+  for (const Json::Value &field_value : fields_value) {
+    if (!field_value.isString()) {
+      LOG_ERROR("Field name of index [%s] is not a string. json value=%s",
+          index_name, field_value.toStyledString().c_str());
+      return RC::INTERNAL;
+    }
+
+    const FieldMeta *field = table.field(field_value.asCString());
+    if (nullptr == field) {
+      LOG_ERROR("Deserialize index [%s]: no such field: %s", index_name, field_value.asCString());
+      return RC::SCHEMA_FIELD_MISSING;
+    }
+    fields.push_back(field);
+  }
+  return RC::SUCCESS;
+}
+
+RC IndexMeta::init(const char *name, const vector<const FieldMeta *> &fields,
+    const vector<const FieldMeta *> &include_fields)
 {
   if (common::is_blank(name)) {
     LOG_ERROR("Failed to init index, name is empty.");
     return RC::INVALID_ARGUMENT;
   }
 
-  name_  = name;
-  field_ = field.name();
+  if (fields.empty()) {
+    LOG_ERROR("Failed to init index, no field. name=%s", name);
+    return RC::INVALID_ARGUMENT;
+  }
+
+  name_ = name;
+  fields_.clear();
+  for (const FieldMeta *field : fields) {
+    fields_.push_back(field->name());
+  }
+  include_fields_.clear();
+  for (const FieldMeta *field : include_fields) {
+    include_fields_.push_back(field->name());
+  }
   return RC::SUCCESS;
 }
 
 void IndexMeta::to_json(Json::Value &json_value) const
 {
-  json_value[FIELD_NAME]       = name_;
-  json_value[FIELD_FIELD_NAME] = field_;
+  json_value[FIELD_NAME] = name_;
+
+  Json::Value fields_value(Json::arrayValue);
+  for (const string &field : fields_) {
+    fields_value.append(field);
+  }
+  json_value[FIELD_FIELD_NAMES] = std::move(fields_value);
+
+  if (!include_fields_.empty()) {
+    Json::Value include_fields_value(Json::arrayValue);
+    for (const string &field : include_fields_) {
+      include_fields_value.append(field);
+    }
+    json_value[FIELD_INCLUDE_FIELD_NAMES] = std::move(include_fields_value);
+  }
 }
 
 RC IndexMeta::from_json(const TableMeta &table, const Json::Value &json_value, IndexMeta &index)
 {
-  const Json::Value &name_value  = json_value[FIELD_NAME];
-  const Json::Value &field_value = json_value[FIELD_FIELD_NAME];
+  const Json::Value &name_value = json_value[FIELD_NAME];
   if (!name_value.isString()) {
     LOG_ERROR("Index name is not a string. json value=%s", name_value.toStyledString().c_str());
     return RC::INTERNAL;
   }
 
-  if (!field_value.isString()) {
-    LOG_ERROR("Field name of index [%s] is not a string. json value=%s",
-        name_value.asCString(), field_value.toStyledString().c_str());
+  // 只有一个字段的索引以前记录在 field_name 中
+  Json::Value fields_value = json_value[FIELD_FIELD_NAMES];
+  if (fields_value.isNull()) {
+    fields_value = Json::Value(Json::arrayValue);
+    fields_value.append(json_value[FIELD_FIELD_NAME]);
+  }
+
+  if (!fields_value.isArray() || fields_value.empty()) {
+    LOG_ERROR("Field names of index [%s] is not an array. json value=%s",
+        name_value.asCString(), fields_value.toStyledString().c_str());
     return RC::INTERNAL;
   }
 
-  const FieldMeta *field = table.field(field_value.asCString());
-  if (nullptr == field) {
-    LOG_ERROR("Deserialize index [%s]: no such field: %s", name_value.asCString(), field_value.asCString());
-    return RC::SCHEMA_FIELD_MISSING;
+  vector<const FieldMeta *> fields;
+  RC rc = fields_from_json(table, name_value.asCString(), fields_value, fields);
+  if (OB_FAIL(rc)) {
+    return rc;
   }
 
-  return index.init(name_value.asCString(), *field);
+  vector<const FieldMeta *> include_fields;
+  const Json::Value        &include_fields_value = json_value[FIELD_INCLUDE_FIELD_NAMES];
+  if (!include_fields_value.isNull()) {
+    if (!include_fields_value.isArray()) {
+      LOG_ERROR("Include field names of index [%s] is not an array. json value=%s",
+          name_value.asCString(), include_fields_value.toStyledString().c_str());
+      return RC::INTERNAL;
+    }
+    rc = fields_from_json(table, name_value.asCString(), include_fields_value, include_fields);
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+  }
+
+  return index.init(name_value.asCString(), fields, include_fields);
 }
 
 const char *IndexMeta::name() const { return name_.c_str(); }
 
-const char *IndexMeta::field() const { return field_.c_str(); }
+const char *IndexMeta::field() const { return fields_.front().c_str(); }
 
-void IndexMeta::desc(ostream &os) const { os << "index name=" << name_ << ", field=" << field_; }
\ No newline at end of file
+void IndexMeta::desc(ostream &os) const
+{
+  os << "index name=" << name_ << ", fields=";
+  for (size_t i = 0; i < fields_.size(); i++) {
+    if (i != 0) {
+      os << ",";
+    }
+    os << fields_[i];
+  }
+  if (!include_fields_.empty()) {
+    os << ", include=";
+    for (size_t i = 0; i < include_fields_.size(); i++) {
+      if (i != 0) {
+        os << ",";
+      }
+      os << include_fields_[i];
+    }
+  }
+}
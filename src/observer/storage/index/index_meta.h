@@ -16,6 +16,7 @@ See the Mulan PSL v2 for more details. */
 
 #include "common/sys/rc.h"
 #include "common/lang/string.h"
+#include "common/lang/vector.h"
 
 class TableMeta;
 class FieldMeta;
@@ -28,6 +29,8 @@ class Value;
  * @brief 描述一个索引
  * @ingroup Index
  * @details 一个索引包含了表的哪些字段，索引的名称等。
+ * 包含多个字段时，键值按照字段的顺序比较，即联合索引。
+ * INCLUDE 字段不参与比较，只是存放在叶子节点中，查询只用到索引中的字段时可以不读取记录。
  * 如果以后实现了多种类型的索引，还需要记录索引的类型，对应类型的一些元数据等
  */
 class IndexMeta
@@ -35,11 +38,18 @@ class IndexMeta
 public:
   IndexMeta() = default;
 
-  RC init(const char *name, const FieldMeta &field);
+  RC init(const char *name, const vector<const FieldMeta *> &fields,
+      const vector<const FieldMeta *> &include_fields = {});
 
 public:
   const char *name() const;
+  /// @brief 第一个字段
   const char *field() const;
+  /// @brief 索引包含的所有字段，按照键值中的顺序排列
+  const vector<string> &fields() const { return fields_; }
+  int                   field_num() const { return static_cast<int>(fields_.size()); }
+  /// @brief 存放在叶子节点中的INCLUDE字段
+  const vector<string> &include_fields() const { return include_fields_; }
 
   void desc(ostream &os) const;
 
@@ -48,6 +58,7 @@ public:
   static RC from_json(const TableMeta &table, const Json::Value &json_value, IndexMeta &index);
 
 protected:
-  string name_;   // index's name
-  string field_;  // field's name
+  string         name_;            // index's name
+  vector<string> fields_;          // fields' name
+  vector<string> include_fields_;  // include fields' name
 };
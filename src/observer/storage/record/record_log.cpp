@@ -37,6 +37,7 @@ string RecordOperation::to_string() const
     case Type::INSERT: return ret + "INSERT";
     case Type::DELETE: return ret + "DELETE";
     case Type::UPDATE: return ret + "UPDATE";
+    case Type::UPDATE_DELTA: return ret + "UPDATE_DELTA";
     default: return ret + "UNKNOWN";
   }
 }
@@ -58,7 +59,8 @@ string RecordLogHeader::to_string() const
     } break;
     case RecordOperation::Type::INSERT:
     case RecordOperation::Type::DELETE:
-    case RecordOperation::Type::UPDATE: {
+    case RecordOperation::Type::UPDATE:
+    case RecordOperation::Type::UPDATE_DELTA: {
       ss << ", slot_num:" << slot_num;
     } break;
     default: {
@@ -129,18 +131,71 @@ RC RecordLogHandler::insert_record(Frame *frame, const RID &rid, const char *rec
   return rc;
 }
 
-RC RecordLogHandler::update_record(Frame *frame, const RID &rid, const char *record)
+RC RecordLogHandler::update_record(Frame *frame, const RID &rid, const char *old_record, const char *record)
 {
-  const int        log_payload_size = RecordLogHeader::SIZE + record_size_;
-  vector<char>     log_payload(log_payload_size);
+  vector<char> log_payload(RecordLogHeader::SIZE);
   RecordLogHeader *header = reinterpret_cast<RecordLogHeader *>(log_payload.data());
   header->buffer_pool_id  = buffer_pool_id_;
-  header->operation_type  = RecordOperation(RecordOperation::Type::UPDATE).type_id();
+  header->operation_type  = RecordOperation(RecordOperation::Type::UPDATE_DELTA).type_id();
   header->page_num        = rid.page_num;
   header->slot_num        = rid.slot_num;
   header->storage_format  = static_cast<int>(storage_format_);
+
+  if (old_record != nullptr && old_record != record) {
+    if (encode_delta(old_record, record, log_payload)) {
+      if (log_payload.size() == static_cast<size_t>(RecordLogHeader::SIZE)) {
+        // 数据没有变化
+        return RC::SUCCESS;
+      }
+      return append_log(frame, std::move(log_payload));
+    }
+  }
+
+  log_payload.resize(RecordLogHeader::SIZE + record_size_);
+  header                 = reinterpret_cast<RecordLogHeader *>(log_payload.data());
+  header->operation_type = RecordOperation(RecordOperation::Type::UPDATE).type_id();
   memcpy(log_payload.data() + RecordLogHeader::SIZE, record, record_size_);
+  return append_log(frame, std::move(log_payload));
+}
+
+bool RecordLogHandler::encode_delta(const char *old_record, const char *record, vector<char> &delta) const
+{
+  // 每一段修改需要8个字节的偏移和长度，间隔小于这个值的两段修改合并成一段更省空间
+  const int32_t segment_header_size = 2 * sizeof(int32_t);
+  const size_t  full_size           = delta.size() + record_size_;
+
+  int32_t pos = 0;
+  while (pos < record_size_) {
+    if (old_record[pos] == record[pos]) {
+      pos++;
+      continue;
+    }
+
+    const int32_t begin = pos;
+    int32_t       end   = pos + 1;  // 当前这一段修改的结束位置(不包含)
+    for (pos = end; pos < record_size_ && pos - end < segment_header_size; pos++) {
+      if (old_record[pos] != record[pos]) {
+        end = pos + 1;
+      }
+    }
 
+    const int32_t length = end - begin;
+    if (delta.size() + segment_header_size + length >= full_size) {
+      return false;
+    }
+
+    const size_t offset = delta.size();
+    delta.resize(offset + segment_header_size + length);
+    memcpy(delta.data() + offset, &begin, sizeof(begin));
+    memcpy(delta.data() + offset + sizeof(begin), &length, sizeof(length));
+    memcpy(delta.data() + offset + segment_header_size, record + begin, length);
+    pos = end;
+  }
+  return true;
+}
+
+RC RecordLogHandler::append_log(Frame *frame, vector<char> &&log_payload)
+{
   LSN lsn = 0;
   RC  rc  = log_handler_->append(lsn, LogModule::Id::RECORD_MANAGER, std::move(log_payload));
   if (OB_SUCC(rc) && lsn > 0) {
@@ -226,6 +281,9 @@ RC RecordLogReplayer::replay(const LogEntry &entry)
     case RecordOperation::Type::UPDATE: {
       rc = replay_update(*buffer_pool, *log_header);
     } break;
+    case RecordOperation::Type::UPDATE_DELTA: {
+      rc = replay_update_delta(*buffer_pool, *log_header, entry.payload_size() - RecordLogHeader::SIZE);
+    } break;
     default: {
       LOG_WARN("unknown record operation type: %d", log_header->operation_type);
       return RC::INVALID_ARGUMENT;
@@ -329,3 +387,56 @@ RC RecordLogReplayer::replay_update(DiskBufferPool &buffer_pool, const RecordLog
 
   return rc;
 }
+
+RC RecordLogReplayer::replay_update_delta(DiskBufferPool &buffer_pool, const RecordLogHeader &header, int32_t delta_size)
+{
+  VacuousLogHandler             vacuous_log_handler;
+  unique_ptr<RecordPageHandler> record_page_handler(RecordPageHandler::create(StorageFormat(header.storage_format)));
+
+  RC rc = record_page_handler->init(buffer_pool, vacuous_log_handler, header.page_num, ReadWriteMode::READ_WRITE);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("fail to init record page handler. page num=%d, rc=%s", header.page_num, strrc(rc));
+    return rc;
+  }
+
+  RID    rid(header.page_num, header.slot_num);
+  Record inplace_record;
+  rc = record_page_handler->get_record(rid, inplace_record);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("fail to get record to recover update. page num=%d, slot num=%d, rc=%s", 
+             header.page_num, header.slot_num, strrc(rc));
+    return rc;
+  }
+
+  Record record;
+  record.copy_data(inplace_record.data(), inplace_record.len());
+
+  const int32_t segment_header_size = 2 * sizeof(int32_t);
+  for (int32_t pos = 0; pos < delta_size;) {
+    int32_t offset = 0;
+    int32_t length = 0;
+    if (pos + segment_header_size > delta_size) {
+      LOG_WARN("invalid update delta log. header=%s", header.to_string().c_str());
+      return RC::LOG_ENTRY_INVALID;
+    }
+    memcpy(&offset, header.data + pos, sizeof(offset));
+    memcpy(&length, header.data + pos + sizeof(offset), sizeof(length));
+    pos += segment_header_size;
+    if (offset < 0 || length <= 0 || offset + length > record.len() || pos + length > delta_size) {
+      LOG_WARN("invalid update delta log. header=%s, offset=%d, length=%d", header.to_string().c_str(), offset, length);
+      return RC::LOG_ENTRY_INVALID;
+    }
+
+    memcpy(record.data() + offset, header.data + pos, length);
+    pos += length;
+  }
+
+  rc = record_page_handler->update_record(rid, record.data());
+  if (OB_FAIL(rc)) {
+    LOG_WARN("fail to recover update record. page num=%d, slot num=%d, rc=%s", 
+             header.page_num, header.slot_num, strrc(rc));
+    return rc;
+  }
+
+  return rc;
+}
@@ -20,6 +20,7 @@ See the Mulan PSL v2 for more details. */
 #include "common/sys/rc.h"
 #include "common/lang/span.h"
 #include "common/lang/string.h"
+#include "common/lang/vector.h"
 #include "storage/clog/log_replayer.h"
 #include "sql/parser/parse_defs.h"
 
@@ -40,8 +41,9 @@ public:
   {
     INIT_PAGE,  /// 初始化空页面
     INSERT,     /// 插入一条记录
-    DELETE,     /// 删除一条记录
-    UPDATE      /// 更新一条记录
+    DELETE,       /// 删除一条记录
+    UPDATE,       /// 更新一条记录，记录更新后完整的数据
+    UPDATE_DELTA  /// 更新一条记录，只记录修改过的部分，见 RecordLogHandler::update_record
   };
 
 public:
@@ -120,10 +122,23 @@ public:
    * @brief 更新一条记录
    * @param frame 页帧
    * @param rid 记录的位置
+   * @param old_record 更新前的记录，为空或者与 record 相同(原地修改)时记录完整的数据
    * @param record 更新后的记录。不需要做回滚，所以不用记录原先的数据
-   * @details 更新数据时，通常只更新其中几个字段，这里记录所有数据，是可以优化的。
+   * @details 更新数据时通常只修改其中几个字段，比如事务提交时只修改事务ID字段。
+   * 给出更新前的记录时，只记录修改过的部分(UPDATE_DELTA)：日志数据是多个 (int32 偏移, int32 长度, 新的数据)，
+   * 间隔很近的修改合并成一段。修改的部分不比完整的记录小时，仍然记录完整的数据(UPDATE)。
+   * 数据没有变化时不记录日志。
    */
-  RC update_record(Frame *frame, const RID &rid, const char *record);
+  RC update_record(Frame *frame, const RID &rid, const char *old_record, const char *record);
+
+private:
+  RC append_log(Frame *frame, vector<char> &&log_payload);
+
+  /**
+   * @brief 把新旧记录之间的差异编码到 delta 后面
+   * @return 差异编码后是否比完整的记录小
+   */
+  bool encode_delta(const char *old_record, const char *record, vector<char> &delta) const;
 
 private:
   LogHandler   *log_handler_    = nullptr;
@@ -149,6 +164,7 @@ private:
   RC replay_insert(DiskBufferPool &buffer_pool, const RecordLogHeader &log_header);
   RC replay_delete(DiskBufferPool &buffer_pool, const RecordLogHeader &log_header);
   RC replay_update(DiskBufferPool &buffer_pool, const RecordLogHeader &log_header);
+  RC replay_update_delta(DiskBufferPool &buffer_pool, const RecordLogHeader &log_header, int32_t delta_size);
 
 private:
   BufferPoolManager &bpm_;
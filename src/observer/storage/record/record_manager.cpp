@@ -12,6 +12,7 @@ See the Mulan PSL v2 for more details. */
 // Created by Meiyi & Longda on 2021/4/13.
 //
 #include "storage/record/record_manager.h"
+#include "common/lang/algorithm.h"
 #include "common/log/log.h"
 #include "storage/common/condition_filter.h"
 #include "storage/trx/trx.h"
@@ -364,20 +365,21 @@ RC RowRecordPageHandler::update_record(const RID &rid, const char *data)
   if (bitmap.get_bit(rid.slot_num)) {
     frame_->mark_dirty();
 
+    // 先记录日志，修改前的数据用来计算只记录修改部分的日志
     char *record_data = get_record_data(rid.slot_num);
-    if (record_data == data) {
-      // nothing to do
-    } else {
-      memcpy(record_data, data, page_header_->record_real_size);
-    }
-
-    RC rc = log_handler_.update_record(frame_, rid, data);
+    RC    rc          = log_handler_.update_record(frame_, rid, record_data, data);
     if (OB_FAIL(rc)) {
       LOG_ERROR("Failed to update record. page_num %d:%d. rc=%s", 
                 disk_buffer_pool_->file_desc(), frame_->page_num(), strrc(rc));
       // return rc; // ignore errors
     }
 
+    if (record_data == data) {
+      // nothing to do
+    } else {
+      memcpy(record_data, data, page_header_->record_real_size);
+    }
+
     return RC::SUCCESS;
   } else {
     LOG_DEBUG("Invalid slot_num %d, slot is empty, page_num %d.", rid.slot_num, frame_->page_num());
@@ -502,6 +504,7 @@ void RecordFileHandler::close()
 {
   if (disk_buffer_pool_ != nullptr) {
     free_pages_.clear();
+    all_visible_pages_.clear();
     disk_buffer_pool_ = nullptr;
     log_handler_      = nullptr;
     table_meta_       = nullptr;
@@ -602,7 +605,11 @@ RC RecordFileHandler::insert_record(const char *data, int record_size, RID *rid)
   }
 
   // 找到空闲位置
-  return record_page_handler->insert_record(data, rid);
+  ret = record_page_handler->insert_record(data, rid);
+  if (OB_SUCC(ret)) {
+    clear_all_visible(current_page_num);
+  }
+  return ret;
 }
 
 RC RecordFileHandler::recover_insert_record(const char *data, int record_size, const RID &rid)
@@ -617,7 +624,11 @@ RC RecordFileHandler::recover_insert_record(const char *data, int record_size, c
     return ret;
   }
 
-  return record_page_handler->recover_insert_record(data, rid);
+  ret = record_page_handler->recover_insert_record(data, rid);
+  if (OB_SUCC(ret)) {
+    clear_all_visible(rid.page_num);
+  }
+  return ret;
 }
 
 RC RecordFileHandler::delete_record(const RID *rid)
@@ -633,6 +644,9 @@ RC RecordFileHandler::delete_record(const RID *rid)
   }
 
   rc = record_page_handler->delete_record(rid);
+  if (OB_SUCC(rc)) {
+    clear_all_visible(rid->page_num);
+  }
   // 📢 这里注意要清理掉资源，否则会与insert_record中的加锁顺序冲突而可能出现死锁
   // delete record的加锁逻辑是拿到页面锁，删除指定记录，然后加上和释放record manager锁
   // insert record是加上 record manager锁，然后拿到指定页面锁再释放record manager锁
@@ -696,10 +710,85 @@ RC RecordFileHandler::visit_record(const RID &rid, function<bool(Record &)> upda
   bool updated = updater(record);
   if (updated) {
     rc = page_handler->update_record(rid, record.data());
+    clear_all_visible(rid.page_num);
   }
   return rc;
 }
 
+RC RecordFileHandler::collect_records(PageNum &page_num, int max_pages, function<bool(const Record &)> filter,
+    vector<Record> &records, int &page_count, function<bool(const Record &)> visible_filter)
+{
+  page_count = 0;
+
+  // 第0个页面是buffer pool的文件头，记录从第1个页面开始
+  BufferPoolIterator bp_iterator;
+  RC                 rc = bp_iterator.init(*disk_buffer_pool_, max(page_num, PageNum(1)));
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to init bp iterator. rc=%s", strrc(rc));
+    return rc;
+  }
+
+  unique_ptr<RecordPageHandler> page_handler(RecordPageHandler::create(storage_format_));
+  while (page_count < max_pages && bp_iterator.has_next()) {
+    PageNum current_page = bp_iterator.next();
+    rc                   = page_handler->init(*disk_buffer_pool_, *log_handler_, current_page, ReadWriteMode::READ_ONLY);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to init record page handler. page_num=%d, rc=%s", current_page, strrc(rc));
+      return rc;
+    }
+
+    RecordPageIterator page_iterator;
+    page_iterator.init(page_handler.get());
+    Record record;
+    bool   all_visible = visible_filter != nullptr;
+    while (page_iterator.has_next()) {
+      rc = page_iterator.next(record);
+      if (OB_FAIL(rc)) {
+        break;
+      }
+      if (filter(record)) {
+        records.emplace_back();
+        records.back().copy_data(record.data(), record.len());
+        records.back().set_rid(record.rid());
+      }
+      if (all_visible && !visible_filter(record)) {
+        all_visible = false;
+      }
+    }
+
+    // 还持有页面的读锁，修改记录的线程会在拿到写锁之后清除标记
+    if (OB_SUCC(rc) && all_visible) {
+      visible_lock_.lock();
+      all_visible_pages_.insert(current_page);
+      visible_lock_.unlock();
+    }
+    page_handler->cleanup();
+    page_count++;
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to fetch record. page_num=%d, rc=%s", current_page, strrc(rc));
+      return rc;
+    }
+  }
+
+  page_num = bp_iterator.has_next() ? bp_iterator.next() : BP_INVALID_PAGE_NUM;
+  return RC::SUCCESS;
+}
+
+bool RecordFileHandler::all_visible(PageNum page_num) const
+{
+  visible_lock_.lock_shared();
+  bool visible = all_visible_pages_.count(page_num) > 0;
+  visible_lock_.unlock_shared();
+  return visible;
+}
+
+void RecordFileHandler::clear_all_visible(PageNum page_num)
+{
+  visible_lock_.lock();
+  all_visible_pages_.erase(page_num);
+  visible_lock_.unlock();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 RecordFileScanner::~RecordFileScanner() { close_scan(); }
@@ -720,6 +809,7 @@ RC RecordFileScanner::open_scan(Table *table, DiskBufferPool &buffer_pool, Trx *
     LOG_WARN("failed to init bp iterator. rc=%d:%s", rc, strrc(rc));
     return rc;
   }
+  bp_iterator_.set_read_ahead(BufferPoolIterator::DEFAULT_READ_AHEAD_PAGES);
   condition_filter_ = condition_filter;
   if (table == nullptr || table->table_meta().storage_format() == StorageFormat::ROW_FORMAT) {
     record_page_handler_ = new RowRecordPageHandler();
@@ -885,6 +975,7 @@ RC ChunkFileScanner::open_scan_chunk(
     LOG_WARN("failed to init bp iterator. rc=%d:%s", rc, strrc(rc));
     return rc;
   }
+  bp_iterator_.set_read_ahead(BufferPoolIterator::DEFAULT_READ_AHEAD_PAGES);
   if (table == nullptr || table->table_meta().storage_format() == StorageFormat::ROW_FORMAT) {
     record_page_handler_ = new RowRecordPageHandler();
   } else {
@@ -16,6 +16,7 @@ See the Mulan PSL v2 for more details. */
 
 #include "common/lang/bitmap.h"
 #include "common/lang/sstream.h"
+#include "common/lang/unordered_set.h"
 #include "storage/buffer/disk_buffer_pool.h"
 #include "storage/common/chunk.h"
 #include "storage/record/record.h"
@@ -401,6 +402,33 @@ public:
 
   RC visit_record(const RID &rid, function<bool(Record &)> updater);
 
+  /**
+   * @brief 从指定页面开始，复制出若干个页面中满足条件的记录
+   * @details 每个页面只在复制记录的时候加读锁，调用者可以在之后再删除这些记录。清理旧版本记录时使用
+   * @param[in,out] page_num 从哪个页面开始，返回下次开始的页面，所有页面都访问完时返回 BP_INVALID_PAGE_NUM
+   * @param max_pages        最多访问多少个页面
+   * @param filter           返回 true 的记录才会复制出来
+   * @param[out] records     复制出来的记录
+   * @param[out] page_count  实际访问的页面个数
+   * @param visible_filter   不为空时，如果页面上所有的记录都满足这个条件，就把页面标记为对所有事务可见
+   */
+  RC collect_records(PageNum &page_num, int max_pages, function<bool(const Record &)> filter, vector<Record> &records,
+      int &page_count, function<bool(const Record &)> visible_filter = nullptr);
+
+  /**
+   * @brief 页面上的记录是否对所有事务都可见
+   * @details 可见性标记只保存在内存中，由 collect_records 设置，修改页面上的记录时清除，重启后要重新设置。
+   * 覆盖索引扫描时，有标记的页面不需要再读取记录判断可见性
+   */
+  bool all_visible(PageNum page_num) const;
+
+private:
+  /**
+   * @brief 清除页面的可见性标记
+   * @details 需要在持有页面写锁时调用，这样不会与 collect_records 设置标记交错
+   */
+  void clear_all_visible(PageNum page_num);
+
 private:
   /**
    * @brief 初始化当前没有填满记录的页面，初始化free_pages_成员
@@ -412,6 +440,8 @@ private:
   LogHandler            *log_handler_      = nullptr;  ///< 记录日志的处理器
   unordered_set<PageNum> free_pages_;                  ///< 没有填充满的页面集合
   common::Mutex          lock_;  ///< 当编译时增加-DCONCURRENCY=ON 选项时，才会真正的支持并发
+  unordered_set<PageNum> all_visible_pages_;           ///< 记录都对所有事务可见的页面
+  mutable common::SharedMutex visible_lock_;           ///< 保护 all_visible_pages_
   StorageFormat          storage_format_;
   TableMeta             *table_meta_;
 };
@@ -80,16 +80,29 @@ public:
   RC delete_record(const RID &rid);
   RC get_record(const RID &rid, Record &record);
 
+  /**
+   * @brief 删除一条没有事务能看到的旧版本记录
+   * @details 与 delete_record 不同，索引中可能没有这条记录，比如记录删除之后才创建的索引，这种情况会忽略
+   */
+  RC purge_record(const Record &record);
+
   RC recover_insert_record(Record &record);
 
   // TODO refactor
-  RC create_index(Trx *trx, const FieldMeta *field_meta, const char *index_name);
+  /**
+   * @brief 创建索引
+   * @param field_metas 索引包含的字段，多个字段时按照顺序组成联合索引
+   * @param include_field_metas 只存放在索引叶子节点中的字段
+   */
+  RC create_index(Trx *trx, const vector<const FieldMeta *> &field_metas, const char *index_name,
+      const vector<const FieldMeta *> &include_field_metas = {});
 
   RC get_record_scanner(RecordFileScanner &scanner, Trx *trx, ReadWriteMode mode);
 
   RC get_chunk_scanner(ChunkFileScanner &scanner, Trx *trx, ReadWriteMode mode);
 
   RecordFileHandler *record_handler() const { return record_handler_; }
+  DiskBufferPool    *data_buffer_pool() const { return data_buffer_pool_; }
 
   /**
    * @brief 可以在页面锁保护的情况下访问记录
@@ -120,8 +133,11 @@ private:
 
 public:
   Index *find_index(const char *index_name) const;
+  /// @brief 第一个字段是 field_name 的索引
   Index *find_index_by_field(const char *field_name) const;
 
+  const vector<Index *> &indexes() const { return indexes_; }
+
 private:
   Db                *db_ = nullptr;
   string             base_dir_;
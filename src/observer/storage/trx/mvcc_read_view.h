@@ -0,0 +1,56 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "common/lang/algorithm.h"
+#include "common/lang/vector.h"
+
+/**
+ * @brief 多版本事务的一致性快照
+ * @ingroup Transaction
+ * @details 记录上保存的事务号，没有提交时是负的事务号，提交后是提交时分配的事务号(commit xid)。
+ * 事务号和 commit xid 使用同一个计数器分配，比快照的事务号小的 commit xid 一般都已经提交了，
+ * 但是提交需要逐条修改记录，并不是原子的。快照记录了创建时正在提交的 commit xid，
+ * 它们提交的数据即使已经修改到了记录上，对这个快照也不可见。
+ * 快照创建之后就不会再修改，判断可见性时不需要加锁。
+ */
+class MvccReadView
+{
+public:
+  MvccReadView() = default;
+
+  /**
+   * @param trx_id 创建快照的事务号
+   * @param committing_xids 创建快照时正在提交的 commit xid，需要有序
+   */
+  MvccReadView(int32_t trx_id, vector<int32_t> committing_xids)
+      : trx_id_(trx_id), committing_xids_(std::move(committing_xids))
+  {}
+
+  int32_t trx_id() const { return trx_id_; }
+
+  /// @brief 使用 commit_xid 提交的数据对当前快照是否可见
+  bool is_visible(int32_t commit_xid) const
+  {
+    return commit_xid <= trx_id_ &&
+           (committing_xids_.empty() || !binary_search(committing_xids_.begin(), committing_xids_.end(), commit_xid));
+  }
+
+  /**
+   * @brief 比这个值小的 commit xid 对当前快照都是可见的
+   * @details 清理旧版本记录时使用，删除的 commit xid 比所有快照的 low_limit 都小时，就没有事务能看到这条记录了
+   */
+  int32_t low_limit() const { return committing_xids_.empty() ? trx_id_ : min(trx_id_, committing_xids_.front()); }
+
+private:
+  int32_t         trx_id_ = 0;
+  vector<int32_t> committing_xids_;  ///< 有序
+};
@@ -16,7 +16,93 @@ See the Mulan PSL v2 for more details. */
 #include "storage/db/db.h"
 #include "storage/field/field.h"
 #include "storage/trx/mvcc_trx_log.h"
+#include "common/conf/ini.h"
+#include "common/ini_setting.h"
 #include "common/lang/algorithm.h"
+#include "common/lang/string.h"
+
+void MvccActiveTrxTable::insert(int32_t trx_id, MvccTrx *trx)
+{
+  Shard &s = shard(trx_id);
+  s.lock.lock();
+  s.trxes[trx_id] = trx;
+  s.lock.unlock();
+}
+
+void MvccActiveTrxTable::erase(int32_t trx_id)
+{
+  Shard &s = shard(trx_id);
+  s.lock.lock();
+  s.trxes.erase(trx_id);
+  s.lock.unlock();
+}
+
+MvccTrx *MvccActiveTrxTable::find(int32_t trx_id)
+{
+  Shard &s = shard(trx_id);
+  s.lock.lock();
+  auto     iter = s.trxes.find(trx_id);
+  MvccTrx *trx  = iter == s.trxes.end() ? nullptr : iter->second;
+  s.lock.unlock();
+  return trx;
+}
+
+int32_t MvccActiveTrxTable::min_low_limit(int32_t limit)
+{
+  for (Shard &s : shards_) {
+    s.lock.lock();
+    for (auto &pair : s.trxes) {
+      limit = min(limit, pair.second->read_view().low_limit());
+    }
+    s.lock.unlock();
+  }
+  return limit;
+}
+
+LSN MvccActiveTrxTable::min_first_lsn(LSN limit)
+{
+  for (Shard &s : shards_) {
+    s.lock.lock();
+    for (auto &pair : s.trxes) {
+      const LSN first_lsn = pair.second->first_lsn();
+      if (first_lsn > 0) {
+        limit = min(limit, first_lsn);
+      }
+    }
+    s.lock.unlock();
+  }
+  return limit;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void MvccCommitTable::insert(int32_t trx_id, int32_t commit_xid)
+{
+  Shard &s = shard(trx_id);
+  s.lock.lock();
+  s.commit_xids[trx_id] = commit_xid;
+  s.lock.unlock();
+}
+
+void MvccCommitTable::erase(int32_t trx_id)
+{
+  Shard &s = shard(trx_id);
+  s.lock.lock();
+  s.commit_xids.erase(trx_id);
+  s.lock.unlock();
+}
+
+int32_t MvccCommitTable::find(int32_t trx_id)
+{
+  Shard &s = shard(trx_id);
+  s.lock.lock();
+  auto    iter       = s.commit_xids.find(trx_id);
+  int32_t commit_xid = iter == s.commit_xids.end() ? 0 : iter->second;
+  s.lock.unlock();
+  return commit_xid;
+}
+
+////////////////////////////////////////////////////////////////////////////////
 
 MvccTrxKit::~MvccTrxKit()
 {
@@ -36,16 +122,203 @@ RC MvccTrxKit::init()
       FieldMeta("__trx_xid_begin", AttrType::INTS, 0 /*attr_offset*/, 4 /*attr_len*/, false /*visible*/, -1/*field_id*/),
       FieldMeta("__trx_xid_end", AttrType::INTS, 0 /*attr_offset*/, 4 /*attr_len*/, false /*visible*/, -2/*field_id*/)};
 
-  LOG_INFO("init mvcc trx kit done.");
+  int    lock_wait_timeout_ms = 0;
+  string timeout_str = common::get_properties()->get(LOCK_WAIT_TIMEOUT_MS, LOCK_WAIT_TIMEOUT_MS_DEFAULT, STORAGE);
+  if (!common::str_to_val(timeout_str, lock_wait_timeout_ms) || lock_wait_timeout_ms < 0) {
+    LOG_ERROR("invalid lock wait timeout: %s", timeout_str.c_str());
+    return RC::INVALID_ARGUMENT;
+  }
+  lock_manager_.init(lock_wait_timeout_ms);
+
+  LOG_INFO("init mvcc trx kit done. lock wait timeout=%dms", lock_wait_timeout_ms);
   return RC::SUCCESS;
 }
 
 const vector<FieldMeta> *MvccTrxKit::trx_fields() const { return &fields_; }
 
-int32_t MvccTrxKit::next_trx_id() { return ++current_trx_id_; }
-
 int32_t MvccTrxKit::max_trx_id() const { return numeric_limits<int32_t>::max(); }
 
+int32_t MvccTrxKit::begin_trx(MvccTrx *trx, MvccReadView &read_view)
+{
+  // 在锁内登记到活跃事务表中，oldest_active_trx_id 不会漏掉已经创建了快照的事务
+  view_lock_.lock();
+  int32_t trx_id = ++current_trx_id_;
+  read_view      = MvccReadView(trx_id, committing_xids_);
+  active_trxes_.insert(trx_id, trx);
+  view_lock_.unlock();
+  return trx_id;
+}
+
+int32_t MvccTrxKit::begin_commit()
+{
+  // 事务号递增分配，直接追加就是有序的
+  view_lock_.lock();
+  int32_t commit_xid = ++current_trx_id_;
+  committing_xids_.push_back(commit_xid);
+  view_lock_.unlock();
+  return commit_xid;
+}
+
+void MvccTrxKit::end_trx(int32_t trx_id, int32_t commit_xid)
+{
+  if (commit_xid > 0) {
+    view_lock_.lock();
+    auto iter = std::lower_bound(committing_xids_.begin(), committing_xids_.end(), commit_xid);
+    if (iter != committing_xids_.end() && *iter == commit_xid) {
+      committing_xids_.erase(iter);
+    }
+    view_lock_.unlock();
+  }
+
+  active_trxes_.erase(trx_id);
+}
+
+void MvccTrxKit::publish_commit(int32_t trx_id, int32_t commit_xid, LSN first_lsn, vector<Operation> &&operations)
+{
+  if (operations.empty()) {
+    return;
+  }
+
+  // 插入提交表之后，其它事务就能看到这个事务修改的所有记录了
+  commit_table_.insert(trx_id, commit_xid);
+
+  pending_operations_ += static_cast<int64_t>(operations.size());
+  committed_lock_.lock();
+  committed_trxes_.push_back(CommittedTrx{trx_id, commit_xid, first_lsn, std::move(operations)});
+  committed_lock_.unlock();
+}
+
+RC MvccTrxKit::cleanup_if_need()
+{
+  if (pending_operations_ < MAX_PENDING_OPERATIONS) {
+    return RC::SUCCESS;
+  }
+  return cleanup();
+}
+
+RC MvccTrxKit::cleanup()
+{
+  cleanup_lock_.lock();
+
+  // 在同一把锁内取出事务并设置 cleaning_lsn_，min_recovery_lsn 不会漏掉正在回写的事务
+  deque<CommittedTrx> trxes;
+  committed_lock_.lock();
+  trxes.swap(committed_trxes_);
+  LSN cleaning_lsn = 0;
+  for (const CommittedTrx &trx : trxes) {
+    if (trx.first_lsn > 0 && (cleaning_lsn == 0 || trx.first_lsn < cleaning_lsn)) {
+      cleaning_lsn = trx.first_lsn;
+    }
+  }
+  cleaning_lsn_ = cleaning_lsn;
+  committed_lock_.unlock();
+
+  int64_t operation_count = 0;
+  for (const CommittedTrx &trx : trxes) {
+    rewrite_records(trx);
+    operation_count += static_cast<int64_t>(trx.operations.size());
+  }
+  cleaning_lsn_ = 0;
+  pending_operations_ -= operation_count;
+
+  // 之后开始的事务只能读到回写之后的记录，比它老的事务都结束后就可以从提交表中删除了
+  const int32_t retire_xid = current_trx_id_;
+  for (const CommittedTrx &trx : trxes) {
+    retired_trxes_.emplace_back(trx.trx_id, retire_xid);
+  }
+
+  const int32_t oldest_trx_id = oldest_active_trx_id();
+  while (!retired_trxes_.empty() && retired_trxes_.front().second < oldest_trx_id) {
+    commit_table_.erase(retired_trxes_.front().first);
+    retired_trxes_.pop_front();
+  }
+
+  cleanup_lock_.unlock();
+
+  if (!trxes.empty()) {
+    LOG_DEBUG("cleanup committed trxes done. trx count=%ld, operation count=%ld, retired trx count=%ld",
+              trxes.size(), operation_count, retired_trxes_.size());
+  }
+  return RC::SUCCESS;
+}
+
+void MvccTrxKit::rewrite_records(const CommittedTrx &trx)
+{
+  for (const Operation &operation : trx.operations) {
+    Table *table = operation.table();
+    RID    rid(operation.page_num(), operation.slot_num());
+
+    span<const FieldMeta> trx_fields = table->table_meta().trx_fields();
+    ASSERT(trx_fields.size() >= 2, "invalid trx fields number. %d", trx_fields.size());
+
+    Field xid_field;
+    switch (operation.type()) {
+      case Operation::Type::INSERT: xid_field = Field(table, &trx_fields[0]); break;
+      case Operation::Type::DELETE: xid_field = Field(table, &trx_fields[1]); break;
+      default: {
+        ASSERT(false, "unsupported operation. type=%d", static_cast<int>(operation.type()));
+      } break;
+    }
+
+    // 记录可能已经回写过(恢复时)，或者已经被清理掉并且空间被其它记录复用了，只修改还是这个事务号的记录
+    auto record_updater = [&xid_field, &trx](Record &record) -> bool {
+      if (xid_field.get_int(record) != -trx.trx_id) {
+        return false;
+      }
+      xid_field.set_int(record, trx.commit_xid);
+      return true;
+    };
+
+    RC rc = table->visit_record(rid, record_updater);
+    if (OB_FAIL(rc) && rc != RC::RECORD_NOT_EXIST) {
+      LOG_WARN("failed to rewrite committed record. table=%s, rid=%s, trx id=%d, commit xid=%d, rc=%s",
+               table->name(), rid.to_string().c_str(), trx.trx_id, trx.commit_xid, strrc(rc));
+    }
+  }
+}
+
+LSN MvccTrxKit::min_recovery_lsn(LSN lsn)
+{
+  // 事务先加入等待回写的列表再从活跃事务表中删除，所以先看活跃事务表
+  lsn = active_trxes_.min_first_lsn(lsn);
+
+  committed_lock_.lock();
+  for (const CommittedTrx &trx : committed_trxes_) {
+    if (trx.first_lsn > 0) {
+      lsn = min(lsn, trx.first_lsn);
+    }
+  }
+  const LSN cleaning_lsn = cleaning_lsn_;
+  committed_lock_.unlock();
+
+  if (cleaning_lsn > 0) {
+    lsn = min(lsn, cleaning_lsn);
+  }
+  return lsn;
+}
+
+void MvccTrxKit::update_trx_id(int32_t trx_id)
+{
+  view_lock_.lock();
+  if (current_trx_id_ < trx_id) {
+    current_trx_id_ = trx_id;
+  }
+  view_lock_.unlock();
+}
+
+int32_t MvccTrxKit::oldest_active_trx_id()
+{
+  // 之后开始的事务，快照中的事务号和正在提交的事务号都不会比这个值小
+  view_lock_.lock();
+  int32_t limit = current_trx_id_ + 1;
+  if (!committing_xids_.empty()) {
+    limit = min(limit, committing_xids_.front());
+  }
+  view_lock_.unlock();
+
+  return active_trxes_.min_low_limit(limit);
+}
+
 Trx *MvccTrxKit::create_trx(LogHandler &log_handler)
 {
   Trx *trx = new MvccTrx(*this, log_handler);
@@ -59,20 +332,29 @@ Trx *MvccTrxKit::create_trx(LogHandler &log_handler)
 
 Trx *MvccTrxKit::create_trx(LogHandler &log_handler, int32_t trx_id)
 {
-  Trx *trx = new MvccTrx(*this, log_handler, trx_id);
+  auto *trx = new MvccTrx(*this, log_handler, trx_id);
   if (trx != nullptr) {
     lock_.lock();
     trxes_.push_back(trx);
+    lock_.unlock();
+
+    view_lock_.lock();
     if (current_trx_id_ < trx_id) {
       current_trx_id_ = trx_id;
     }
-    lock_.unlock();
+    active_trxes_.insert(trx_id, trx);
+    view_lock_.unlock();
   }
   return trx;
 }
 
 void MvccTrxKit::destroy_trx(Trx *trx)
 {
+  // 没有结束的事务，比如重做日志时创建的事务，也要从活跃事务表中删除
+  if (active_trxes_.find(trx->id()) == trx) {
+    active_trxes_.erase(trx->id());
+  }
+
   lock_.lock();
   for (auto iter = trxes_.begin(), itend = trxes_.end(); iter != itend; ++iter) {
     if (*iter == trx) {
@@ -85,19 +367,7 @@ void MvccTrxKit::destroy_trx(Trx *trx)
   delete trx;
 }
 
-Trx *MvccTrxKit::find_trx(int32_t trx_id)
-{
-  lock_.lock();
-  for (Trx *trx : trxes_) {
-    if (trx->id() == trx_id) {
-      lock_.unlock();
-      return trx;
-    }
-  }
-  lock_.unlock();
-
-  return nullptr;
-}
+Trx *MvccTrxKit::find_trx(int32_t trx_id) { return active_trxes_.find(trx_id); }
 
 void MvccTrxKit::all_trxes(vector<Trx *> &trxes)
 {
@@ -111,19 +381,70 @@ LogReplayer *MvccTrxKit::create_log_replayer(Db &db, LogHandler &log_handler)
   return new MvccTrxLogReplayer(db, *this, log_handler);
 }
 
+RC MvccTrxKit::purge(Table *table, PageNum &page_num, int max_pages, int &page_count, int &purged)
+{
+  page_count = 0;
+  purged     = 0;
+  if (table->table_meta().storage_format() != StorageFormat::ROW_FORMAT) {
+    page_num = BP_INVALID_PAGE_NUM;
+    return RC::SUCCESS;
+  }
+
+  span<const FieldMeta> trx_fields = table->table_meta().trx_fields();
+  ASSERT(trx_fields.size() >= 2, "invalid trx fields number. %d", trx_fields.size());
+  Field begin_xid_field(table, &trx_fields[0]);
+  Field end_xid_field(table, &trx_fields[1]);
+
+  // end xid 是正数说明删除已经提交，max_trx_id 表示没有删除
+  const int32_t oldest_trx_id = oldest_active_trx_id();
+  auto          dead_filter   = [&end_xid_field, oldest_trx_id, this](const Record &record) {
+    int32_t end_xid = end_xid_field.get_int(record);
+    return end_xid > 0 && end_xid != max_trx_id() && end_xid < oldest_trx_id;
+  };
+  // 插入已经提交并写回，早于所有活跃事务，而且没有删除，这样的记录对所有事务都可见
+  auto visible_filter = [&begin_xid_field, &end_xid_field, oldest_trx_id, this](const Record &record) {
+    int32_t begin_xid = begin_xid_field.get_int(record);
+    int32_t end_xid   = end_xid_field.get_int(record);
+    return begin_xid > 0 && begin_xid < oldest_trx_id && end_xid == max_trx_id();
+  };
+
+  vector<Record> dead_records;
+  RC rc = table->record_handler()->collect_records(
+      page_num, max_pages, dead_filter, dead_records, page_count, visible_filter);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to collect dead records. table=%s, rc=%s", table->name(), strrc(rc));
+    return rc;
+  }
+
+  // 这些记录对所有事务都不可见，也不会再被修改，可以直接删除
+  for (const Record &record : dead_records) {
+    rc = table->purge_record(record);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to purge record. table=%s, rid=%s, rc=%s",
+               table->name(), record.rid().to_string().c_str(), strrc(rc));
+      return rc;
+    }
+    purged++;
+  }
+
+  LOG_DEBUG("purge table done. table=%s, pages=%d, purged=%d, oldest trx id=%d",
+            table->name(), page_count, purged, oldest_trx_id);
+  return RC::SUCCESS;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 MvccTrx::MvccTrx(MvccTrxKit &kit, LogHandler &log_handler) : trx_kit_(kit), log_handler_(log_handler)
 {}
 
 MvccTrx::MvccTrx(MvccTrxKit &kit, LogHandler &log_handler, int32_t trx_id) 
-  : trx_kit_(kit), log_handler_(log_handler), trx_id_(trx_id)
+  : trx_kit_(kit), log_handler_(log_handler), trx_id_(trx_id), read_view_(trx_id, {})
 {
   started_    = true;
   recovering_ = true;
 }
 
-MvccTrx::~MvccTrx() {}
+MvccTrx::~MvccTrx() { release_locks(); }
 
 RC MvccTrx::insert_record(Table *table, Record &record)
 {
@@ -134,6 +455,7 @@ RC MvccTrx::insert_record(Table *table, Record &record)
   begin_field.set_int(record, -trx_id_);
   end_field.set_int(record, trx_kit_.max_trx_id());
 
+  mark_first_lsn();
   RC rc = table->insert_record(record);
   if (rc != RC::SUCCESS) {
     LOG_WARN("failed to insert record into table. rc=%s", strrc(rc));
@@ -154,15 +476,28 @@ RC MvccTrx::delete_record(Table *table, Record &record)
   Field end_field;
   trx_fields(table, begin_field, end_field);
 
+  // 先锁住记录，其它事务正在修改这条记录时会等它结束
+  RC rc = lock_record(table, record.rid());
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
   RC delete_result = RC::SUCCESS;
 
-  RC rc = table->visit_record(record.rid(), [this, table, &delete_result, &end_field](Record &inplace_record) -> bool {
+  mark_first_lsn();
+  rc = table->visit_record(record.rid(), [this, table, &delete_result, &end_field](Record &inplace_record) -> bool {
     RC rc = this->visit_record(table, inplace_record, ReadWriteMode::READ_WRITE);
     if (OB_FAIL(rc)) {
       delete_result = rc;
       return false;
     }
 
+    // 已经拿到了行锁，不应该还有其它没有结束的事务在删除这条记录
+    if (end_field.get_int(inplace_record) < 0) {
+      delete_result = RC::LOCKED_CONCURRENCY_CONFLICT;
+      return false;
+    }
+
     end_field.set_int(inplace_record, -trx_id_);
     return true;
   });
@@ -186,22 +521,34 @@ RC MvccTrx::delete_record(Table *table, Record &record)
   return RC::SUCCESS;
 }
 
+bool MvccTrx::page_visible(Table *table, PageNum page_num)
+{
+  return table->table_meta().storage_format() == StorageFormat::ROW_FORMAT &&
+         table->record_handler()->all_visible(page_num);
+}
+
 RC MvccTrx::visit_record(Table *table, Record &record, ReadWriteMode mode)
 {
   Field begin_field;
   Field end_field;
   trx_fields(table, begin_field, end_field);
 
-  int32_t begin_xid = begin_field.get_int(record);
-  int32_t end_xid   = end_field.get_int(record);
+  int32_t begin_xid = resolve_xid(begin_field.get_int(record));
+  int32_t end_xid   = resolve_xid(end_field.get_int(record));
 
+  // 已经提交的 xid 是否可见由快照决定，不需要访问其它事务，也不需要加锁
   RC rc = RC::SUCCESS;
   if (begin_xid > 0 && end_xid > 0) {
-    if (trx_id_ >= begin_xid && trx_id_ <= end_xid) {
-      rc = RC::SUCCESS;
-    } else {
+    if (!read_view_.is_visible(begin_xid) || read_view_.is_visible(end_xid)) {
       LOG_TRACE("record invisible. trx id=%d, begin xid=%d, end xid=%d", trx_id_, begin_xid, end_xid);
       rc = RC::RECORD_INVISIBLE;
+    } else if (mode == ReadWriteMode::READ_WRITE && end_xid != trx_kit_.max_trx_id()) {
+      // 快照之后其它事务删除了这条记录并且已经提交，不能再修改
+      LOG_TRACE("concurrency conflict. someone has deleted this record. trx id=%d, begin xid=%d, end xid=%d",
+                trx_id_, begin_xid, end_xid);
+      rc = RC::LOCKED_CONCURRENCY_CONFLICT;
+    } else {
+      rc = RC::SUCCESS;
     }
   } else if (begin_xid < 0) {
     // begin xid 小于0说明是刚插入而且没有提交的数据
@@ -212,6 +559,10 @@ RC MvccTrx::visit_record(Table *table, Record &record, ReadWriteMode mode)
                 trx_id_, begin_xid, end_xid);
       rc = RC::RECORD_INVISIBLE;
     }
+  } else if (!read_view_.is_visible(begin_xid)) {
+    // 快照之后才提交的数据
+    LOG_TRACE("record invisible. trx id=%d, begin xid=%d, end xid=%d", trx_id_, begin_xid, end_xid);
+    rc = RC::RECORD_INVISIBLE;
   } else if (end_xid < 0) {
     // end xid 小于0 说明是正在删除但是还没有提交的数据
     if (mode == ReadWriteMode::READ_ONLY) {
@@ -224,13 +575,12 @@ RC MvccTrx::visit_record(Table *table, Record &record, ReadWriteMode mode)
         rc = RC::RECORD_INVISIBLE;
       }
     } else {
-      // 如果当前想要修改此条数据，并且不是当前事务删除的，简单的报错
-      // 这是事务并发处理的一种方式，非常简单粗暴。其它的并发处理方法，可以等待，或者让客户端重试
-      // 或者等事务结束后，再检测修改的数据是否有冲突
+      // 其它事务正在删除这条记录。这里还拿着页面的锁，不能等待，
+      // 修改记录时 delete_record 会先加行锁，等那个事务结束之后再判断是否冲突
       if (-end_xid != trx_id_) {
-        LOG_TRACE("concurrency conflit. someone is deleting this record right now. trx id=%d, begin xid=%d, end xid=%d",
+        LOG_TRACE("someone is deleting this record right now. trx id=%d, begin xid=%d, end xid=%d",
                   trx_id_, begin_xid, end_xid);
-        rc = RC::LOCKED_CONCURRENCY_CONFLICT;
+        rc = RC::SUCCESS;
       } else {
         LOG_TRACE("record invisible. self has deleted this record. trx id=%d, begin xid=%d, end xid=%d",
                   trx_id_, begin_xid, end_xid);
@@ -260,11 +610,56 @@ void MvccTrx::trx_fields(Table *table, Field &begin_xid_field, Field &end_xid_fi
   end_xid_field.set_field(&trx_fields[1]);
 }
 
+int32_t MvccTrx::resolve_xid(int32_t xid)
+{
+  // 负的事务号可能是已经提交但是还没有回写到记录上的事务
+  if (xid < 0 && -xid != trx_id_) {
+    int32_t commit_xid = trx_kit_.commit_xid(-xid);
+    if (commit_xid > 0) {
+      return commit_xid;
+    }
+  }
+  return xid;
+}
+
+RC MvccTrx::lock_record(Table *table, const RID &rid)
+{
+  RowLockKey key{table->table_id(), rid};
+  bool       acquired = false;
+  RC         rc       = trx_kit_.lock_manager().lock(trx_id_, key, acquired);
+  if (OB_FAIL(rc)) {
+    LOG_TRACE("failed to lock record. trx id=%d, table=%s, rid=%s, rc=%s",
+              trx_id_, table->name(), rid.to_string().c_str(), strrc(rc));
+    return rc;
+  }
+
+  if (acquired) {
+    locks_.push_back(key);
+  }
+  return RC::SUCCESS;
+}
+
+void MvccTrx::release_locks()
+{
+  for (const RowLockKey &key : locks_) {
+    trx_kit_.lock_manager().unlock(trx_id_, key);
+  }
+  locks_.clear();
+}
+
+void MvccTrx::mark_first_lsn()
+{
+  // 在写日志之前取当前的LSN，检查点看到这个值时，事务的日志一定不会比它小
+  if (first_lsn_ == 0) {
+    first_lsn_ = log_handler_.current_lsn();
+  }
+}
+
 RC MvccTrx::start_if_need()
 {
   if (!started_) {
     ASSERT(operations_.empty(), "try to start a new trx while operations is not empty");
-    trx_id_ = trx_kit_.next_trx_id();
+    trx_id_ = trx_kit_.begin_trx(this, read_view_);
     LOG_DEBUG("current thread change to new trx with %d", trx_id_);
     started_ = true;
   }
@@ -273,75 +668,38 @@ RC MvccTrx::start_if_need()
 
 RC MvccTrx::commit()
 {
-  int32_t commit_id = trx_kit_.next_trx_id();
+  int32_t commit_id = trx_kit_.begin_commit();
   return commit_with_trx_id(commit_id);
 }
 
 RC MvccTrx::commit_with_trx_id(int32_t commit_xid)
 {
-  // TODO 原子性提交BUG：这里存在一个很大的问题，不能让其他事务一次性看到当前事务更新到的数据或同时看不到
-  RC rc    = RC::SUCCESS;
-  started_ = false;
-
-  for (const Operation &operation : operations_) {
-    switch (operation.type()) {
-      case Operation::Type::INSERT: {
-        RID    rid(operation.page_num(), operation.slot_num());
-        Table *table = operation.table();
-        Field  begin_xid_field, end_xid_field;
-        trx_fields(table, begin_xid_field, end_xid_field);
-
-        auto record_updater = [this, &begin_xid_field, commit_xid](Record &record) -> bool {
-          LOG_DEBUG("before commit insert record. trx id=%d, begin xid=%d, commit xid=%d, lbt=%s",
-                    trx_id_, begin_xid_field.get_int(record), commit_xid, lbt());
-          ASSERT(begin_xid_field.get_int(record) == -this->trx_id_ && (!recovering_), 
-                 "got an invalid record while committing. begin xid=%d, this trx id=%d", 
-                 begin_xid_field.get_int(record), trx_id_);
-
-          begin_xid_field.set_int(record, commit_xid);
-          return true;
-        };
-
-        rc = operation.table()->visit_record(rid, record_updater);
-        ASSERT(rc == RC::SUCCESS, "failed to get record while committing. rid=%s, rc=%s",
-               rid.to_string().c_str(), strrc(rc));
-      } break;
-
-      case Operation::Type::DELETE: {
-        Table *table = operation.table();
-        RID    rid(operation.page_num(), operation.slot_num());
-
-        Field begin_xid_field, end_xid_field;
-        trx_fields(table, begin_xid_field, end_xid_field);
-
-        auto record_updater = [this, &end_xid_field, commit_xid](Record &record) -> bool {
-          (void)this;
-          ASSERT(end_xid_field.get_int(record) == -trx_id_, 
-                 "got an invalid record while committing. end xid=%d, this trx id=%d", 
-                 end_xid_field.get_int(record), trx_id_);
-
-          end_xid_field.set_int(record, commit_xid);
-          return true;
-        };
-
-        rc = operation.table()->visit_record(rid, record_updater);
-        ASSERT(rc == RC::SUCCESS, "failed to get record while committing. rid=%s, rc=%s",
-               rid.to_string().c_str(), strrc(rc));
-      } break;
-
-      default: {
-        ASSERT(false, "unsupported operation. type=%d", static_cast<int>(operation.type()));
-      }
-    }
-  }
-
+  // 提交时不修改记录，日志落盘之后记录到提交表中，所有修改的记录就同时对新的快照可见了，
+  // 记录上的事务号由 MvccTrxKit::cleanup 稍后回写。
+  // 提交日志记录之后事务才结束，在这之前 commit xid 都在正在提交的列表中，
+  // 清理线程也不会清理当前事务删除的记录，否则清理记录的日志可能在提交日志之前，重启时回滚这个事务就找不到记录了
+  RC rc = RC::SUCCESS;
   if (!recovering_) {
     rc = log_handler_.commit(trx_id_, commit_xid);
   }
 
+  trx_kit_.publish_commit(trx_id_, commit_xid, first_lsn_, std::move(operations_));
   operations_.clear();
+  // 提交对其它事务可见之后再释放锁，等锁的事务醒来就能看到记录已经被删除了
+  release_locks();
+  trx_kit_.end_trx(trx_id_, commit_xid);
+  started_   = false;
+  first_lsn_ = 0;
 
   LOG_TRACE("append trx commit log. trx id=%d, commit_xid=%d, rc=%s", trx_id_, commit_xid, strrc(rc));
+
+  // 恢复时其它日志还在并行回放，等日志回放完成后再统一回写
+  if (!recovering_) {
+    RC cleanup_rc = trx_kit_.cleanup_if_need();
+    if (OB_FAIL(cleanup_rc)) {
+      LOG_WARN("failed to cleanup committed trxes. rc=%s", strrc(cleanup_rc));
+    }
+  }
   return rc;
 }
 
@@ -419,6 +777,9 @@ RC MvccTrx::rollback()
   if (!recovering_) {
     rc = log_handler_.rollback(trx_id_);
   }
+  release_locks();
+  trx_kit_.end_trx(trx_id_, 0);
+  first_lsn_ = 0;
   LOG_TRACE("append trx rollback log. trx id=%d, rc=%s", trx_id_, strrc(rc));
   return rc;
 }
@@ -464,9 +825,11 @@ RC MvccTrx::redo(Db *db, const LogEntry &log_entry)
     } break;
 
     case MvccTrxLogOperation::Type::COMMIT: {
-      // auto *trx_log_record = reinterpret_cast<const MvccTrxCommitLogEntry *>(log_entry.data());
-      // commit_with_trx_id(trx_log_record->commit_trx_id);
-      // 遇到了提交日志，说明前面的记录都已经提交成功了
+      // 遇到了提交日志，说明前面的记录都已经提交成功了。
+      // 提交时记录上的事务号可能还没有回写，这里同样记录到提交表中，日志回放完成后再回写
+      auto *trx_log_record = reinterpret_cast<const MvccTrxCommitLogEntry *>(log_entry.data());
+      trx_kit_.update_trx_id(trx_log_record->commit_trx_id);
+      rc = commit_with_trx_id(trx_log_record->commit_trx_id);
     } break;
 
     case MvccTrxLogOperation::Type::ROLLBACK: {
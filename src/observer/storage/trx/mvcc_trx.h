@@ -14,14 +14,86 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include "common/lang/array.h"
+#include "common/lang/deque.h"
+#include "common/lang/unordered_map.h"
 #include "common/lang/vector.h"
 #include "storage/trx/trx.h"
+#include "storage/trx/mvcc_read_view.h"
 #include "storage/trx/mvcc_trx_log.h"
+#include "storage/trx/row_lock_manager.h"
 
 class CLogManager;
 class LogHandler;
+class MvccTrx;
 class MvccTrxLogHandler;
 
+/**
+ * @brief 活跃事务表
+ * @ingroup Transaction
+ * @details 事务号到事务的哈希表。按照事务号分成多个分片，每个分片一把锁，
+ * 事务开始和结束时只需要锁一个分片，不同的事务之间基本不会冲突。
+ */
+class MvccActiveTrxTable
+{
+public:
+  void     insert(int32_t trx_id, MvccTrx *trx);
+  void     erase(int32_t trx_id);
+  MvccTrx *find(int32_t trx_id);
+
+  /// @brief 所有活跃事务快照的 low_limit 中最小的一个，不会超过 limit
+  int32_t min_low_limit(int32_t limit);
+
+  /// @brief 所有活跃事务的第一条日志的LSN中最小的一个，不会超过 limit
+  LSN min_first_lsn(LSN limit);
+
+private:
+  static constexpr int SHARD_NUM = 16;
+
+  struct Shard
+  {
+    common::Mutex                     lock;
+    unordered_map<int32_t, MvccTrx *> trxes;
+  };
+
+  Shard &shard(int32_t trx_id) { return shards_[static_cast<uint32_t>(trx_id) % SHARD_NUM]; }
+
+private:
+  array<Shard, SHARD_NUM> shards_;
+};
+
+/**
+ * @brief 提交表
+ * @ingroup Transaction
+ * @details 已经提交但是还没有回写到记录上的事务，事务号到 commit xid 的映射。
+ * 提交时只需要插入一项，事务修改的所有记录就同时对之后的快照可见。
+ * 访问记录时，如果记录上是其它事务的负的事务号，就到这里找它的 commit xid。
+ * 同活跃事务表一样按照事务号分片加锁。
+ */
+class MvccCommitTable
+{
+public:
+  void insert(int32_t trx_id, int32_t commit_xid);
+  void erase(int32_t trx_id);
+
+  /// @brief 查找事务的 commit xid，没有提交或者已经回写完成时返回0
+  int32_t find(int32_t trx_id);
+
+private:
+  static constexpr int SHARD_NUM = 16;
+
+  struct Shard
+  {
+    common::Mutex                   lock;
+    unordered_map<int32_t, int32_t> commit_xids;
+  };
+
+  Shard &shard(int32_t trx_id) { return shards_[static_cast<uint32_t>(trx_id) % SHARD_NUM]; }
+
+private:
+  array<Shard, SHARD_NUM> shards_;
+};
+
 class MvccTrxKit : public TrxKit
 {
 public:
@@ -36,7 +108,7 @@ public:
   void destroy_trx(Trx *trx) override;
 
   /**
-   * @brief 找到对应事务号的事务
+   * @brief 找到对应事务号的活跃事务
    * @details 当前仅在recover场景下使用
    */
   Trx *find_trx(int32_t trx_id) override;
@@ -44,25 +116,127 @@ public:
 
   LogReplayer *create_log_replayer(Db &db, LogHandler &log_handler) override;
 
+  /**
+   * @brief 清理已经删除并且对所有活跃事务都不可见的记录
+   * @details 删除事务提交并且回写后，记录的 end xid 是提交时的事务号。快照看不到这个事务号的事务还能看到这条记录，
+   * 所以只有 end xid 小于 oldest_active_trx_id 的记录才能清理。
+   * 逐个页面找出这样的记录，然后同普通的删除一样，删掉索引项和记录本身，并记录日志。
+   */
+  RC purge(Table *table, PageNum &page_num, int max_pages, int &page_count, int &purged) override;
+
+  /**
+   * @brief 把提交表中的事务号回写到记录上
+   * @details 同一时间只有一个线程回写。回写完成后不能马上从提交表中删除，
+   * 回写之前开始的事务可能拿着记录的副本，还要用提交表判断可见性，等这些事务都结束后再删除。
+   */
+  RC cleanup() override;
+
+  /// @brief 活跃事务和还没有回写完成的事务中，最小的第一条日志的LSN
+  LSN min_recovery_lsn(LSN lsn) override;
+
 public:
-  int32_t next_trx_id();
+  /**
+   * @brief 开始一个事务
+   * @details 分配事务号并创建快照，然后登记到活跃事务表中
+   * @param trx 开始的事务
+   * @param[out] read_view 事务的快照
+   * @return 分配的事务号
+   */
+  int32_t begin_trx(MvccTrx *trx, MvccReadView &read_view);
+
+  /**
+   * @brief 分配提交使用的事务号(commit xid)
+   * @details 调用 end_trx 之前，这个事务号都在正在提交的列表中，这期间创建的快照看不到它提交的数据
+   */
+  int32_t begin_commit();
+
+  /**
+   * @brief 事务结束，从活跃事务表和正在提交的列表中删除
+   * @param trx_id 事务号
+   * @param commit_xid begin_commit 分配的事务号，回滚时是0
+   */
+  void end_trx(int32_t trx_id, int32_t commit_xid);
+
+  /**
+   * @brief 提交事务
+   * @details 记录提交表之后，事务修改的记录就都是已经提交的状态了。这些记录稍后由 cleanup 回写
+   * @param trx_id 事务号
+   * @param commit_xid 提交使用的事务号
+   * @param first_lsn 事务第一条日志的LSN
+   * @param operations 事务修改过的记录
+   */
+  void publish_commit(int32_t trx_id, int32_t commit_xid, LSN first_lsn, vector<Operation> &&operations);
+
+  /// @brief 等待回写的记录太多时，由提交事务的线程帮忙回写
+  RC cleanup_if_need();
+
+  /// @brief 已经提交还没有回写完成的事务的 commit xid，没有找到时返回0
+  int32_t commit_xid(int32_t trx_id) { return commit_table_.find(trx_id); }
+
+  /// @brief 保证之后分配的事务号比 trx_id 大，日志回放时使用
+  void update_trx_id(int32_t trx_id);
+
+  RowLockManager &lock_manager() { return lock_manager_; }
+
+  /**
+   * @brief 最老的活跃快照能看到的事务号
+   * @details 比它小的 commit xid 对所有活跃的和之后开始的事务都是可见的。
+   * 没有活跃事务时返回下一个要分配的事务号
+   */
+  int32_t oldest_active_trx_id();
 
 public:
   int32_t max_trx_id() const;
 
 private:
+  /**
+   * @brief 已经提交还没有回写完成的事务
+   */
+  struct CommittedTrx
+  {
+    int32_t           trx_id     = 0;
+    int32_t           commit_xid = 0;
+    LSN               first_lsn  = 0;
+    vector<Operation> operations;
+  };
+
+  void rewrite_records(const CommittedTrx &trx);
+
+private:
+  /// 等待回写的记录超过这个数量时，提交的线程自己回写
+  static constexpr int64_t MAX_PENDING_OPERATIONS = 64 * 1024;
+
   vector<FieldMeta> fields_;  // 存储事务数据需要用到的字段元数据，所有表结构都需要带的
 
   atomic<int32_t> current_trx_id_{0};
 
+  /// 分配事务号、创建快照和修改 committing_xids_ 时加锁，保证快照中正在提交的列表与事务号是一致的
+  common::Mutex      view_lock_;
+  vector<int32_t>    committing_xids_;  ///< 正在提交的 commit xid，有序
+  MvccActiveTrxTable active_trxes_;     ///< 已经开始并且还没有结束的事务
+
+  MvccCommitTable     commit_table_;
+  common::Mutex       committed_lock_;
+  deque<CommittedTrx> committed_trxes_;        ///< 等待回写的事务，按照提交的顺序
+  atomic<int64_t>     pending_operations_{0};  ///< 等待回写的记录数
+  atomic<LSN>         cleaning_lsn_{0};        ///< 正在回写的事务中最小的 first_lsn，0 表示没有
+
+  /// 回写记录时加锁，保证同一时间只有一个线程回写
+  common::Mutex                 cleanup_lock_;
+  deque<pair<int32_t, int32_t>> retired_trxes_;  ///< 回写完成的事务号，以及回写完成时的当前事务号
+
+  RowLockManager lock_manager_;  ///< 修改记录时加的行锁
+
   common::Mutex lock_;
-  vector<Trx *> trxes_;
+  vector<Trx *> trxes_;  ///< 所有创建的事务，包括还没有开始的
 };
 
 /**
  * @brief 多版本并发事务
  * @ingroup Transaction
- * TODO 没有垃圾回收
+ * @details 事务开始时创建快照(MvccReadView)，整个事务都使用这个快照判断已经提交的数据是否可见。
+ * 提交时只记录提交表(MvccCommitTable)，记录上的事务号由 MvccTrxKit::cleanup 稍后回写。
+ * 删除的记录不会马上从文件中删除，而是由 MvccTrxKit::purge 在没有事务能看到之后再清理
  */
 class MvccTrx : public Trx
 {
@@ -91,6 +265,12 @@ public:
    */
   RC visit_record(Table *table, Record &record, ReadWriteMode mode) override;
 
+  /**
+   * @brief 清理旧版本时会把记录都对所有事务可见的页面标记出来，这些页面不需要再检查事务号
+   * @see RecordFileHandler::all_visible
+   */
+  bool page_visible(Table *table, PageNum page_num) override;
+
   RC start_if_need() override;
   RC commit() override;
   RC rollback() override;
@@ -99,10 +279,26 @@ public:
 
   int32_t id() const override { return trx_id_; }
 
+  /// @brief 事务开始时创建的快照
+  const MvccReadView &read_view() const { return read_view_; }
+
+  /// @brief 事务第一条日志的LSN，没有写过日志时是0
+  LSN first_lsn() const { return first_lsn_; }
+
 private:
   RC   commit_with_trx_id(int32_t commit_id);
   void trx_fields(Table *table, Field &begin_xid_field, Field &end_xid_field) const;
 
+  /// @brief 记录上的事务号如果是已经提交的其它事务，返回它的 commit xid
+  int32_t resolve_xid(int32_t xid);
+
+  /// @brief 写第一条日志之前调用，记录检查点不能超过的LSN
+  void mark_first_lsn();
+
+  /// @brief 给要修改的记录加锁，事务结束时释放
+  RC   lock_record(Table *table, const RID &rid);
+  void release_locks();
+
 private:
   static const int32_t MAX_TRX_ID = numeric_limits<int32_t>::max();
 
@@ -110,10 +306,13 @@ private:
   // using OperationSet = unordered_set<Operation, OperationHasher, OperationEqualer>;
   using OperationSet = vector<Operation>;
 
-  MvccTrxKit       &trx_kit_;
-  MvccTrxLogHandler log_handler_;
-  int32_t           trx_id_     = -1;
-  bool              started_    = false;
-  bool              recovering_ = false;
-  OperationSet      operations_;
+  MvccTrxKit        &trx_kit_;
+  MvccTrxLogHandler  log_handler_;
+  int32_t            trx_id_     = -1;
+  bool               started_    = false;
+  bool               recovering_ = false;
+  MvccReadView       read_view_;
+  atomic<LSN>        first_lsn_{0};
+  OperationSet       operations_;
+  vector<RowLockKey> locks_;  ///< 持有的行锁，事务结束时释放
 };
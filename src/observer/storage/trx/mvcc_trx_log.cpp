@@ -114,9 +114,8 @@ RC MvccTrxLogHandler::commit(int32_t trx_id, int32_t commit_trx_id)
     return rc;
   }
 
-  // 我们在这里粗暴的等待日志写入到磁盘
-  // 有必要的话，可以让上层来决定如何等待
-  return log_handler_.wait_lsn(lsn);
+  // 是否等待日志落盘由日志的持久化级别决定
+  return log_handler_.wait_commit_lsn(lsn);
 }
 
 RC MvccTrxLogHandler::rollback(int32_t trx_id)
@@ -132,6 +131,8 @@ RC MvccTrxLogHandler::rollback(int32_t trx_id)
       lsn, LogModule::Id::TRANSACTION, span<const char>(reinterpret_cast<const char *>(&log_entry), sizeof(log_entry)));
 }
 
+LSN MvccTrxLogHandler::current_lsn() const { return log_handler_.current_lsn(); }
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 MvccTrxLogReplayer::MvccTrxLogReplayer(Db &db, MvccTrxKit &trx_kit, LogHandler &log_handler)
   : db_(db), trx_kit_(trx_kit), log_handler_(log_handler)
@@ -141,7 +142,7 @@ RC MvccTrxLogReplayer::replay(const LogEntry &entry)
 {
   RC rc = RC::SUCCESS;
 
-  // 由于当前没有check point，所以所有的事务都重做。
+  // 检查点不会超过还没有结束或者还没有回写完成的事务的第一条日志，这些事务的日志都会重做
 
   ASSERT(entry.module().id() == LogModule::Id::TRANSACTION, "invalid log module id: %d", entry.module().id());
 
@@ -155,7 +156,7 @@ RC MvccTrxLogReplayer::replay(const LogEntry &entry)
   auto trx_iter = trx_map_.find(header->trx_id);
   if (trx_iter == trx_map_.end()) {
     trx = static_cast<MvccTrx *>(trx_kit_.create_trx(log_handler_, header->trx_id));
-    // trx = new MvccTrx(trx_kit_, log_handler_, header->trx_id);
+    trx_map_.emplace(header->trx_id, trx);
   } else {
     trx = trx_iter->second;
   }
@@ -166,7 +167,6 @@ RC MvccTrxLogReplayer::replay(const LogEntry &entry)
   /// 如果事务结束了，需要从内存中把它删除
   if (MvccTrxLogOperation(header->operation_type).type() == MvccTrxLogOperation::Type::ROLLBACK ||
       MvccTrxLogOperation(header->operation_type).type() == MvccTrxLogOperation::Type::COMMIT) {
-    Trx *trx = trx_map_[header->trx_id];
     trx_kit_.destroy_trx(trx);
     trx_map_.erase(header->trx_id);
   }
@@ -180,9 +180,10 @@ RC MvccTrxLogReplayer::on_done()
   for (auto &pair : trx_map_) {
     MvccTrx *trx = pair.second;
     trx->rollback(); // 恢复时的rollback，可能遇到之前已经回滚一半的事务又再次调用回滚的情况
-    delete pair.second;
+    trx_kit_.destroy_trx(trx);
   }
   trx_map_.clear();
 
-  return RC::SUCCESS;
+  // 回放提交日志时只记录了提交表，所有的页面日志都回放完了，现在可以回写记录了
+  return trx_kit_.cleanup();
 }
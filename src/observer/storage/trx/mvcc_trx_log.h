@@ -134,6 +134,9 @@ public:
    */
   RC rollback(int32_t trx_id);
 
+  /// @brief 当前的LSN，之后记录的日志都比它大
+  LSN current_lsn() const;
+
 private:
   LogHandler &log_handler_;
 };
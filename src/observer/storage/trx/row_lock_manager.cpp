@@ -0,0 +1,119 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "storage/trx/row_lock_manager.h"
+#include "common/lang/chrono.h"
+#include "common/log/log.h"
+
+RC RowLockManager::lock(int32_t trx_id, const RowLockKey &key, bool &acquired)
+{
+  acquired = false;
+
+  Shard             &s = shard(key);
+  unique_lock<mutex> guard(s.lock);
+
+#ifdef CONCURRENCY
+  const auto deadline = chrono::steady_clock::now() + chrono::milliseconds(wait_timeout_ms_);
+#endif
+  while (true) {
+    auto iter = s.owners.find(key);
+    if (iter == s.owners.end()) {
+      s.owners.emplace(key, trx_id);
+      acquired = true;
+      return RC::SUCCESS;
+    }
+
+    const int32_t owner = iter->second;
+    if (owner == trx_id) {
+      return RC::SUCCESS;
+    }
+
+#ifdef CONCURRENCY
+    if (chrono::steady_clock::now() >= deadline) {
+      LOG_INFO("lock wait timeout. trx id=%d, owner=%d, table id=%d, rid=%s",
+               trx_id, owner, key.table_id, key.rid.to_string().c_str());
+      return RC::LOCKED_CONCURRENCY_CONFLICT;
+    }
+
+    if (wait_for(trx_id, owner)) {
+      LOG_INFO("deadlock detected. trx id=%d, owner=%d, table id=%d, rid=%s",
+               trx_id, owner, key.table_id, key.rid.to_string().c_str());
+      return RC::LOCKED_DEADLOCK;
+    }
+
+    // 被唤醒后锁可能已经被其它事务抢到了，重新检查一遍
+    s.waiters++;
+    s.cond.wait_until(guard, deadline);
+    s.waiters--;
+    stop_waiting(trx_id);
+#else
+    LOG_TRACE("row is locked by another trx. trx id=%d, owner=%d, table id=%d, rid=%s",
+              trx_id, owner, key.table_id, key.rid.to_string().c_str());
+    return RC::LOCKED_CONCURRENCY_CONFLICT;
+#endif
+  }
+}
+
+void RowLockManager::unlock(int32_t trx_id, const RowLockKey &key)
+{
+  Shard            &s = shard(key);
+  lock_guard<mutex> guard(s.lock);
+
+  auto iter = s.owners.find(key);
+  if (iter == s.owners.end() || iter->second != trx_id) {
+    LOG_WARN("try to unlock a row not locked by this trx. trx id=%d, table id=%d, rid=%s",
+             trx_id, key.table_id, key.rid.to_string().c_str());
+    return;
+  }
+
+  s.owners.erase(iter);
+  if (s.waiters > 0) {
+    s.cond.notify_all();
+  }
+}
+
+size_t RowLockManager::lock_count()
+{
+  size_t count = 0;
+  for (Shard &s : shards_) {
+    lock_guard<mutex> guard(s.lock);
+    count += s.owners.size();
+  }
+  return count;
+}
+
+bool RowLockManager::wait_for(int32_t trx_id, int32_t owner)
+{
+  lock_guard<mutex> guard(graph_lock_);
+
+  // 每个事务最多等待一个锁，沿着等待链走下去，如果回到了自己就是死锁。
+  // 已经结束的事务不会再等锁，过期的等待关系走到它那里就断了，不会误判
+  int32_t current = owner;
+  for (size_t i = 0; i <= waits_for_.size(); i++) {
+    auto iter = waits_for_.find(current);
+    if (iter == waits_for_.end()) {
+      break;
+    }
+
+    current = iter->second;
+    if (current == trx_id) {
+      return true;
+    }
+  }
+
+  waits_for_[trx_id] = owner;
+  return false;
+}
+
+void RowLockManager::stop_waiting(int32_t trx_id)
+{
+  lock_guard<mutex> guard(graph_lock_);
+  waits_for_.erase(trx_id);
+}
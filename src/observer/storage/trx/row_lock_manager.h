@@ -0,0 +1,103 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "common/lang/array.h"
+#include "common/lang/condition_variable.h"
+#include "common/lang/mutex.h"
+#include "common/lang/unordered_map.h"
+#include "common/sys/rc.h"
+#include "storage/record/record.h"
+
+/**
+ * @brief 行锁的标识，哪张表的哪条记录
+ * @ingroup Transaction
+ */
+struct RowLockKey
+{
+  int32_t table_id = -1;
+  RID     rid;
+
+  bool operator==(const RowLockKey &other) const { return table_id == other.table_id && rid == other.rid; }
+};
+
+struct RowLockKeyHasher
+{
+  size_t operator()(const RowLockKey &key) const
+  {
+    return (static_cast<size_t>(key.table_id) << 48) ^ (static_cast<size_t>(key.rid.page_num) << 16) ^
+           static_cast<size_t>(key.rid.slot_num);
+  }
+};
+
+/**
+ * @brief 行锁管理器
+ * @ingroup Transaction
+ * @details 事务修改记录之前加上这条记录的排它锁，事务结束时释放。
+ * 锁表按照记录分片，每个分片一把锁和一个条件变量，等锁的事务在分片的条件变量上等待。
+ * 每个事务同时最多等待一个锁，并且只有排它锁，等待关系构成的图中每个事务最多只有一条出边，
+ * 加锁等待之前沿着这条链检查一下有没有回到自己，就能发现死锁，由发起等待的事务放弃。
+ * 等锁超过一定时间也会放弃，比如持有锁的客户端一直不提交。
+ * 不支持并发(没有定义 CONCURRENCY)时不会等待，遇到冲突直接返回。
+ */
+class RowLockManager
+{
+public:
+  /**
+   * @param wait_timeout_ms 等锁的超时时间
+   */
+  void init(int wait_timeout_ms) { wait_timeout_ms_ = wait_timeout_ms; }
+
+  /**
+   * @brief 加排它锁，锁被其它事务持有时等待它释放
+   * @param trx_id 加锁的事务
+   * @param key 锁住的记录
+   * @param[out] acquired 是否新加上的锁。已经持有这个锁时是 false
+   * @return RC - SUCCESS 加锁成功
+   *            - LOCKED_DEADLOCK 等待会造成死锁
+   *            - LOCKED_CONCURRENCY_CONFLICT 等锁超时，或者不支持并发时锁被其它事务持有
+   */
+  RC lock(int32_t trx_id, const RowLockKey &key, bool &acquired);
+
+  /// @brief 释放锁，唤醒等待这个锁的事务
+  void unlock(int32_t trx_id, const RowLockKey &key);
+
+  /// @brief 当前有多少个锁，测试使用
+  size_t lock_count();
+
+private:
+  /**
+   * @brief 登记 trx_id 等待 owner，如果会形成环就返回 true 并且不登记
+   */
+  bool wait_for(int32_t trx_id, int32_t owner);
+  void stop_waiting(int32_t trx_id);
+
+private:
+  static constexpr int SHARD_NUM = 64;
+
+  struct Shard
+  {
+    mutex                                                lock;
+    condition_variable                                   cond;
+    int32_t                                              waiters = 0;  ///< 有事务在等待时释放锁才需要唤醒
+    unordered_map<RowLockKey, int32_t, RowLockKeyHasher> owners;       ///< 记录到持有锁的事务
+  };
+
+  Shard &shard(const RowLockKey &key) { return shards_[RowLockKeyHasher()(key) % SHARD_NUM]; }
+
+private:
+  int wait_timeout_ms_ = 0;
+
+  array<Shard, SHARD_NUM> shards_;
+
+  mutex                           graph_lock_;  ///< 保护 waits_for_，在分片锁之内加锁
+  unordered_map<int32_t, int32_t> waits_for_;   ///< 正在等锁的事务，以及持有这个锁的事务
+};
@@ -43,3 +43,15 @@ TrxKit *TrxKit::create(const char *name)
   
   return trx_kit;
 }
+
+RC TrxKit::purge(Table *table, PageNum &page_num, int max_pages, int &page_count, int &purged)
+{
+  page_num   = BP_INVALID_PAGE_NUM;
+  page_count = 0;
+  purged     = 0;
+  return RC::SUCCESS;
+}
+
+RC TrxKit::cleanup() { return RC::SUCCESS; }
+
+LSN TrxKit::min_recovery_lsn(LSN lsn) { return lsn; }
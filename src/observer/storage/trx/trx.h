@@ -129,6 +129,31 @@ public:
 
   virtual LogReplayer *create_log_replayer(Db &db, LogHandler &log_handler) = 0;
 
+  /**
+   * @brief 清理一张表中对所有事务都不可见的旧版本记录，以及它们的索引项
+   * @details 默认什么都不做，只有多版本的事务模型才会留下旧版本的记录
+   * @param table           要清理的表
+   * @param[in,out] page_num 从哪个页面开始清理，返回下次开始的页面，BP_INVALID_PAGE_NUM 表示这张表清理完了一遍
+   * @param max_pages       最多访问多少个页面
+   * @param[out] page_count 实际访问的页面个数
+   * @param[out] purged     清理掉的记录个数
+   */
+  virtual RC purge(Table *table, PageNum &page_num, int max_pages, int &page_count, int &purged);
+
+  /**
+   * @brief 把已经提交的事务信息回写到它修改的记录上
+   * @details 事务提交时可以不修改记录，而是延迟到这里批量处理。默认什么都不做
+   */
+  virtual RC cleanup();
+
+  /**
+   * @brief 重启恢复时需要从哪个LSN开始重放事务日志
+   * @details 检查点不能超过这个LSN，否则还没有结束，或者提交后还没有回写记录的事务，
+   * 重启后就找不到它们的日志了。默认没有限制
+   * @param lsn 没有这样的事务时返回这个值
+   */
+  virtual LSN min_recovery_lsn(LSN lsn);
+
 public:
   static TrxKit *create(const char *name);
 };
@@ -147,6 +172,12 @@ public:
   virtual RC delete_record(Table *table, Record &record)                    = 0;
   virtual RC visit_record(Table *table, Record &record, ReadWriteMode mode) = 0;
 
+  /**
+   * @brief 页面上的记录是否对当前事务都可见
+   * @details 返回 true 时只读访问可以不用读取记录判断可见性，比如覆盖索引扫描直接使用索引中的数据
+   */
+  virtual bool page_visible(Table *table, PageNum page_num) = 0;
+
   virtual RC start_if_need() = 0;
   virtual RC commit()        = 0;
   virtual RC rollback()      = 0;
@@ -0,0 +1,120 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+#include "common/io/async_io.h"
+#include "common/lang/string.h"
+#include "common/lang/vector.h"
+
+using namespace common;
+
+class AsyncIoTest : public ::testing::TestWithParam<const char *>
+{
+protected:
+  void SetUp() override
+  {
+    ::remove(filename_);
+    fd_ = ::open(filename_, O_CREAT | O_RDWR, 0644);
+    ASSERT_GE(fd_, 0);
+  }
+
+  void TearDown() override
+  {
+    ::close(fd_);
+    ::remove(filename_);
+  }
+
+protected:
+  const char *filename_ = "async_io_test.dat";
+  int         fd_       = -1;
+};
+
+TEST_P(AsyncIoTest, write_and_read)
+{
+  unique_ptr<AsyncIoEngine> engine = AsyncIoEngine::create(GetParam(), 4 /*queue_depth*/);
+  ASSERT_NE(engine, nullptr);
+
+  // 请求个数比队列深度多，并且写入的位置是乱序的
+  const int    block_num  = 32;
+  const size_t block_size = 4096;
+
+  vector<vector<char>>   blocks(block_num, vector<char>(block_size));
+  vector<iovec>          iovs(block_num);
+  vector<AsyncIoRequest> requests;
+  for (int i = 0; i < block_num; i++) {
+    const int block_index = (i * 7) % block_num;
+    memset(blocks[i].data(), 'a' + block_index % 26, block_size);
+    iovs[i] = iovec{blocks[i].data(), block_size};
+    requests.push_back(AsyncIoRequest::write(fd_, static_cast<int64_t>(block_index) * block_size, &iovs[i], 1));
+  }
+  ASSERT_EQ(RC::SUCCESS, engine->submit_and_wait(requests));
+  for (const AsyncIoRequest &request : requests) {
+    ASSERT_EQ(0, request.error);
+    ASSERT_EQ(static_cast<int64_t>(block_size), request.transferred);
+  }
+
+  // 一个请求读取多个块
+  vector<char>  buffer(block_num * block_size);
+  vector<iovec> read_iovs(block_num);
+  for (int i = 0; i < block_num; i++) {
+    read_iovs[i] = iovec{buffer.data() + i * block_size, block_size};
+  }
+  AsyncIoRequest read_requests[2] = {
+      AsyncIoRequest::read(fd_, 0, read_iovs.data(), block_num / 2),
+      AsyncIoRequest::read(fd_, block_num / 2 * block_size, read_iovs.data() + block_num / 2, block_num / 2),
+  };
+  ASSERT_EQ(RC::SUCCESS, engine->submit_and_wait(read_requests));
+  for (int i = 0; i < block_num; i++) {
+    ASSERT_EQ('a' + i % 26, buffer[i * block_size]);
+    ASSERT_EQ('a' + i % 26, buffer[(i + 1) * block_size - 1]);
+  }
+
+  // 读到文件末尾按照失败处理
+  AsyncIoRequest eof_request = AsyncIoRequest::read(fd_, block_num * block_size, read_iovs.data(), 1);
+  ASSERT_EQ(RC::IOERR_READ, engine->submit_and_wait(eof_request));
+  ASSERT_NE(0, eof_request.error);
+}
+
+TEST_P(AsyncIoTest, append)
+{
+  unique_ptr<AsyncIoEngine> engine = AsyncIoEngine::create(GetParam());
+  ASSERT_NE(engine, nullptr);
+
+  ::close(fd_);
+  fd_ = ::open(filename_, O_WRONLY | O_APPEND, 0644);
+  ASSERT_GE(fd_, 0);
+
+  string header  = "header";
+  string payload = "payload";
+  for (int i = 0; i < 3; i++) {
+    iovec          iovs[2] = {{header.data(), header.size()}, {payload.data(), payload.size()}};
+    AsyncIoRequest request = AsyncIoRequest::write(fd_, -1 /*offset*/, iovs, 2);
+    ASSERT_EQ(RC::SUCCESS, engine->submit_and_wait(request));
+  }
+
+  ASSERT_EQ(static_cast<off_t>(3 * (header.size() + payload.size())), ::lseek(fd_, 0, SEEK_END));
+}
+
+INSTANTIATE_TEST_SUITE_P(AsyncIoEngines, AsyncIoTest, ::testing::Values("sync", "thread_pool", "io_uring"));
+
+TEST(AsyncIoEngine, create)
+{
+  ASSERT_STREQ("sync", AsyncIoEngine::create(nullptr)->name());
+  ASSERT_STREQ("sync", AsyncIoEngine::create("SYNC")->name());
+  ASSERT_STREQ("thread_pool", AsyncIoEngine::create("thread_pool")->name());
+  ASSERT_EQ(nullptr, AsyncIoEngine::create("unknown"));
+
+  // 不支持 io_uring 时退化为线程池
+  const char *name = AsyncIoEngine::create("io_uring")->name();
+  ASSERT_TRUE(0 == strcmp(name, "io_uring") || 0 == strcmp(name, "thread_pool"));
+}
@@ -13,6 +13,8 @@ See the Mulan PSL v2 for more details. */
 //
 
 #include "storage/buffer/disk_buffer_pool.h"
+#include "storage/buffer/double_write_buffer.h"
+#include "storage/clog/vacuous_log_handler.h"
 #include "gtest/gtest.h"
 
 void test_get(BPFrameManager &frame_manager)
@@ -125,6 +127,239 @@ TEST(test_frame_manager, test_frame_manager_simple_lru)
   frame_manager.cleanup();
 }
 
+TEST(test_frame_manager, test_frame_manager_partitioned)
+{
+  BPFrameManager frame_manager("Test");
+  frame_manager.init(2, 4);
+  ASSERT_EQ(4, frame_manager.partition_num());
+
+  test_get(frame_manager);
+
+  // 分区的空闲页帧用完后，可以从其它分区借，所以总的页帧数与不分区时一样
+  test_alloc(frame_manager);
+
+  frame_manager.cleanup();
+}
+
+TEST(test_frame_manager, test_frame_manager_huge_page_numa)
+{
+  // 系统没有预留大页或者只有一个NUMA节点时，会退化成普通的页面，行为与默认配置一样
+  BPFrameManager frame_manager("Test");
+  ASSERT_EQ(RC::SUCCESS, frame_manager.init(2, 4, "lru", true /*huge_page*/, true /*numa_aware*/));
+  ASSERT_EQ(2 * DEFAULT_ITEM_NUM_PER_POOL, static_cast<int>(frame_manager.total_frame_num()));
+  ASSERT_GE(frame_manager.arena().node_num(), 1);
+
+  test_get(frame_manager);
+
+  test_alloc(frame_manager);
+
+  frame_manager.cleanup();
+}
+
+TEST(test_frame_arena, node_of)
+{
+  FrameArena arena;
+  ASSERT_EQ(RC::SUCCESS, arena.init(10, false /*huge_page*/, false /*numa_aware*/));
+  ASSERT_EQ(10, static_cast<int>(arena.frame_num()));
+  ASSERT_EQ(1, arena.node_num());
+  for (size_t i = 0; i < arena.frame_num(); i++) {
+    Frame *frame = arena.frame(i);
+    ASSERT_EQ(0, arena.node_of(frame));
+    ASSERT_EQ(0, frame->pin_count());
+    frame->clear_page();
+  }
+  ASSERT_EQ(0, arena.current_node());
+  ASSERT_GE(FrameArena::system_node_num(), 1);
+  arena.cleanup();
+  ASSERT_EQ(0, static_cast<int>(arena.frame_num()));
+}
+
+TEST(test_frame, optimistic_read)
+{
+  Frame frame;
+  frame.pin();
+
+  uint64_t version = 0;
+  ASSERT_TRUE(frame.optimistic_read_begin(version));
+  ASSERT_TRUE(frame.optimistic_read_validate(version));
+
+  // 读锁不会修改版本号
+  frame.read_latch();
+  ASSERT_TRUE(frame.optimistic_read_validate(version));
+  frame.read_unlatch();
+  ASSERT_TRUE(frame.optimistic_read_validate(version));
+
+  // 持有写锁期间不能开始乐观读，递归加写锁只修改一次版本号
+  frame.write_latch();
+  uint64_t latched_version = 0;
+  ASSERT_FALSE(frame.optimistic_read_begin(latched_version));
+  ASSERT_FALSE(frame.optimistic_read_validate(version));
+  frame.write_latch();
+  frame.write_unlatch();
+  ASSERT_FALSE(frame.optimistic_read_begin(latched_version));
+  frame.write_unlatch();
+
+  ASSERT_FALSE(frame.optimistic_read_validate(version));
+  uint64_t new_version = 0;
+  ASSERT_TRUE(frame.optimistic_read_begin(new_version));
+  ASSERT_EQ(new_version, version + 2);
+
+  frame.unpin();
+}
+
+TEST(test_frame_manager, test_min_recovery_lsn)
+{
+  BPFrameManager frame_manager("Test");
+  frame_manager.init(1);
+
+  const int buffer_pool_id = 1;
+  Frame    *frame1         = frame_manager.alloc(buffer_pool_id, 1);
+  Frame    *frame2         = frame_manager.alloc(buffer_pool_id, 2);
+  Frame    *frame3         = frame_manager.alloc(buffer_pool_id, 3);
+  ASSERT_NE(frame1, nullptr);
+  ASSERT_NE(frame2, nullptr);
+  ASSERT_NE(frame3, nullptr);
+
+  // 没有脏页
+  ASSERT_EQ(100, frame_manager.min_recovery_lsn(100));
+
+  // 恢复LSN是变脏之后的第一条日志
+  frame1->set_lsn(10);
+  frame1->mark_dirty();
+  frame1->set_lsn(20);
+  ASSERT_EQ(10, frame1->rec_lsn());
+  frame2->set_lsn(30);
+  frame2->mark_dirty();
+  ASSERT_EQ(10, frame_manager.min_recovery_lsn(100));
+
+  // 刷盘之后恢复LSN清零
+  frame1->clear_dirty();
+  ASSERT_EQ(0, frame1->rec_lsn());
+  ASSERT_EQ(30, frame_manager.min_recovery_lsn(100));
+
+  // 修改了但是还没有写日志的页面，后续的日志一定比当前的页面LSN大
+  frame3->set_lsn(25);
+  frame3->clear_dirty();
+  frame3->mark_dirty();
+  ASSERT_EQ(26, frame_manager.min_recovery_lsn(100));
+
+  frame1->unpin();
+  frame2->unpin();
+  frame3->unpin();
+  frame_manager.cleanup();
+}
+
+/**
+ * 一个热点页面被淘汰后很快又被加载，然后做一次"全表扫描"，
+ * 2Q 策略下热点页面应该最后被淘汰，而LRU策略下热点页面会最先被淘汰
+ */
+void scan_after_hot_page(FrameEvictionPolicy &policy, vector<Frame *> &victims)
+{
+  const int buffer_pool_id = 1;
+  const int frame_num      = 9;
+
+  vector<unique_ptr<Frame>> frames;
+  for (int i = 0; i < frame_num; i++) {
+    frames.push_back(make_unique<Frame>());
+    frames.back()->set_buffer_pool_id(buffer_pool_id);
+    frames.back()->set_page_num(i + 1);
+  }
+
+  Frame *hot_frame = frames[0].get();
+  policy.on_insert(hot_frame);
+  policy.on_remove(hot_frame);
+  policy.on_insert(hot_frame);
+
+  for (int i = 1; i < frame_num; i++) {
+    policy.on_insert(frames[i].get());
+  }
+
+  policy.foreach_victim([&victims](Frame *frame) {
+    victims.push_back(frame);
+    return true;
+  });
+
+  ASSERT_EQ(victims.size(), static_cast<size_t>(frame_num));
+  for (auto &frame : frames) {
+    policy.on_remove(frame.get());
+  }
+
+  victims.push_back(hot_frame);  // 用最后一个元素告诉调用者哪个是热点页面
+}
+
+TEST(test_frame_manager, test_frame_eviction_policy)
+{
+  vector<Frame *> victims;
+
+  TwoQueueEvictionPolicy two_queue;
+  scan_after_hot_page(two_queue, victims);
+  ASSERT_EQ(victims.back(), victims[victims.size() - 2]);  // 热点页面最后淘汰
+
+  victims.clear();
+  LruEvictionPolicy lru;
+  scan_after_hot_page(lru, victims);
+  ASSERT_EQ(victims.back(), victims.front());  // 热点页面最先淘汰
+
+  unique_ptr<FrameEvictionPolicy> policy(FrameEvictionPolicy::create("2Q"));
+  ASSERT_NE(policy, nullptr);
+  ASSERT_STREQ(policy->name(), "2q");
+  ASSERT_EQ(FrameEvictionPolicy::create("unknown"), nullptr);
+}
+
+TEST(test_page_cleaner, test_page_cleaner_run_once)
+{
+  const char *filename = "test_page_cleaner.bp";
+  ::remove(filename);
+
+  VacuousLogHandler log_handler;
+  BufferPoolManager bpm(DEFAULT_ITEM_NUM_PER_POOL * BP_PAGE_SIZE, 1 /*partition_num*/);
+  ASSERT_EQ(bpm.init(make_unique<VacuousDoubleWriteBuffer>()), RC::SUCCESS);
+  ASSERT_EQ(bpm.create_file(filename), RC::SUCCESS);
+
+  DiskBufferPool *buffer_pool = nullptr;
+  ASSERT_EQ(bpm.open_file(log_handler, filename, buffer_pool), RC::SUCCESS);
+
+  const int       page_num = DEFAULT_ITEM_NUM_PER_POOL - 8;
+  vector<Frame *> frames;
+  for (int i = 0; i < page_num; i++) {
+    Frame *frame = nullptr;
+    ASSERT_EQ(buffer_pool->allocate_page(&frame), RC::SUCCESS);
+    frame->mark_dirty();
+    frames.push_back(frame);
+  }
+
+  Frame *pinned_frame = frames.back();
+  for (Frame *frame : frames) {
+    if (frame != pinned_frame) {
+      buffer_pool->unpin_page(frame);
+    }
+  }
+
+  PageCleaner &cleaner = bpm.get_page_cleaner();
+  ASSERT_EQ(cleaner.run_once(0.0), 0);
+  ASSERT_LT(cleaner.clean_ratio(), 0.5);
+
+  const int flushed_num = cleaner.run_once(0.5);
+  ASSERT_GT(flushed_num, 0);
+  ASSERT_GE(cleaner.clean_ratio(), 0.5);
+  ASSERT_EQ(cleaner.run_once(0.5), 0);
+
+  // 正在使用的页面不会被刷新，页面刷新后依然在内存中
+  cleaner.run_once(1.0);
+  ASSERT_TRUE(pinned_frame->dirty());
+  for (Frame *frame : frames) {
+    if (frame != pinned_frame) {
+      ASSERT_FALSE(frame->dirty());
+    }
+  }
+  ASSERT_EQ(cleaner.flushed_page_count(), page_num - 1);
+  ASSERT_EQ(bpm.get_frame_manager().frame_num(), static_cast<size_t>(page_num + 1));
+
+  buffer_pool->unpin_page(pinned_frame);
+  ASSERT_EQ(buffer_pool->close_file(), RC::SUCCESS);
+  ::remove(filename);
+}
+
 int main(int argc, char **argv)
 {
 
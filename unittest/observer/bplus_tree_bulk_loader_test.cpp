@@ -0,0 +1,227 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <filesystem>
+
+#include "gtest/gtest.h"
+#include "common/lang/algorithm.h"
+#include "common/lang/random.h"
+#include "common/log/log.h"
+#include "storage/buffer/disk_buffer_pool.h"
+#include "storage/buffer/double_write_buffer.h"
+#include "storage/clog/vacuous_log_handler.h"
+#include "storage/index/bplus_tree.h"
+#include "storage/index/bplus_tree_bulk_loader.h"
+
+using namespace std;
+using namespace common;
+
+class BplusTreeBulkLoaderTest : public testing::Test
+{
+public:
+  void SetUp() override
+  {
+    ASSERT_EQ(RC::SUCCESS, bpm_.init(make_unique<VacuousDoubleWriteBuffer>()));
+  }
+
+  void TearDown() override
+  {
+    if (handler_) {
+      handler_->close();
+    }
+    filesystem::remove_all(directory_);
+  }
+
+  /// @brief 重新创建一个空的B+树文件
+  void reset()
+  {
+    if (handler_) {
+      handler_->close();
+    }
+    filesystem::remove_all(directory_);
+    filesystem::create_directories(directory_);
+
+    ASSERT_EQ(RC::SUCCESS, bpm_.create_file(file_.c_str()));
+    ASSERT_EQ(RC::SUCCESS, bpm_.open_file(log_handler_, file_.c_str(), buffer_pool_));
+    handler_ = make_unique<BplusTreeHandler>();
+  }
+
+  /// @brief 在新的B+树上批量插入乱序的 0 ~ count-1
+  void load(int count, int max_size, int64_t memory_limit, double fill_factor, int *run_count = nullptr)
+  {
+    reset();
+    ASSERT_EQ(RC::SUCCESS,
+        handler_->create(log_handler_, *buffer_pool_, AttrType::INTS, sizeof(int), max_size, max_size));
+
+    vector<int> keys(count);
+    for (int i = 0; i < count; i++) {
+      keys[i] = i;
+    }
+    shuffle(keys.begin(), keys.end(), mt19937(count));
+
+    BplusTreeBulkLoader loader(*handler_, (directory_ / "sort").string(), memory_limit, fill_factor);
+    for (int key : keys) {
+      ASSERT_EQ(RC::SUCCESS, loader.add(reinterpret_cast<const char *>(&key), RID(key / 100, key % 100)));
+    }
+    ASSERT_EQ(RC::SUCCESS, loader.finish());
+    ASSERT_EQ(count, loader.key_count());
+    if (run_count != nullptr) {
+      *run_count = loader.run_count();
+    }
+  }
+
+  /// @brief 按照顺序扫描整棵树，检查键值是否是 0 ~ count-1
+  void check_scan(int count)
+  {
+    BplusTreeScanner scanner(*handler_);
+    ASSERT_EQ(RC::SUCCESS, scanner.open(nullptr, 0, false, nullptr, 0, false));
+    RID rid;
+    int expected = 0;
+    RC  rc       = RC::SUCCESS;
+    while (OB_SUCC(rc = scanner.next_entry(rid))) {
+      ASSERT_EQ(RID(expected / 100, expected % 100), rid);
+      expected++;
+    }
+    ASSERT_EQ(RC::RECORD_EOF, rc);
+    ASSERT_EQ(count, expected);
+  }
+
+protected:
+  filesystem::path             directory_{"bplus_tree_bulk_loader"};
+  filesystem::path             file_ = directory_ / "test.btree";
+  VacuousLogHandler            log_handler_;
+  BufferPoolManager            bpm_;
+  DiskBufferPool              *buffer_pool_ = nullptr;
+  unique_ptr<BplusTreeHandler> handler_;
+};
+
+TEST_F(BplusTreeBulkLoaderTest, in_memory)
+{
+  const int count     = 1000;
+  int       run_count = -1;
+  load(count, 8 /*max_size*/, 1024 * 1024, 0.75, &run_count);
+  ASSERT_EQ(0, run_count);
+  ASSERT_TRUE(handler_->validate_tree());
+  check_scan(count);
+
+  for (int key : {0, 1, 499, 999}) {
+    list<RID> rids;
+    ASSERT_EQ(RC::SUCCESS, handler_->get_entry(reinterpret_cast<const char *>(&key), sizeof(key), rids));
+    ASSERT_EQ(1, rids.size());
+    ASSERT_EQ(RID(key / 100, key % 100), rids.front());
+  }
+
+  // 构建完成之后可以正常地插入和删除
+  for (int key = count; key < count * 2; key++) {
+    RID rid(key / 100, key % 100);
+    ASSERT_EQ(RC::SUCCESS, handler_->insert_entry(reinterpret_cast<const char *>(&key), &rid));
+  }
+  ASSERT_TRUE(handler_->validate_tree());
+  check_scan(count * 2);
+
+  for (int key = 0; key < count * 2; key += 2) {
+    RID rid(key / 100, key % 100);
+    ASSERT_EQ(RC::SUCCESS, handler_->delete_entry(reinterpret_cast<const char *>(&key), &rid));
+  }
+  ASSERT_TRUE(handler_->validate_tree());
+}
+
+TEST_F(BplusTreeBulkLoaderTest, external_sort)
+{
+  // 每个临时文件大约放 1024 / (4 + 8 + 8) 个键值
+  const int count     = 5000;
+  int       run_count = 0;
+  load(count, 16 /*max_size*/, 1024, 1.0, &run_count);
+  ASSERT_GT(run_count, 1);
+  ASSERT_TRUE(handler_->validate_tree());
+  check_scan(count);
+
+  // 只剩下B+树文件，临时文件都删掉了
+  int files = 0;
+  for (const auto &entry : filesystem::directory_iterator(directory_)) {
+    ASSERT_EQ(file_, entry.path());
+    files++;
+  }
+  ASSERT_EQ(1, files);
+}
+
+TEST_F(BplusTreeBulkLoaderTest, fill_factor)
+{
+  // 节点按照填充率填充，但是不少于半满
+  load(1000, 10 /*max_size*/, 1024 * 1024, 0.1);
+  ASSERT_TRUE(handler_->validate_tree());
+  check_scan(1000);
+  const PageNum half_full_pages = buffer_pool_->page_count();
+
+  load(1000, 10 /*max_size*/, 1024 * 1024, 1.0);
+  ASSERT_TRUE(handler_->validate_tree());
+  check_scan(1000);
+  ASSERT_LT(buffer_pool_->page_count(), half_full_pages);
+}
+
+TEST_F(BplusTreeBulkLoaderTest, node_boundary)
+{
+  // 键值个数在节点大小的边界附近，检查每一层节点的划分
+  for (int count : {1, 7, 8, 9, 64, 65, 73}) {
+    load(count, 8 /*max_size*/, 1024 * 1024, 1.0);
+    ASSERT_TRUE(handler_->validate_tree()) << "count=" << count;
+    check_scan(count);
+  }
+}
+
+TEST_F(BplusTreeBulkLoaderTest, include_columns)
+{
+  // 键值之后附带一个 INTS 字段，外部排序时要和键值一起移动
+  const int count = 3000;
+  reset();
+  ASSERT_EQ(RC::SUCCESS,
+      handler_->create(log_handler_,
+          *buffer_pool_,
+          vector<AttrType>{AttrType::INTS},
+          vector<int>{sizeof(int)},
+          16 /*internal_max_size*/,
+          16 /*leaf_max_size*/,
+          sizeof(int) /*include_length*/));
+
+  BplusTreeBulkLoader loader(*handler_, (directory_ / "sort").string(), 1024, 1.0);
+  for (int i = 0; i < count; i++) {
+    int key     = (i * 7) % count;
+    int include = -key;
+    ASSERT_EQ(RC::SUCCESS,
+        loader.add(reinterpret_cast<const char *>(&key), RID(key / 100, key % 100), reinterpret_cast<const char *>(&include)));
+  }
+  ASSERT_EQ(RC::SUCCESS, loader.finish());
+  ASSERT_GT(loader.run_count(), 1);
+  ASSERT_TRUE(handler_->validate_tree());
+
+  BplusTreeScanner scanner(*handler_);
+  ASSERT_EQ(RC::SUCCESS, scanner.open(nullptr, 0, false, nullptr, 0, false));
+  RID         rid;
+  const char *user_key     = nullptr;
+  const char *include_data = nullptr;
+  int         expected     = 0;
+  RC          rc           = RC::SUCCESS;
+  while (OB_SUCC(rc = scanner.next_entry(rid, user_key, include_data))) {
+    ASSERT_EQ(expected, *reinterpret_cast<const int *>(user_key));
+    ASSERT_EQ(RID(expected / 100, expected % 100), rid);
+    ASSERT_EQ(-expected, *reinterpret_cast<const int *>(include_data));
+    expected++;
+  }
+  ASSERT_EQ(RC::RECORD_EOF, rc);
+  ASSERT_EQ(count, expected);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  filesystem::path log_filename = filesystem::path(argv[0]).filename();
+  LoggerFactory::init_default(log_filename.string() + ".log", LOG_LEVEL_INFO);
+  return RUN_ALL_TESTS();
+}
@@ -568,6 +568,49 @@ TEST(test_bplus_tree, test_chars)
   ASSERT_EQ(2, count);
 }
 
+TEST(test_bplus_tree, test_key_comparator)
+{
+  // 特化的比较器与构造 Value 比较的结果一致
+  auto check = [](AttrType type, int length, const char *v1, const char *v2) {
+    AttrComparator        comparator;
+    GenericAttrComparator generic(type, length);
+    comparator.init(type, length);
+    EXPECT_EQ(generic(v1, v2), comparator(v1, v2));
+    EXPECT_EQ(generic(v2, v1), comparator(v2, v1));
+    return comparator(v1, v2);
+  };
+
+  int ints[] = {-5, 3, 3, INT32_MIN, INT32_MAX};
+  ASSERT_EQ(-1, check(AttrType::INTS, 4, (char *)&ints[0], (char *)&ints[1]));
+  ASSERT_EQ(0, check(AttrType::INTS, 4, (char *)&ints[1], (char *)&ints[2]));
+  ASSERT_EQ(-1, check(AttrType::INTS, 4, (char *)&ints[3], (char *)&ints[4]));
+
+  float floats[] = {-1.5f, 2.0f, 2.0000001f};
+  ASSERT_EQ(-1, check(AttrType::FLOATS, 4, (char *)&floats[0], (char *)&floats[1]));
+  ASSERT_EQ(0, check(AttrType::FLOATS, 4, (char *)&floats[1], (char *)&floats[2]));
+
+  // 不足定长的字符串以 '\0' 结尾，满定长的没有结尾
+  char chars[][5] = {{'a', 'b', 0, 'x', 'y'}, {'a', 'b', 'c', 0, 0}, {'a', 'b', 'c', 'd', 'e'}, {'a', 'b', 0, 'z', 'z'}};
+  ASSERT_EQ(-1, check(AttrType::CHARS, 5, chars[0], chars[1]));
+  ASSERT_EQ(-1, check(AttrType::CHARS, 5, chars[1], chars[2]));
+  ASSERT_EQ(0, check(AttrType::CHARS, 5, chars[0], chars[3]));
+
+  // 属性相同时比较 RID
+  char key1[4 + sizeof(RID)];
+  char key2[4 + sizeof(RID)];
+  RID  rid1(1, 2);
+  RID  rid2(1, 3);
+  memcpy(key1, &ints[1], 4);
+  memcpy(key1 + 4, &rid1, sizeof(RID));
+  memcpy(key2, &ints[2], 4);
+  memcpy(key2 + 4, &rid2, sizeof(RID));
+
+  KeyComparator key_comparator;
+  key_comparator.init(AttrType::INTS, 4);
+  ASSERT_LT(key_comparator(key1, key2), 0);
+  ASSERT_GT(key_comparator.visit([&](const auto &comparator) { return comparator(key2, key1); }), 0);
+}
+
 TEST(test_bplus_tree, test_scanner)
 {
   LoggerFactory::init_default("test.log");
@@ -793,6 +836,179 @@ TEST(test_bplus_tree, test_scanner)
   handler.close();
 }
 
+TEST(test_bplus_tree, test_composite_key)
+{
+  LoggerFactory::init_default("test.log");
+
+  filesystem::path test_directory("bplus_tree");
+  filesystem::path buffer_pool_file = test_directory / "composite.btree";
+  filesystem::remove_all(test_directory);
+  filesystem::create_directory(test_directory);
+
+  VacuousLogHandler log_handler;
+
+  BufferPoolManager bpm;
+  ASSERT_EQ(RC::SUCCESS, bpm.init(make_unique<VacuousDoubleWriteBuffer>()));
+  ASSERT_EQ(RC::SUCCESS, bpm.create_file(buffer_pool_file.c_str()));
+
+  DiskBufferPool *buffer_pool = nullptr;
+  ASSERT_EQ(RC::SUCCESS, bpm.open_file(log_handler, buffer_pool_file.c_str(), buffer_pool));
+  ASSERT_NE(nullptr, buffer_pool);
+
+  // 两个 INTS 字段组成的联合索引 (a, b)
+  BplusTreeHandler handler;
+  ASSERT_EQ(RC::SUCCESS,
+      handler.create(log_handler,
+          *buffer_pool,
+          vector<AttrType>{AttrType::INTS, AttrType::INTS},
+          vector<int>{sizeof(int), sizeof(int)},
+          ORDER,
+          ORDER));
+
+  // a 取 0 ~ 19，b 取 0 ~ 9，插入顺序打乱
+  RID rid;
+  for (int i = 0; i < 200; i++) {
+    int n        = (i * 7) % 200;
+    int key[2]   = {n % 20, n / 20};
+    rid.page_num = key[0];
+    rid.slot_num = key[1];
+    ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)key, &rid));
+  }
+  ASSERT_TRUE(handler.validate_tree());
+
+  auto scan_count = [&handler](const int *left, int left_len, bool left_inclusive,
+                        const int *right, int right_len, bool right_inclusive) {
+    BplusTreeScanner scanner(handler);
+    RC rc = scanner.open((const char *)left, left_len, left_inclusive, (const char *)right, right_len, right_inclusive);
+    EXPECT_EQ(RC::SUCCESS, rc);
+    int count = 0;
+    RID rid;
+    while (OB_SUCC(rc = scanner.next_entry(rid))) {
+      count++;
+    }
+    EXPECT_EQ(RC::RECORD_EOF, rc);
+    scanner.close();
+    return count;
+  };
+
+  // 只给出第一个字段：a = 5
+  int a = 5;
+  ASSERT_EQ(10, scan_count(&a, 4, true, &a, 4, true));
+
+  list<RID> rids;
+  ASSERT_EQ(RC::SUCCESS, handler.get_entry((const char *)&a, 4, rids));
+  ASSERT_EQ(10, rids.size());
+  for (const RID &r : rids) {
+    ASSERT_EQ(5, r.page_num);
+  }
+
+  // 前缀范围：5 < a <= 7
+  int a_end = 7;
+  ASSERT_EQ(20, scan_count(&a, 4, false, &a_end, 4, true));
+  ASSERT_EQ(30, scan_count(&a, 4, true, &a_end, 4, true));
+  ASSERT_EQ(70, scan_count(nullptr, 0, true, &a_end, 4, false));
+
+  // 完整键值：a = 5 and 3 <= b < 6
+  int left[2]  = {5, 3};
+  int right[2] = {5, 6};
+  ASSERT_EQ(3, scan_count(left, 8, true, right, 8, false));
+  ASSERT_EQ(2, scan_count(left, 8, false, right, 8, false));
+
+  // 左边是前缀，右边是完整键值：a >= 5 and (a, b) <= (5, 6)
+  ASSERT_EQ(7, scan_count(&a, 4, true, right, 8, true));
+  // 左边是完整键值，右边是前缀：(a, b) > (5, 3) and a <= 5
+  ASSERT_EQ(6, scan_count(left, 8, false, &a, 4, true));
+
+  // 相等的前缀，不包含边界时是非法的范围
+  BplusTreeScanner invalid_range_scanner(handler);
+  ASSERT_EQ(RC::INVALID_ARGUMENT, invalid_range_scanner.open((const char *)&a, 4, false, (const char *)&a, 4, true));
+  // 键值长度必须是前几个字段的长度之和
+  BplusTreeScanner invalid_length_scanner(handler);
+  ASSERT_EQ(RC::INVALID_ARGUMENT, invalid_length_scanner.open((const char *)&a, 2, true, (const char *)&a, 2, true));
+
+  // 删除 a = 5 的一半数据
+  for (int b = 0; b < 10; b += 2) {
+    int key[2]   = {5, b};
+    rid.page_num = 5;
+    rid.slot_num = b;
+    ASSERT_EQ(RC::SUCCESS, handler.delete_entry((const char *)key, &rid));
+  }
+  ASSERT_TRUE(handler.validate_tree());
+  ASSERT_EQ(5, scan_count(&a, 4, true, &a, 4, true));
+
+  handler.close();
+}
+
+TEST(test_bplus_tree, test_include_columns)
+{
+  LoggerFactory::init_default("test.log");
+
+  filesystem::path test_directory("bplus_tree");
+  filesystem::path index_file = test_directory / "include.btree";
+  filesystem::remove_all(test_directory);
+  filesystem::create_directory(test_directory);
+
+  VacuousLogHandler log_handler;
+
+  BufferPoolManager bpm;
+  ASSERT_EQ(RC::SUCCESS, bpm.init(make_unique<VacuousDoubleWriteBuffer>()));
+
+  // 键值是一个 INTS 字段，叶子节点中附带两个 INTS 字段
+  const int include_length = 2 * sizeof(int);
+  BplusTreeHandler handler;
+  ASSERT_EQ(RC::SUCCESS,
+      handler.create(log_handler,
+          bpm,
+          index_file.c_str(),
+          vector<AttrType>{AttrType::INTS},
+          vector<int>{sizeof(int)},
+          ORDER,
+          ORDER,
+          include_length));
+
+  const int count = 200;
+  for (int i = 0; i < count; i++) {
+    int key        = (i * 7) % count;
+    int include[2] = {key * 10, key * 100};
+    RID rid(key, key + 1);
+    ASSERT_EQ(RC::SUCCESS, handler.insert_entry((const char *)&key, &rid, (const char *)include));
+  }
+  ASSERT_TRUE(handler.validate_tree());
+
+  // 删除奇数键值，分裂和合并节点时附带的字段要跟着键值移动
+  for (int key = 1; key < count; key += 2) {
+    RID rid(key, key + 1);
+    ASSERT_EQ(RC::SUCCESS, handler.delete_entry((const char *)&key, &rid));
+  }
+  ASSERT_TRUE(handler.validate_tree());
+  handler.close();
+
+  // 重新打开之后还能读到附带的字段
+  ASSERT_EQ(RC::SUCCESS, handler.open(log_handler, bpm, index_file.c_str()));
+  ASSERT_EQ(include_length, handler.file_header().include_length);
+
+  BplusTreeScanner scanner(handler);
+  ASSERT_EQ(RC::SUCCESS, scanner.open(nullptr, 0, false, nullptr, 0, false));
+  RID         rid;
+  const char *user_key     = nullptr;
+  const char *include_data = nullptr;
+  int         expected     = 0;
+  RC          rc           = RC::SUCCESS;
+  while (OB_SUCC(rc = scanner.next_entry(rid, user_key, include_data))) {
+    const int *include = (const int *)include_data;
+    ASSERT_EQ(expected, *(const int *)user_key);
+    ASSERT_EQ(RID(expected, expected + 1), rid);
+    ASSERT_EQ(expected * 10, include[0]);
+    ASSERT_EQ(expected * 100, include[1]);
+    expected += 2;
+  }
+  ASSERT_EQ(RC::RECORD_EOF, rc);
+  ASSERT_EQ(count, expected);
+  scanner.close();
+
+  handler.close();
+}
+
 TEST(test_bplus_tree, test_bplus_tree_insert)
 {
   LoggerFactory::init_default("test.log");
@@ -0,0 +1,122 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "storage/db/db.h"
+#include "storage/record/record_manager.h"
+#include "storage/table/table.h"
+#include "storage/trx/trx.h"
+
+using namespace std;
+using namespace common;
+
+static void insert_records(Table *table, int field_num, int begin, int end)
+{
+  for (int i = begin; i < end; i++) {
+    vector<Value> values(field_num, Value(i));
+
+    Record record;
+    ASSERT_EQ(RC::SUCCESS, table->make_record(values.size(), values.data(), record));
+    ASSERT_EQ(RC::SUCCESS, table->insert_record(record));
+  }
+}
+
+static int count_records(Table *table)
+{
+  RecordFileScanner scanner;
+  EXPECT_EQ(RC::SUCCESS, table->get_record_scanner(scanner, nullptr, ReadWriteMode::READ_ONLY));
+
+  int    count = 0;
+  Record record;
+  while (OB_SUCC(scanner.next(record))) {
+    count++;
+  }
+  return count;
+}
+
+TEST(Checkpoint, recover_from_checkpoint)
+{
+  /*
+  建表并插入一批数据，执行sync，所有页面都落盘，检查点推进到当前LSN之后，之前的日志文件被删除。
+  然后再插入一批数据，等日志落盘后把所有文件复制到另一个目录，此时这部分数据页没有落盘。
+  使用新的目录初始化数据库，只从检查点开始重做，数据依然完整。
+  */
+  filesystem::path test_directory("checkpoint_test");
+  filesystem::remove_all(test_directory);
+
+  filesystem::path db_path          = test_directory / "test_db";
+  filesystem::path db_path2         = test_directory / "test_db2";
+  const char      *trx_kit_name     = "vacuous";
+  const char      *log_handler_name = "disk";
+  filesystem::create_directories(db_path);
+
+  auto db = make_unique<Db>();
+  ASSERT_EQ(RC::SUCCESS, db->init("test_db", db_path.c_str(), trx_kit_name, log_handler_name));
+
+  const int               field_num = 4;
+  vector<AttrInfoSqlNode> attr_infos(field_num);
+  for (int i = 0; i < field_num; i++) {
+    attr_infos[i].name   = "field_" + to_string(i);
+    attr_infos[i].type   = AttrType::INTS;
+    attr_infos[i].length = 4;
+  }
+  ASSERT_EQ(RC::SUCCESS, db->create_table("t", attr_infos));
+  Table *table = db->find_table("t");
+  ASSERT_NE(table, nullptr);
+
+  const int insert_num1 = 3000;
+  insert_records(table, field_num, 0, insert_num1);
+
+  ASSERT_EQ(RC::SUCCESS, db->sync());
+  const LSN sync_lsn = db->log_handler().current_lsn();
+  ASSERT_EQ(sync_lsn + 1, db->check_point_lsn());
+  ASSERT_FALSE(filesystem::exists(db_path / "clog" / "clog_0.log"));
+
+  // 没有新的修改时检查点不变
+  ASSERT_EQ(RC::SUCCESS, db->checkpoint());
+  ASSERT_EQ(sync_lsn + 1, db->check_point_lsn());
+
+  const int insert_num2 = 1500;
+  insert_records(table, field_num, insert_num1, insert_num1 + insert_num2);
+
+  // 脏页的恢复LSN不会小于上次的检查点，检查点不会回退
+  ASSERT_EQ(RC::SUCCESS, db->checkpoint());
+  ASSERT_EQ(sync_lsn + 1, db->check_point_lsn());
+
+  const LSN current_lsn = db->log_handler().current_lsn();
+  ASSERT_EQ(RC::SUCCESS, db->log_handler().wait_lsn(current_lsn));
+  filesystem::copy(db_path, db_path2, filesystem::copy_options::recursive);
+
+  auto db2 = make_unique<Db>();
+  ASSERT_EQ(RC::SUCCESS, db2->init("test_db", db_path2.c_str(), trx_kit_name, log_handler_name));
+  ASSERT_EQ(sync_lsn + 1, db2->check_point_lsn());
+  ASSERT_EQ(current_lsn, db2->log_handler().current_lsn());
+
+  Table *table2 = db2->find_table("t");
+  ASSERT_NE(table2, nullptr);
+  ASSERT_EQ(insert_num1 + insert_num2, count_records(table2));
+
+  db2.reset();
+  db.reset();
+  filesystem::remove_all(test_directory);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  filesystem::path log_filename = filesystem::path(argv[0]).filename();
+  LoggerFactory::init_default(log_filename.string() + ".log", LOG_LEVEL_INFO);
+  return RUN_ALL_TESTS();
+}
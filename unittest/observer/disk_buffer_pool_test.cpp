@@ -105,6 +105,129 @@ TEST(DiskBufferPool, allocate_dispose)
   ASSERT_EQ(buffer_pool_manager.close_file(buffer_pool_filename.c_str()), RC::SUCCESS);
 }
 
+TEST(DiskBufferPool, prefetch)
+{
+  filesystem::path directory("buffer_pool");
+  filesystem::remove_all(directory);
+  filesystem::create_directories(directory);
+
+  filesystem::path buffer_pool_filename = directory / "prefetch.bp";
+
+  BufferPoolManager buffer_pool_manager;
+  ASSERT_EQ(RC::SUCCESS, buffer_pool_manager.init(make_unique<VacuousDoubleWriteBuffer>()));
+  VacuousLogHandler log_handler;
+
+  ASSERT_EQ(RC::SUCCESS, buffer_pool_manager.create_file(buffer_pool_filename.c_str()));
+  DiskBufferPool *buffer_pool = nullptr;
+  ASSERT_EQ(RC::SUCCESS, buffer_pool_manager.open_file(log_handler, buffer_pool_filename.c_str(), buffer_pool));
+
+  // 每个页面的数据中记录自己的页面编号
+  const int page_num = 200;
+  for (int i = 0; i < page_num; i++) {
+    Frame *frame = nullptr;
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->allocate_page(&frame));
+    *reinterpret_cast<PageNum *>(frame->data()) = frame->page_num();
+    frame->mark_dirty();
+    ASSERT_EQ(buffer_pool->unpin_page(frame), RC::SUCCESS);
+  }
+
+  const PageNum disposed_page = 50;
+  ASSERT_EQ(RC::SUCCESS, buffer_pool->dispose_page(disposed_page));
+  ASSERT_EQ(buffer_pool_manager.close_file(buffer_pool_filename.c_str()), RC::SUCCESS);
+
+  // 预读的页面在内存中，但是没有被pin住
+  ASSERT_EQ(RC::SUCCESS, buffer_pool_manager.open_file(log_handler, buffer_pool_filename.c_str(), buffer_pool));
+  BPFrameManager &frame_manager = buffer_pool_manager.get_frame_manager();
+  ASSERT_EQ(frame_manager.frame_num(), 1);
+  ASSERT_EQ(RC::SUCCESS, buffer_pool->prefetch(1, 100));
+  ASSERT_EQ(frame_manager.frame_num(), 100);
+  ASSERT_FALSE(frame_manager.contains(buffer_pool->id(), disposed_page));
+  ASSERT_EQ(RC::SUCCESS, buffer_pool->check_all_pages_unpinned());
+
+  const int64_t miss_count = frame_manager.miss_count();
+  for (PageNum i = 1; i <= 100; i++) {
+    if (i == disposed_page) {
+      continue;
+    }
+    Frame *frame = nullptr;
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->get_this_page(i, &frame));
+    ASSERT_EQ(*reinterpret_cast<PageNum *>(frame->data()), i);
+    ASSERT_EQ(buffer_pool->unpin_page(frame), RC::SUCCESS);
+  }
+  ASSERT_EQ(frame_manager.miss_count(), miss_count);
+  ASSERT_EQ(buffer_pool_manager.close_file(buffer_pool_filename.c_str()), RC::SUCCESS);
+
+  // 顺序遍历时自动预读
+  ASSERT_EQ(RC::SUCCESS, buffer_pool_manager.open_file(log_handler, buffer_pool_filename.c_str(), buffer_pool));
+  BufferPoolIterator iterator;
+  iterator.init(*buffer_pool, 1);
+  iterator.set_read_ahead(16);
+  int count = 0;
+  while (iterator.has_next()) {
+    PageNum page = iterator.next();
+    Frame  *frame = nullptr;
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->get_this_page(page, &frame));
+    ASSERT_EQ(*reinterpret_cast<PageNum *>(frame->data()), page);
+    ASSERT_EQ(buffer_pool->unpin_page(frame), RC::SUCCESS);
+    count++;
+  }
+  ASSERT_EQ(count, page_num - 1);
+  ASSERT_LT(frame_manager.miss_count() - miss_count, 10);
+  ASSERT_EQ(buffer_pool_manager.close_file(buffer_pool_filename.c_str()), RC::SUCCESS);
+}
+
+TEST(DiskBufferPool, space_map)
+{
+  filesystem::path directory("buffer_pool");
+  filesystem::remove_all(directory);
+  filesystem::create_directories(directory);
+
+  filesystem::path buffer_pool_filename = directory / "space_map.bp";
+
+  BufferPoolManager buffer_pool_manager;
+  ASSERT_EQ(RC::SUCCESS, buffer_pool_manager.init(make_unique<VacuousDoubleWriteBuffer>()));
+  VacuousLogHandler log_handler;
+
+  ASSERT_EQ(RC::SUCCESS, buffer_pool_manager.create_file(buffer_pool_filename.c_str()));
+  DiskBufferPool *buffer_pool = nullptr;
+  ASSERT_EQ(RC::SUCCESS, buffer_pool_manager.open_file(log_handler, buffer_pool_filename.c_str(), buffer_pool));
+
+  // 分配的页面超过文件头位图能够记录的个数，第一个组的空间映射页不会分配给调用者
+  const PageNum map_page = BPFileHeader::HEADER_MAP_PAGES;
+  const int     page_num = BPFileHeader::HEADER_MAP_PAGES + 100;
+  for (int i = 1; i < page_num; i++) {
+    Frame *frame = nullptr;
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->allocate_page(&frame));
+    ASSERT_NE(frame->page_num(), map_page);
+    ASSERT_EQ(buffer_pool->unpin_page(frame), RC::SUCCESS);
+  }
+  ASSERT_EQ(buffer_pool->page_count(), page_num + 1);
+  ASSERT_NE(RC::SUCCESS, buffer_pool->dispose_page(map_page));
+
+  // 两个组中各释放一个页面
+  ASSERT_EQ(RC::SUCCESS, buffer_pool->dispose_page(map_page + 50));
+  ASSERT_EQ(RC::SUCCESS, buffer_pool->dispose_page(10));
+  ASSERT_EQ(buffer_pool_page_count(buffer_pool), page_num - 1 - 2);
+
+  // 重启之后空间映射页从文件中加载，释放的页面按照编号从小到大重新分配
+  ASSERT_EQ(buffer_pool_manager.close_file(buffer_pool_filename.c_str()), RC::SUCCESS);
+  ASSERT_EQ(RC::SUCCESS, buffer_pool_manager.open_file(log_handler, buffer_pool_filename.c_str(), buffer_pool));
+  ASSERT_EQ(buffer_pool->page_count(), page_num + 1);
+  ASSERT_EQ(buffer_pool_page_count(buffer_pool), page_num - 1 - 2);
+
+  const PageNum expected_pages[] = {10, map_page + 50, page_num + 1};
+  for (PageNum expected_page : expected_pages) {
+    Frame *frame = nullptr;
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->allocate_page(&frame));
+    ASSERT_EQ(frame->page_num(), expected_page);
+    ASSERT_EQ(buffer_pool->unpin_page(frame), RC::SUCCESS);
+  }
+  ASSERT_EQ(buffer_pool_page_count(buffer_pool), page_num);
+
+  ASSERT_EQ(buffer_pool_manager.close_file(buffer_pool_filename.c_str()), RC::SUCCESS);
+  filesystem::remove_all(directory);
+}
+
 TEST(BufferPool, create)
 {
   filesystem::path test_directory("buffer_pool");
@@ -20,6 +20,9 @@ See the Mulan PSL v2 for more details. */
 #include "storage/clog/disk_log_handler.h"
 #include "storage/clog/log_replayer.h"
 #include "common/thread/thread_pool_executor.h"
+#include "common/lang/atomic.h"
+#include "common/lang/chrono.h"
+#include "common/lang/thread.h"
 
 using namespace std;
 using namespace common;
@@ -151,6 +154,56 @@ TEST(DiskLogHandler, test_replay)
   // filesystem::remove_all(path);
 }
 
+TEST(DiskLogHandler, test_recycle)
+{
+  const char *path = "test_log_handler_recycle";
+  filesystem::remove_all(path);
+
+  DiskLogHandler  handler;
+  TestLogReplayer replayer;
+  ASSERT_EQ(RC::SUCCESS, handler.init(path));
+  ASSERT_EQ(RC::SUCCESS, handler.replay(replayer, 0));
+  ASSERT_EQ(RC::SUCCESS, handler.start());
+
+  const int times = 3500;
+  for (int i = 0; i < times; ++i) {
+    LSN          lsn = 0;
+    vector<char> data(10);
+    ASSERT_EQ(handler.append(lsn, LogModule::Id::BUFFER_POOL, std::move(data)), RC::SUCCESS);
+  }
+  ASSERT_EQ(RC::SUCCESS, handler.wait_lsn(times));
+
+  // 每个文件1000条日志，clog_0 和 clog_1000 中的日志都小于 2500
+  ASSERT_EQ(RC::SUCCESS, handler.recycle(2500));
+  ASSERT_FALSE(filesystem::exists(filesystem::path(path) / "clog_0.log"));
+  ASSERT_FALSE(filesystem::exists(filesystem::path(path) / "clog_1000.log"));
+  ASSERT_TRUE(filesystem::exists(filesystem::path(path) / "clog_2000.log"));
+
+  // 最后一个文件正在写入，总是保留
+  ASSERT_EQ(RC::SUCCESS, handler.recycle(times + 1000));
+  ASSERT_TRUE(filesystem::exists(filesystem::path(path) / "clog_3000.log"));
+
+  ASSERT_EQ(RC::SUCCESS, handler.stop());
+  ASSERT_EQ(RC::SUCCESS, handler.await_termination());
+
+  DiskLogHandler  handler2;
+  TestLogReplayer replayer2;
+  ASSERT_EQ(RC::SUCCESS, handler2.init(path));
+  ASSERT_EQ(RC::SUCCESS, handler2.replay(replayer2, 3200));
+  ASSERT_EQ(times - 3200 + 1, replayer2.count());
+  ASSERT_EQ(times, handler2.current_lsn());
+
+  // 检查点之后没有日志时，LSN 从检查点继续
+  DiskLogHandler  handler3;
+  TestLogReplayer replayer3;
+  ASSERT_EQ(RC::SUCCESS, handler3.init(path));
+  ASSERT_EQ(RC::SUCCESS, handler3.replay(replayer3, times + 100));
+  ASSERT_EQ(0, replayer3.count());
+  ASSERT_EQ(times + 99, handler3.current_lsn());
+
+  filesystem::remove_all(path);
+}
+
 TEST(DiskLogHandler, multi_thread)
 {
   const char *directory = "test_log_handler_multi_thread";
@@ -180,6 +233,57 @@ TEST(DiskLogHandler, multi_thread)
   ASSERT_EQ(RC::SUCCESS, handler.await_termination());
 }
 
+TEST(DiskLogHandler, group_commit)
+{
+  // 多个线程同时追加日志并等待落盘，等待返回时日志一定已经落盘，并且不需要按照固定的时间间隔轮询
+  const char *directory = "test_log_handler_group_commit";
+  filesystem::remove_all(directory);
+
+  DiskLogHandler  handler;
+  TestLogReplayer replayer;
+  ASSERT_EQ(RC::SUCCESS, handler.init(directory));
+  ASSERT_EQ(RC::SUCCESS, handler.replay(replayer, 0));
+  ASSERT_EQ(RC::SUCCESS, handler.start());
+
+  const int     thread_num = 8;
+  const int     times      = 500;
+  atomic<int>   failed_count{0};
+  vector<thread> threads;
+
+  auto begin = chrono::steady_clock::now();
+  for (int t = 0; t < thread_num; t++) {
+    threads.emplace_back([&handler, &failed_count]() {
+      for (int i = 0; i < times; i++) {
+        LSN lsn = 0;
+        if (OB_FAIL(handler.append(lsn, LogModule::Id::TRANSACTION, vector<char>(10))) ||
+            OB_FAIL(handler.wait_lsn(lsn)) || handler.current_flushed_lsn() < lsn) {
+          failed_count++;
+        }
+      }
+    });
+  }
+  for (thread &t : threads) {
+    t.join();
+  }
+  auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - begin);
+
+  ASSERT_EQ(0, failed_count.load());
+  ASSERT_EQ(thread_num * times, handler.current_flushed_lsn());
+  // 每次提交都等待100毫秒的话需要50秒
+  ASSERT_LT(elapsed.count(), 20 * 1000);
+
+  ASSERT_EQ(RC::SUCCESS, handler.stop());
+  ASSERT_EQ(RC::SUCCESS, handler.await_termination());
+
+  DiskLogHandler  handler2;
+  TestLogReplayer replayer2;
+  ASSERT_EQ(RC::SUCCESS, handler2.init(directory));
+  ASSERT_EQ(RC::SUCCESS, handler2.replay(replayer2, 0));
+  ASSERT_EQ(thread_num * times, replayer2.count());
+
+  filesystem::remove_all(directory);
+}
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
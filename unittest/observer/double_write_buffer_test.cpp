@@ -201,6 +201,71 @@ TEST(DoubleWriteBuffer, single_file_exception)
   bpm  = nullptr;
 }
 
+TEST(DoubleWriteBuffer, batch_pipeline)
+{
+  /*
+  每个批次只有4个页面，写入多个批次的页面，
+  还在 double write buffer 中的页面可以读到最新的数据，
+  显式刷新之后重新打开，检查数据文件中的数据
+  */
+  filesystem::path directory("double_write_buffer_test_batch_pipeline_dir");
+  filesystem::remove_all(directory);
+  filesystem::create_directories(directory);
+
+  filesystem::path buffer_pool_filename         = directory / "buffer_pool.bp";
+  filesystem::path double_write_buffer_filename = directory / "double_write_buffer.dwb";
+
+  const int         max_pages = 4;
+  auto              bpm       = make_unique<BufferPoolManager>();
+  VacuousLogHandler log_handler;
+  auto double_write_buffer = make_unique<DiskDoubleWriteBuffer>(*bpm, max_pages, 10 /*flush_interval_ms*/);
+  ASSERT_EQ(RC::SUCCESS, double_write_buffer->open_file(double_write_buffer_filename.c_str()));
+  DiskDoubleWriteBuffer *dblwr_buffer = double_write_buffer.get();
+  ASSERT_EQ(bpm->init(std::move(double_write_buffer)), RC::SUCCESS);
+
+  DiskBufferPool *buffer_pool = nullptr;
+  ASSERT_EQ(RC::SUCCESS, bpm->create_file(buffer_pool_filename.c_str()));
+  ASSERT_EQ(RC::SUCCESS, bpm->open_file(log_handler, buffer_pool_filename.c_str(), buffer_pool));
+
+  const int       page_num = max_pages * 5;
+  vector<PageNum> page_nums;
+  for (int i = 0; i < page_num; i++) {
+    Frame *frame = nullptr;
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->allocate_page(&frame));
+    memset(frame->data(), i, BP_PAGE_DATA_SIZE);
+    frame->mark_dirty();
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->flush_page(*frame));
+    page_nums.push_back(frame->page_num());
+    frame->unpin();
+  }
+
+  // 还没有写到数据文件中的页面，从 double write buffer 中读取
+  Page page;
+  if (RC::SUCCESS == dblwr_buffer->read_page(buffer_pool, page_nums.back(), page)) {
+    ASSERT_EQ(static_cast<char>(page_num - 1), page.data[0]);
+  }
+
+  ASSERT_EQ(RC::SUCCESS, dblwr_buffer->flush_page());
+  ASSERT_GE(dblwr_buffer->flushed_batch_count(), page_num / max_pages);
+  ASSERT_EQ(RC::BUFFERPOOL_INVALID_PAGE_NUM, dblwr_buffer->read_page(buffer_pool, page_nums.back(), page));
+  bpm = nullptr;
+
+  bpm                 = make_unique<BufferPoolManager>();
+  double_write_buffer = make_unique<DiskDoubleWriteBuffer>(*bpm, max_pages);
+  ASSERT_EQ(RC::SUCCESS, double_write_buffer->open_file(double_write_buffer_filename.c_str()));
+  ASSERT_EQ(bpm->init(std::move(double_write_buffer)), RC::SUCCESS);
+  ASSERT_EQ(RC::SUCCESS, bpm->open_file(log_handler, buffer_pool_filename.c_str(), buffer_pool));
+
+  for (int i = 0; i < page_num; i++) {
+    Frame *frame = nullptr;
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->get_this_page(page_nums[i], &frame));
+    ASSERT_EQ(static_cast<char>(i), frame->data()[0]);
+    ASSERT_EQ(static_cast<char>(i), frame->data()[BP_PAGE_DATA_SIZE - 1]);
+    frame->unpin();
+  }
+  bpm = nullptr;
+}
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
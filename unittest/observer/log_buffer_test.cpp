@@ -13,11 +13,15 @@ See the Mulan PSL v2 for more details. */
 //
 
 #include "gtest/gtest.h"
+#include "common/lang/atomic.h"
+#include "common/lang/filesystem.h"
+#include "common/lang/thread.h"
 
 #define private public
 #define protected public
 #include "storage/clog/log_buffer.h"
 #include "storage/clog/log_file.h"
+#include "storage/clog/log_entry.h"
 
 using namespace std;
 using namespace common;
@@ -66,6 +70,122 @@ TEST(LogEntryBuffer, test_append)
   filesystem::remove("test_log_entry_buffer.log");
 }
 
+TEST(LogEntryBuffer, multi_writer)
+{
+  /*
+  多个线程同时追加大小不同的日志，一个线程同时刷盘，每个文件最多放 entries_per_file 条日志。
+  日志总量是缓冲区的很多倍，缓冲区会回绕，追加的线程也会等待空间。
+  最后读出所有的日志文件，检查LSN是连续的，每条日志的内容都是完整的，并且每个线程的日志是按照追加顺序排列的。
+  */
+  const char *directory = "test_log_buffer_multi_writer";
+  filesystem::remove_all(directory);
+  filesystem::create_directories(directory);
+
+  const int thread_num       = 8;
+  const int times            = 10000;
+  const LSN total            = thread_num * times;
+  const LSN entries_per_file = 10000;
+
+  LogEntryBuffer buffer;
+  ASSERT_EQ(RC::SUCCESS, buffer.init(0));
+
+  // 数据的前两个int是线程编号和序号，后面填充序号的低8位
+  auto make_data = [](int32_t thread_index, int32_t seq) {
+    vector<char> data(8 + (thread_index * 131 + seq * 17) % 1024);
+    memcpy(data.data(), &thread_index, sizeof(thread_index));
+    memcpy(data.data() + 4, &seq, sizeof(seq));
+    memset(data.data() + 8, static_cast<char>(seq), data.size() - 8);
+    return data;
+  };
+
+  atomic<int> failed_count{0};
+  vector<thread> writers;
+  for (int t = 0; t < thread_num; t++) {
+    writers.emplace_back([&buffer, &failed_count, &make_data, t]() {
+      for (int i = 0; i < times; i++) {
+        LSN lsn = 0;
+        if (OB_FAIL(buffer.append(lsn, LogModule::Id::BUFFER_POOL, make_data(t, i)))) {
+          failed_count++;
+        }
+      }
+    });
+  }
+
+  thread flusher([&buffer, &failed_count, directory, entries_per_file, total]() {
+    LogFileWriter writer;
+    while (buffer.flushed_lsn() < total) {
+      if (!writer.valid() || writer.full()) {
+        writer.close();
+        const LSN first_lsn = buffer.flushed_lsn() + 1;
+        string    filename  = string(directory) + "/" + to_string(first_lsn) + ".log";
+        if (OB_FAIL(writer.open(filename.c_str(), first_lsn + entries_per_file - 1))) {
+          failed_count++;
+          return;
+        }
+      }
+
+      int count = 0;
+      RC  rc    = buffer.flush(writer, count);
+      if (OB_FAIL(rc) && rc != RC::LOG_FILE_FULL) {
+        failed_count++;
+        return;
+      }
+      if (count == 0) {
+        this_thread::yield();
+      }
+    }
+    writer.close();
+  });
+
+  for (thread &writer : writers) {
+    writer.join();
+  }
+  flusher.join();
+
+  ASSERT_EQ(0, failed_count.load());
+  ASSERT_EQ(total, buffer.current_lsn());
+  ASSERT_EQ(total, buffer.flushed_lsn());
+  ASSERT_EQ(0, buffer.entry_number());
+  ASSERT_EQ(0, buffer.bytes());
+
+  vector<int32_t> next_seq(thread_num, 0);
+  LSN             expected_lsn = 1;
+  auto            callback     = [&](LogEntry &entry) -> RC {
+    EXPECT_EQ(expected_lsn, entry.lsn());
+    expected_lsn++;
+
+    int32_t thread_index = 0;
+    int32_t seq          = 0;
+    memcpy(&thread_index, entry.data(), sizeof(thread_index));
+    memcpy(&seq, entry.data() + 4, sizeof(seq));
+    EXPECT_TRUE(thread_index >= 0 && thread_index < thread_num);
+    if (thread_index < 0 || thread_index >= thread_num) {
+      return RC::INTERNAL;
+    }
+    EXPECT_EQ(next_seq[thread_index], seq);
+    next_seq[thread_index] = seq + 1;
+
+    vector<char> expected = make_data(thread_index, seq);
+    EXPECT_EQ(static_cast<int32_t>(expected.size()), entry.payload_size());
+    EXPECT_EQ(0, memcmp(expected.data(), entry.data(), min(expected.size(), static_cast<size_t>(entry.payload_size()))));
+    return RC::SUCCESS;
+  };
+
+  for (LSN first_lsn = 1; first_lsn <= total; first_lsn += entries_per_file) {
+    string        filename = string(directory) + "/" + to_string(first_lsn) + ".log";
+    LogFileReader reader;
+    ASSERT_EQ(RC::SUCCESS, reader.open(filename.c_str()));
+    ASSERT_EQ(RC::SUCCESS, reader.iterate(callback));
+    reader.close();
+  }
+  ASSERT_EQ(total + 1, expected_lsn);
+  for (int t = 0; t < thread_num; t++) {
+    ASSERT_EQ(times, next_seq[t]);
+  }
+
+  filesystem::remove_all(directory);
+}
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -59,6 +59,31 @@ TEST(LogEntry, size)
   ASSERT_NE(entry.init(1, LogModule::Id::BPLUS_TREE, std::move(data2)), RC::SUCCESS);
 }
 
+TEST(LogEntry, view)
+{
+  const char data[] = "log entry payload";
+
+  LogEntry entry;
+  ASSERT_EQ(RC::SUCCESS, entry.init_view(1, LogModule(LogModule::Id::RECORD_MANAGER), span<const char>(data, sizeof(data))));
+  ASSERT_EQ(data, entry.data());
+  ASSERT_EQ(static_cast<int32_t>(sizeof(data)), entry.payload_size());
+  ASSERT_EQ(entry.payload().data(), data);
+
+  // 移动后仍然指向原来的数据
+  LogEntry entry2(std::move(entry));
+  ASSERT_EQ(data, entry2.data());
+  ASSERT_EQ(nullptr, entry.data());
+
+  // 重新初始化为有自己数据的日志
+  vector<char> owned(data, data + sizeof(data));
+  const char  *owned_data = owned.data();
+  ASSERT_EQ(RC::SUCCESS, entry2.init(2, LogModule::Id::RECORD_MANAGER, std::move(owned)));
+  ASSERT_EQ(owned_data, entry2.data());
+  entry = std::move(entry2);
+  ASSERT_EQ(owned_data, entry.data());
+  ASSERT_EQ(0, memcmp(data, entry.data(), sizeof(data)));
+}
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -23,6 +23,7 @@ See the Mulan PSL v2 for more details. */
 #include "storage/clog/log_file.h"
 #include "storage/clog/log_entry.h"
 #include "storage/clog/log_module.h"
+#include "storage/clog/log_compressor.h"
 
 using namespace std;
 using namespace common;
@@ -30,6 +31,7 @@ using namespace common;
 TEST(LogFileWriter, basic)
 {
   const char *filename = "test_log_file_writer.log";
+  filesystem::remove(filename);
 
   // test LogFileWriter open, close, valid
   LogFileWriter writer;
@@ -178,6 +180,366 @@ TEST(LogFileReadWrite, test_read_write)
   // filesystem::remove(log_file);
 }
 
+TEST(LogFileWriter, write_batch)
+{
+  const char *log_file = "test_log_file_write_batch.log";
+  filesystem::remove(log_file);
+
+  LogFileWriter writer;
+  LSN           end_lsn = 1000 - 1;
+  ASSERT_EQ(RC::SUCCESS, writer.open(log_file, end_lsn));
+
+  // 条数超过 IOV_MAX 时会分成多次写入，超过文件最大LSN的日志不会写入
+  vector<LogEntry> entries(1200);
+  for (size_t i = 0; i < entries.size(); i++) {
+    ASSERT_EQ(RC::SUCCESS, entries[i].init(static_cast<LSN>(i + 1), LogModule::Id::BUFFER_POOL, vector<char>(10 + i % 7)));
+  }
+
+  int count = 0;
+  ASSERT_EQ(RC::SUCCESS, writer.write(span<LogEntry>(entries.data(), 100), count));
+  ASSERT_EQ(100, count);
+  ASSERT_EQ(RC::LOG_FILE_FULL, writer.write(span<LogEntry>(entries.data() + 100, entries.size() - 100), count));
+  ASSERT_EQ(end_lsn - 100, count);
+  ASSERT_TRUE(writer.full());
+  ASSERT_EQ(RC::LOG_FILE_FULL, writer.write(span<LogEntry>(entries.data() + end_lsn, entries.size() - end_lsn), count));
+  ASSERT_EQ(0, count);
+  writer.close();
+
+  LogFileReader reader;
+  ASSERT_EQ(RC::SUCCESS, reader.open(log_file));
+  LSN  expected_lsn = 1;
+  auto callback     = [&expected_lsn](LogEntry &entry) -> RC {
+    EXPECT_EQ(expected_lsn, entry.lsn());
+    EXPECT_EQ(10 + (expected_lsn - 1) % 7, entry.payload_size());
+    expected_lsn++;
+    return RC::SUCCESS;
+  };
+  ASSERT_EQ(RC::SUCCESS, reader.iterate(callback));
+  ASSERT_EQ(end_lsn + 1, expected_lsn);
+
+  filesystem::remove(log_file);
+}
+
+TEST(LogFileWriter, preallocate_and_reopen)
+{
+  const char *log_file = "test_log_file_preallocate.log";
+  filesystem::remove(log_file);
+
+  const LSN     end_lsn          = 1000 - 1;
+  const int64_t preallocate_size = 4096;
+
+  LogFileWriter writer;
+  ASSERT_EQ(RC::SUCCESS, writer.open(log_file, end_lsn, preallocate_size));
+  ASSERT_EQ(preallocate_size, static_cast<int64_t>(filesystem::file_size(log_file)));
+
+  // 写入的数据超过预分配的空间时会继续扩展文件
+  LogEntry entry;
+  LSN      lsn = 1;
+  for (; lsn <= 300; lsn++) {
+    ASSERT_EQ(RC::SUCCESS, entry.init(lsn, LogModule::Id::BUFFER_POOL, vector<char>(10 + lsn % 7)));
+    ASSERT_EQ(RC::SUCCESS, writer.write(entry));
+  }
+  const int64_t written_size = writer.offset_;
+  ASSERT_GT(written_size, preallocate_size);
+  ASSERT_GE(static_cast<int64_t>(filesystem::file_size(log_file)), written_size);
+  ASSERT_EQ(0, static_cast<int64_t>(filesystem::file_size(log_file)) % preallocate_size);
+  writer.close();
+
+  // 重新打开时跳过预分配的空间，接着最后一条日志写
+  ASSERT_EQ(RC::SUCCESS, writer.open(log_file, end_lsn, preallocate_size));
+  ASSERT_EQ(written_size, writer.offset_);
+  ASSERT_EQ(lsn - 1, writer.last_lsn_);
+  for (; lsn <= end_lsn; lsn++) {
+    ASSERT_EQ(RC::SUCCESS, entry.init(lsn, LogModule::Id::BUFFER_POOL, vector<char>(10 + lsn % 7)));
+    ASSERT_EQ(RC::SUCCESS, writer.write(entry));
+  }
+  ASSERT_TRUE(writer.full());
+  writer.close();
+
+  LogFileReader reader;
+  ASSERT_EQ(RC::SUCCESS, reader.open(log_file));
+  LSN  expected_lsn = 1;
+  auto callback     = [&expected_lsn](LogEntry &entry) -> RC {
+    EXPECT_EQ(expected_lsn, entry.lsn());
+    EXPECT_EQ(10 + expected_lsn % 7, entry.payload_size());
+    expected_lsn++;
+    return RC::SUCCESS;
+  };
+  ASSERT_EQ(RC::SUCCESS, reader.iterate(callback));
+  ASSERT_EQ(end_lsn + 1, expected_lsn);
+
+  expected_lsn = 500;
+  ASSERT_EQ(RC::SUCCESS, reader.iterate(callback, expected_lsn));
+  ASSERT_EQ(end_lsn + 1, expected_lsn);
+  reader.close();
+
+  filesystem::remove(log_file);
+}
+
+TEST(LogFileWriter, durability)
+{
+  const char *log_file = "test_log_file_durability.log";
+
+  const LogDurability durabilities[] = {
+      LogDurability::NONE, LogDurability::WRITE, LogDurability::FDATASYNC, LogDurability::DSYNC};
+  for (LogDurability durability : durabilities) {
+    filesystem::remove(log_file);
+
+    LogDurability parsed = LogDurability::FDATASYNC;
+    ASSERT_EQ(RC::SUCCESS, log_durability_from_string(log_durability_name(durability), parsed));
+    ASSERT_EQ(durability, parsed);
+
+    LogFileWriter writer;
+    writer.set_durability(durability);
+    ASSERT_EQ(RC::SUCCESS, writer.open(log_file, 100, 1024));
+
+    vector<LogEntry> entries(100);
+    for (size_t i = 0; i < entries.size(); i++) {
+      ASSERT_EQ(RC::SUCCESS, entries[i].init(static_cast<LSN>(i + 1), LogModule::Id::TRANSACTION, vector<char>(16)));
+    }
+    int count = 0;
+    ASSERT_EQ(RC::SUCCESS, writer.write(span<LogEntry>(entries.data(), entries.size()), count));
+    ASSERT_EQ(100, count);
+    ASSERT_TRUE(writer.full());
+    writer.close();
+
+    LogFileReader reader;
+    ASSERT_EQ(RC::SUCCESS, reader.open(log_file));
+    count = 0;
+    ASSERT_EQ(RC::SUCCESS, reader.iterate([&count](LogEntry &) {
+      count++;
+      return RC::SUCCESS;
+    }));
+    ASSERT_EQ(100, count) << log_durability_name(durability);
+    reader.close();
+  }
+
+  LogDurability durability = LogDurability::NONE;
+  ASSERT_EQ(RC::SUCCESS, log_durability_from_string("", durability));
+  ASSERT_EQ(LogDurability::FDATASYNC, durability);
+  ASSERT_EQ(RC::SUCCESS, log_durability_from_string("DSync", durability));
+  ASSERT_EQ(LogDurability::DSYNC, durability);
+  ASSERT_NE(RC::SUCCESS, log_durability_from_string("fsync", durability));
+
+  filesystem::remove(log_file);
+}
+
+TEST(LogCompressor, round_trip)
+{
+  const LogCompression compressions[] = {LogCompression::BUILTIN, LogCompression::LZ4};
+
+  vector<vector<char>> inputs;
+  inputs.emplace_back();
+  inputs.emplace_back(3, 'a');
+  inputs.emplace_back(100000, 0);
+  vector<char> text;
+  for (int i = 0; i < 10000; i++) {
+    string line = "record " + to_string(i % 37) + " updated by trx " + to_string(i) + "\n";
+    text.insert(text.end(), line.begin(), line.end());
+  }
+  inputs.push_back(text);
+  vector<char> random_data(70000);
+  srand(0);
+  for (char &c : random_data) {
+    c = static_cast<char>(rand());
+  }
+  inputs.push_back(random_data);
+
+  for (LogCompression compression : compressions) {
+    LogCompression parsed = LogCompression::NONE;
+    ASSERT_EQ(RC::SUCCESS, log_compression_from_string(log_compression_name(compression), parsed));
+
+    for (const vector<char> &input : inputs) {
+      vector<char> compressed;
+      ASSERT_EQ(RC::SUCCESS, LogCompressor::compress(parsed, input, compressed));
+      ASSERT_LE(compressed.size(), LogCompressor::max_compressed_size(parsed, input.size()));
+
+      vector<char> output(input.size());
+      ASSERT_EQ(RC::SUCCESS, LogCompressor::decompress(parsed, compressed, span<char>(output)));
+      ASSERT_EQ(input, output);
+
+      // 损坏的数据不能解压
+      if (compressed.size() > 1) {
+        ASSERT_NE(RC::SUCCESS,
+            LogCompressor::decompress(parsed, span<const char>(compressed.data(), compressed.size() / 2), output));
+      }
+    }
+  }
+
+  vector<char> compressed;
+  ASSERT_EQ(RC::SUCCESS, LogCompressor::compress(LogCompression::BUILTIN, text, compressed));
+  ASSERT_LT(compressed.size() * 2, text.size());
+
+  LogCompression compression = LogCompression::BUILTIN;
+  ASSERT_EQ(RC::SUCCESS, log_compression_from_string("", compression));
+  ASSERT_EQ(LogCompression::NONE, compression);
+  ASSERT_NE(RC::SUCCESS, log_compression_from_string("zip", compression));
+}
+
+TEST(LogFileWriter, compression)
+{
+  const char *log_file = "test_log_file_compression.log";
+  filesystem::remove(log_file);
+
+  const LSN end_lsn = 1000 - 1;
+
+  // 日志数据由LSN决定，大部分可以压缩，每100条有一条较大的随机数据
+  auto make_data = [](LSN lsn) {
+    vector<char> data(lsn % 100 == 0 ? 2000 : 40 + lsn % 13);
+    for (size_t i = 0; i < data.size(); i++) {
+      data[i] = lsn % 100 == 0 ? static_cast<char>((lsn * 7919 + i * i * 31) >> 3) : static_cast<char>(i % 5);
+    }
+    return data;
+  };
+  auto write_entries = [&make_data](LogFileWriter &writer, LSN begin, LSN end) {
+    vector<LogEntry> entries(end - begin);
+    for (LSN lsn = begin; lsn < end; lsn++) {
+      ASSERT_EQ(RC::SUCCESS, entries[lsn - begin].init(lsn, LogModule::Id::RECORD_MANAGER, make_data(lsn)));
+    }
+    int count = 0;
+    ASSERT_EQ(RC::SUCCESS, writer.write(span<LogEntry>(entries), count));
+    ASSERT_EQ(end - begin, count);
+  };
+
+  LogFileWriter writer;
+  writer.set_compression(LogCompression::BUILTIN);
+  ASSERT_EQ(RC::SUCCESS, writer.open(log_file, end_lsn, 4096));
+  write_entries(writer, 1, 2);  // 太小不压缩
+  write_entries(writer, 2, 300);
+  ASSERT_LT(writer.written_bytes() * 2, writer.raw_bytes());
+  writer.close();
+
+  // 重新打开后接着写，写一部分没有压缩的日志
+  ASSERT_EQ(RC::SUCCESS, writer.open(log_file, end_lsn, 4096));
+  ASSERT_EQ(299, writer.last_lsn_);
+  write_entries(writer, 300, 600);
+  writer.set_compression(LogCompression::NONE);
+  write_entries(writer, 600, 700);
+  writer.set_compression(LogCompression::BUILTIN);
+  write_entries(writer, 700, 800);
+
+  const int64_t complete_offset = writer.offset_;
+  writer.close();
+
+  LogFileReader reader;
+  ASSERT_EQ(RC::SUCCESS, reader.open(log_file));
+  LSN  expected_lsn = 1;
+  auto callback     = [&expected_lsn, &make_data](LogEntry &entry) -> RC {
+    EXPECT_EQ(expected_lsn, entry.lsn());
+    EXPECT_EQ(LogModule::Id::RECORD_MANAGER, entry.module().id());
+    EXPECT_EQ(make_data(expected_lsn), vector<char>(entry.data(), entry.data() + entry.payload_size()));
+    expected_lsn++;
+    return RC::SUCCESS;
+  };
+  ASSERT_EQ(RC::SUCCESS, reader.iterate(callback));
+  ASSERT_EQ(800, expected_lsn);
+
+  // 从一批压缩日志的中间开始读
+  expected_lsn = 450;
+  ASSERT_EQ(RC::SUCCESS, reader.iterate(callback, expected_lsn));
+  ASSERT_EQ(800, expected_lsn);
+  reader.close();
+
+  // 最后一批压缩日志只写了一部分，读取时当作日志的末尾，重新打开时从它开始覆盖
+  ASSERT_EQ(RC::SUCCESS, writer.open(log_file, end_lsn, 4096));
+  write_entries(writer, 800, 900);
+  writer.close();
+  filesystem::resize_file(log_file, complete_offset + LogHeader::SIZE + LogCompressedHeader::SIZE + 10);
+  filesystem::resize_file(log_file, complete_offset + 4096);
+
+  ASSERT_EQ(RC::SUCCESS, reader.open(log_file));
+  expected_lsn = 1;
+  ASSERT_EQ(RC::SUCCESS, reader.iterate(callback));
+  ASSERT_EQ(800, expected_lsn);
+  reader.close();
+
+  ASSERT_EQ(RC::SUCCESS, writer.open(log_file, end_lsn, 4096));
+  ASSERT_EQ(complete_offset, writer.offset_);
+  ASSERT_EQ(799, writer.last_lsn_);
+  write_entries(writer, 800, end_lsn + 1);
+  ASSERT_TRUE(writer.full());
+  writer.close();
+
+  ASSERT_EQ(RC::SUCCESS, reader.open(log_file));
+  expected_lsn = 1;
+  ASSERT_EQ(RC::SUCCESS, reader.iterate(callback));
+  ASSERT_EQ(end_lsn + 1, expected_lsn);
+  reader.close();
+
+  filesystem::remove(log_file);
+}
+
+TEST(LogFileReader, footer_index)
+{
+  const char *log_file = "test_log_file_footer_index.log";
+  const LSN   end_lsn  = 1000 - 1;
+
+  auto make_data = [](LSN lsn) { return vector<char>(100 + lsn % 50, static_cast<char>(lsn)); };
+
+  const LogCompression compressions[] = {LogCompression::NONE, LogCompression::BUILTIN};
+  for (LogCompression compression : compressions) {
+    filesystem::remove(log_file);
+
+    LogFileWriter writer;
+    writer.set_compression(compression);
+    ASSERT_EQ(RC::SUCCESS, writer.open(log_file, end_lsn, 64 * 1024));
+    for (LSN begin = 1; begin <= end_lsn; begin += 37) {
+      vector<LogEntry> entries;
+      for (LSN lsn = begin; lsn < begin + 37 && lsn <= end_lsn; lsn++) {
+        entries.emplace_back();
+        ASSERT_EQ(RC::SUCCESS, entries.back().init(lsn, LogModule::Id::RECORD_MANAGER, make_data(lsn)));
+      }
+      int count = 0;
+      ASSERT_EQ(RC::SUCCESS, writer.write(span<LogEntry>(entries), count));
+    }
+    ASSERT_TRUE(writer.full());
+    const int64_t data_size = writer.offset_;
+    writer.close();
+
+    // 写满关闭后，文件的最后是索引，没有预分配的空间
+    const int64_t file_size = static_cast<int64_t>(filesystem::file_size(log_file));
+    ASSERT_GT(file_size, data_size);
+
+    LogFileReader reader;
+    ASSERT_EQ(RC::SUCCESS, reader.open(log_file));
+    ASSERT_EQ(data_size, reader.data_end_);
+    if (compression == LogCompression::NONE) {
+      ASSERT_GT(reader.index_.size(), 2);
+    }
+
+    auto check = [&](LogFileReader &reader) {
+      for (LSN start_lsn : {LSN(0), LSN(1), LSN(2), LSN(100), LSN(500), LSN(777), end_lsn - 1, end_lsn, end_lsn + 1}) {
+        LSN expected_lsn = max(start_lsn, LSN(1));
+        ASSERT_EQ(RC::SUCCESS, reader.iterate([&](LogEntry &entry) {
+          EXPECT_EQ(expected_lsn, entry.lsn());
+          EXPECT_EQ(make_data(expected_lsn), vector<char>(entry.payload().begin(), entry.payload().end()));
+          expected_lsn++;
+          return RC::SUCCESS;
+        }, start_lsn));
+        ASSERT_EQ(max(end_lsn + 1, start_lsn), expected_lsn) << "start lsn " << start_lsn;
+      }
+    };
+    check(reader);
+    reader.close();
+
+    // 重新打开写满的文件，不会再扩展文件
+    ASSERT_EQ(RC::SUCCESS, writer.open(log_file, end_lsn, 64 * 1024));
+    ASSERT_TRUE(writer.full());
+    ASSERT_EQ(data_size, writer.offset_);
+    writer.close();
+    ASSERT_EQ(file_size, static_cast<int64_t>(filesystem::file_size(log_file)));
+
+    // 尾部损坏时没有索引，从头扫描
+    filesystem::resize_file(log_file, file_size - 1);
+    ASSERT_EQ(RC::SUCCESS, reader.open(log_file));
+    ASSERT_TRUE(reader.index_.empty());
+    check(reader);
+    reader.close();
+  }
+
+  filesystem::remove(log_file);
+}
+
 TEST(LogFileManager, get_lsn_from_filename)
 {
   const char *file_prefix = LogFileManager::file_prefix_;
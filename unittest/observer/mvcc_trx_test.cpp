@@ -0,0 +1,625 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <filesystem>
+
+#include "gtest/gtest.h"
+#include "common/conf/ini.h"
+#include "common/ini_setting.h"
+#define private public
+#include "storage/table/table.h"
+#undef private
+#include "storage/db/db.h"
+#include "storage/field/field.h"
+#include "storage/index/index.h"
+#include "storage/record/record_manager.h"
+#include "storage/trx/mvcc_trx.h"
+#include "common/log/log.h"
+#include "sql/operator/index_only_scan_physical_operator.h"
+
+using namespace std;
+using namespace common;
+
+namespace {
+
+int scan_count(Table *table, Trx *trx)
+{
+  RecordFileScanner scanner;
+  EXPECT_EQ(RC::SUCCESS, table->get_record_scanner(scanner, trx, ReadWriteMode::READ_ONLY));
+  int    count = 0;
+  Record record;
+  while (OB_SUCC(scanner.next(record))) {
+    count++;
+  }
+  return count;
+}
+
+int index_count(Index *index)
+{
+  IndexScanner *scanner = index->create_scanner(nullptr, 0, true, nullptr, 0, true);
+  EXPECT_NE(nullptr, scanner);
+  int count = 0;
+  RID rid;
+  while (OB_SUCC(scanner->next_entry(&rid))) {
+    count++;
+  }
+  scanner->destroy();
+  return count;
+}
+
+/// @brief 使用覆盖索引扫描整个索引，检查INCLUDE字段的值，返回扫描到的记录数
+int index_only_scan_count(Table *table, Index *index, Trx *trx, int64_t &heap_fetch_count)
+{
+  IndexOnlyScanPhysicalOperator oper(table, index, {}, true, {}, true);
+  EXPECT_EQ(RC::SUCCESS, oper.open(trx));
+  int count = 0;
+  while (OB_SUCC(oper.next())) {
+    Tuple *tuple = oper.current_tuple();
+    Value  key;
+    Value  include;
+    EXPECT_EQ(RC::SUCCESS, tuple->find_cell(TupleCellSpec(table->name(), "field_0"), key));
+    EXPECT_EQ(RC::SUCCESS, tuple->find_cell(TupleCellSpec(table->name(), "field_1"), include));
+    EXPECT_EQ(key.get_int() * 10, include.get_int());
+    count++;
+  }
+  heap_fetch_count = oper.heap_fetch_count();
+  EXPECT_EQ(RC::SUCCESS, oper.close());
+  return count;
+}
+
+}  // namespace
+
+TEST(MvccTrx, purge)
+{
+  /*
+  插入一批数据后删除其中的一半。
+  删除之前开始的事务还在时，这些记录不能清理；这个事务结束后，清理掉这些记录和它们的索引项，
+  之后插入的记录会复用这些空间。
+  */
+  filesystem::path test_directory("mvcc_trx_test");
+  filesystem::remove_all(test_directory);
+  filesystem::create_directories(test_directory);
+
+  auto db = make_unique<Db>();
+  ASSERT_EQ(RC::SUCCESS, db->init("test_db", test_directory.c_str(), "mvcc", "disk"));
+
+  vector<AttrInfoSqlNode> attr_infos(4);
+  for (size_t i = 0; i < attr_infos.size(); i++) {
+    attr_infos[i].name   = "field_" + to_string(i);
+    attr_infos[i].type   = AttrType::INTS;
+    attr_infos[i].length = 4;
+  }
+  ASSERT_EQ(RC::SUCCESS, db->create_table("t", attr_infos));
+  Table *table = db->find_table("t");
+  ASSERT_NE(nullptr, table);
+
+  TrxKit &trx_kit = db->trx_kit();
+
+  const int   record_num = 2000;
+  vector<RID> rids;
+  Trx        *trx = trx_kit.create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, trx->start_if_need());
+  for (int i = 0; i < record_num; i++) {
+    vector<Value> values(attr_infos.size(), Value(i));
+    Record        record;
+    ASSERT_EQ(RC::SUCCESS, table->make_record(values.size(), values.data(), record));
+    ASSERT_EQ(RC::SUCCESS, trx->insert_record(table, record));
+    rids.push_back(record.rid());
+  }
+  ASSERT_EQ(RC::SUCCESS, trx->commit());
+  trx_kit.destroy_trx(trx);
+
+  trx = trx_kit.create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, trx->start_if_need());
+  const FieldMeta *field_meta = table->table_meta().field("field_0");
+  ASSERT_EQ(RC::SUCCESS, table->create_index(trx, {field_meta}, "t_field_0"));
+  ASSERT_EQ(RC::SUCCESS, trx->commit());
+  trx_kit.destroy_trx(trx);
+  Index *index = table->find_index("t_field_0");
+  ASSERT_NE(nullptr, index);
+
+  Trx *reader = trx_kit.create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, reader->start_if_need());
+
+  trx = trx_kit.create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, trx->start_if_need());
+  for (int i = 0; i < record_num; i += 2) {
+    Record record;
+    record.set_rid(rids[i]);
+    ASSERT_EQ(RC::SUCCESS, trx->delete_record(table, record));
+  }
+  ASSERT_EQ(RC::SUCCESS, trx->commit());
+  trx_kit.destroy_trx(trx);
+
+  // 删除之前开始的事务还能看到这些记录
+  ASSERT_EQ(RC::SUCCESS, db->purge());
+  ASSERT_EQ(0, db->purged_records());
+  ASSERT_EQ(record_num, scan_count(table, reader));
+  ASSERT_EQ(record_num, index_count(index));
+
+  ASSERT_EQ(RC::SUCCESS, reader->commit());
+  trx_kit.destroy_trx(reader);
+
+  // 每次只清理一个页面，最终也能清理完
+  const PageNum page_count = table->data_buffer_pool()->page_count();
+  for (int i = 0; i < page_count; i++) {
+    ASSERT_EQ(RC::SUCCESS, db->purge(1));
+  }
+  ASSERT_EQ(record_num / 2, db->purged_records());
+  ASSERT_EQ(record_num / 2, scan_count(table, nullptr));
+  ASSERT_EQ(record_num / 2, index_count(index));
+
+  ASSERT_EQ(RC::SUCCESS, db->purge());
+  ASSERT_EQ(record_num / 2, db->purged_records());
+
+  // 清理出来的空间会被新插入的记录使用
+  trx = trx_kit.create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, trx->start_if_need());
+  for (int i = 0; i < record_num / 2; i++) {
+    vector<Value> values(attr_infos.size(), Value(record_num + i));
+    Record        record;
+    ASSERT_EQ(RC::SUCCESS, table->make_record(values.size(), values.data(), record));
+    ASSERT_EQ(RC::SUCCESS, trx->insert_record(table, record));
+  }
+  ASSERT_EQ(record_num, scan_count(table, trx));
+  ASSERT_EQ(RC::SUCCESS, trx->commit());
+  trx_kit.destroy_trx(trx);
+  ASSERT_EQ(page_count, table->data_buffer_pool()->page_count());
+  ASSERT_EQ(record_num, index_count(index));
+
+  db.reset();
+  filesystem::remove_all(test_directory);
+}
+
+TEST(MvccTrx, visibility_map)
+{
+  /*
+  清理旧版本时，记录都对所有事务可见的页面会被标记出来，覆盖索引扫描这些页面上的记录时不需要读取记录。
+  修改了页面上的记录之后标记被清除，下一次清理时重新标记。
+  */
+  filesystem::path test_directory("mvcc_trx_test");
+  filesystem::remove_all(test_directory);
+  filesystem::create_directories(test_directory);
+
+  auto db = make_unique<Db>();
+  ASSERT_EQ(RC::SUCCESS, db->init("test_db", test_directory.c_str(), "mvcc", "disk"));
+
+  vector<AttrInfoSqlNode> attr_infos(4);
+  for (size_t i = 0; i < attr_infos.size(); i++) {
+    attr_infos[i].name   = "field_" + to_string(i);
+    attr_infos[i].type   = AttrType::INTS;
+    attr_infos[i].length = 4;
+  }
+  ASSERT_EQ(RC::SUCCESS, db->create_table("t", attr_infos));
+  Table *table = db->find_table("t");
+  ASSERT_NE(nullptr, table);
+  RecordFileHandler *record_handler = table->record_handler();
+
+  TrxKit &trx_kit = db->trx_kit();
+
+  const int   record_num = 1000;
+  vector<RID> rids;
+  Trx        *trx = trx_kit.create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, trx->start_if_need());
+  for (int i = 0; i < record_num; i++) {
+    vector<Value> values{Value(i), Value(i * 10), Value(i * 100), Value(i * 1000)};
+    Record        record;
+    ASSERT_EQ(RC::SUCCESS, table->make_record(values.size(), values.data(), record));
+    ASSERT_EQ(RC::SUCCESS, trx->insert_record(table, record));
+    rids.push_back(record.rid());
+  }
+  ASSERT_EQ(RC::SUCCESS, trx->commit());
+  trx_kit.destroy_trx(trx);
+  ASSERT_NE(rids.front().page_num, rids.back().page_num);
+
+  // 索引 (field_0) include (field_1)
+  trx = trx_kit.create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, trx->start_if_need());
+  const TableMeta &table_meta = table->table_meta();
+  ASSERT_EQ(RC::SUCCESS, table->create_index(trx, {table_meta.field("field_0")}, "t_field_0", {table_meta.field("field_1")}));
+  ASSERT_EQ(RC::SUCCESS, trx->commit());
+  trx_kit.destroy_trx(trx);
+  Index *index = table->find_index("t_field_0");
+  ASSERT_NE(nullptr, index);
+  ASSERT_EQ(1, index->include_field_metas().size());
+
+  // 还没有清理过，需要读取每一条记录判断可见性
+  int64_t heap_fetch_count = 0;
+  Trx    *reader           = trx_kit.create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, reader->start_if_need());
+  ASSERT_FALSE(record_handler->all_visible(rids.front().page_num));
+  ASSERT_EQ(record_num, index_only_scan_count(table, index, reader, heap_fetch_count));
+  ASSERT_EQ(record_num, heap_fetch_count);
+  ASSERT_EQ(RC::SUCCESS, reader->commit());
+  trx_kit.destroy_trx(reader);
+
+  // 清理之后所有的页面都标记为可见，扫描时不再读取记录
+  ASSERT_EQ(RC::SUCCESS, db->purge());
+  for (const RID &rid : rids) {
+    ASSERT_TRUE(record_handler->all_visible(rid.page_num));
+  }
+  reader = trx_kit.create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, reader->start_if_need());
+  ASSERT_EQ(record_num, index_only_scan_count(table, index, reader, heap_fetch_count));
+  ASSERT_EQ(0, heap_fetch_count);
+
+  // 删除第一个页面上的一条记录，这个页面的标记被清除，其它页面不受影响
+  trx = trx_kit.create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, trx->start_if_need());
+  Record record;
+  record.set_rid(rids.front());
+  ASSERT_EQ(RC::SUCCESS, trx->delete_record(table, record));
+  ASSERT_FALSE(record_handler->all_visible(rids.front().page_num));
+  ASSERT_TRUE(record_handler->all_visible(rids.back().page_num));
+
+  // 删除还没有提交，其它事务仍然能看到这条记录，删除的事务自己看不到
+  ASSERT_EQ(record_num, index_only_scan_count(table, index, reader, heap_fetch_count));
+  ASSERT_GT(heap_fetch_count, 0);
+  ASSERT_LT(heap_fetch_count, record_num);
+  ASSERT_EQ(record_num - 1, index_only_scan_count(table, index, trx, heap_fetch_count));
+  ASSERT_EQ(RC::SUCCESS, trx->commit());
+  trx_kit.destroy_trx(trx);
+
+  // 删除之前开始的事务还在，页面不能标记为可见
+  ASSERT_EQ(RC::SUCCESS, db->purge());
+  ASSERT_FALSE(record_handler->all_visible(rids.front().page_num));
+  ASSERT_EQ(record_num, index_only_scan_count(table, index, reader, heap_fetch_count));
+  ASSERT_EQ(RC::SUCCESS, reader->commit());
+  trx_kit.destroy_trx(reader);
+
+  // 清理掉删除的记录之后再清理一次，页面重新标记为可见
+  ASSERT_EQ(RC::SUCCESS, db->purge());
+  ASSERT_EQ(1, db->purged_records());
+  ASSERT_EQ(RC::SUCCESS, db->purge());
+  ASSERT_TRUE(record_handler->all_visible(rids.front().page_num));
+
+  // 新插入的记录所在的页面也会清除标记
+  trx = trx_kit.create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, trx->start_if_need());
+  vector<Value> values{Value(record_num), Value(record_num * 10), Value(0), Value(0)};
+  ASSERT_EQ(RC::SUCCESS, table->make_record(values.size(), values.data(), record));
+  ASSERT_EQ(RC::SUCCESS, trx->insert_record(table, record));
+  ASSERT_FALSE(record_handler->all_visible(record.rid().page_num));
+  ASSERT_EQ(record_num, index_only_scan_count(table, index, trx, heap_fetch_count));
+  ASSERT_EQ(RC::SUCCESS, trx->commit());
+  trx_kit.destroy_trx(trx);
+
+  db.reset();
+  filesystem::remove_all(test_directory);
+}
+
+TEST(MvccTrx, read_view)
+{
+  // 正在提交的 commit xid 即使比快照的事务号小也不可见
+  MvccReadView read_view(10, {4, 7});
+  ASSERT_TRUE(read_view.is_visible(3));
+  ASSERT_FALSE(read_view.is_visible(4));
+  ASSERT_TRUE(read_view.is_visible(5));
+  ASSERT_FALSE(read_view.is_visible(7));
+  ASSERT_TRUE(read_view.is_visible(10));
+  ASSERT_FALSE(read_view.is_visible(11));
+  ASSERT_EQ(4, read_view.low_limit());
+  ASSERT_EQ(10, MvccReadView(10, {}).low_limit());
+}
+
+TEST(MvccTrx, snapshot)
+{
+  /*
+  读事务开始之后，其它事务插入和删除的数据对它都不可见，也不能再修改其它事务已经删除的数据。
+  提交过程中的事务修改的数据，对新开始的事务不可见。
+  */
+  filesystem::path test_directory("mvcc_trx_snapshot_test");
+  filesystem::remove_all(test_directory);
+  filesystem::create_directories(test_directory);
+
+  auto db = make_unique<Db>();
+  ASSERT_EQ(RC::SUCCESS, db->init("test_db", test_directory.c_str(), "mvcc", "disk"));
+
+  vector<AttrInfoSqlNode> attr_infos(2);
+  for (size_t i = 0; i < attr_infos.size(); i++) {
+    attr_infos[i].name   = "field_" + to_string(i);
+    attr_infos[i].type   = AttrType::INTS;
+    attr_infos[i].length = 4;
+  }
+  ASSERT_EQ(RC::SUCCESS, db->create_table("t", attr_infos));
+  Table *table = db->find_table("t");
+  ASSERT_NE(nullptr, table);
+
+  auto  &trx_kit = static_cast<MvccTrxKit &>(db->trx_kit());
+  auto   insert  = [&](Trx *trx, int value, RID &rid) {
+    vector<Value> values(attr_infos.size(), Value(value));
+    Record        record;
+    ASSERT_EQ(RC::SUCCESS, table->make_record(values.size(), values.data(), record));
+    ASSERT_EQ(RC::SUCCESS, trx->insert_record(table, record));
+    rid = record.rid();
+  };
+
+  const int   record_num = 10;
+  vector<RID> rids(record_num);
+  Trx        *trx = trx_kit.create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, trx->start_if_need());
+  for (int i = 0; i < record_num; i++) {
+    insert(trx, i, rids[i]);
+  }
+  ASSERT_EQ(RC::SUCCESS, trx->commit());
+  trx_kit.destroy_trx(trx);
+
+  Trx *reader = trx_kit.create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, reader->start_if_need());
+  ASSERT_EQ(reader, trx_kit.find_trx(reader->id()));
+
+  Trx *writer = trx_kit.create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, writer->start_if_need());
+  RID new_rid;
+  insert(writer, record_num, new_rid);
+  Record record;
+  record.set_rid(rids[0]);
+  ASSERT_EQ(RC::SUCCESS, writer->delete_record(table, record));
+  ASSERT_EQ(RC::SUCCESS, writer->commit());
+  ASSERT_EQ(nullptr, trx_kit.find_trx(writer->id()));
+  trx_kit.destroy_trx(writer);
+
+  ASSERT_EQ(record_num, scan_count(table, reader));
+  record.set_rid(rids[0]);
+  ASSERT_EQ(RC::LOCKED_CONCURRENCY_CONFLICT, reader->delete_record(table, record));
+  ASSERT_EQ(RC::SUCCESS, reader->commit());
+  trx_kit.destroy_trx(reader);
+
+  // 模拟一个正在提交的事务：commit xid 已经分配，但是还没有结束
+  const int32_t commit_xid = trx_kit.begin_commit();
+  trx                      = trx_kit.create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, trx->start_if_need());
+  ASSERT_GT(trx->id(), commit_xid);
+  ASSERT_FALSE(static_cast<MvccTrx *>(trx)->read_view().is_visible(commit_xid));
+  ASSERT_EQ(commit_xid, trx_kit.oldest_active_trx_id());
+  ASSERT_EQ(record_num, scan_count(table, trx));
+  // 提交结束之后，快照中还有这个 commit xid 的事务结束之前，也不能清理它删除的数据
+  trx_kit.end_trx(0, commit_xid);
+  ASSERT_EQ(commit_xid, trx_kit.oldest_active_trx_id());
+  ASSERT_EQ(RC::SUCCESS, trx->commit());
+  trx_kit.destroy_trx(trx);
+  ASSERT_GT(trx_kit.oldest_active_trx_id(), commit_xid);
+
+  db.reset();
+  filesystem::remove_all(test_directory);
+}
+
+TEST(MvccTrx, commit_table)
+{
+  /*
+  提交时只记录提交表，不修改记录。其它事务通过提交表判断可见性，回写之后结果不变。
+  回写之前开始的事务结束后，才会从提交表中删除。
+  */
+  filesystem::path test_directory("mvcc_trx_commit_table_test");
+  filesystem::remove_all(test_directory);
+  filesystem::create_directories(test_directory);
+
+  auto db = make_unique<Db>();
+  ASSERT_EQ(RC::SUCCESS, db->init("test_db", test_directory.c_str(), "mvcc", "disk"));
+
+  vector<AttrInfoSqlNode> attr_infos(2);
+  for (size_t i = 0; i < attr_infos.size(); i++) {
+    attr_infos[i].name   = "field_" + to_string(i);
+    attr_infos[i].type   = AttrType::INTS;
+    attr_infos[i].length = 4;
+  }
+  ASSERT_EQ(RC::SUCCESS, db->create_table("t", attr_infos));
+  Table *table = db->find_table("t");
+  ASSERT_NE(nullptr, table);
+
+  auto &trx_kit         = static_cast<MvccTrxKit &>(db->trx_kit());
+  Field begin_xid_field = Field(table, &table->table_meta().trx_fields()[0]);
+  auto  begin_xid_of    = [&](const RID &rid) {
+    Record record;
+    EXPECT_EQ(RC::SUCCESS, table->get_record(rid, record));
+    return begin_xid_field.get_int(record);
+  };
+
+  Trx *reader = trx_kit.create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, reader->start_if_need());
+
+  const int   record_num = 10;
+  vector<RID> rids;
+  Trx        *writer = trx_kit.create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, writer->start_if_need());
+  for (int i = 0; i < record_num; i++) {
+    vector<Value> values(attr_infos.size(), Value(i));
+    Record        record;
+    ASSERT_EQ(RC::SUCCESS, table->make_record(values.size(), values.data(), record));
+    ASSERT_EQ(RC::SUCCESS, writer->insert_record(table, record));
+    rids.push_back(record.rid());
+  }
+  const int32_t writer_id = writer->id();
+  ASSERT_EQ(RC::SUCCESS, writer->commit());
+  trx_kit.destroy_trx(writer);
+
+  // 记录上还是负的事务号，新的事务通过提交表看到这些记录
+  const int32_t commit_xid = trx_kit.commit_xid(writer_id);
+  ASSERT_GT(commit_xid, writer_id);
+  ASSERT_EQ(-writer_id, begin_xid_of(rids[0]));
+
+  Trx *trx = trx_kit.create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, trx->start_if_need());
+  ASSERT_EQ(record_num, scan_count(table, trx));
+  ASSERT_EQ(0, scan_count(table, reader));
+
+  // 回写之后可见性不变，但是 reader 可能还拿着回写之前的记录，提交表中的记录要保留
+  ASSERT_EQ(RC::SUCCESS, trx_kit.cleanup());
+  for (const RID &rid : rids) {
+    ASSERT_EQ(commit_xid, begin_xid_of(rid));
+  }
+  ASSERT_EQ(record_num, scan_count(table, trx));
+  ASSERT_EQ(0, scan_count(table, reader));
+  ASSERT_EQ(commit_xid, trx_kit.commit_xid(writer_id));
+
+  ASSERT_EQ(RC::SUCCESS, reader->commit());
+  trx_kit.destroy_trx(reader);
+  ASSERT_EQ(RC::SUCCESS, trx->commit());
+  trx_kit.destroy_trx(trx);
+  ASSERT_EQ(RC::SUCCESS, trx_kit.cleanup());
+  ASSERT_EQ(0, trx_kit.commit_xid(writer_id));
+
+  db.reset();
+  filesystem::remove_all(test_directory);
+}
+
+TEST(MvccTrx, row_lock)
+{
+  /*
+  删除其它事务正在删除的记录时，等待那个事务结束：它回滚了就可以删除，提交了就是冲突。
+  这里只有一个线程，等锁会超时。
+  */
+  filesystem::path test_directory("mvcc_trx_row_lock_test");
+  filesystem::remove_all(test_directory);
+  filesystem::create_directories(test_directory);
+
+  get_properties()->put(LOCK_WAIT_TIMEOUT_MS, "100", STORAGE);
+  auto db = make_unique<Db>();
+  ASSERT_EQ(RC::SUCCESS, db->init("test_db", test_directory.c_str(), "mvcc", "disk"));
+  get_properties()->put(LOCK_WAIT_TIMEOUT_MS, LOCK_WAIT_TIMEOUT_MS_DEFAULT, STORAGE);
+
+  vector<AttrInfoSqlNode> attr_infos(2);
+  for (size_t i = 0; i < attr_infos.size(); i++) {
+    attr_infos[i].name   = "field_" + to_string(i);
+    attr_infos[i].type   = AttrType::INTS;
+    attr_infos[i].length = 4;
+  }
+  ASSERT_EQ(RC::SUCCESS, db->create_table("t", attr_infos));
+  Table *table = db->find_table("t");
+  ASSERT_NE(nullptr, table);
+
+  auto &trx_kit = static_cast<MvccTrxKit &>(db->trx_kit());
+
+  Trx          *trx = trx_kit.create_trx(db->log_handler());
+  vector<Value> values(attr_infos.size(), Value(1));
+  Record        record;
+  ASSERT_EQ(RC::SUCCESS, trx->start_if_need());
+  ASSERT_EQ(RC::SUCCESS, table->make_record(values.size(), values.data(), record));
+  ASSERT_EQ(RC::SUCCESS, trx->insert_record(table, record));
+  const RID rid = record.rid();
+  ASSERT_EQ(RC::SUCCESS, trx->commit());
+  trx_kit.destroy_trx(trx);
+
+  Trx *trx1 = trx_kit.create_trx(db->log_handler());
+  Trx *trx2 = trx_kit.create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, trx1->start_if_need());
+  ASSERT_EQ(RC::SUCCESS, trx2->start_if_need());
+
+  record.set_rid(rid);
+  ASSERT_EQ(RC::SUCCESS, trx1->delete_record(table, record));
+  ASSERT_EQ(1, trx_kit.lock_manager().lock_count());
+  // 读写模式扫描时还能看到这条记录，删除时才等锁
+  ASSERT_EQ(RC::SUCCESS, trx2->visit_record(table, record, ReadWriteMode::READ_WRITE));
+  ASSERT_EQ(RC::LOCKED_CONCURRENCY_CONFLICT, trx2->delete_record(table, record));
+
+  // 回滚之后释放锁，可以删除
+  ASSERT_EQ(RC::SUCCESS, trx1->rollback());
+  trx_kit.destroy_trx(trx1);
+  ASSERT_EQ(0, trx_kit.lock_manager().lock_count());
+  ASSERT_EQ(RC::SUCCESS, trx2->delete_record(table, record));
+
+  // 提交之后，快照在提交之前的事务拿到锁也不能再删除
+  Trx *trx3 = trx_kit.create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, trx3->start_if_need());
+  ASSERT_EQ(RC::SUCCESS, trx2->commit());
+  trx_kit.destroy_trx(trx2);
+  ASSERT_EQ(0, trx_kit.lock_manager().lock_count());
+  ASSERT_EQ(RC::LOCKED_CONCURRENCY_CONFLICT, trx3->delete_record(table, record));
+  ASSERT_EQ(RC::SUCCESS, trx3->rollback());
+  trx_kit.destroy_trx(trx3);
+  ASSERT_EQ(0, trx_kit.lock_manager().lock_count());
+
+  db.reset();
+  filesystem::remove_all(test_directory);
+}
+
+TEST(MvccTrx, recover)
+{
+  /*
+  日志落盘之后把数据库目录复制一份，模拟宕机重启。
+  没有提交的事务在恢复之后回滚，并且不能一直留在活跃事务表中，否则清理线程永远不能清理旧版本记录。
+  */
+  filesystem::path test_directory("mvcc_trx_recover_test");
+  filesystem::remove_all(test_directory);
+  filesystem::path db_path  = test_directory / "test_db";
+  filesystem::path db_path2 = test_directory / "test_db2";
+  filesystem::create_directories(db_path);
+
+  auto db = make_unique<Db>();
+  ASSERT_EQ(RC::SUCCESS, db->init("test_db", db_path.c_str(), "mvcc", "disk"));
+
+  vector<AttrInfoSqlNode> attr_infos(2);
+  for (size_t i = 0; i < attr_infos.size(); i++) {
+    attr_infos[i].name   = "field_" + to_string(i);
+    attr_infos[i].type   = AttrType::INTS;
+    attr_infos[i].length = 4;
+  }
+  ASSERT_EQ(RC::SUCCESS, db->create_table("t", attr_infos));
+  ASSERT_EQ(RC::SUCCESS, db->sync());
+  Table *table = db->find_table("t");
+  ASSERT_NE(nullptr, table);
+
+  TrxKit &trx_kit = db->trx_kit();
+  auto    insert  = [&](Trx *trx, int value) {
+    vector<Value> values(attr_infos.size(), Value(value));
+    Record        record;
+    ASSERT_EQ(RC::SUCCESS, table->make_record(values.size(), values.data(), record));
+    ASSERT_EQ(RC::SUCCESS, trx->insert_record(table, record));
+  };
+
+  const int record_num = 10;
+  Trx      *trx        = trx_kit.create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, trx->start_if_need());
+  for (int i = 0; i < record_num; i++) {
+    insert(trx, i);
+  }
+  ASSERT_EQ(RC::SUCCESS, trx->commit());
+  trx_kit.destroy_trx(trx);
+
+  Trx *uncommitted = trx_kit.create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, uncommitted->start_if_need());
+  for (int i = 0; i < record_num; i++) {
+    insert(uncommitted, record_num + i);
+  }
+
+  LogHandler &log_handler = db->log_handler();
+  ASSERT_EQ(RC::SUCCESS, log_handler.wait_lsn(log_handler.current_lsn()));
+  filesystem::copy(db_path, db_path2, filesystem::copy_options::recursive);
+
+  auto db2 = make_unique<Db>();
+  ASSERT_EQ(RC::SUCCESS, db2->init("test_db2", db_path2.c_str(), "mvcc", "disk"));
+  Table *table2 = db2->find_table("t");
+  ASSERT_NE(nullptr, table2);
+  ASSERT_EQ(record_num, scan_count(table2, nullptr));
+
+  // 提交的事务在恢复之后对新的事务可见
+  auto &trx_kit2 = static_cast<MvccTrxKit &>(db2->trx_kit());
+  trx            = trx_kit2.create_trx(db2->log_handler());
+  ASSERT_EQ(RC::SUCCESS, trx->start_if_need());
+  ASSERT_EQ(record_num, scan_count(table2, trx));
+  ASSERT_EQ(RC::SUCCESS, trx->commit());
+  trx_kit2.destroy_trx(trx);
+  ASSERT_EQ(nullptr, trx_kit2.find_trx(uncommitted->id()));
+  ASSERT_GT(trx_kit2.oldest_active_trx_id(), uncommitted->id());
+
+  db2.reset();
+  ASSERT_EQ(RC::SUCCESS, uncommitted->rollback());
+  trx_kit.destroy_trx(uncommitted);
+  db.reset();
+  filesystem::remove_all(test_directory);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  filesystem::path log_filename = filesystem::path(argv[0]).filename();
+  LoggerFactory::init_default(log_filename.string() + ".log", LOG_LEVEL_INFO);
+  return RUN_ALL_TESTS();
+}
@@ -204,15 +204,16 @@ TEST(RecordFileScanner, test_record_file_iterator)
   delete bpm;
 }
 
-TEST(RecordManager, durability)
+/*
+ * 测试场景：
+ * 1. 创建一个文件，插入一些记录
+ * 2. 随机进行插入、更新、删除操作
+ * 3. 重启数据库，使用 recovery_threads 个线程回放日志，检查记录是否恢复
+ */
+static void test_durability(
+    const char *directory_name, int recovery_threads, LogCompression compression = LogCompression::NONE)
 {
-  /*
-   * 测试场景：
-   * 1. 创建一个文件，插入一些记录
-   * 2. 随机进行插入、更新、删除操作
-   * 3. 重启数据库，检查记录是否恢复
-   */
-  filesystem::path directory("record_manager_durability");
+  filesystem::path directory(directory_name);
   filesystem::remove_all(directory);
   ASSERT_TRUE(filesystem::create_directories(directory));
 
@@ -224,6 +225,7 @@ TEST(RecordManager, durability)
 
   DiskLogHandler        log_handler;
   IntegratedLogReplayer log_replayer(bpm);
+  log_handler.set_compression(compression);
   ASSERT_EQ(log_handler.init(directory.c_str()), RC::SUCCESS);
   ASSERT_EQ(log_handler.replay(log_replayer, 0), RC::SUCCESS);
   ASSERT_EQ(log_handler.start(), RC::SUCCESS);
@@ -327,6 +329,9 @@ TEST(RecordManager, durability)
   // 停掉log_handler
   ASSERT_EQ(log_handler.stop(), RC::SUCCESS);
   ASSERT_EQ(log_handler.await_termination(), RC::SUCCESS);
+  if (compression != LogCompression::NONE) {
+    ASSERT_LT(log_handler.written_bytes(), log_handler.raw_bytes());
+  }
 
   // 重新创建资源并尝试从日志中恢复数据，然后校验数据
   DiskLogHandler    log_handler2;
@@ -337,10 +342,11 @@ TEST(RecordManager, durability)
   ASSERT_EQ(bpm2.open_file(log_handler2, record_manager_file.c_str(), buffer_pool2), RC::SUCCESS);
   ASSERT_NE(buffer_pool2, nullptr);
 
-  IntegratedLogReplayer log_replayer2(bpm2);
+  IntegratedLogReplayer log_replayer2(bpm2, nullptr /*trx_log_replayer*/, recovery_threads);
   ASSERT_EQ(log_handler2.init(directory.c_str()), RC::SUCCESS);
   ASSERT_EQ(log_handler2.replay(log_replayer2, 0), RC::SUCCESS);
   ASSERT_EQ(log_handler2.start(), RC::SUCCESS);
+  ASSERT_EQ(log_replayer2.on_done(), RC::SUCCESS);
 
   RecordFileHandler record_file_handler2(StorageFormat::ROW_FORMAT);
   ASSERT_EQ(record_file_handler2.init(*buffer_pool2, log_handler2, nullptr), RC::SUCCESS);
@@ -355,6 +361,15 @@ TEST(RecordManager, durability)
   bpm2.close_file(record_manager_file.c_str());
 }
 
+TEST(RecordManager, durability) { test_durability("record_manager_durability", 1); }
+
+TEST(RecordManager, parallel_recovery) { test_durability("record_manager_parallel_recovery", 4); }
+
+TEST(RecordManager, compressed_log)
+{
+  test_durability("record_manager_compressed_log", 1, LogCompression::BUILTIN);
+}
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,129 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <filesystem>
+
+#include "gtest/gtest.h"
+#include "common/lang/atomic.h"
+#include "common/lang/chrono.h"
+#include "common/lang/thread.h"
+#include "common/log/log.h"
+#include "storage/trx/row_lock_manager.h"
+
+using namespace std;
+using namespace common;
+
+TEST(RowLockManager, lock_unlock)
+{
+  RowLockManager lock_manager;
+  lock_manager.init(100 /*wait_timeout_ms*/);
+
+  RowLockKey key1{1, RID(1, 1)};
+  RowLockKey key2{1, RID(1, 2)};
+  RowLockKey key3{2, RID(1, 1)};
+
+  bool acquired = false;
+  ASSERT_EQ(RC::SUCCESS, lock_manager.lock(1, key1, acquired));
+  ASSERT_TRUE(acquired);
+  // 重复加锁
+  ASSERT_EQ(RC::SUCCESS, lock_manager.lock(1, key1, acquired));
+  ASSERT_FALSE(acquired);
+
+  // 不同的记录互不影响
+  ASSERT_EQ(RC::SUCCESS, lock_manager.lock(2, key2, acquired));
+  ASSERT_TRUE(acquired);
+  ASSERT_EQ(RC::SUCCESS, lock_manager.lock(2, key3, acquired));
+  ASSERT_TRUE(acquired);
+  ASSERT_EQ(3, lock_manager.lock_count());
+
+  // 其它事务持有的锁，等待超时
+  ASSERT_EQ(RC::LOCKED_CONCURRENCY_CONFLICT, lock_manager.lock(2, key1, acquired));
+  ASSERT_FALSE(acquired);
+
+  // 不是自己的锁不能释放
+  lock_manager.unlock(2, key1);
+  ASSERT_EQ(3, lock_manager.lock_count());
+
+  lock_manager.unlock(1, key1);
+  ASSERT_EQ(RC::SUCCESS, lock_manager.lock(2, key1, acquired));
+  ASSERT_TRUE(acquired);
+
+  lock_manager.unlock(2, key1);
+  lock_manager.unlock(2, key2);
+  lock_manager.unlock(2, key3);
+  ASSERT_EQ(0, lock_manager.lock_count());
+}
+
+#ifdef CONCURRENCY
+TEST(RowLockManager, wait)
+{
+  RowLockManager lock_manager;
+  lock_manager.init(10 * 1000 /*wait_timeout_ms*/);
+
+  RowLockKey key{1, RID(1, 1)};
+  bool       acquired = false;
+  ASSERT_EQ(RC::SUCCESS, lock_manager.lock(1, key, acquired));
+
+  atomic<bool> locked{false};
+  thread       waiter([&]() {
+    bool waiter_acquired = false;
+    EXPECT_EQ(RC::SUCCESS, lock_manager.lock(2, key, waiter_acquired));
+    EXPECT_TRUE(waiter_acquired);
+    locked = true;
+  });
+
+  this_thread::sleep_for(chrono::milliseconds(100));
+  ASSERT_FALSE(locked);
+
+  // 释放锁之后等待的事务拿到锁
+  lock_manager.unlock(1, key);
+  waiter.join();
+  ASSERT_TRUE(locked);
+  lock_manager.unlock(2, key);
+}
+
+TEST(RowLockManager, deadlock)
+{
+  RowLockManager lock_manager;
+  lock_manager.init(10 * 1000 /*wait_timeout_ms*/);
+
+  RowLockKey key1{1, RID(1, 1)};
+  RowLockKey key2{1, RID(1, 2)};
+  bool       acquired = false;
+  ASSERT_EQ(RC::SUCCESS, lock_manager.lock(1, key1, acquired));
+  ASSERT_EQ(RC::SUCCESS, lock_manager.lock(2, key2, acquired));
+
+  // 事务1等待事务2持有的锁
+  thread waiter([&]() {
+    bool waiter_acquired = false;
+    EXPECT_EQ(RC::SUCCESS, lock_manager.lock(1, key2, waiter_acquired));
+    lock_manager.unlock(1, key2);
+  });
+  this_thread::sleep_for(chrono::milliseconds(100));
+
+  // 事务2再等待事务1就会死锁，事务2放弃之后释放自己的锁，事务1就能拿到锁
+  auto begin = chrono::steady_clock::now();
+  ASSERT_EQ(RC::LOCKED_DEADLOCK, lock_manager.lock(2, key1, acquired));
+  ASSERT_LT(chrono::steady_clock::now() - begin, chrono::seconds(1));
+  lock_manager.unlock(2, key2);
+  waiter.join();
+
+  lock_manager.unlock(1, key1);
+  ASSERT_EQ(0, lock_manager.lock_count());
+}
+#endif  // CONCURRENCY
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  filesystem::path log_filename = filesystem::path(argv[0]).filename();
+  LoggerFactory::init_default(log_filename.string() + ".log", LOG_LEVEL_INFO);
+  return RUN_ALL_TESTS();
+}